@@ -122,6 +122,128 @@
 # define UAVCAN_TINY_PROTO 0
 #endif
 
+/**
+ * Capacity of the per-transfer-type data type ID index maintained by the dispatcher, in distinct data type IDs.
+ * The index turns per-frame listener lookup into a binary search instead of a linear walk over all listeners;
+ * it costs 2 pointers' worth of RAM per entry, so it is disabled by default on embedded targets.
+ * If the number of distinct data type IDs exceeds this value, the dispatcher falls back to the linear search.
+ * Set to zero to disable the index.
+ */
+#ifndef UAVCAN_DISPATCHER_LISTENER_INDEX_SIZE
+# if UAVCAN_GENERAL_PURPOSE_PLATFORM && !UAVCAN_TINY
+#  define UAVCAN_DISPATCHER_LISTENER_INDEX_SIZE 64
+# else
+#  define UAVCAN_DISPATCHER_LISTENER_INDEX_SIZE 0
+# endif
+#endif
+
+/**
+ * Size, in bits, of the bitmap of subscribed message data type IDs that the dispatcher checks against the raw CAN ID
+ * of every received frame before parsing it. Frames of data types nobody listens to, and service frames addressed
+ * to other nodes, are dropped without constructing an RxFrame. Must be a power of two not greater than 65536;
+ * smaller bitmaps hash the data type ID, so that some foreign frames pass through to the full check.
+ * Service data type IDs always use an exact 256-bit bitmap per transfer type. Set to zero to disable the filter.
+ */
+#ifndef UAVCAN_DISPATCHER_RX_PREFILTER_BITS
+# if UAVCAN_GENERAL_PURPOSE_PLATFORM && !UAVCAN_TINY
+#  define UAVCAN_DISPATCHER_RX_PREFILTER_BITS 65536
+# elif UAVCAN_TINY
+#  define UAVCAN_DISPATCHER_RX_PREFILTER_BITS 0
+# else
+#  define UAVCAN_DISPATCHER_RX_PREFILTER_BITS 256
+# endif
+#endif
+
+/**
+ * Maximum number of filter configurations that CanAcceptanceFilterConfigurator::MergeByVolume partitions into
+ * hardware filters with an exact search; larger inputs are first reduced to this size greedily. The search is
+ * exponential in this value in the worst case (it also gives up after a fixed number of steps, keeping the best
+ * partition found), so it is disabled by default on embedded targets. Set to zero to use only the greedy merge.
+ */
+#ifndef UAVCAN_CAN_ACCEPTANCE_FILTER_EXACT_MERGE_LIMIT
+# if UAVCAN_GENERAL_PURPOSE_PLATFORM && !UAVCAN_TINY
+#  define UAVCAN_CAN_ACCEPTANCE_FILTER_EXACT_MERGE_LIMIT 16
+# else
+#  define UAVCAN_CAN_ACCEPTANCE_FILTER_EXACT_MERGE_LIMIT 0
+# endif
+#endif
+
+/**
+ * Enables the slice-by-8 implementation of the transfer CRC functions, which processes 8 bytes per iteration
+ * instead of one. The lookup tables take about 32 kB of RAM and are computed on first use, so this is disabled
+ * by default on embedded targets.
+ */
+#ifndef UAVCAN_CRC_SLICE_BY_8
+# if UAVCAN_GENERAL_PURPOSE_PLATFORM && !UAVCAN_TINY
+#  define UAVCAN_CRC_SLICE_BY_8 1
+# else
+#  define UAVCAN_CRC_SLICE_BY_8 0
+# endif
+#endif
+
+/**
+ * Number of multi-frame transfer buffers that each transfer listener keeps in a contiguous arena, where any offset
+ * can be accessed in constant time. Buffers that don't fit into the arena fall back to chains of memory pool blocks.
+ * The arena takes this many times the maximum transfer size and is reserved with std::malloc() from the receiving
+ * path, on the first multi-frame transfer of the listener; this memory is not accounted by the pool allocator of
+ * the node. Therefore the arena is disabled by default; enable it only if the heap can be used at run time.
+ * Must not exceed 32.
+ */
+#ifndef UAVCAN_TRANSFER_BUFFER_ARENA_SLOTS
+# define UAVCAN_TRANSFER_BUFFER_ARENA_SLOTS 0
+#endif
+
+/**
+ * Number of slots of the outgoing transfer registry, which keeps the transfer ID of every local publisher and of
+ * every service client per server node. Must be a power of two. Up to 3/4 of the slots can be occupied; once the
+ * registry is full, new senders fail with -ErrMemory until the entries of inactive senders expire.
+ * Each slot takes 16 bytes of RAM in the dispatcher.
+ */
+#ifndef UAVCAN_OUTGOING_TRANSFER_REGISTRY_SLOTS
+# if UAVCAN_GENERAL_PURPOSE_PLATFORM && !UAVCAN_TINY
+#  define UAVCAN_OUTGOING_TRANSFER_REGISTRY_SLOTS 1024
+# elif UAVCAN_TINY
+#  define UAVCAN_OUTGOING_TRANSFER_REGISTRY_SLOTS 16
+# else
+#  define UAVCAN_OUTGOING_TRANSFER_REGISTRY_SLOTS 64
+# endif
+#endif
+
+/**
+ * Deadline scheduler implementation.
+ * The default is a sorted linked list, which costs nothing per handler but needs O(N) to start or stop one.
+ * The heap variant keeps the handlers in an intrusive pairing heap, so these operations are O(log N); it takes
+ * two extra pointers per handler, thus it is enabled by default only on general purpose platforms.
+ */
+#ifndef UAVCAN_DEADLINE_SCHEDULER_HEAP
+# if UAVCAN_GENERAL_PURPOSE_PLATFORM && !UAVCAN_TINY
+#  define UAVCAN_DEADLINE_SCHEDULER_HEAP 1
+# else
+#  define UAVCAN_DEADLINE_SCHEDULER_HEAP 0
+# endif
+#endif
+
+/**
+ * Per-priority TX queue statistics, see CanTxQueueStats.
+ * They take about 1.7 KB of RAM per interface, thus they are enabled by default only on general purpose platforms.
+ */
+#ifndef UAVCAN_TX_QUEUE_STATS
+# if UAVCAN_GENERAL_PURPOSE_PLATFORM && !UAVCAN_TINY
+#  define UAVCAN_TX_QUEUE_STATS 1
+# else
+#  define UAVCAN_TX_QUEUE_STATS 0
+# endif
+#endif
+
+/**
+ * CAN FD mode: CAN frames carry up to 64 data bytes, and transfers are split into frames of the lengths allowed
+ * by CAN FD. All nodes on the bus and the CAN driver must support CAN FD.
+ * This makes every CanFrame 56 bytes larger and requires larger memory pool blocks, so it is disabled by default.
+ */
+#ifndef UAVCAN_CAN_FD
+# define UAVCAN_CAN_FD 0
+#endif
+
 /**
  * Disable the global data type registry, which can save some space on embedded systems.
  */
@@ -225,6 +347,9 @@ namespace uavcan
 #ifdef UAVCAN_MEM_POOL_BLOCK_SIZE
 /// Explicitly specified by the user.
 static const unsigned MemPoolBlockSize = UAVCAN_MEM_POOL_BLOCK_SIZE;
+#elif UAVCAN_CAN_FD
+/// TX queue entries hold a whole CAN FD frame.
+static const unsigned MemPoolBlockSize = 128;
 #elif defined(__BIGGEST_ALIGNMENT__) && (__BIGGEST_ALIGNMENT__ <= 8)
 /// Convenient default for GCC-like compilers - if alignment allows, pool block size can be safely reduced.
 static const unsigned MemPoolBlockSize = 64;
@@ -278,6 +403,37 @@ static const unsigned MaxCanAcceptanceFilters = UAVCAN_MAX_CAN_ACCEPTANCE_FILTER
 static const unsigned MaxCanAcceptanceFilters = 32;
 #endif
 
+/**
+ * Maximum number of CAN frames fetched from the driver per select() call, see ICanIface::receiveBatch().
+ * The dispatcher keeps that many frames on the stack while spinning, so the default is 1 on embedded targets.
+ */
+#ifdef UAVCAN_CAN_RX_BATCH_SIZE
+/// Explicitly specified by the user.
+static const unsigned CanRxBatchSize = UAVCAN_CAN_RX_BATCH_SIZE;
+#elif UAVCAN_GENERAL_PURPOSE_PLATFORM
+static const unsigned CanRxBatchSize = 16;
+#else
+static const unsigned CanRxBatchSize = 1;
+#endif
+
+typedef char _check_for_CAN_RX_BATCH_SIZE[(CanRxBatchSize > 0) ? 1 : -1];
+
+/**
+ * Maximum number of CAN frames of a multi-frame transfer passed to the CAN IO layer at once, see
+ * CanIOManager::sendBatch(). The transfer sender keeps that many frames on the stack; longer transfers are sent
+ * in several batches.
+ */
+#ifdef UAVCAN_CAN_TX_BATCH_SIZE
+/// Explicitly specified by the user.
+static const unsigned CanTxBatchSize = UAVCAN_CAN_TX_BATCH_SIZE;
+#elif UAVCAN_GENERAL_PURPOSE_PLATFORM
+static const unsigned CanTxBatchSize = 64;
+#else
+static const unsigned CanTxBatchSize = 4;
+#endif
+
+typedef char _check_for_CAN_TX_BATCH_SIZE[(CanTxBatchSize > 0) ? 1 : -1];
+
 }
 
 #endif // UAVCAN_BUILD_CONFIG_HPP_INCLUDED
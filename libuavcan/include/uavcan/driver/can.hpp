@@ -29,11 +29,16 @@ struct UAVCAN_EXPORT CanFrame
     static const uint32_t FlagRTR = 1U << 30;                  ///< Remote transmission request
     static const uint32_t FlagERR = 1U << 29;                  ///< Error frame
 
-    static const uint8_t MaxDataLen = 8;
+    static const uint8_t MaxClassicDataLen = 8;
+#if UAVCAN_CAN_FD
+    static const uint8_t MaxDataLen = 64;
+#else
+    static const uint8_t MaxDataLen = MaxClassicDataLen;
+#endif
 
     uint32_t id;                ///< CAN ID with flags (above)
     uint8_t data[MaxDataLen];
-    uint8_t dlc;                ///< Data Length Code
+    uint8_t dlc;                ///< Data length in bytes; above 8 only in CAN FD mode, see isValidDataLen()
 
     CanFrame() :
         id(0),
@@ -70,6 +75,20 @@ struct UAVCAN_EXPORT CanFrame
     bool isExtended()                  const { return id & FlagEFF; }
     bool isRemoteTransmissionRequest() const { return id & FlagRTR; }
     bool isErrorFrame()                const { return id & FlagERR; }
+    bool isCanFd()                     const { return dlc > MaxClassicDataLen; }
+
+    /**
+     * Conversion between the Data Length Code as transmitted on the bus and the data length in bytes.
+     * CAN FD codes 9 to 15 stand for 12, 16, 20, 24, 32, 48 and 64 bytes. Lengths that have no code of their
+     * own are rounded up, which is how much data a driver has to put into the frame.
+     */
+    static uint8_t dlcToDataLen(uint8_t dlc);
+    static uint8_t dataLenToDlc(uint8_t data_len);
+
+    /**
+     * Whether a frame can carry exactly that many bytes, without padding.
+     */
+    static bool isValidDataLen(uint8_t data_len) { return dlcToDataLen(dataLenToDlc(data_len)) == data_len; }
 
 #if UAVCAN_TOSTRING
     enum StringRepresentation
@@ -121,9 +140,17 @@ struct UAVCAN_EXPORT CanSelectMasks
     uint8_t read;
     uint8_t write;
 
+    /**
+     * Set by the driver if select() returned because it was woken up from another thread or an interrupt,
+     * e.g. to let the application process some work; the library then returns from Node::spin() early.
+     * Drivers that don't support wakeups leave it cleared.
+     */
+    bool wakeup;
+
     CanSelectMasks() :
         read(0),
-        write(0)
+        write(0),
+        wakeup(false)
     { }
 };
 
@@ -141,6 +168,22 @@ typedef uint16_t CanIOFlags;
 static const CanIOFlags CanIOFlagLoopback = 1;
 static const CanIOFlags CanIOFlagAbortOnError = 2;
 
+/**
+ * One frame received with @ref ICanIface::receiveBatch().
+ * Fields have the same meaning as the output arguments of @ref ICanIface::receive().
+ */
+struct UAVCAN_EXPORT CanRxBatchItem
+{
+    CanFrame frame;
+    MonotonicTime ts_monotonic;
+    UtcTime ts_utc;
+    CanIOFlags flags;
+
+    CanRxBatchItem()
+        : flags(0)
+    { }
+};
+
 /**
  * Single non-blocking CAN interface.
  */
@@ -182,6 +225,39 @@ public:
     virtual int16_t receive(CanFrame& out_frame, MonotonicTime& out_ts_monotonic, UtcTime& out_ts_utc,
                             CanIOFlags& out_flags) = 0;
 
+    /**
+     * Non-blocking reception of up to max_items frames at once.
+     *
+     * The default implementation invokes receive() until the RX buffer is empty or the output array is full.
+     * Drivers that can fetch several frames per system call or per interrupt should override this method.
+     *
+     * @param [out] out_items   Array of at least max_items items.
+     * @param [in]  max_items   Capacity of the output array, must be positive.
+     * @return Number of frames received (0 = RX buffer empty), negative for error.
+     *         If an error occurs after some frames were received, these frames are returned and the error is
+     *         expected to be reported on the next call.
+     */
+    virtual int16_t receiveBatch(CanRxBatchItem* out_items, uint16_t max_items)
+    {
+        UAVCAN_ASSERT((out_items != UAVCAN_NULLPTR) && (max_items > 0));
+        int16_t num_received = 0;
+        while (uint16_t(num_received) < max_items)
+        {
+            CanRxBatchItem& item = out_items[num_received];
+            const int16_t res = receive(item.frame, item.ts_monotonic, item.ts_utc, item.flags);
+            if (res < 0)
+            {
+                return (num_received > 0) ? num_received : res;
+            }
+            if (res == 0)
+            {
+                break;
+            }
+            num_received++;
+        }
+        return num_received;
+    }
+
     /**
      * Configure the hardware CAN filters. @ref CanFilterConfig.
      *
@@ -427,6 +427,16 @@ class UAVCAN_EXPORT Array : public ArrayImpl<T, ArrayMode, MaxSize_>
     typedef ArrayImpl<T, ArrayMode, MaxSize_> Base;
     typedef Array<T, ArrayMode, MaxSize_> SelfType;
 
+    /**
+     * Arrays of 8-bit integers are encoded and decoded in bulk rather than element by element.
+     */
+    enum { IsByteArray = IsIntegerSpec<T>::Result && (T::MaxBitLen == 8) };
+    /**
+     * A tail array chunk must fit into one BitStream read, otherwise a chunk that runs past the end of the stream
+     * would be partially consumed. One byte is reserved for unaligned streams.
+     */
+    enum { TailChunkSize = BitStream::MaxBitsPerRW / 8 - 1 };
+
     static bool isOptimizedTailArray(TailArrayOptimizationMode tao_mode)
     {
         return (T::MinBitLen >= 8) && (tao_mode == TailArrayOptEnabled);
@@ -435,6 +445,11 @@ class UAVCAN_EXPORT Array : public ArrayImpl<T, ArrayMode, MaxSize_>
     int encodeImpl(ScalarCodec& codec, const TailArrayOptimizationMode tao_mode, FalseType) const  /// Static
     {
         UAVCAN_ASSERT(size() > 0);
+        return encodeElements(codec, tao_mode, BooleanType<IsByteArray>());
+    }
+
+    int encodeElements(ScalarCodec& codec, const TailArrayOptimizationMode tao_mode, FalseType) const
+    {
         for (SizeType i = 0; i < size(); i++)
         {
             const bool last_item = i == (size() - 1);
@@ -447,6 +462,11 @@ class UAVCAN_EXPORT Array : public ArrayImpl<T, ArrayMode, MaxSize_>
         return 1;
     }
 
+    int encodeElements(ScalarCodec& codec, const TailArrayOptimizationMode, TrueType) const
+    {
+        return codec.encodeBytes(reinterpret_cast<const uint8_t*>(Base::begin()), unsigned(size()));
+    }
+
     int encodeImpl(ScalarCodec& codec, const TailArrayOptimizationMode tao_mode, TrueType) const   /// Dynamic
     {
         StaticAssert<IsDynamic>::check();
@@ -471,6 +491,11 @@ class UAVCAN_EXPORT Array : public ArrayImpl<T, ArrayMode, MaxSize_>
     int decodeImpl(ScalarCodec& codec, const TailArrayOptimizationMode tao_mode, FalseType)  /// Static
     {
         UAVCAN_ASSERT(size() > 0);
+        return decodeElements(codec, tao_mode, BooleanType<IsByteArray>());
+    }
+
+    int decodeElements(ScalarCodec& codec, const TailArrayOptimizationMode tao_mode, FalseType)
+    {
         for (SizeType i = 0; i < size(); i++)
         {
             const bool last_item = i == (size() - 1);
@@ -485,6 +510,57 @@ class UAVCAN_EXPORT Array : public ArrayImpl<T, ArrayMode, MaxSize_>
         return 1;
     }
 
+    int decodeElements(ScalarCodec& codec, const TailArrayOptimizationMode, TrueType)
+    {
+        return codec.decodeBytes(reinterpret_cast<uint8_t*>(Base::begin()), unsigned(size()));
+    }
+
+    int decodeTailElements(ScalarCodec& codec, FalseType)
+    {
+        while (true)
+        {
+            ValueType value = ValueType();
+            const int res = RawValueType::decode(value, codec, TailArrayOptDisabled);
+            if (res < 0)
+            {
+                return res;
+            }
+            if (res == 0)             // Success: End of stream reached (even if zero items were read)
+            {
+                return 1;
+            }
+            if (size() == MaxSize_)   // Error: Max array length reached, but the end of stream is not
+            {
+                return -ErrInvalidMarshalData;
+            }
+            push_back(value);
+        }
+    }
+
+    /**
+     * The stream length is not known in advance, so the data is read in chunks until one of them fails to fit,
+     * then the rest is read element by element.
+     */
+    int decodeTailElements(ScalarCodec& codec, TrueType)
+    {
+        while ((MaxSize_ - size()) >= unsigned(TailChunkSize))
+        {
+            const SizeType offset = size();
+            resize(SizeType(offset + TailChunkSize));
+            const int res = codec.decodeBytes(reinterpret_cast<uint8_t*>(Base::begin()) + offset, TailChunkSize);
+            if (res < 0)
+            {
+                return res;
+            }
+            if (res == 0)
+            {
+                resize(offset);
+                break;
+            }
+        }
+        return decodeTailElements(codec, FalseType());
+    }
+
 #if __GNUC__
 # pragma GCC diagnostic push
 # pragma GCC diagnostic ignored "-Wtype-limits"
@@ -495,24 +571,7 @@ class UAVCAN_EXPORT Array : public ArrayImpl<T, ArrayMode, MaxSize_>
         Base::clear();
         if (isOptimizedTailArray(tao_mode))
         {
-            while (true)
-            {
-                ValueType value = ValueType();
-                const int res = RawValueType::decode(value, codec, TailArrayOptDisabled);
-                if (res < 0)
-                {
-                    return res;
-                }
-                if (res == 0)             // Success: End of stream reached (even if zero items were read)
-                {
-                    return 1;
-                }
-                if (size() == MaxSize_)   // Error: Max array length reached, but the end of stream is not
-                {
-                    return -ErrInvalidMarshalData;
-                }
-                push_back(value);
-            }
+            return decodeTailElements(codec, BooleanType<IsByteArray>());
         }
         else
         {
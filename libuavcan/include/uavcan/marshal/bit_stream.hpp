@@ -32,7 +32,10 @@ class UAVCAN_EXPORT BitStream
 {
     static const unsigned MaxBytesPerRW = 16;
 
-    ITransferBuffer& buf_;
+    ITransferBuffer* const buf_;        ///< Null in span mode
+    uint8_t* const span_;
+    const unsigned span_capacity_;
+    unsigned span_len_;
     unsigned bit_offset_;
     uint8_t byte_cache_;
 
@@ -52,6 +55,12 @@ class UAVCAN_EXPORT BitStream
                      reinterpret_cast<unsigned char*>(dst_org), 0);
     }
 
+    int writeBuffer(const uint8_t* bytes, const unsigned bitlen);
+    int readBuffer(uint8_t* bytes, const unsigned bitlen);
+
+    int writeSpan(const uint8_t* bytes, const unsigned bitlen);
+    int readSpan(uint8_t* bytes, const unsigned bitlen);
+
 public:
     static const unsigned MaxBitsPerRW = MaxBytesPerRW * 8;
 
@@ -62,13 +71,40 @@ public:
     };
 
     explicit BitStream(ITransferBuffer& buf)
-        : buf_(buf)
+        : buf_(&buf)
+        , span_(UAVCAN_NULLPTR)
+        , span_capacity_(0)
+        , span_len_(0)
         , bit_offset_(0)
         , byte_cache_(0)
     {
         StaticAssert<sizeof(uint8_t) == 1>::check();
     }
 
+    /**
+     * Span mode: the stream works directly on a contiguous chunk of memory rather than through the virtual
+     * ITransferBuffer interface, so that the whole serialization routine can be inlined.
+     * A writable span is initially empty; writes extend it up to the capacity, see @ref getSpanLen().
+     * A read-only span contains len bytes and can't be written.
+     */
+    BitStream(uint8_t* span, unsigned capacity)
+        : buf_(UAVCAN_NULLPTR)
+        , span_(span)
+        , span_capacity_(capacity)
+        , span_len_(0)
+        , bit_offset_(0)
+        , byte_cache_(0)
+    { }
+
+    BitStream(const uint8_t* span, unsigned len)
+        : buf_(UAVCAN_NULLPTR)
+        , span_(const_cast<uint8_t*>(span))     // Never written because the capacity is zero
+        , span_capacity_(0)
+        , span_len_(len)
+        , bit_offset_(0)
+        , byte_cache_(0)
+    { }
+
     /**
      * Write/read calls interpret bytes as bit arrays, 8 bits per byte, where the most
      * significant bits have lower index, i.e.:
@@ -80,14 +116,87 @@ public:
      *   Zero     - Out of buffer space
      *   Positive - OK
      */
-    int write(const uint8_t* bytes, const unsigned bitlen);
-    int read(uint8_t* bytes, const unsigned bitlen);
+    int write(const uint8_t* bytes, const unsigned bitlen)
+    {
+        return (buf_ == UAVCAN_NULLPTR) ? writeSpan(bytes, bitlen) : writeBuffer(bytes, bitlen);
+    }
+    int read(uint8_t* bytes, const unsigned bitlen)
+    {
+        return (buf_ == UAVCAN_NULLPTR) ? readSpan(bytes, bitlen) : readBuffer(bytes, bitlen);
+    }
+
+    /**
+     * Same as a sequence of 8-bit write()/read() calls, but not limited by @ref MaxBitsPerRW.
+     * If the stream is byte aligned or in span mode, the data is transferred to/from the buffer in one call.
+     * Return values are the same as above.
+     */
+    int writeBytes(const uint8_t* bytes, unsigned len);
+    int readBytes(uint8_t* bytes, unsigned len);
+
+    /**
+     * Number of bytes written to or available in the span. Always zero if the stream is not in span mode.
+     */
+    unsigned getSpanLen() const { return span_len_; }
 
 #if UAVCAN_TOSTRING
     std::string toString() const;
 #endif
 };
 
+// ----------------------------------------------------------------------------
+
+inline int BitStream::writeSpan(const uint8_t* bytes, const unsigned bitlen)
+{
+    const unsigned new_bit_offset = bit_offset_ + bitlen;
+    const unsigned new_span_len = bitlenToBytelen(new_bit_offset);
+    if (new_span_len > span_capacity_)
+    {
+        return ResultOutOfBuffer;
+    }
+
+    if (((bit_offset_ % 8) == 0) && ((bitlen % 8) == 0))
+    {
+        (void)copy(bytes, bytes + (bitlen / 8), span_ + (bit_offset_ / 8));
+    }
+    else
+    {
+        // New bytes are cleared first so that the padding bits of the last byte are zero, same as in buffer mode
+        fill(span_ + bitlenToBytelen(bit_offset_), span_ + new_span_len, uint8_t(0));
+        copyBitArrayAlignedToUnaligned(bytes, bitlen, span_ + (bit_offset_ / 8), bit_offset_ % 8);
+    }
+
+    bit_offset_ = new_bit_offset;
+    span_len_ = max(span_len_, new_span_len);
+    return ResultOk;
+}
+
+inline int BitStream::readSpan(uint8_t* bytes, const unsigned bitlen)
+{
+    const unsigned new_bit_offset = bit_offset_ + bitlen;
+    if (bitlenToBytelen(new_bit_offset) > span_len_)
+    {
+        return ResultOutOfBuffer;
+    }
+
+    if ((bit_offset_ % 8) == 0)
+    {
+        const unsigned bytelen = bitlenToBytelen(bitlen);
+        (void)copy(span_ + (bit_offset_ / 8), span_ + (bit_offset_ / 8) + bytelen, bytes);
+        if ((bitlen % 8) != 0)
+        {
+            bytes[bytelen - 1] = uint8_t(bytes[bytelen - 1] & uint8_t(0xFFU << (8 - (bitlen % 8))));
+        }
+    }
+    else
+    {
+        fill(bytes, bytes + bitlenToBytelen(bitlen), uint8_t(0));
+        copyBitArrayUnalignedToAligned(span_ + (bit_offset_ / 8), bit_offset_ % 8, bitlen, bytes);
+    }
+
+    bit_offset_ = new_bit_offset;
+    return ResultOk;
+}
+
 }
 
 #endif // UAVCAN_MARSHAL_BIT_STREAM_HPP_INCLUDED
@@ -91,10 +91,41 @@ public:
 
     template <unsigned BitLen, typename T>
     int decode(T& value);
+
+    /**
+     * Same as encode<8>()/decode<8>() applied to every element of an 8-bit integer array, but done in bulk.
+     */
+    int encodeBytes(const uint8_t* bytes, unsigned len) { return stream_.writeBytes(bytes, len); }
+    int decodeBytes(uint8_t* bytes, unsigned len) { return stream_.readBytes(bytes, len); }
 };
 
 // ----------------------------------------------------------------------------
 
+inline int ScalarCodec::encodeBytesImpl(uint8_t* const bytes, const unsigned bitlen)
+{
+    UAVCAN_ASSERT(bytes);
+    // Underlying stream class assumes that more significant bits have lower index, so we need to shift some.
+    if (bitlen % 8)
+    {
+        bytes[bitlen / 8] = uint8_t(bytes[bitlen / 8] << ((8 - (bitlen % 8)) & 7));
+    }
+    return stream_.write(bytes, bitlen);
+}
+
+inline int ScalarCodec::decodeBytesImpl(uint8_t* const bytes, const unsigned bitlen)
+{
+    UAVCAN_ASSERT(bytes);
+    const int read_res = stream_.read(bytes, bitlen);
+    if (read_res > 0)
+    {
+        if (bitlen % 8)
+        {
+            bytes[bitlen / 8] = uint8_t(bytes[bitlen / 8] >> ((8 - (bitlen % 8)) & 7));  // As in encode(), vice versa
+        }
+    }
+    return read_res;
+}
+
 template <unsigned BitLen, typename T>
 int ScalarCodec::encode(const T value)
 {
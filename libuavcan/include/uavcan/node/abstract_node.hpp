@@ -65,15 +65,12 @@ public:
         return getScheduler().spin(deadline);
     }
 
-    int spin(RxFrame& frame, MonotonicTime deadline)
-    {
-        return getScheduler().spin(frame, deadline);
-    }
-
     /**
      * Runs the node.
      * Normally your application should not block anywhere else.
      * Block inside this method forever or call it periodically.
+     * If the CAN driver supports wakeups (see CanSelectMasks::wakeup), another thread can make this method return
+     * before the duration expires.
      * This method returns 0 if no errors occurred, or a negative error code if something failed (see error.hpp).
      */
     int spin(MonotonicDuration duration)
@@ -81,11 +78,6 @@ public:
         return getScheduler().spin(getMonotonicTime() + duration);
     }
 
-    int spin(RxFrame& frame, MonotonicDuration duration)
-    {
-        return getScheduler().spin(frame, getMonotonicTime() + duration);
-    }
-
     /**
      * This method is designed for non-blocking applications.
      * Instead of blocking, it returns immediately once all available CAN frames and timer events are processed.
@@ -98,9 +90,41 @@ public:
         return getScheduler().spinOnce();
     }
 
-    int spinOnce(RxFrame &frame)
+    /**
+     * Same as above, but the CAN frames are decoded into the caller's frame object by the codec of the given
+     * frame format, see frame_format.hpp. The non-templated versions use @ref StandardFrameFormat.
+     */
+    template <typename Format>
+    int spin(RxFrame& frame, MonotonicTime deadline)
+    {
+        return getScheduler().spin<Format>(frame, deadline);
+    }
+
+    int spin(RxFrame& frame, MonotonicTime deadline)
+    {
+        return spin<StandardFrameFormat>(frame, deadline);
+    }
+
+    template <typename Format>
+    int spin(RxFrame& frame, MonotonicDuration duration)
+    {
+        return getScheduler().spin<Format>(frame, getMonotonicTime() + duration);
+    }
+
+    int spin(RxFrame& frame, MonotonicDuration duration)
+    {
+        return spin<StandardFrameFormat>(frame, duration);
+    }
+
+    template <typename Format>
+    int spinOnce(RxFrame& frame)
+    {
+        return getScheduler().spinOnce<Format>(frame);
+    }
+
+    int spinOnce(RxFrame& frame)
     {
-        return getScheduler().spinOnce(frame);
+        return spinOnce<StandardFrameFormat>(frame);
     }
 
     /**
@@ -98,7 +98,7 @@ class UAVCAN_EXPORT GenericPublisher : public GenericPublisherBase
 
     int checkInit();
 
-    int doEncode(const DataStruct& message, ITransferBuffer& buffer) const;
+    int doEncode(const DataStruct& message, StaticTransferBufferImpl& buffer) const;
 
     int genericPublish(const DataStruct& message, TransferType transfer_type, NodeID dst_node_id,
                        TransferID* tid, MonotonicTime blocking_deadline);
@@ -174,9 +174,11 @@ int GenericPublisher<DataSpec, DataStruct>::checkInit()
 }
 
 template <typename DataSpec, typename DataStruct>
-int GenericPublisher<DataSpec, DataStruct>::doEncode(const DataStruct& message, ITransferBuffer& buffer) const
+int GenericPublisher<DataSpec, DataStruct>::doEncode(const DataStruct& message,
+                                                     StaticTransferBufferImpl& buffer) const
 {
-    BitStream bitstream(buffer);
+    // The buffer is contiguous, so the codec can write into it directly
+    BitStream bitstream(buffer.getRawPtr(), buffer.getSize());
     ScalarCodec codec(bitstream);
     const int encode_res = DataStruct::encode(message, codec);
     if (encode_res <= 0)
@@ -184,6 +186,7 @@ int GenericPublisher<DataSpec, DataStruct>::doEncode(const DataStruct& message,
         UAVCAN_ASSERT(0);   // Impossible, internal error
         return -ErrInvalidMarshalData;
     }
+    buffer.setMaxWritePos(uint16_t(bitstream.getSpanLen()));
     return encode_res;
 }
 
@@ -260,7 +260,11 @@ void GenericSubscriber<DataSpec, DataStruct, TransferListenerType>::handleIncomi
     /*
      * Decoding into the temporary storage
      */
-    BitStream bitstream(transfer);
+    unsigned payload_len = 0;
+    const uint8_t* const payload = transfer.getContiguousPayload(payload_len);
+
+    // Single-frame transfers are decoded directly from the frame payload
+    BitStream bitstream = (payload != UAVCAN_NULLPTR) ? BitStream(payload, payload_len) : BitStream(transfer);
     ScalarCodec codec(bitstream);
 
     const int decode_res = DataStruct::decode(rx_struct, codec);
@@ -145,33 +145,51 @@ public:
         return -ErrNotInited;
     }
 
+    template <typename Format>
     int spin(RxFrame& frame, MonotonicTime deadline)
     {
         if (started_)
         {
-            return INode::spin(frame, deadline);
+            return INode::spin<Format>(frame, deadline);
         }
         return -ErrNotInited;
     }
 
+    int spin(RxFrame& frame, MonotonicTime deadline)
+    {
+        return spin<StandardFrameFormat>(frame, deadline);
+    }
+
+    template <typename Format>
     int spin(RxFrame& frame, MonotonicDuration duration)
     {
         if (started_)
         {
-            return INode::spin(frame, duration);
+            return INode::spin<Format>(frame, duration);
         }
         return -ErrNotInited;
     }
 
+    int spin(RxFrame& frame, MonotonicDuration duration)
+    {
+        return spin<StandardFrameFormat>(frame, duration);
+    }
+
+    template <typename Format>
     int spinOnce(RxFrame& frame)
     {
         if (started_)
         {
-            return INode::spinOnce(frame);
+            return INode::spinOnce<Format>(frame);
         }
         return -ErrNotInited;
     }
 
+    int spinOnce(RxFrame& frame)
+    {
+        return spinOnce<StandardFrameFormat>(frame);
+    }
+
     bool isStarted() const { return started_; }
 
     uint64_t getInternalFailureCount() const { return internal_failure_cnt_; }
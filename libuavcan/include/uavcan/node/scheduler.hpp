@@ -16,13 +16,25 @@ class UAVCAN_EXPORT Scheduler;
 
 class UAVCAN_EXPORT DeadlineHandler : public LinkedListNode<DeadlineHandler>
 {
+    friend class DeadlineScheduler;
+
     MonotonicTime deadline_;
+#if UAVCAN_DEADLINE_SCHEDULER_HEAP
+    DeadlineHandler* heap_child_;   ///< First child; siblings are linked via the list node
+    DeadlineHandler* heap_prev_;    ///< Previous sibling, or parent for the first child
+#endif
 
 protected:
     Scheduler& scheduler_;
 
     explicit DeadlineHandler(Scheduler& scheduler)
+#if UAVCAN_DEADLINE_SCHEDULER_HEAP
+        : heap_child_(UAVCAN_NULLPTR)
+        , heap_prev_(UAVCAN_NULLPTR)
+        , scheduler_(scheduler)
+#else
         : scheduler_(scheduler)
+#endif
     { }
 
     virtual ~DeadlineHandler() { stop(); }
@@ -43,15 +55,38 @@ public:
 };
 
 
+/**
+ * Keeps the running deadline handlers ordered by deadline, see UAVCAN_DEADLINE_SCHEDULER_HEAP.
+ * Handlers with equal deadlines are fired in the order of registration only in the linked list mode.
+ */
 class UAVCAN_EXPORT DeadlineScheduler : Noncopyable
 {
+#if UAVCAN_DEADLINE_SCHEDULER_HEAP
+    DeadlineHandler* heap_root_;
+    unsigned num_handlers_;
+
+    static DeadlineHandler* meld(DeadlineHandler* a, DeadlineHandler* b);
+    static DeadlineHandler* mergePairs(DeadlineHandler* first);
+#else
     LinkedListRoot<DeadlineHandler> handlers_;  // Ordered by deadline, lowest first
+#endif
 
 public:
+#if UAVCAN_DEADLINE_SCHEDULER_HEAP
+    DeadlineScheduler()
+        : heap_root_(UAVCAN_NULLPTR)
+        , num_handlers_(0)
+    { }
+#endif
+
     void add(DeadlineHandler* mdh);
     void remove(DeadlineHandler* mdh);
     bool doesExist(const DeadlineHandler* mdh) const;
+#if UAVCAN_DEADLINE_SCHEDULER_HEAP
+    unsigned getNumHandlers() const { return num_handlers_; }
+#else
     unsigned getNumHandlers() const { return handlers_.getLength(); }
+#endif
 
     MonotonicTime pollAndGetMonotonicTime(ISystemClock& sysclock);
     MonotonicTime getEarliestDeadline() const;
@@ -103,10 +138,10 @@ public:
     /**
      * Spin until the deadline, or until some error occurs.
      * This function will return strictly when the deadline is reached, even if there are unprocessed frames.
+     * It returns earlier if the CAN driver reports a wakeup, see CanSelectMasks::wakeup.
      * Returns negative error code.
      */
     int spin(MonotonicTime deadline);
-    int spin(RxFrame& frame, MonotonicTime deadline);
 
     /**
      * Non-blocking version of @ref spin() - spins until all pending frames and events are processed,
@@ -114,7 +149,18 @@ public:
      * Returns negative error code.
      */
     int spinOnce();
+
+    /**
+     * Same as above, but the CAN frames are decoded into the caller's frame object by the codec of the given
+     * frame format, see Dispatcher::spin<>() and frame_format.hpp.
+     */
+    template <typename Format>
+    int spin(RxFrame& frame, MonotonicTime deadline);
+    int spin(RxFrame& frame, MonotonicTime deadline) { return spin<StandardFrameFormat>(frame, deadline); }
+
+    template <typename Format>
     int spinOnce(RxFrame& frame);
+    int spinOnce(RxFrame& frame) { return spinOnce<StandardFrameFormat>(frame); }
 
     DeadlineScheduler& getDeadlineScheduler() { return deadline_scheduler_; }
 
@@ -152,6 +198,65 @@ public:
     }
 };
 
+// ----------------------------------------------------------------------------
+
+template <typename Format>
+int Scheduler::spin(RxFrame& frame, MonotonicTime deadline)
+{
+    if (inside_spin_)  // Preventing recursive calls
+    {
+        UAVCAN_ASSERT(0);
+        return -ErrRecursiveCall;
+    }
+    InsideSpinSetter iss(*this);
+    UAVCAN_ASSERT(inside_spin_);
+
+    int retval = 0;
+    while (true)
+    {
+        const MonotonicTime dl = computeDispatcherSpinDeadline(deadline);
+        retval = dispatcher_.spin<Format>(frame, dl);
+        if (retval < 0)
+        {
+            break;
+        }
+
+        const MonotonicTime ts = deadline_scheduler_.pollAndGetMonotonicTime(getSystemClock());
+        pollCleanup(ts, unsigned(retval));
+        const bool woken_up = dispatcher_.getCanIOManager().yieldWakeup();
+        if ((ts >= deadline) || woken_up)
+        {
+            break;
+        }
+    }
+
+    return retval;
+}
+
+template <typename Format>
+int Scheduler::spinOnce(RxFrame& frame)
+{
+    if (inside_spin_)  // Preventing recursive calls
+    {
+        UAVCAN_ASSERT(0);
+        return -ErrRecursiveCall;
+    }
+    InsideSpinSetter iss(*this);
+    UAVCAN_ASSERT(inside_spin_);
+
+    const int retval = dispatcher_.spinOnce<Format>(frame);
+    if (retval < 0)
+    {
+        return retval;
+    }
+
+    const MonotonicTime ts = deadline_scheduler_.pollAndGetMonotonicTime(getSystemClock());
+    pollCleanup(ts, unsigned(retval));
+    (void)dispatcher_.getCanIOManager().yieldWakeup();      // The call returns anyway
+
+    return retval;
+}
+
 }
 
 #endif // UAVCAN_NODE_SCHEDULER_HPP_INCLUDED
@@ -426,15 +426,13 @@ bool ServiceClient<DataType_, Callback_>::shouldAcceptFrame(const RxFrame& frame
     UAVCAN_ASSERT(frame.getTransferType() == TransferTypeServiceResponse); // Other types filtered out by dispatcher
 
 
-    if(frame.getFrameType() == 0)
+    // Other frame formats may auto-increment the transfer ID, so their responses cannot be matched with the calls
+    if (StandardFrameFormat::matches(frame))
     {
         return UAVCAN_NULLPTR != call_registry_.find(CallStateMatchingPredicate(ServiceCallID(frame.getSrcNodeID(),
                                                                                           frame.getTransferID())));
     }
-    else
-    {
-        return true;
-    }
+    return true;
 }
 
 template <typename DataType_, typename Callback_>
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2014 Pavel Kirienko <pavel.kirienko@gmail.com>
+ *
+ * Service that reports the per-priority TX queue statistics of the local node.
+ */
+
+#ifndef UAVCAN_PROTOCOL_TX_QUEUE_STATS_PROVIDER_HPP_INCLUDED
+#define UAVCAN_PROTOCOL_TX_QUEUE_STATS_PROVIDER_HPP_INCLUDED
+
+#include <uavcan/build_config.hpp>
+#include <uavcan/node/service_server.hpp>
+#include <uavcan/util/method_binder.hpp>
+
+#if !UAVCAN_TX_QUEUE_STATS
+# error UAVCAN_TX_QUEUE_STATS is disabled
+#endif
+
+namespace uavcan
+{
+/**
+ * This class provides the TX queue statistics of the local node (see CanTxQueueStats), which don't fit into the
+ * standard uavcan.protocol.GetTransportStats response. The service data type has to be defined by the application
+ * (in a vendor-specific namespace) as follows:
+ *
+ *     uint8 iface_index
+ *     ---
+ *     uint16[<=32] depth
+ *     uint16[<=32] peak_depth
+ *     uint32[<=32] num_transmitted
+ *     uint32[<=32] num_expired
+ *     uint32[<=32] num_rejected
+ *     uint32[<=32] max_latency_usec
+ *     uint32[<=256] latency_histogram     # 8 bins per priority level, one level after another
+ *
+ * All arrays are indexed by priority level. The response is empty if the requested interface doesn't exist.
+ *
+ * @tparam DataType_    The service data type defined as above.
+ */
+template <typename DataType_>
+class UAVCAN_EXPORT TxQueueStatsProvider : Noncopyable
+{
+    typedef MethodBinder<const TxQueueStatsProvider*,
+                         int (TxQueueStatsProvider::*)(const typename DataType_::Request&,
+                                                       typename DataType_::Response&) const>
+            GetTxQueueStatsCallback;
+
+    ServiceServer<DataType_, GetTxQueueStatsCallback> srv_;
+
+    int handleGetTxQueueStats(const typename DataType_::Request& req, typename DataType_::Response& resp) const
+    {
+        const CanTxQueueStats* const stats =
+            srv_.getNode().getDispatcher().getCanIOManager().getTxQueueStats(req.iface_index);
+        if (stats == UAVCAN_NULLPTR)
+        {
+            return 0;
+        }
+
+        for (unsigned i = 0; i < CanTxQueueStats::NumPriorityLevels; i++)
+        {
+            const CanTxQueueStats::PriorityLevel& level = stats->levels[i];
+            resp.depth.push_back(level.depth);
+            resp.peak_depth.push_back(level.peak_depth);
+            resp.num_transmitted.push_back(level.num_transmitted);
+            resp.num_expired.push_back(level.num_expired);
+            resp.num_rejected.push_back(level.num_rejected);
+            resp.max_latency_usec.push_back(level.max_latency_usec);
+            for (unsigned k = 0; k < CanTxQueueStats::NumLatencyBins; k++)
+            {
+                resp.latency_histogram.push_back(level.latency_histogram[k]);
+            }
+        }
+        return 0;
+    }
+
+public:
+    explicit TxQueueStatsProvider(INode& node)
+        : srv_(node)
+    { }
+
+    /**
+     * Once started, this class requires no further attention.
+     * Returns negative error code.
+     */
+    int start()
+    {
+        return srv_.start(GetTxQueueStatsCallback(this, &TxQueueStatsProvider::handleGetTxQueueStats));
+    }
+};
+
+}
+
+#endif // UAVCAN_PROTOCOL_TX_QUEUE_STATS_PROVIDER_HPP_INCLUDED
@@ -97,7 +97,11 @@ class TimeBase
     uint64_t usec_;
 
 protected:
+#if UAVCAN_CPP_VERSION >= UAVCAN_CPP11
+    ~TimeBase() = default;          // Keeps the time types trivially copyable
+#else
     ~TimeBase() { }
+#endif
 
     TimeBase()
         : usec_(0)
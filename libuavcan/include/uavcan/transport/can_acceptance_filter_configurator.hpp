@@ -11,6 +11,7 @@
 #include <uavcan/error.hpp>
 #include <uavcan/transport/dispatcher.hpp>
 #include <uavcan/node/abstract_node.hpp>
+#include <uavcan/node/timer.hpp>
 #include <uavcan/build_config.hpp>
 #include <uavcan/util/multiset.hpp>
 
@@ -28,7 +29,8 @@ namespace uavcan
  * the number of available HW filters, configurations will be merged automatically in the most efficient way.
  *
  * Note that if the application adds additional server or subscriber objects after the filters have been configured,
- * the configuration procedure will have to be performed again.
+ * the configuration procedure will have to be performed again; @ref CanAcceptanceFilterAutoConfigurator does that
+ * automatically.
  *
  * The maximum number of CAN acceptance filters is predefined in uavcan/build_config.hpp through a constant
  * @ref MaxCanAcceptanceFilters. The algorithm doesn't allow to have higher number of HW filters configurations than
@@ -47,6 +49,20 @@ public:
         IgnoreAnonymousMessages
     };
 
+    /**
+     * These arguments define how configurations are merged when there are more of them than HW filters.
+     * MergeByRank      - repeatedly merges the pair of configurations that yields the most specific mask.
+     * MergeByVolume    - minimizes the total number of CAN IDs accepted by the resulting filters, i.e. the amount
+     *                    of foreign traffic that passes through. Configurations are merged greedily by the least
+     *                    volume increase until at most @ref UAVCAN_CAN_ACCEPTANCE_FILTER_EXACT_MERGE_LIMIT of them
+     *                    are left; the rest is partitioned with an exact branch-and-bound search.
+     */
+    enum MergeAlgorithm
+    {
+        MergeByRank,
+        MergeByVolume
+    };
+
 private:
     /**
      * Below constants based on UAVCAN transport layer specification. Masks and ID's depends on message
@@ -71,10 +87,14 @@ private:
 
     typedef uavcan::Multiset<CanFilterConfig> MultisetConfigContainer;
 
-    static CanFilterConfig mergeFilters(CanFilterConfig& a_, CanFilterConfig& b_);
+    static CanFilterConfig mergeFilters(const CanFilterConfig& a_, const CanFilterConfig& b_);
     static uint8_t countBits(uint32_t n_);
     uint16_t getNumFilters() const;
 
+    void mergePairByVolume();
+    int16_t mergeConfigurationsByRank(uint16_t acceptance_filters_number);
+    int16_t mergeConfigurationsByVolume(uint16_t acceptance_filters_number);
+
     /**
      * Fills the multiset_configs_ to proceed it with mergeConfigurations()
      */
@@ -89,6 +109,7 @@ private:
     INode& node_;               //< Node reference is needed for access to ICanDriver and Dispatcher
     MultisetConfigContainer multiset_configs_;
     uint16_t filters_number_;
+    MergeAlgorithm merge_algorithm_;
 
 public:
     /**
@@ -102,8 +123,17 @@ public:
         : node_(node)
         , multiset_configs_(node.getAllocator())
         , filters_number_(filters_number)
+        , merge_algorithm_(MergeByRank)
     { }
 
+    /**
+     * Number of CAN IDs accepted by the filter; used as the cost estimate by @ref MergeByVolume.
+     */
+    static uint32_t getAcceptedVolume(const CanFilterConfig& config)
+    {
+        return uint32_t(1UL << (29U - countBits(config.mask & CanFrame::MaskExtID)));
+    }
+
     /**
      * This method invokes loadInputConfiguration() and mergeConfigurations() consequently
      * in order to comute optimal filter configurations for the current hardware.
@@ -113,9 +143,11 @@ public:
      *
      * @param mode Either: AcceptAnonymousMessages - the filters will accept all anonymous messages (this is default)
      *                     IgnoreAnonymousMessages - anonymous messages will be ignored
+     * @param algorithm    Refer to @ref MergeAlgorithm; MergeByRank is the default.
      * @return 0 = success, negative for error.
      */
-    int computeConfiguration(AnonymousMessages mode = AcceptAnonymousMessages);
+    int computeConfiguration(AnonymousMessages mode = AcceptAnonymousMessages,
+                             MergeAlgorithm algorithm = MergeByRank);
 
     /**
      * Add an additional filter configuration.
@@ -141,6 +173,95 @@ public:
     }
 };
 
+#if !UAVCAN_TINY
+/**
+ * This class keeps the hardware acceptance filters in sync with the subscribers and servers of the node.
+ *
+ * Once started, it observes the listener registries of the dispatcher. When message or service request listeners
+ * are added or removed, the configuration is recomputed after a debounce delay, so that a burst of registrations
+ * (e.g. at startup) results in a single reconfiguration. The CAN driver is reconfigured only if the computed
+ * filters differ from the ones applied last time. Configurations are merged with
+ * @ref CanAcceptanceFilterConfigurator::MergeByVolume.
+ *
+ * Service response listeners do not affect the filters, so their changes, which happen on every service call,
+ * are ignored. The service filter depends on the local node ID, so the filters are recomputed without delay once
+ * the node ID is assigned, e.g. by the dynamic node ID allocation client after the configurator has been started
+ * in passive mode. The dispatcher has one registry observer slot, so only one object of this class can run per node.
+ */
+class CanAcceptanceFilterAutoConfigurator : private TimerBase
+                                          , private ITransferListenerRegistryObserver
+{
+    INode& node_;
+    const MonotonicDuration debounce_delay_;
+    const CanAcceptanceFilterConfigurator::AnonymousMessages anon_mode_;
+    const uint16_t filters_number_;
+    NodeID configured_node_id_;         ///< Node ID that the last configuration was computed for
+    CanFilterConfig applied_configs_[MaxCanAcceptanceFilters];
+    uint16_t num_applied_configs_;
+    uint32_t num_reconfigurations_;
+    int last_result_;
+
+    virtual void handleTimerEvent(const TimerEvent&);
+    virtual void handleTransferListenerRegistryChange(TransferType transfer_type);
+
+public:
+    static MonotonicDuration getDefaultDebounceDelay() { return MonotonicDuration::fromMSec(100); }
+
+    /**
+     * @param node              Libuavcan node whose subscribers/servers/etc will be used to configure the filters.
+     * @param debounce_delay    Delay between the last registry change and the reconfiguration.
+     * @param mode              Refer to @ref CanAcceptanceFilterConfigurator::computeConfiguration().
+     * @param filters_number    Refer to @ref CanAcceptanceFilterConfigurator constructor.
+     */
+    explicit CanAcceptanceFilterAutoConfigurator(INode& node,
+                                                 MonotonicDuration debounce_delay = getDefaultDebounceDelay(),
+                                                 CanAcceptanceFilterConfigurator::AnonymousMessages mode
+                                                     = CanAcceptanceFilterConfigurator::AcceptAnonymousMessages,
+                                                 uint16_t filters_number = 0)
+        : TimerBase(node)
+        , node_(node)
+        , debounce_delay_(debounce_delay)
+        , anon_mode_(mode)
+        , filters_number_(filters_number)
+        , configured_node_id_(node.getNodeID())
+        , num_applied_configs_(0)
+        , num_reconfigurations_(0)
+        , last_result_(0)
+    { }
+
+    virtual ~CanAcceptanceFilterAutoConfigurator() { stop(); }
+
+    /**
+     * Starts observing the listener registries and configures the filters right away.
+     * @return 0 = success, negative for error; the observation continues regardless.
+     */
+    int start();
+
+    /**
+     * Stops observing the listener registries. The filters that are currently applied stay in effect.
+     */
+    void stop();
+
+    bool isStarted() const { return node_.getDispatcher().getTransferListenerRegistryObserver() == this; }
+
+    /**
+     * Recomputes the configuration immediately and applies it if it has changed.
+     * @return 0 = success, negative for error.
+     */
+    int reconfigure();
+
+    /**
+     * Result of the last reconfiguration attempt, 0 = success, negative for error.
+     */
+    int getLastResult() const { return last_result_; }
+
+    /**
+     * Number of times the CAN driver was actually reconfigured.
+     */
+    uint32_t getNumReconfigurations() const { return num_reconfigurations_; }
+};
+#endif
+
 /**
  * This function is a shortcut for @ref CanAcceptanceFilterConfigurator.
  * It allows to compute filter configuration and then apply it in just one step.
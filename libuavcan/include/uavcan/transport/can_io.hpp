@@ -11,7 +11,6 @@
 #include <uavcan/error.hpp>
 #include <uavcan/std.hpp>
 #include <uavcan/util/linked_list.hpp>
-#include <uavcan/util/avl_tree.hpp>
 #include <uavcan/dynamic_memory.hpp>
 #include <uavcan/build_config.hpp>
 #include <uavcan/util/templates.hpp>
@@ -37,16 +36,68 @@ struct UAVCAN_EXPORT CanRxFrame : public CanFrame
 #endif
 };
 
-struct UAVCAN_EXPORT CanTxQueueEntry  // Not required to be packed - fits the block in any case
+/**
+ * Random access source of the frames of one transfer. This allows to enqueue a long transfer without compiling
+ * all of its frames into a temporary array first - each frame is compiled right into its TX queue entry.
+ */
+class UAVCAN_EXPORT ICanFrameSequence
 {
+public:
+    virtual ~ICanFrameSequence() { }
+
+    virtual unsigned getNumFrames() const = 0;
+
+    /**
+     * Returns false if the frame can't be produced; this is a logic error.
+     */
+    virtual bool getFrame(unsigned index, CanFrame& out_frame) const = 0;
+};
+
+/**
+ * TX queue entry. The entry is linked into both indexes of the queue directly, so that every enqueued frame
+ * takes exactly one memory block.
+ */
+struct UAVCAN_EXPORT CanTxQueueEntry
+{
+    friend class CanTxQueue;
+
+private:
+    CanTxQueueEntry* prio_left_;
+    CanTxQueueEntry* prio_right_;
+    CanTxQueueEntry* deadline_left_;
+    CanTxQueueEntry* deadline_right_;
+
+public:
     MonotonicTime deadline;
     const CanFrame frame;
+
+private:
+    /**
+     * Enqueue time in microseconds, low 32 bits, made strictly increasing within the queue.
+     * Keeps frames of equal priority FIFO and gives the time the frame has spent in the queue.
+     */
+    const uint32_t seq_;
+
+public:
     CanIOFlags flags;
 
-    CanTxQueueEntry(const CanFrame& arg_frame, const MonotonicTime arg_deadline, CanIOFlags arg_flags)
-        : deadline(arg_deadline)
+private:
+    int8_t prio_height_;
+    int8_t deadline_height_;
+
+public:
+    CanTxQueueEntry(const CanFrame& arg_frame, const MonotonicTime arg_deadline, CanIOFlags arg_flags,
+                    uint32_t arg_seq)
+        : prio_left_(UAVCAN_NULLPTR)
+        , prio_right_(UAVCAN_NULLPTR)
+        , deadline_left_(UAVCAN_NULLPTR)
+        , deadline_right_(UAVCAN_NULLPTR)
+        , deadline(arg_deadline)
         , frame(arg_frame)
+        , seq_(arg_seq)
         , flags(arg_flags)
+        , prio_height_(1)
+        , deadline_height_(1)
     {
         IsDynamicallyAllocatable<CanTxQueueEntry>::check();
     }
@@ -75,41 +126,142 @@ struct UAVCAN_EXPORT CanTxQueueEntry  // Not required to be packed - fits the bl
 #endif
 };
 
-class UAVCAN_EXPORT CanTxQueue : public AvlTree<CanTxQueueEntry>
+#if UAVCAN_TX_QUEUE_STATS
+/**
+ * TX queue statistics of one interface, per priority level.
+ * The level of a frame is given by the five most significant bits of its CAN ID, which hold the transfer priority
+ * in UAVCAN frames; level 0 is the highest priority.
+ */
+struct UAVCAN_EXPORT CanTxQueueStats
 {
-private:
-    void postOrderTraverseEntryCleanup(Node* n);
+    enum { NumPriorityLevels = 32 };
+
+    /**
+     * Enqueue-to-transmit latency histogram.
+     * The upper bounds of the bins are 250 us, 1 ms, 4 ms, 16 ms, 64 ms, 256 ms, 1 s; the last bin takes the rest.
+     */
+    enum { NumLatencyBins = 8 };
+    static const uint32_t FirstLatencyBinUSec = 250;
+
+    struct PriorityLevel
+    {
+        uint16_t depth;                 ///< Frames in the queue now
+        uint16_t peak_depth;
+        uint32_t num_transmitted;
+        uint32_t num_expired;           ///< Dropped from the queue after the deadline
+        uint32_t num_rejected;          ///< Not enqueued because of OOM or an expired deadline
+        uint32_t max_latency_usec;
+        uint32_t latency_histogram[NumLatencyBins];
+
+        PriorityLevel()
+            : depth(0)
+            , peak_depth(0)
+            , num_transmitted(0)
+            , num_expired(0)
+            , num_rejected(0)
+            , max_latency_usec(0)
+        {
+            fill(latency_histogram, latency_histogram + NumLatencyBins, uint32_t(0));
+        }
+    };
+
+    PriorityLevel levels[NumPriorityLevels];
 
-protected:
+    static uint8_t getPriorityLevel(const CanFrame& frame);
+    static uint8_t getLatencyBin(uint32_t latency_usec);
+};
+#endif
+
+/**
+ * Prioritized TX queue.
+ *
+ * Entries are kept in two intrusive AVL trees: one is ordered by frame priority (frames of equal priority are
+ * ordered by insertion), the other one is ordered by transmission deadline. The latter allows to purge the expired
+ * entries in O(log n) each, without traversing the whole queue.
+ *
+ * A frame can't stay in the queue longer than @ref MaxFrameLifetimeUSec (about 18 minutes); a later deadline is
+ * reduced to that. This keeps the enqueue timestamps of all queued frames comparable despite the wrap-around.
+ */
+class UAVCAN_EXPORT CanTxQueue : Noncopyable
+{
+    struct PriorityIndex;
+    struct DeadlineIndex;
+    template <typename Index> struct Tree;
+
+    LimitedPoolAllocator allocator_;
     ISystemClock& sysclock_;
+    CanTxQueueEntry* prio_root_;
+    CanTxQueueEntry* deadline_root_;
     uint32_t rejected_frames_cnt_;
+    uint32_t last_seq_;
+    uint16_t size_;
+#if UAVCAN_TX_QUEUE_STATS
+    CanTxQueueStats stats_;
+#endif
+
+    static void destroyRecursively(CanTxQueueEntry* entry, IPoolAllocator& allocator);
+    static bool containsRecursively(const CanTxQueueEntry* entry, const CanFrame& frame);
 
-    bool linkedListContains(Node* head, const CanFrame& frame) const;
-    void safeIncrementRejectedFrames();
-    AvlTree::Node* searchForNonExpiredMax(Node* n);
+    uint32_t makeSeq(MonotonicTime timestamp, unsigned num_frames);
+    void registerRejectedFrames(const ICanFrameSequence& frames);
+    void unlink(CanTxQueueEntry* entry);
+    void removeExpired(MonotonicTime timestamp);
 
 public:
+    static const uint32_t MaxFrameLifetimeUSec = 1UL << 30;
+
     CanTxQueue(IPoolAllocator& allocator, ISystemClock& sysclock, std::size_t allocator_quota) :
-        AvlTree(allocator, allocator_quota),
+        allocator_(allocator, allocator_quota),
         sysclock_(sysclock),
-        rejected_frames_cnt_(0)
-    {}
+        prio_root_(UAVCAN_NULLPTR),
+        deadline_root_(UAVCAN_NULLPTR),
+        rejected_frames_cnt_(0),
+        last_seq_(0),
+        size_(0)
+    { }
 
-    ~CanTxQueue() override;
+    ~CanTxQueue();
 
-    /* Avl Tree allocates the AvlTree::Node, while this(CanTxQueue) allocates the CanTxQueueEntry
-     * Same logic for removal. */
     void push(const CanFrame& frame, MonotonicTime tx_deadline, CanIOFlags flags);
+
+    /**
+     * Enqueues several frames with the same deadline and flags, e.g. the remaining frames of a multi-frame transfer.
+     * Frames of equal priority are transmitted in the order they were pushed.
+     * The frames are enqueued either all together or not at all - a partially enqueued transfer would only waste
+     * the bus bandwidth, since the receiving side would not be able to reassemble it.
+     */
+    void push(const CanFrame* frames, unsigned num_frames, MonotonicTime tx_deadline, CanIOFlags flags);
+
+    /**
+     * Same as above, but the frames are fetched from the sequence one by one as the entries are constructed.
+     * Returns true if the frames were enqueued.
+     */
+    bool push(const ICanFrameSequence& frames, MonotonicTime tx_deadline, CanIOFlags flags);
+
+    /**
+     * Removes a transmitted entry.
+     */
     void remove(CanTxQueueEntry* entry);
 
     uint32_t getRejectedFrameCount() const { return rejected_frames_cnt_; }
 
+#if UAVCAN_TX_QUEUE_STATS
+    const CanTxQueueStats& getStats() const { return stats_; }
+#endif
+
     bool contains(const CanFrame& frame) const;
 
-    /* Tries to look up rightmost Node. If the frame is expired, removes it and continues traversing */
+    /**
+     * Returns the highest priority entry, or null if the queue is empty.
+     * Expired entries are removed first.
+     */
     CanTxQueueEntry* peek();
 
     bool topPriorityHigherOrEqual(const CanFrame& rhs_frame);
+
+    bool isEmpty() const { return size_ == 0; }
+
+    unsigned getSize() const { return size_; }
 };
 
 struct UAVCAN_EXPORT CanIfacePerfCounters
@@ -145,6 +297,7 @@ class UAVCAN_EXPORT CanIOManager : Noncopyable
     IfaceFrameCounters counters_[MaxCanIfaces];
 
     const uint8_t num_ifaces_;
+    bool wakeup_pending_;
 
     int sendToIface(uint8_t iface_index, const CanFrame& frame, MonotonicTime tx_deadline, CanIOFlags flags);
     int sendFromTxQueue(uint8_t iface_index);
@@ -159,6 +312,18 @@ public:
 
     CanIfacePerfCounters getIfacePerfCounters(uint8_t iface_index) const;
 
+    /**
+     * Number of frames waiting in the TX queue of the interface.
+     */
+    unsigned getTxQueueDepth(uint8_t iface_index) const;
+
+#if UAVCAN_TX_QUEUE_STATS
+    /**
+     * Returns null if there's no such interface.
+     */
+    const CanTxQueueStats* getTxQueueStats(uint8_t iface_index) const;
+#endif
+
     const ICanDriver& getCanDriver() const { return driver_; }
     ICanDriver& getCanDriver()             { return driver_; }
 
@@ -172,7 +337,57 @@ public:
      */
     int send(const CanFrame& frame, MonotonicTime tx_deadline, MonotonicTime blocking_deadline,
              uint8_t iface_mask, CanIOFlags flags);
+
+    /**
+     * Same as send(), but for a sequence of frames that must be transmitted in order, e.g. a multi-frame transfer.
+     * While the driver accepts frames without blocking, they are transmitted directly, so that a short burst
+     * doesn't have to go through the TX queue; whatever is left by the blocking deadline is enqueued in one go,
+     * all or nothing (see CanTxQueue::push()).
+     * Returns the number of frames transmitted on all interfaces, or a negative error code.
+     */
+    int sendBatch(const CanFrame* frames, unsigned num_frames, MonotonicTime tx_deadline,
+                  MonotonicTime blocking_deadline, uint8_t iface_mask, CanIOFlags flags);
+
+    /**
+     * Enqueues the frames of one transfer on every interface from the mask without accessing the driver, so the
+     * call never blocks. The queued frames are transmitted later by receive() (hence by Node::spin()) and by the
+     * following send() calls, in the order of priority.
+     * Every interface receives either the whole sequence or nothing, see CanTxQueue::push().
+     * Returns the number of interfaces that accepted the frames, or a negative error code.
+     */
+    int enqueue(const ICanFrameSequence& frames, MonotonicTime tx_deadline, uint8_t iface_mask, CanIOFlags flags);
+
     int receive(CanRxFrame& out_frame, MonotonicTime blocking_deadline, CanIOFlags& out_flags);
+
+    /**
+     * Same as receive(), but collects up to max_frames frames after a single select() call.
+     * The output capacity is split evenly between the interfaces that are ready for reading, so that a saturated
+     * interface can't starve the others.
+     * At most @ref CanRxBatchSize frames are returned regardless of max_frames.
+     * Returns:
+     *  0 - timed out, or the driver was woken up, see isWakeupPending()
+     *  1+ - number of frames received
+     *  negative - failure
+     */
+    int receiveBatch(CanRxFrame* out_frames, CanIOFlags* out_flags, unsigned max_frames,
+                     MonotonicTime blocking_deadline);
+
+    /**
+     * Whether the driver has reported a wakeup (see CanSelectMasks::wakeup) that was not yet yielded.
+     * A wakeup makes receive() return before the blocking deadline, even if no frames were received; until it is
+     * yielded, receive() does not block at all.
+     */
+    bool isWakeupPending() const { return wakeup_pending_; }
+
+    /**
+     * Returns whether a wakeup was pending, and clears it.
+     */
+    bool yieldWakeup()
+    {
+        const bool res = wakeup_pending_;
+        wakeup_pending_ = false;
+        return res;
+    }
 };
 
 }
@@ -30,6 +30,9 @@ class UAVCAN_EXPORT TransferCRC
 #if !UAVCAN_TINY
     static const uint16_t Table[256];
 #endif
+#if UAVCAN_CRC_SLICE_BY_8
+    static uint16_t addSliceBy8(uint16_t crc, const uint8_t* bytes, unsigned len);
+#endif
 
     uint16_t value_;
 
@@ -66,6 +69,15 @@ public:
     void add(const uint8_t* bytes, unsigned len)
     {
         UAVCAN_ASSERT(bytes);
+#if UAVCAN_CRC_SLICE_BY_8
+        if (len >= 8)
+        {
+            const unsigned sliced_len = len & ~7U;
+            value_ = addSliceBy8(value_, bytes, sliced_len);
+            bytes += sliced_len;
+            len -= sliced_len;
+        }
+#endif
         while (len--)
         {
             add(*bytes++);
@@ -78,6 +90,9 @@ public:
 class UAVCAN_EXPORT TransferCRC32
 {
     static const uint32_t Table[256];
+#if UAVCAN_CRC_SLICE_BY_8
+    static uint32_t addSliceBy8(uint32_t crc, const uint8_t* bytes, unsigned len);
+#endif
 
     uint32_t value_;
 
@@ -96,6 +111,15 @@ public:
     void add(const uint8_t* bytes, unsigned len)
     {
         UAVCAN_ASSERT(bytes);
+#if UAVCAN_CRC_SLICE_BY_8
+        if (len >= 8)
+        {
+            const unsigned sliced_len = len & ~7U;
+            value_ = addSliceBy8(value_, bytes, sliced_len);
+            bytes += sliced_len;
+            len -= sliced_len;
+        }
+#endif
         while (len--)
         {
             add(*bytes++);
@@ -107,6 +131,10 @@ public:
 
 class UAVCAN_EXPORT TransferCRC48
 {
+#if UAVCAN_CRC_SLICE_BY_8
+    static uint64_t addSliceBy8(uint64_t crc, const uint8_t* bytes, unsigned len);
+#endif
+
     uint64_t value_;
 
 public:
@@ -130,9 +158,22 @@ public:
         }
     }
 
+    /**
+     * Note that the output is XORed with a constant at the end of every call, so the result depends on
+     * how the data is split between calls.
+     */
     void add(const uint8_t* bytes, unsigned len)
     {
         UAVCAN_ASSERT(bytes);
+#if UAVCAN_CRC_SLICE_BY_8
+        if (len >= 8)
+        {
+            const unsigned sliced_len = len & ~7U;
+            value_ = addSliceBy8(value_, bytes, sliced_len);
+            bytes += sliced_len;
+            len -= sliced_len;
+        }
+#endif
         while (len--)
         {
             add(*bytes++);
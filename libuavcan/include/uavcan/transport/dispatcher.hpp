@@ -10,6 +10,7 @@
 #include <uavcan/std.hpp>
 #include <uavcan/build_config.hpp>
 #include <uavcan/transport/perf_counter.hpp>
+#include <uavcan/transport/frame_format.hpp>
 #include <uavcan/transport/transfer_listener.hpp>
 #include <uavcan/transport/outgoing_transfer_registry.hpp>
 #include <uavcan/transport/can_io.hpp>
@@ -72,6 +73,20 @@ public:
      */
     virtual void handleRxFrame(const CanRxFrame& frame, CanIOFlags flags) = 0;
 };
+
+/**
+ * Implement this interface to be notified when transfer listeners are registered or unregistered.
+ * The notification is delivered after the change took effect, from the same context.
+ * A change of the service request type is also reported when the local node ID is assigned, since that changes
+ * which service requests the node receives.
+ */
+class UAVCAN_EXPORT ITransferListenerRegistryObserver
+{
+public:
+    virtual ~ITransferListenerRegistryObserver() { }
+
+    virtual void handleTransferListenerRegistryChange(TransferType transfer_type) = 0;
+};
 #endif
 
 /**
@@ -88,6 +103,29 @@ class UAVCAN_EXPORT Dispatcher : Noncopyable
     {
         LinkedListRoot<TransferListener> list_;
 
+#if UAVCAN_DISPATCHER_LISTENER_INDEX_SIZE > 0
+        /**
+         * Points to the first listener of every distinct data type ID in the list.
+         * Entries follow the list order, i.e. data type IDs are descending.
+         * The index is rebuilt on every registration change, which is rare compared to frame reception.
+         */
+        struct IndexEntry
+        {
+            TransferListener* first;
+            uint16_t data_type_id;
+        };
+        IndexEntry index_[UAVCAN_DISPATCHER_LISTENER_INDEX_SIZE];
+        uint16_t index_len_;
+        bool index_overflow_;
+
+        void rebuildIndex();
+#endif
+
+        /**
+         * Returns the first listener of the specified data type ID; the rest of them follow it in the list.
+         */
+        TransferListener* findFirst(DataTypeID dtid) const;
+
         class DataTypeIDInsertionComparator
         {
             const DataTypeID id_;
@@ -103,6 +141,13 @@ class UAVCAN_EXPORT Dispatcher : Noncopyable
     public:
         enum Mode { UniqueListener, ManyListeners };
 
+#if UAVCAN_DISPATCHER_LISTENER_INDEX_SIZE > 0
+        ListenerRegistry()
+            : index_len_(0)
+            , index_overflow_(false)
+        { }
+#endif
+
         bool add(TransferListener* listener, Mode mode);
         void remove(TransferListener* listener);
         bool exists(DataTypeID dtid) const;
@@ -118,9 +163,55 @@ class UAVCAN_EXPORT Dispatcher : Noncopyable
     ListenerRegistry lsrv_req_;
     ListenerRegistry lsrv_resp_;
 
+#if UAVCAN_DISPATCHER_RX_PREFILTER_BITS > 0
+    /**
+     * Classifies raw CAN IDs with a few shifts and bitmap lookups, so that frames nobody is interested in are
+     * dropped before they are parsed. False positives are allowed; they are handled by the regular path.
+     * The bitmaps are rebuilt from the listener registries on every registration change.
+     */
+    class RxPrefilter
+    {
+        enum { MessageBitmapSize = UAVCAN_DISPATCHER_RX_PREFILTER_BITS / 32 };
+        enum { ServiceBitmapSize = 256 / 32 };
+
+        uint32_t messages_[MessageBitmapSize];
+        uint32_t requests_[ServiceBitmapSize];
+        uint32_t responses_[ServiceBitmapSize];
+
+        static void rebuild(uint32_t* bitmap, unsigned bitmap_size, const LinkedListRoot<TransferListener>& list);
+
+        static bool test(const uint32_t* bitmap, unsigned bit)
+        {
+            return (bitmap[bit >> 5] & (1UL << (bit & 31U))) != 0;
+        }
+
+    public:
+        RxPrefilter()
+        {
+            StaticAssert<((UAVCAN_DISPATCHER_RX_PREFILTER_BITS & (UAVCAN_DISPATCHER_RX_PREFILTER_BITS - 1)) == 0)>::check();
+            StaticAssert<(UAVCAN_DISPATCHER_RX_PREFILTER_BITS >= 32)>::check();
+            StaticAssert<(UAVCAN_DISPATCHER_RX_PREFILTER_BITS <= 65536)>::check();
+            fill_n(messages_, unsigned(MessageBitmapSize), uint32_t(0));
+            fill_n(requests_, unsigned(ServiceBitmapSize), uint32_t(0));
+            fill_n(responses_, unsigned(ServiceBitmapSize), uint32_t(0));
+        }
+
+        void rebuild(TransferType transfer_type, const LinkedListRoot<TransferListener>& list);
+
+        /**
+         * Returns false if the frame can be dropped. Frames that are not valid UAVCAN frames are always
+         * accepted, so that they are rejected and traced by the parser as before.
+         */
+        bool accept(uint32_t can_id, NodeID self_node_id) const;
+    };
+
+    RxPrefilter rx_prefilter_;
+#endif
+
 #if !UAVCAN_TINY
     LoopbackFrameListenerRegistry loopback_listeners_;
     IRxFrameListener* rx_listener_;
+    ITransferListenerRegistryObserver* listener_registry_observer_;
 #endif
 
     NodeID self_node_id_;
@@ -129,41 +220,83 @@ class UAVCAN_EXPORT Dispatcher : Noncopyable
     void handleFrame(const CanRxFrame& can_frame);
     void handleLoopbackFrame(const CanRxFrame& can_frame);
 
+    template <typename Format>
     void handleFrame(RxFrame& frame, const CanRxFrame& can_frame);
+    template <typename Format>
     void handleLoopbackFrame(RxFrame& frame, const CanRxFrame& can_frame);
 
     void notifyRxFrameListener(const CanRxFrame& can_frame, CanIOFlags flags);
+    void notifyListenerRegistryObserver(TransferType transfer_type);
+
+    int handleBatch(const CanRxFrame* can_frames, const CanIOFlags* flags, int num_frames);
+    template <typename Format>
+    int handleBatch(RxFrame& frame, const CanRxFrame* can_frames, const CanIOFlags* flags, int num_frames);
+
+    bool isSentByThisNode(const CanFrame& can_frame) const;
 
 public:
     Dispatcher(ICanDriver& driver, IPoolAllocator& allocator, ISystemClock& sysclock)
         : canio_(driver, allocator, sysclock)
         , sysclock_(sysclock)
-        , outgoing_transfer_reg_(allocator)
 #if !UAVCAN_TINY
         , rx_listener_(UAVCAN_NULLPTR)
+        , listener_registry_observer_(UAVCAN_NULLPTR)
 #endif
         , self_node_id_(NodeID::Broadcast)  // Default
         , self_node_id_is_set_(false)
     { }
 
     /**
-     * This version returns strictly when the deadline is reached.
+     * This version returns strictly when the deadline is reached, or earlier if the CAN driver reports a wakeup
+     * (see CanSelectMasks::wakeup); the wakeup is left pending in the CAN IO manager.
      */
     int spin(MonotonicTime deadline);
-    int spin(RxFrame& frame, MonotonicTime deadline);
 
     /**
      * This version does not return until all available frames are processed.
+     * Frames are fetched from the driver in batches of up to @ref CanRxBatchSize per select() call.
      */
     int spinOnce();
+
+    /**
+     * Same as above, but the frames are decoded into the caller's frame object by the codec of the given frame
+     * format, see frame_format.hpp; the frame type of the object is preserved. Unlike the versions above, only
+     * the frames addressed to this node are processed and the RX prefilter is not applied.
+     */
+    template <typename Format>
+    int spin(RxFrame& frame, MonotonicTime deadline);
+    int spin(RxFrame& frame, MonotonicTime deadline) { return spin<StandardFrameFormat>(frame, deadline); }
+
+    template <typename Format>
     int spinOnce(RxFrame& frame);
+    int spinOnce(RxFrame& frame) { return spinOnce<StandardFrameFormat>(frame); }
 
     /**
-     * Refer to CanIOManager::send() for the parameter description
+     * Refer to CanIOManager::send() for the parameter description.
+     * The templated version encodes the frame with the codec of the given frame format, see frame_format.hpp.
      */
+    int send(const Frame& frame, MonotonicTime tx_deadline, MonotonicTime blocking_deadline,
+             CanIOFlags flags, uint8_t iface_mask)
+    {
+        return send<StandardFrameFormat>(frame, tx_deadline, blocking_deadline, flags, iface_mask);
+    }
+
+    template <typename Format>
     int send(const Frame& frame, MonotonicTime tx_deadline, MonotonicTime blocking_deadline,
              CanIOFlags flags, uint8_t iface_mask);
 
+    /**
+     * Sends the compiled frames of one transfer in order, see Frame::compile().
+     * Refer to CanIOManager::sendBatch() for the parameter description
+     */
+    int sendBatch(const CanFrame* frames, unsigned num_frames, MonotonicTime tx_deadline,
+                  MonotonicTime blocking_deadline, CanIOFlags flags, uint8_t iface_mask);
+
+    /**
+     * Refer to CanIOManager::enqueue() for the parameter description
+     */
+    int enqueue(const ICanFrameSequence& frames, MonotonicTime tx_deadline, CanIOFlags flags, uint8_t iface_mask);
+
     void cleanup(MonotonicTime ts);
 
     bool registerMessageListener(TransferListener* listener);
@@ -217,6 +350,17 @@ public:
         UAVCAN_ASSERT(listener != UAVCAN_NULLPTR);
         rx_listener_ = listener;
     }
+
+    ITransferListenerRegistryObserver* getTransferListenerRegistryObserver() const
+    {
+        return listener_registry_observer_;
+    }
+    void removeTransferListenerRegistryObserver() { listener_registry_observer_ = UAVCAN_NULLPTR; }
+    void installTransferListenerRegistryObserver(ITransferListenerRegistryObserver* observer)
+    {
+        UAVCAN_ASSERT(observer != UAVCAN_NULLPTR);
+        listener_registry_observer_ = observer;
+    }
 #endif
 
     /**
@@ -241,6 +385,152 @@ public:
     TransferPerfCounter& getTransferPerfCounter() { return perf_; }
 };
 
+// ----------------------------------------------------------------------------
+
+template <typename Format>
+void Dispatcher::handleFrame(RxFrame& frame, const CanRxFrame& can_frame)
+{
+    if (!frame.parse<Format>(can_frame))
+    {
+        // This is not counted as a transport error
+        UAVCAN_TRACE("Dispatcher", "Invalid CAN frame received: %s", can_frame.toString().c_str());
+        return;
+    }
+
+    if (frame.getDstNodeID() != getNodeID())
+    {
+        return;
+    }
+
+    switch (frame.getTransferType())
+    {
+    case TransferTypeMessageBroadcast:
+    {
+        lmsg_.handleFrame(frame);
+        break;
+    }
+    case TransferTypeServiceRequest:
+    {
+        lsrv_req_.handleFrame(frame);
+        break;
+    }
+    case TransferTypeServiceResponse:
+    {
+        lsrv_resp_.handleFrame(frame);
+        break;
+    }
+    default:
+    {
+        UAVCAN_ASSERT(0);
+        break;
+    }
+    }
+}
+
+template <typename Format>
+void Dispatcher::handleLoopbackFrame(RxFrame& frame, const CanRxFrame& can_frame)
+{
+#if UAVCAN_TINY
+    (void)frame;
+    (void)can_frame;
+#else
+    if (!frame.parse<Format>(can_frame))
+    {
+        UAVCAN_TRACE("Dispatcher", "Invalid loopback CAN frame: %s", can_frame.toString().c_str());
+        UAVCAN_ASSERT(0);  // No way!
+        return;
+    }
+    UAVCAN_ASSERT(frame.getSrcNodeID() == getNodeID());
+    loopback_listeners_.invokeListeners(frame);
+#endif
+}
+
+template <typename Format>
+int Dispatcher::handleBatch(RxFrame& frame, const CanRxFrame* can_frames, const CanIOFlags* flags, int num_frames)
+{
+    int num_frames_processed = 0;
+    for (int i = 0; i < num_frames; i++)
+    {
+        if (flags[i] & CanIOFlagLoopback)
+        {
+            handleLoopbackFrame<Format>(frame, can_frames[i]);
+        }
+        else
+        {
+            num_frames_processed++;
+            handleFrame<Format>(frame, can_frames[i]);
+        }
+        notifyRxFrameListener(can_frames[i], flags[i]);
+    }
+    return num_frames_processed;
+}
+
+template <typename Format>
+int Dispatcher::spin(RxFrame& frame, MonotonicTime deadline)
+{
+    int num_frames_processed = 0;
+    CanRxFrame can_frames[CanRxBatchSize];
+    CanIOFlags flags[CanRxBatchSize];
+    do
+    {
+        const int res = canio_.receiveBatch(can_frames, flags, CanRxBatchSize, deadline);
+        if (res < 0)
+        {
+            return res;
+        }
+        num_frames_processed += handleBatch<Format>(frame, can_frames, flags, res);
+    }
+    while ((sysclock_.getMonotonic() < deadline) && !canio_.isWakeupPending());
+
+    return num_frames_processed;
+}
+
+template <typename Format>
+int Dispatcher::spinOnce(RxFrame& frame)
+{
+    int num_frames_processed = 0;
+    CanRxFrame can_frames[CanRxBatchSize];
+    CanIOFlags flags[CanRxBatchSize];
+    while (true)
+    {
+        const int res = canio_.receiveBatch(can_frames, flags, CanRxBatchSize, MonotonicTime());
+        if (res < 0)
+        {
+            return res;
+        }
+        else if (res > 0)
+        {
+            num_frames_processed += handleBatch<Format>(frame, can_frames, flags, res);
+        }
+        else
+        {
+            break;      // No frames left
+        }
+    }
+
+    return num_frames_processed;
+}
+
+template <typename Format>
+int Dispatcher::send(const Frame& frame, MonotonicTime tx_deadline, MonotonicTime blocking_deadline,
+                     CanIOFlags flags, uint8_t iface_mask)
+{
+    if (frame.getSrcNodeID() != getNodeID())
+    {
+        UAVCAN_ASSERT(0);
+        return -ErrLogic;
+    }
+
+    CanFrame can_frame;
+    if (!Format::compile(frame, can_frame))
+    {
+        UAVCAN_TRACE("Dispatcher", "Unable to send: frame is malformed: %s", frame.toString().c_str());
+        UAVCAN_ASSERT(0);
+        return -ErrLogic;
+    }
+    return canio_.send(can_frame, tx_deadline, blocking_deadline, iface_mask, flags);
+}
+
 }
 
 #endif // UAVCAN_TRANSPORT_DISPATCHER_HPP_INCLUDED
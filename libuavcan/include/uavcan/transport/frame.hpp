@@ -14,22 +14,30 @@
 namespace uavcan
 {
 
+/**
+ * The frame is copied on every reception and transmission, so it has no virtual methods and its fields are
+ * ordered to avoid padding; see also RxFrame.
+ */
 class UAVCAN_EXPORT Frame
 {
 public:
-    enum { PayloadCapacity = 8 };       // Will be redefined when CAN FD is available
+#if UAVCAN_CAN_FD
+    enum { PayloadCapacity = CanFrame::MaxDataLen - 1 };    // The last byte of a CAN FD frame is the tail byte
+#else
+    enum { PayloadCapacity = 8 };
+#endif
 
     uint8_t payload_[PayloadCapacity];
-    TransferPriority transfer_priority_;
-    TransferType transfer_type_;
     DataTypeID data_type_id_;
-    uint_fast8_t payload_len_;
+    TransferPriority transfer_priority_;
+    uint8_t transfer_type_;             // TransferType
+    uint8_t payload_len_;
     NodeID src_node_id_;
     NodeID dst_node_id_;
     TransferID transfer_id_;
-    bool start_of_transfer_;
-    bool end_of_transfer_;
-    bool toggle_;
+    bool start_of_transfer_ : 1;
+    bool end_of_transfer_ : 1;
+    bool toggle_ : 1;
     TransferID transfer_id_base_;
     uint8_t transfer_id_auto_inc_;
     uint8_t type_;// 0: is uavcan
@@ -37,7 +45,7 @@ public:
 
     enum { FRAME_TYPE_UAVCAN = 0 };
     Frame() :
-        transfer_type_(TransferType(NumTransferTypes)),                // Invalid value
+        transfer_type_(NumTransferTypes),                       // Invalid value
         payload_len_(0),
         start_of_transfer_(false),
         end_of_transfer_(false),
@@ -48,7 +56,7 @@ public:
     { }
 
     Frame(uint8_t type) :
-        transfer_type_(TransferType(NumTransferTypes)),                // Invalid value
+        transfer_type_(NumTransferTypes),                       // Invalid value
         payload_len_(0),
         start_of_transfer_(false),
         end_of_transfer_(false),
@@ -63,9 +71,9 @@ public:
           NodeID src_node_id,
           NodeID dst_node_id,
           TransferID transfer_id) :
-        transfer_priority_(TransferPriority::Default),
-        transfer_type_(transfer_type),
         data_type_id_(data_type_id),
+        transfer_priority_(TransferPriority::Default),
+        transfer_type_(static_cast<uint8_t>(transfer_type)),
         payload_len_(0),
         src_node_id_(src_node_id),
         dst_node_id_(dst_node_id),
@@ -108,8 +116,8 @@ public:
     unsigned getPayloadLen() const { return payload_len_; }
     const uint8_t* getPayloadPtr() const { return payload_; }
 
-    TransferType getTransferType() const { return transfer_type_; }
-    void setTransferType(TransferType type) { transfer_type_ = type; }
+    TransferType getTransferType() const { return TransferType(transfer_type_); }
+    void setTransferType(TransferType type) { transfer_type_ = static_cast<uint8_t>(type); }
     DataTypeID getDataTypeID()     const { return data_type_id_; }
     void setDataTypeID(DataTypeID id)     { data_type_id_ = id; }
     NodeID getSrcNodeID()          const { return src_node_id_; }
@@ -131,9 +139,29 @@ public:
     bool getToggle() const { return toggle_; }
 
 
-    virtual bool parse(const CanFrame& can_frame);
-    virtual bool compile(CanFrame& can_frame) const;
-    virtual bool isValid() const;
+    bool parse(const CanFrame& can_frame);
+    bool compile(CanFrame& can_frame) const;
+    bool isValid() const;
+
+    /**
+     * Same as isValid(), but ignores the fields that may differ between frames of a transfer, i.e. the tail byte
+     * and the payload.
+     */
+    bool isHeaderValid() const;
+
+    /**
+     * Returns the CAN ID of this frame without the parts that may differ between frames (i.e. the discriminator
+     * of anonymous frames), or zero if the header of the frame is not valid, see isHeaderValid().
+     * The result depends only on the priority, data type ID, transfer type and node IDs, so it can be computed
+     * once and then reused for all frames of the transfers that have the same values of these fields.
+     */
+    uint32_t makeCanIdTemplate() const;
+
+    /**
+     * Same as compile(), but the CAN ID is taken from the template, see makeCanIdTemplate(); only the fields that
+     * may differ between frames are validated.
+     */
+    bool compile(CanFrame& can_frame, uint32_t can_id_template) const;
 
     bool operator!=(const Frame& rhs) const { return !operator==(rhs); }
     bool operator==(const Frame& rhs) const;
@@ -144,12 +172,15 @@ public:
 };
 
 
+/**
+ * The interface index is declared first so that it can occupy the tail padding of the base class.
+ */
 class UAVCAN_EXPORT RxFrame : public Frame
 {
 public:
+    uint8_t iface_index_;
     MonotonicTime ts_mono_;
     UtcTime ts_utc_;
-    uint8_t iface_index_;
 
     RxFrame()
         : iface_index_(0)
@@ -161,14 +192,29 @@ public:
     { }
 
     RxFrame(const Frame& frame, MonotonicTime ts_mono, UtcTime ts_utc, uint8_t iface_index)
-        : ts_mono_(ts_mono)
-        , ts_utc_(ts_utc)
+        : Frame(frame)
         , iface_index_(iface_index)
+        , ts_mono_(ts_mono)
+        , ts_utc_(ts_utc)
+    { }
+
+    bool parse(const CanRxFrame& can_frame);
+
+    /**
+     * Same as above, but the CAN frame is decoded by the codec of the given frame format, see frame_format.hpp.
+     * The frame type is left as is.
+     */
+    template <typename Format>
+    bool parse(const CanRxFrame& can_frame)
     {
-        *static_cast<Frame*>(this) = frame;
+        return Format::parse(can_frame, *this) && setRxInfo(can_frame);
     }
 
-    virtual bool parse(const CanRxFrame& can_frame);
+    /**
+     * Copies the timestamps and the interface index of a received CAN frame.
+     * Returns false if the frame has no monotonic timestamp.
+     */
+    bool setRxInfo(const CanRxFrame& can_frame);
 
     /**
      * Can't be zero.
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2014 Pavel Kirienko <pavel.kirienko@gmail.com>
+ */
+
+#ifndef UAVCAN_TRANSPORT_FRAME_FORMAT_HPP_INCLUDED
+#define UAVCAN_TRANSPORT_FRAME_FORMAT_HPP_INCLUDED
+
+#include <uavcan/build_config.hpp>
+#include <uavcan/transport/frame.hpp>
+#include <uavcan/transport/crc.hpp>
+
+namespace uavcan
+{
+/**
+ * Frame format policies tell the transport layer how the frames of one frame format are encoded and how their
+ * transfers are laid out.
+ *
+ * A policy defines:
+ *  - parse()               Decodes a CAN frame into a Frame, see Frame::parse(). Used by RxFrame::parse<>()
+ *                          and by the spin path that takes a frame object, see Dispatcher::spin<>().
+ *  - compile()             Encodes a Frame into a CAN frame, see Frame::compile(). Used by Dispatcher::send<>().
+ *  - TransferCrcLen        Number of transfer CRC bytes that lead a multi-frame transfer; either zero or
+ *                          TransferCRC::NumBytes.
+ *  - ValidatesTransfers    Whether the receiver enforces the transfer ID, toggle bit, interface and timing rules
+ *                          of the protocol; otherwise the frames are accepted in the order of arrival.
+ *
+ * The codec and the transfer layout are independent: the codec sets the frame fields and leaves the frame type
+ * alone, whereas TransferReceiver::addFrame<>(), TransferListener::handleFrame<>() and TransferSender::send<>()
+ * take the transfer layout from their template argument. The non-templated entry points select the layout by
+ * Frame::getFrameType(). Note that the transfer sender always encodes frames with the standard CAN ID layout,
+ * see Frame::makeCanIdTemplate(); a proprietary CAN ID layout can only be sent frame by frame with
+ * Dispatcher::send<>().
+ *
+ * A proprietary codec is defined by inheriting one of the policies below and hiding parse() and compile().
+ */
+struct UAVCAN_EXPORT StandardFrameFormat
+{
+    enum { FrameType = Frame::FRAME_TYPE_UAVCAN };
+    enum { TransferCrcLen = TransferCRC::NumBytes };
+    enum { ValidatesTransfers = 1 };
+
+    static bool matches(const Frame& frame) { return frame.getFrameType() == FrameType; }
+
+    static bool parse(const CanFrame& can_frame, Frame& out_frame) { return out_frame.parse(can_frame); }
+
+    static bool compile(const Frame& frame, CanFrame& out_can_frame) { return frame.compile(out_can_frame); }
+};
+
+/**
+ * Non-UAVCAN frames, i.e. Frame::getFrameType() is not zero: the transfers carry no CRC and their frames are not
+ * validated, the payload is reassembled as it arrives. The frames use the standard CAN ID layout.
+ */
+struct UAVCAN_EXPORT RawFrameFormat
+{
+    enum { TransferCrcLen = 0 };
+    enum { ValidatesTransfers = 0 };
+
+    static bool parse(const CanFrame& can_frame, Frame& out_frame) { return out_frame.parse(can_frame); }
+
+    static bool compile(const Frame& frame, CanFrame& out_can_frame) { return frame.compile(out_can_frame); }
+};
+
+}
+
+#endif // UAVCAN_TRANSPORT_FRAME_FORMAT_HPP_INCLUDED
@@ -8,8 +8,9 @@
 #include <cassert>
 #include <uavcan/std.hpp>
 #include <uavcan/build_config.hpp>
-#include <uavcan/util/map.hpp>
+#include <uavcan/util/templates.hpp>
 #include <uavcan/debug.hpp>
+#include <uavcan/data_type.hpp>
 #include <uavcan/transport/transfer.hpp>
 #include <uavcan/time.hpp>
 
@@ -42,6 +43,7 @@ public:
 
     DataTypeID getDataTypeID() const { return data_type_id_; }
     TransferType getTransferType() const { return TransferType(transfer_type_); }
+    NodeID getDestinationNodeID() const { return destination_node_id_; }
 
     bool operator==(const OutgoingTransferRegistryKey& rhs) const
     {
@@ -60,69 +62,71 @@ public:
  * Outgoing transfer registry keeps track of Transfer ID values for all currently existing local transfer senders.
  * If a local transfer sender was inactive for a sufficiently long time, the outgoing transfer registry will
  * remove the respective Transfer ID tracking object.
+ *
+ * The entries are stored in a fixed-size open addressing hash table with linear probing, see
+ * UAVCAN_OUTGOING_TRANSFER_REGISTRY_SLOTS. Removed entries are backfilled by the following ones of the same probe
+ * sequence, so that there are no tombstones and a lookup stops at the first empty slot.
+ *
+ * Complexity of accessOrCreate() is O(1). cleanup() returns immediately until the earliest deadline is reached,
+ * and only then sweeps the table in O(N); exists() is O(N).
  */
 class UAVCAN_EXPORT OutgoingTransferRegistry : Noncopyable
 {
-    struct Value
+    struct Slot
     {
-        MonotonicTime deadline;
+        MonotonicTime deadline;         ///< Zero if the slot is empty
+        uint32_t key;
         TransferID tid;
     };
 
-    class DeadlineExpiredPredicate
+    enum { NumSlots = UAVCAN_OUTGOING_TRANSFER_REGISTRY_SLOTS };
+    enum { SlotIndexMask = NumSlots - 1 };
+
+    Slot slots_[NumSlots];
+    MonotonicTime earliest_deadline_;   ///< Lower bound of the deadlines of all entries
+    uint16_t num_entries_;
+
+    static uint32_t packKey(const OutgoingTransferRegistryKey& key)
     {
-        const MonotonicTime ts_;
-
-    public:
-        explicit DeadlineExpiredPredicate(MonotonicTime ts)
-            : ts_(ts)
-        { }
-
-        bool operator()(const OutgoingTransferRegistryKey& key, const Value& value) const
-        {
-            (void)key;
-            UAVCAN_ASSERT(!value.deadline.isZero());
-            const bool expired = value.deadline <= ts_;
-            if (expired)
-            {
-                UAVCAN_TRACE("OutgoingTransferRegistry", "Expired %s tid=%i",
-                             key.toString().c_str(), int(value.tid.get()));
-            }
-            return expired;
-        }
-    };
+        return (uint32_t(key.getDataTypeID().get()) << 16) |
+               (uint32_t(key.getTransferType()) << 8) |
+               uint32_t(key.getDestinationNodeID().get());
+    }
 
-    class ExistenceCheckingPredicate
+    static unsigned getHomeIndex(uint32_t packed_key)
     {
-        const DataTypeID dtid_;
-        const TransferType tt_;
-
-    public:
-        ExistenceCheckingPredicate(DataTypeID dtid, TransferType tt)
-            : dtid_(dtid)
-            , tt_(tt)
-        { }
-
-        bool operator()(const OutgoingTransferRegistryKey& key, const Value&) const
-        {
-            return dtid_ == key.getDataTypeID() && tt_ == key.getTransferType();
-        }
-    };
+        const uint32_t hash = packed_key * 2654435761U;     // Knuth's multiplicative hash
+        return unsigned(hash ^ (hash >> 16)) & unsigned(SlotIndexMask);
+    }
 
-    Map<OutgoingTransferRegistryKey, Value> map_;
+    void removeAt(unsigned index);
 
 public:
     static const MonotonicDuration MinEntryLifetime;
 
-    explicit OutgoingTransferRegistry(IPoolAllocator& allocator)
-        : map_(allocator)
-    { }
+    /**
+     * Maximum number of entries.
+     */
+    enum { Capacity = NumSlots - NumSlots / 4 };
 
+    OutgoingTransferRegistry()
+        : num_entries_(0)
+    {
+        StaticAssert<(NumSlots >= 4) && ((NumSlots & SlotIndexMask) == 0)>::check();
+        StaticAssert<(Capacity <= 0xFFFF)>::check();
+    }
+
+    /**
+     * Returns null pointer if the registry is full.
+     * The returned pointer is valid until the next call of this method or of cleanup().
+     */
     TransferID* accessOrCreate(const OutgoingTransferRegistryKey& key, MonotonicTime new_deadline);
 
     bool exists(DataTypeID dtid, TransferType tt) const;
 
     void cleanup(MonotonicTime ts);
+
+    unsigned getSize() const { return num_entries_; }
 };
 
 }
@@ -94,6 +94,41 @@ public:
 #endif
 };
 
+/**
+ * Contiguous storage for up to @ref NumSlots transfer buffers of the same size, see
+ * UAVCAN_TRANSFER_BUFFER_ARENA_SLOTS (disabled by default). The memory is reserved with std::malloc() on the first
+ * slot allocation.
+ * If the arena is disabled, slot allocation always fails.
+ */
+class UAVCAN_EXPORT TransferBufferArena : Noncopyable
+{
+    uint8_t* memory_;
+    uint32_t used_slots_mask_;
+    const uint16_t slot_size_;
+
+public:
+    enum { NumSlots = UAVCAN_TRANSFER_BUFFER_ARENA_SLOTS };
+
+    explicit TransferBufferArena(uint16_t slot_size) :
+        memory_(UAVCAN_NULLPTR),
+        used_slots_mask_(0),
+        slot_size_(slot_size)
+    {
+        StaticAssert<(NumSlots <= 32)>::check();
+    }
+
+    ~TransferBufferArena();
+
+    /**
+     * Returns null if all slots are in use or the memory could not be reserved.
+     */
+    uint8_t* allocateSlot();
+    void deallocateSlot(uint8_t* slot);
+
+    uint16_t getSlotSize() const { return slot_size_; }
+    unsigned getNumUsedSlots() const;
+};
+
 /**
  * Resizable gather/scatter storage.
  * reset() call releases all memory blocks.
@@ -117,25 +152,36 @@ class UAVCAN_EXPORT TransferBufferManagerEntry : public ITransferBuffer
     };
 
     IPoolAllocator& allocator_;
+    TransferBufferArena* const arena_;
+    uint8_t* arena_slot_;             // If set, the data is stored here and the block list is empty
     LinkedListRoot<Block> blocks_;    // Blocks are ordered from lower to higher buffer offset
     uint16_t max_write_pos_;
     const uint16_t max_size_;
     TransferBufferManagerKey key_;
 
 public:
-    TransferBufferManagerEntry(IPoolAllocator& allocator, uint16_t max_size) :
+    /**
+     * @param arena     Optional; if set, the buffer will take an arena slot on the first write if there is
+     *                  a free one. Otherwise the data will be stored in memory pool blocks.
+     */
+    TransferBufferManagerEntry(IPoolAllocator& allocator, uint16_t max_size,
+                               TransferBufferArena* arena = UAVCAN_NULLPTR) :
         allocator_(allocator),
+        arena_(arena),
+        arena_slot_(UAVCAN_NULLPTR),
         max_write_pos_(0),
         max_size_(max_size)
     {
         StaticAssert<(Block::Size > 8)>::check();
         IsDynamicallyAllocatable<Block>::check();
         IsDynamicallyAllocatable<TransferBufferManagerEntry>::check();
+        UAVCAN_ASSERT((arena == UAVCAN_NULLPTR) || (arena->getSlotSize() >= max_size));
     }
 
     virtual ~TransferBufferManagerEntry() { reset(); }
 
-    static TransferBufferManagerEntry* instantiate(IPoolAllocator& allocator, uint16_t max_size);
+    static TransferBufferManagerEntry* instantiate(IPoolAllocator& allocator, uint16_t max_size,
+                                                   TransferBufferArena* arena = UAVCAN_NULLPTR);
     static void destroy(TransferBufferManagerEntry*& obj, IPoolAllocator& allocator);
 
     virtual int read(unsigned offset, uint8_t* data, unsigned len) const;
@@ -143,6 +189,12 @@ public:
 
     void reset(const TransferBufferManagerKey& key = TransferBufferManagerKey());
 
+    /**
+     * Returns the data if it is stored contiguously in the arena, null otherwise.
+     */
+    const uint8_t* getContiguousData() const { return arena_slot_; }
+    uint16_t getMaxWritePos() const { return max_write_pos_; }
+
     const TransferBufferManagerKey& getKey() const { return key_; }
     bool isEmpty() const { return key_.isEmpty(); }
 };
@@ -154,13 +206,20 @@ class TransferBufferManager : public Noncopyable
 {
     LinkedListRoot<TransferBufferManagerEntry> buffers_;
     IPoolAllocator& allocator_;
+    TransferBufferArena* const arena_;
     const uint16_t max_buf_size_;
 
     TransferBufferManagerEntry* findFirst(const TransferBufferManagerKey& key);
 
 public:
-    TransferBufferManager(uint16_t max_buf_size, IPoolAllocator& allocator) :
+    /**
+     * @param arena     Optional contiguous storage for the buffers, see @ref TransferBufferArena.
+     *                  Its slot size must not be less than max_buf_size.
+     */
+    TransferBufferManager(uint16_t max_buf_size, IPoolAllocator& allocator,
+                          TransferBufferArena* arena = UAVCAN_NULLPTR) :
         allocator_(allocator),
+        arena_(arena),
         max_buf_size_(max_buf_size)
     { }
 
@@ -168,6 +227,12 @@ public:
 
     ITransferBuffer* access(const TransferBufferManagerKey& key);
     ITransferBuffer* create(const TransferBufferManagerKey& key);
+
+    /**
+     * Returns the buffer contents and length if the buffer is stored contiguously, null otherwise.
+     */
+    const uint8_t* accessContiguous(const TransferBufferManagerKey& key, unsigned& out_len);
+
     void remove(const TransferBufferManagerKey& key);
     bool isEmpty() const;
 
@@ -191,6 +256,7 @@ public:
     }
     ITransferBuffer* access() { return bufmgr_.access(key_); }
     ITransferBuffer* create() { return bufmgr_.create(key_); }
+    const uint8_t* accessContiguous(unsigned& out_len) { return bufmgr_.accessContiguous(key_, out_len); }
     void remove() { bufmgr_.remove(key_); }
 };
 
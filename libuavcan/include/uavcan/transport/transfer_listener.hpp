@@ -11,7 +11,6 @@
 #include <uavcan/transport/transfer_receiver.hpp>
 #include <uavcan/transport/perf_counter.hpp>
 #include <uavcan/util/linked_list.hpp>
-#include <uavcan/util/map.hpp>
 #include <uavcan/debug.hpp>
 #include <uavcan/transport/crc.hpp>
 #include <uavcan/data_type.hpp>
@@ -30,6 +29,8 @@ class UAVCAN_EXPORT IncomingTransfer : public ITransferBuffer
     TransferID transfer_id_;
     NodeID src_node_id_;
     uint8_t iface_index_;
+    mutable const uint8_t* flat_payload_;     ///< Set by getPayloadView() once the payload has been flattened
+    mutable uint16_t flat_payload_len_;
 
     /// That's a no-op, asserts in debug builds
     virtual int write(unsigned offset, const uint8_t* data, unsigned len);
@@ -45,6 +46,8 @@ protected:
         , transfer_id_(transfer_id)
         , src_node_id_(source_node_id)
         , iface_index_(iface_index)
+        , flat_payload_(UAVCAN_NULLPTR)
+        , flat_payload_len_(0)
     { }
 
 public:
@@ -58,6 +61,28 @@ public:
      */
     virtual bool isAnonymousTransfer() const { return false; }
 
+    /**
+     * If the payload is stored in contiguous memory (single-frame transfers, multi-frame transfers buffered in the
+     * listener's arena, or any transfer once it has been flattened by @ref getPayloadView()), returns a pointer
+     * to it and writes its length into out_len.
+     * Otherwise returns null, and the payload can be accessed only via read().
+     */
+    virtual const uint8_t* getContiguousPayload(unsigned& out_len) const
+    {
+        out_len = flat_payload_len_;
+        return flat_payload_;
+    }
+
+    /**
+     * Returns a contiguous read-only view of the whole payload and writes its length into out_len.
+     * Single-frame transfers and transfers buffered in the arena are viewed in place, so the storage is not used;
+     * such a view is valid until release().
+     * Other transfers are flattened into the storage once, on the first call; further calls return the same view,
+     * which is valid as long as this object and the storage are, even after release().
+     * Returns null if the storage is not large enough or the payload can't be read.
+     */
+    const uint8_t* getPayloadView(unsigned& out_len, uint8_t* storage, unsigned storage_size) const;
+
     MonotonicTime getMonotonicTimestamp() const { return ts_mono_; }
     UtcTime getUtcTimestamp()             const { return ts_utc_; }
     TransferPriority getPriority()        const { return transfer_priority_; }
@@ -78,6 +103,11 @@ public:
     explicit SingleFrameIncomingTransfer(const RxFrame& frm);
     virtual int read(unsigned offset, uint8_t* data, unsigned len) const;
     virtual bool isAnonymousTransfer() const;
+    virtual const uint8_t* getContiguousPayload(unsigned& out_len) const
+    {
+        out_len = payload_len_;
+        return payload_;
+    }
 };
 
 /**
@@ -91,6 +121,7 @@ public:
                                TransferBufferAccessor& tba);
     virtual int read(unsigned offset, uint8_t* data, unsigned len) const;
     virtual void release() { buf_acc_.remove(); }
+    virtual const uint8_t* getContiguousPayload(unsigned& out_len) const;
 };
 
 /**
@@ -99,8 +130,11 @@ public:
 class UAVCAN_EXPORT TransferListener : public LinkedListNode<TransferListener>
 {
     const DataTypeDescriptor& data_type_;
+#if UAVCAN_TRANSFER_BUFFER_ARENA_SLOTS > 0
+    TransferBufferArena buffer_arena_;
+#endif
     TransferBufferManager bufmgr_;
-    Map<TransferBufferManagerKey, TransferReceiver> receivers_;
+    TransferReceiverTable receivers_;
     TransferPerfCounter& perf_;
     const TransferCRC crc_base_;                      ///< Pre-initialized with data type hash, thus constant
     const TransferCRC32 crc_base32_;                      ///< Pre-initialized with data type hash, thus constant
@@ -121,21 +155,37 @@ class UAVCAN_EXPORT TransferListener : public LinkedListNode<TransferListener>
         bool operator()(const TransferBufferManagerKey& key, const TransferReceiver& value) const;
     };
 
-    bool checkPayloadCrc(const uint64_t compare_with, const ITransferBuffer& tbb) const;
     bool checkPayloadCrc32(const uint64_t compare_with, const ITransferBuffer& tbb) const;
     bool checkPayloadCrc48(const uint64_t compare_with, const ITransferBuffer& tbb) const;
 
+    TransferReceiver* accessReceiver(const TransferBufferManagerKey& key, const RxFrame& frame);
+    void handleNonUnicastFrame(const RxFrame& frame);
+    void handleCompleteTransfer(TransferReceiver& receiver, const RxFrame& frame, TransferBufferAccessor& tba);
+
 protected:
+    template <typename Format>
     void handleReception(TransferReceiver& receiver, const RxFrame& frame, TransferBufferAccessor& tba);
     void handleAnonymousTransferReception(const RxFrame& frame);
 
+    /**
+     * Processes a frame of the given format, see frame_format.hpp. Listeners of proprietary frame formats
+     * override the virtual handleFrame() and forward the frames here.
+     */
+    template <typename Format>
+    void handleFrame(const RxFrame& frame);
+
     virtual void handleIncomingTransfer(IncomingTransfer& transfer) = 0;
 
 public:
     TransferListener(TransferPerfCounter& perf, const DataTypeDescriptor& data_type,
                      uint16_t max_buffer_size, IPoolAllocator& allocator)
         : data_type_(data_type)
+#if UAVCAN_TRANSFER_BUFFER_ARENA_SLOTS > 0
+        , buffer_arena_(max_buffer_size)
+        , bufmgr_(max_buffer_size, allocator, &buffer_arena_)
+#else
         , bufmgr_(max_buffer_size, allocator)
+#endif
         , receivers_(allocator)
         , perf_(perf)
         , crc_base_(data_type.getSignature().toTransferCRC())
@@ -156,9 +206,73 @@ public:
 
     void cleanup(MonotonicTime ts);
 
+    /**
+     * The frame format is selected by Frame::getFrameType().
+     */
     virtual void handleFrame(const RxFrame& frame);
 };
 
+// ----------------------------------------------------------------------------
+
+template <typename Format>
+void TransferListener::handleReception(TransferReceiver& receiver, const RxFrame& frame,
+                                       TransferBufferAccessor& tba)
+{
+    switch (receiver.addFrame<Format>(frame, tba, crc_base_))
+    {
+    case TransferReceiver::ResultNotComplete:
+    {
+        perf_.addErrors(receiver.yieldErrorCount());
+        break;
+    }
+    case TransferReceiver::ResultSingleFrame:
+    {
+        perf_.addRxTransfer();
+        SingleFrameIncomingTransfer it(frame);
+        handleIncomingTransfer(it);
+        break;
+    }
+    case TransferReceiver::ResultComplete:
+    {
+        perf_.addRxTransfer();
+        // The CRC is accumulated by the receiver as the payload arrives, no need to read the buffer again
+        if ((Format::TransferCrcLen > 0) && (receiver.getLastTransferComputedCrc() != receiver.getLastTransferCrc()))
+        {
+            UAVCAN_TRACE("TransferListener", "CRC mismatch, expected=0x%04x, got=0x%04x, last frame: %s",
+                         int(receiver.getLastTransferCrc()), int(receiver.getLastTransferComputedCrc()),
+                         frame.toString().c_str());
+            break;
+        }
+        handleCompleteTransfer(receiver, frame, tba);
+        break;
+    }
+    default:
+    {
+        UAVCAN_ASSERT(0);
+        break;
+    }
+    }
+}
+
+template <typename Format>
+void TransferListener::handleFrame(const RxFrame& frame)
+{
+    if (frame.getSrcNodeID().isUnicast())       // Normal transfer
+    {
+        const TransferBufferManagerKey key(frame.getSrcNodeID(), frame.getTransferType());
+        TransferReceiver* const recv = accessReceiver(key, frame);
+        if (recv != UAVCAN_NULLPTR)
+        {
+            TransferBufferAccessor tba(bufmgr_, key);
+            handleReception<Format>(*recv, frame, tba);
+        }
+    }
+    else
+    {
+        handleNonUnicastFrame(frame);
+    }
+}
+
 /**
  * This class is used by transfer listener to decide if the frame should be accepted or ignored.
  */
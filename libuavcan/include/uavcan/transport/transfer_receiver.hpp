@@ -7,8 +7,13 @@
 
 #include <cstdlib>
 #include <uavcan/build_config.hpp>
+#include <uavcan/dynamic_memory.hpp>
+#include <uavcan/util/templates.hpp>
+#include <uavcan/util/placement_new.hpp>
 #include <uavcan/transport/frame.hpp>
+#include <uavcan/transport/frame_format.hpp>
 #include <uavcan/transport/transfer_buffer.hpp>
+#include <uavcan/transport/crc.hpp>
 
 namespace uavcan
 {
@@ -43,6 +48,7 @@ private:
     uint64_t this_transfer_crc_;
 
     uint16_t buffer_write_pos_;
+    TransferCRC payload_crc_;           ///< Accumulated while the payload is being written
 
     TransferID tid_;    // 1 byte field
 
@@ -63,9 +69,15 @@ private:
     void updateTransferTimings();
     void prepareForNextTransfer();
 
-    bool validate(const RxFrame& frame) const;
-    bool writePayload(const RxFrame& frame, ITransferBuffer& buf);
-    ResultCode receive(const RxFrame& frame, TransferBufferAccessor& tba);
+    bool validate(const RxFrame& frame, unsigned transfer_crc_len) const;
+    bool acceptFrame(const RxFrame& frame, TransferBufferAccessor& tba, unsigned transfer_crc_len);
+    ITransferBuffer* accessBuffer(const RxFrame& frame, TransferBufferAccessor& tba);
+
+    template <typename Format>
+    bool writePayload(const RxFrame& frame, ITransferBuffer& buf, const TransferCRC& crc_base);
+
+    template <typename Format>
+    ResultCode receive(const RxFrame& frame, TransferBufferAccessor& tba, const TransferCRC& crc_base);
 
 public:
     TransferReceiver() :
@@ -79,18 +91,258 @@ public:
 
     bool isTimedOut(MonotonicTime current_ts) const;
 
-    ResultCode addFrame(const RxFrame& frame, TransferBufferAccessor& tba);
+    /**
+     * @param crc_base  Transfer CRC pre-initialized with the data type signature. The CRC of multi-frame transfers
+     *                  is computed on the fly, see @ref getLastTransferComputedCrc().
+     */
+    template <typename Format>
+    ResultCode addFrame(const RxFrame& frame, TransferBufferAccessor& tba,
+                        const TransferCRC& crc_base = TransferCRC());
+
+    /**
+     * Same as above; the frame format is selected by Frame::getFrameType().
+     */
+    ResultCode addFrame(const RxFrame& frame, TransferBufferAccessor& tba,
+                        const TransferCRC& crc_base = TransferCRC());
 
     uint8_t yieldErrorCount();
 
     MonotonicTime getLastTransferTimestampMonotonic() const { return prev_transfer_ts_; }
     UtcTime getLastTransferTimestampUtc() const { return first_frame_ts_; }
 
+    /**
+     * CRC of the last complete multi-frame transfer, as received and as computed over its payload.
+     */
     uint64_t getLastTransferCrc() const { return this_transfer_crc_; }
+    uint16_t getLastTransferComputedCrc() const { return payload_crc_.get(); }
 
     MonotonicDuration getInterval() const { return MonotonicDuration::fromMSec(transfer_interval_msec_); }
 };
 
+// ----------------------------------------------------------------------------
+
+template <typename Format>
+bool TransferReceiver::writePayload(const RxFrame& frame, ITransferBuffer& buf, const TransferCRC& crc_base)
+{
+    const uint8_t* payload = frame.getPayloadPtr();
+    unsigned payload_len = frame.getPayloadLen();
+
+    if ((Format::TransferCrcLen > 0) && frame.isStartOfTransfer())     // First frame contains CRC
+    {
+        if (payload_len < TransferCRC::NumBytes)
+        {
+            return false;    // Must have been validated earlier though. I think I'm paranoid.
+        }
+        this_transfer_crc_ = static_cast<uint16_t>(payload[0] & 0xFF);
+        this_transfer_crc_ |= static_cast<uint16_t>(static_cast<uint16_t>(payload[1] & 0xFF) << 8);  // Little endian.
+        payload += TransferCRC::NumBytes;
+        payload_len -= TransferCRC::NumBytes;
+        payload_crc_ = crc_base;
+    }
+
+    const int res = buf.write(buffer_write_pos_, payload, payload_len);
+    const bool success = res == static_cast<int>(payload_len);
+    if (success)
+    {
+        buffer_write_pos_ = static_cast<uint16_t>(buffer_write_pos_ + payload_len);
+        if (Format::TransferCrcLen > 0)
+        {
+            payload_crc_.add(payload, payload_len);
+        }
+    }
+    return success;
+}
+
+template <typename Format>
+TransferReceiver::ResultCode TransferReceiver::receive(const RxFrame& frame, TransferBufferAccessor& tba,
+                                                      const TransferCRC& crc_base)
+{
+    // Transfer timestamps are derived from the first frame
+    if (frame.isStartOfTransfer())
+    {
+        this_transfer_ts_ = frame.getMonotonicTimestamp();
+        first_frame_ts_   = frame.getUtcTimestamp();
+    }
+
+    if (frame.isStartOfTransfer() && frame.isEndOfTransfer())
+    {
+        tba.remove();
+        updateTransferTimings();
+        prepareForNextTransfer();
+        this_transfer_crc_ = 0;         // SFT has no CRC
+        return ResultSingleFrame;
+    }
+
+    ITransferBuffer* const buf = accessBuffer(frame, tba);
+    if (buf == UAVCAN_NULLPTR)
+    {
+        return ResultNotComplete;
+    }
+    if (!writePayload<Format>(frame, *buf, crc_base))
+    {
+        UAVCAN_TRACE("TransferReceiver", "Payload write failed, %s", frame.toString().c_str());
+        tba.remove();
+        prepareForNextTransfer();
+        registerError();
+        return ResultNotComplete;
+    }
+    next_toggle_ = !next_toggle_;
+
+    if (frame.isEndOfTransfer())
+    {
+        updateTransferTimings();
+        prepareForNextTransfer();
+        return ResultComplete;
+    }
+    return ResultNotComplete;
+}
+
+template <typename Format>
+TransferReceiver::ResultCode TransferReceiver::addFrame(const RxFrame& frame, TransferBufferAccessor& tba,
+                                                       const TransferCRC& crc_base)
+{
+    StaticAssert<(unsigned(Format::TransferCrcLen) == 0) ||
+                 (unsigned(Format::TransferCrcLen) == TransferCRC::NumBytes)>::check();
+
+    if (Format::ValidatesTransfers && !acceptFrame(frame, tba, Format::TransferCrcLen))
+    {
+        return ResultNotComplete;
+    }
+    return receive<Format>(frame, tba, crc_base);
+}
+
+/**
+ * Receiver storage of the transfer listener, directly indexed by the source node ID.
+ *
+ * The index is split into pages of node ID slots; each page and each receiver occupies one block of the pool
+ * allocator, and both are allocated lazily upon the first transfer from the respective node.
+ * Receivers of different transfer types from the same node are chained in the same slot, as well as receivers of
+ * node ID values above NodeID::AbsMax if the node ID bit length has been extended.
+ *
+ * Complexity of access() and insert() is O(1); removeAllWhere() and clear() are O(N) and release the empty pages.
+ */
+class UAVCAN_EXPORT TransferReceiverTable : Noncopyable
+{
+    struct Entry
+    {
+        TransferReceiver receiver;
+        Entry* next;
+        TransferBufferManagerKey key;
+
+        explicit Entry(const TransferBufferManagerKey& arg_key)
+            : next(UAVCAN_NULLPTR)
+            , key(arg_key)
+        {
+            IsDynamicallyAllocatable<Entry>::check();
+        }
+
+        static Entry* instantiate(IPoolAllocator& allocator, const TransferBufferManagerKey& key);
+        static void destroy(Entry*& obj, IPoolAllocator& allocator);
+    };
+
+    struct Page
+    {
+        enum { NumSlots = MemPoolBlockSize / sizeof(Entry*) };
+        Entry* slots[NumSlots];
+
+        Page()
+        {
+            IsDynamicallyAllocatable<Page>::check();
+            fill(slots, slots + NumSlots, static_cast<Entry*>(UAVCAN_NULLPTR));
+        }
+
+        bool isEmpty() const;
+    };
+
+    enum { NumIndexedNodeIDs = NodeID::AbsMax + 1 };
+    enum { NumPages = (NumIndexedNodeIDs + Page::NumSlots - 1) / Page::NumSlots };
+
+    Page* pages_[NumPages];
+    IPoolAllocator& allocator_;
+
+    static unsigned getSlotIndex(const TransferBufferManagerKey& key)
+    {
+        return unsigned(key.getNodeID().get()) % unsigned(NumIndexedNodeIDs);
+    }
+
+    Entry** accessSlot(const TransferBufferManagerKey& key) const
+    {
+        const unsigned index = getSlotIndex(key);
+        Page* const page = pages_[index / unsigned(Page::NumSlots)];
+        return (page == UAVCAN_NULLPTR) ? UAVCAN_NULLPTR : &page->slots[index % unsigned(Page::NumSlots)];
+    }
+
+    void releaseEmptyPages();
+
+public:
+    explicit TransferReceiverTable(IPoolAllocator& allocator)
+        : allocator_(allocator)
+    {
+        fill(pages_, pages_ + NumPages, static_cast<Page*>(UAVCAN_NULLPTR));
+    }
+
+    ~TransferReceiverTable() { clear(); }
+
+    /**
+     * Returns null pointer if there's no such receiver.
+     */
+    TransferReceiver* access(const TransferBufferManagerKey& key);
+
+    /**
+     * Returns the existing receiver if there is one, otherwise creates a new one.
+     * Returns null pointer if the pool allocator is exhausted.
+     */
+    TransferReceiver* insert(const TransferBufferManagerKey& key);
+
+    /**
+     * Removes receivers where the predicate returns true.
+     * Predicate prototype:
+     *  bool (const TransferBufferManagerKey& key, const TransferReceiver& receiver)
+     */
+    template <typename Predicate>
+    void removeAllWhere(Predicate predicate);
+
+    void clear();
+
+    bool isEmpty() const;
+
+    /**
+     * Complexity is O(N).
+     */
+    unsigned getSize() const;
+};
+
+template <typename Predicate>
+void TransferReceiverTable::removeAllWhere(Predicate predicate)
+{
+    for (unsigned p = 0; p < unsigned(NumPages); p++)
+    {
+        if (pages_[p] == UAVCAN_NULLPTR)
+        {
+            continue;
+        }
+        for (unsigned s = 0; s < unsigned(Page::NumSlots); s++)
+        {
+            Entry** link = &pages_[p]->slots[s];
+            while (*link != UAVCAN_NULLPTR)
+            {
+                Entry* entry = *link;
+                if (predicate(static_cast<const TransferBufferManagerKey&>(entry->key),
+                              static_cast<const TransferReceiver&>(entry->receiver)))
+                {
+                    *link = entry->next;
+                    Entry::destroy(entry, allocator_);
+                }
+                else
+                {
+                    link = &entry->next;
+                }
+            }
+        }
+    }
+    releaseEmptyPages();
+}
+
 }
 
 #endif // UAVCAN_TRANSPORT_TRANSFER_RECEIVER_HPP_INCLUDED
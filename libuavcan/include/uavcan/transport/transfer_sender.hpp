@@ -12,6 +12,7 @@
 #include <uavcan/data_type.hpp>
 #include <uavcan/transport/crc.hpp>
 #include <uavcan/transport/transfer.hpp>
+#include <uavcan/transport/frame_format.hpp>
 #include <uavcan/transport/dispatcher.hpp>
 
 namespace uavcan
@@ -31,9 +32,33 @@ class UAVCAN_EXPORT TransferSender
     CanIOFlags flags_;
     uint8_t iface_mask_;
     bool allow_anonymous_transfers_;
+    bool pipelined_;
+
+    /*
+     * The CAN ID template of the last transfer, see Frame::makeCanIdTemplate(). In most cases, a sender
+     * emits transfers to the same destination, so the template can be reused by the following transfers.
+     */
+    mutable uint32_t can_id_template_;
+    mutable uint32_t can_id_template_key_;
 
     void registerError() const;
 
+    uint32_t getCanIdTemplate(const Frame& frame) const;
+
+    static unsigned getTransferCrcLen(const Frame& frame)
+    {
+        return StandardFrameFormat::matches(frame) ? unsigned(StandardFrameFormat::TransferCrcLen)
+                                                   : unsigned(RawFrameFormat::TransferCrcLen);
+    }
+
+    int sendTransfer(Frame& frame, const uint8_t* payload, unsigned payload_len, MonotonicTime tx_deadline,
+                     MonotonicTime blocking_deadline, TransferType transfer_type, NodeID dst_node_id,
+                     TransferID tid, unsigned transfer_crc_len) const;
+
+    int sendTransfer(Frame& frame, const uint8_t* payload, unsigned payload_len, MonotonicTime tx_deadline,
+                     MonotonicTime blocking_deadline, TransferType transfer_type, NodeID dst_node_id,
+                     unsigned transfer_crc_len) const;
+
 public:
     enum { AllIfacesMask = 0xFF };
 
@@ -50,6 +75,9 @@ public:
         , flags_(CanIOFlags(0))
         , iface_mask_(AllIfacesMask)
         , allow_anonymous_transfers_(false)
+        , pipelined_(false)
+        , can_id_template_(0)
+        , can_id_template_key_(0)
     {
         init(data_type);
     }
@@ -61,6 +89,9 @@ public:
         , flags_(CanIOFlags(0))
         , iface_mask_(AllIfacesMask)
         , allow_anonymous_transfers_(false)
+        , pipelined_(false)
+        , can_id_template_(0)
+        , can_id_template_key_(0)
     { }
 
     void init(const DataTypeDescriptor& dtid);
@@ -89,6 +120,16 @@ public:
      */
     void allowAnonymousTransfers() { allow_anonymous_transfers_ = true; }
 
+    /**
+     * In pipelined mode, all frames of a multi-frame transfer are enqueued at once and the send call returns
+     * immediately, regardless of the blocking deadline; the frames are then transmitted from Node::spin() as the
+     * bus permits. This is meant for long low-priority transfers, such as file or firmware chunks, that would
+     * otherwise hold the calling thread until the last frame is handed over to the driver.
+     * Single-frame transfers are not affected. Disabled by default.
+     */
+    bool isPipelined() const { return pipelined_; }
+    void setPipelined(bool pipelined) { pipelined_ = pipelined; }
+
     /**
      * Send with explicit Transfer ID.
      * Should be used only for service responses, where response TID should match request TID.
@@ -97,9 +138,27 @@ public:
              MonotonicTime blocking_deadline, TransferType transfer_type, NodeID dst_node_id,
              TransferID tid) const;
 
+    /**
+     * The overloads that take a Frame select the transfer layout by Frame::getFrameType(); the templated ones take
+     * it from the given format, see frame_format.hpp. Either way, the frames are encoded with the standard
+     * CAN ID layout; the codec of the format is not used here.
+     */
     int send(Frame& frame, const uint8_t* payload, unsigned payload_len, MonotonicTime tx_deadline,
              MonotonicTime blocking_deadline, TransferType transfer_type, NodeID dst_node_id,
-             TransferID tid) const;
+             TransferID tid) const
+    {
+        return sendTransfer(frame, payload, payload_len, tx_deadline, blocking_deadline, transfer_type,
+                            dst_node_id, tid, getTransferCrcLen(frame));
+    }
+
+    template <typename Format>
+    int send(Frame& frame, const uint8_t* payload, unsigned payload_len, MonotonicTime tx_deadline,
+             MonotonicTime blocking_deadline, TransferType transfer_type, NodeID dst_node_id,
+             TransferID tid) const
+    {
+        return sendTransfer(frame, payload, payload_len, tx_deadline, blocking_deadline, transfer_type,
+                            dst_node_id, tid, Format::TransferCrcLen);
+    }
 
     /**
      * Send with automatic Transfer ID.
@@ -113,7 +172,19 @@ public:
              MonotonicTime blocking_deadline, TransferType transfer_type, NodeID dst_node_id) const;
 
     int send(Frame& frame, const uint8_t* payload, unsigned payload_len, MonotonicTime tx_deadline,
-             MonotonicTime blocking_deadline, TransferType transfer_type, NodeID dst_node_id) const;
+             MonotonicTime blocking_deadline, TransferType transfer_type, NodeID dst_node_id) const
+    {
+        return sendTransfer(frame, payload, payload_len, tx_deadline, blocking_deadline, transfer_type,
+                            dst_node_id, getTransferCrcLen(frame));
+    }
+
+    template <typename Format>
+    int send(Frame& frame, const uint8_t* payload, unsigned payload_len, MonotonicTime tx_deadline,
+             MonotonicTime blocking_deadline, TransferType transfer_type, NodeID dst_node_id) const
+    {
+        return sendTransfer(frame, payload, payload_len, tx_deadline, blocking_deadline, transfer_type,
+                            dst_node_id, Format::TransferCrcLen);
+    }
 };
 
 }
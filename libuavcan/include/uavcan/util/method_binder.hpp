@@ -11,6 +11,24 @@
 
 namespace uavcan
 {
+/**
+ * Return type of a pointer to member function that takes up to two parameters.
+ */
+template <typename MemFunPtr> struct UAVCAN_EXPORT MemberFunctionReturnType;
+
+template <typename R, typename C>
+struct UAVCAN_EXPORT MemberFunctionReturnType<R (C::*)()> { typedef R Type; };
+template <typename R, typename C>
+struct UAVCAN_EXPORT MemberFunctionReturnType<R (C::*)() const> { typedef R Type; };
+template <typename R, typename C, typename P1>
+struct UAVCAN_EXPORT MemberFunctionReturnType<R (C::*)(P1)> { typedef R Type; };
+template <typename R, typename C, typename P1>
+struct UAVCAN_EXPORT MemberFunctionReturnType<R (C::*)(P1) const> { typedef R Type; };
+template <typename R, typename C, typename P1, typename P2>
+struct UAVCAN_EXPORT MemberFunctionReturnType<R (C::*)(P1, P2)> { typedef R Type; };
+template <typename R, typename C, typename P1, typename P2>
+struct UAVCAN_EXPORT MemberFunctionReturnType<R (C::*)(P1, P2) const> { typedef R Type; };
+
 /**
  * Use this to call member functions as callbacks in C++03 mode.
  *
@@ -31,6 +49,11 @@ class UAVCAN_EXPORT MethodBinder
     }
 
 public:
+    /**
+     * The call operators return whatever the bound method returns, which can be void.
+     */
+    typedef typename MemberFunctionReturnType<MemFunPtr>::Type ReturnType;
+
     MethodBinder()
         : obj_()
         , fun_()
@@ -52,7 +75,7 @@ public:
     /**
      * Will raise a fatal error if either method pointer or object pointer are null.
      */
-    int operator()()
+    ReturnType operator()()
     {
         validateBeforeCall();
         return (obj_->*fun_)();
@@ -62,7 +85,7 @@ public:
      * Will raise a fatal error if either method pointer or object pointer are null.
      */
     template <typename Par1>
-    int operator()(Par1& p1)
+    ReturnType operator()(Par1& p1)
     {
         validateBeforeCall();
         return (obj_->*fun_)(p1);
@@ -72,7 +95,7 @@ public:
      * Will raise a fatal error if either method pointer or object pointer are null.
      */
     template <typename Par1, typename Par2>
-    int operator()(Par1& p1, Par2& p2)
+    ReturnType operator()(Par1& p1, Par2& p2)
     {
         validateBeforeCall();
         return (obj_->*fun_)(p1, p2);
@@ -14,8 +14,32 @@ const uint32_t CanFrame::MaskExtID;
 const uint32_t CanFrame::FlagEFF;
 const uint32_t CanFrame::FlagRTR;
 const uint32_t CanFrame::FlagERR;
+const uint8_t CanFrame::MaxClassicDataLen;
 const uint8_t CanFrame::MaxDataLen;
 
+uint8_t CanFrame::dlcToDataLen(uint8_t dlc)
+{
+    static const uint8_t Table[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+    return Table[dlc & 0x0FU];
+}
+
+uint8_t CanFrame::dataLenToDlc(uint8_t data_len)
+{
+    if (data_len <= MaxClassicDataLen)
+    {
+        return data_len;
+    }
+    if (data_len <= 24)
+    {
+        return uint8_t(9U + (data_len - MaxClassicDataLen - 1U) / 4U);
+    }
+    if (data_len <= 32)
+    {
+        return 13;
+    }
+    return (data_len <= 48) ? 14 : 15;
+}
+
 bool CanFrame::priorityHigherThan(const CanFrame& rhs) const
 {
     const uint32_t clean_id     = id     & MaskExtID;
@@ -63,7 +87,7 @@ std::string CanFrame::toString(StringRepresentation mode) const
 
     static const unsigned AsciiColumnOffset = 36U;
 
-    char buf[50];
+    char buf[18 + MaxDataLen * 4];
     char* wpos = buf;
     char* const epos = buf + sizeof(buf);
     fill(buf, buf + sizeof(buf), '\0');
@@ -9,23 +9,27 @@
 
 namespace uavcan
 {
-void bitarrayCopy(const unsigned char* src, std::size_t src_offset, std::size_t src_len,
-                  unsigned char* dst, std::size_t dst_offset)
+namespace
 {
-    /*
-     * Should never be called on a zero-length buffer. The caller will also ensure that the bit
-     * offsets never exceed one byte.
-     */
-
-    UAVCAN_ASSERT(src_len > 0U);
-    UAVCAN_ASSERT(src_offset < 8U && dst_offset < 8U);
-
-    const std::size_t last_bit = src_offset + src_len;
+/**
+ * Copies up to 8 bits per iteration; used for the unaligned head and tail of the array.
+ * Returns the number of bits copied, which is less than len if the loop stopped at the destination byte boundary.
+ */
+std::size_t copyBitsBytewise(const unsigned char* src, std::size_t src_offset, std::size_t len,
+                             unsigned char* dst, std::size_t dst_offset, bool stop_at_dst_byte_boundary)
+{
+    const std::size_t src_offset_org = src_offset;
+    const std::size_t last_bit = src_offset + len;
     while (last_bit - src_offset)
     {
         const uint8_t src_bit_offset = src_offset % 8U;
         const uint8_t dst_bit_offset = dst_offset % 8U;
 
+        if (stop_at_dst_byte_boundary && (dst_bit_offset == 0) && (src_offset != src_offset_org))
+        {
+            break;
+        }
+
         // The number of bits to copy
         const uint8_t max_offset = uavcan::max(src_bit_offset, dst_bit_offset);
         const std::size_t copy_bits = uavcan::min(last_bit - src_offset, std::size_t(8U - max_offset));
@@ -55,5 +59,81 @@ void bitarrayCopy(const unsigned char* src, std::size_t src_offset, std::size_t
         src_offset += copy_bits;
         dst_offset += copy_bits;
     }
+    return src_offset - src_offset_org;
+}
+
+inline uint64_t loadBigEndian64(const unsigned char* p)
+{
+    return (uint64_t(p[0]) << 56) | (uint64_t(p[1]) << 48) | (uint64_t(p[2]) << 40) | (uint64_t(p[3]) << 32) |
+           (uint64_t(p[4]) << 24) | (uint64_t(p[5]) << 16) | (uint64_t(p[6]) << 8)  | uint64_t(p[7]);
+}
+
+inline void storeBigEndian64(unsigned char* p, uint64_t x)
+{
+    for (int i = 7; i >= 0; i--)
+    {
+        p[i] = static_cast<unsigned char>(x & 0xFFU);
+        x >>= 8;
+    }
+}
+}
+
+void bitarrayCopy(const unsigned char* src, std::size_t src_offset, std::size_t src_len,
+                  unsigned char* dst, std::size_t dst_offset)
+{
+    /*
+     * Should never be called on a zero-length buffer. The caller will also ensure that the bit
+     * offsets never exceed one byte.
+     */
+
+    UAVCAN_ASSERT(src_len > 0U);
+    UAVCAN_ASSERT(src_offset < 8U && dst_offset < 8U);
+
+    /*
+     * Bring the destination to the byte boundary; everything in between is copied a whole destination byte
+     * at a time, then the remaining tail bits are merged bytewise.
+     */
+    if (dst_offset != 0)
+    {
+        const std::size_t head_len = copyBitsBytewise(src, src_offset, src_len, dst, dst_offset, true);
+        src_offset += head_len;
+        dst_offset += head_len;
+        src_len -= head_len;
+    }
+
+    src += src_offset / 8U;
+    dst += dst_offset / 8U;
+    const unsigned shift = unsigned(src_offset % 8U);
+    std::size_t num_bytes = src_len / 8U;
+
+    if (shift == 0)
+    {
+        (void)std::memmove(dst, src, num_bytes);
+        src += num_bytes;
+        dst += num_bytes;
+    }
+    else
+    {
+        // The loop below needs the byte that follows each source word, which always contains bits to be copied
+        while (num_bytes >= 8U)
+        {
+            const uint64_t word = (loadBigEndian64(src) << shift) | (src[8] >> (8U - shift));
+            storeBigEndian64(dst, word);
+            src += 8;
+            dst += 8;
+            num_bytes -= 8U;
+        }
+        while (num_bytes > 0U)
+        {
+            *dst++ = static_cast<unsigned char>((src[0] << shift) | (src[1] >> (8U - shift)));
+            src++;
+            num_bytes--;
+        }
+    }
+
+    if ((src_len % 8U) != 0)
+    {
+        (void)copyBitsBytewise(src, shift, src_len % 8U, dst, 0, false);
+    }
 }
 }
@@ -12,8 +12,26 @@ namespace uavcan
 const unsigned BitStream::MaxBytesPerRW;
 const unsigned BitStream::MaxBitsPerRW;
 
-int BitStream::write(const uint8_t* bytes, const unsigned bitlen)
+int BitStream::writeBuffer(const uint8_t* bytes, const unsigned bitlen)
 {
+    // Whole bytes at a byte boundary don't need to be merged with anything, so they go straight to the buffer
+    if (((bit_offset_ % 8) == 0) && ((bitlen % 8) == 0))
+    {
+        UAVCAN_ASSERT(byte_cache_ == 0);
+        const unsigned bytelen = bitlen / 8;
+        const int write_res = buf_->write(bit_offset_ / 8, bytes, bytelen);
+        if (write_res < 0)
+        {
+            return write_res;
+        }
+        if (static_cast<unsigned>(write_res) < bytelen)
+        {
+            return ResultOutOfBuffer;
+        }
+        bit_offset_ += bitlen;
+        return ResultOk;
+    }
+
     // Temporary buffer is needed to merge new bits with cached unaligned bits from the last write() (see byte_cache_)
     uint8_t tmp[MaxBytesPerRW + 1];
 
@@ -38,7 +56,7 @@ int BitStream::write(const uint8_t* bytes, const unsigned bitlen)
      * Note that if this write was unaligned, last written byte in the buffer will be rewritten with updated value
      * within the next write() operation.
      */
-    const int write_res = buf_.write(bit_offset_ / 8, tmp, bytelen);
+    const int write_res = buf_->write(bit_offset_ / 8, tmp, bytelen);
     if (write_res < 0)
     {
         return write_res;
@@ -52,14 +70,35 @@ int BitStream::write(const uint8_t* bytes, const unsigned bitlen)
     return ResultOk;
 }
 
-int BitStream::read(uint8_t* bytes, const unsigned bitlen)
+int BitStream::readBuffer(uint8_t* bytes, const unsigned bitlen)
 {
+    // At a byte boundary the data can be read in place; only the unused bits of the last byte need to be cleared
+    if ((bit_offset_ % 8) == 0)
+    {
+        const unsigned bytelen = bitlenToBytelen(bitlen);
+        const int read_res = buf_->read(bit_offset_ / 8, bytes, bytelen);
+        if (read_res < 0)
+        {
+            return read_res;
+        }
+        if (static_cast<unsigned>(read_res) < bytelen)
+        {
+            return ResultOutOfBuffer;
+        }
+        if ((bitlen % 8) != 0)
+        {
+            bytes[bytelen - 1] = uint8_t(bytes[bytelen - 1] & uint8_t(0xFFU << (8 - (bitlen % 8))));
+        }
+        bit_offset_ += bitlen;
+        return ResultOk;
+    }
+
     uint8_t tmp[MaxBytesPerRW + 1];
 
     const unsigned bytelen = bitlenToBytelen(bitlen + (bit_offset_ % 8));
     UAVCAN_ASSERT(MaxBytesPerRW >= bytelen);
 
-    const int read_res = buf_.read(bit_offset_ / 8, tmp, bytelen);
+    const int read_res = buf_->read(bit_offset_ / 8, tmp, bytelen);
     if (read_res < 0)
     {
         return read_res;
@@ -75,6 +114,46 @@ int BitStream::read(uint8_t* bytes, const unsigned bitlen)
     return ResultOk;
 }
 
+int BitStream::writeBytes(const uint8_t* bytes, unsigned len)
+{
+    if ((buf_ == UAVCAN_NULLPTR) || ((bit_offset_ % 8) == 0))
+    {
+        return (len > 0) ? write(bytes, len * 8) : int(ResultOk);
+    }
+    while (len > 0)
+    {
+        const unsigned chunk_len = min(len, MaxBytesPerRW - 1);    // One extra byte is taken by the unaligned bits
+        const int res = write(bytes, chunk_len * 8);
+        if (res <= 0)
+        {
+            return res;
+        }
+        bytes += chunk_len;
+        len -= chunk_len;
+    }
+    return ResultOk;
+}
+
+int BitStream::readBytes(uint8_t* bytes, unsigned len)
+{
+    if ((buf_ == UAVCAN_NULLPTR) || ((bit_offset_ % 8) == 0))
+    {
+        return (len > 0) ? read(bytes, len * 8) : int(ResultOk);
+    }
+    while (len > 0)
+    {
+        const unsigned chunk_len = min(len, MaxBytesPerRW - 1);
+        const int res = read(bytes, chunk_len * 8);
+        if (res <= 0)
+        {
+            return res;
+        }
+        bytes += chunk_len;
+        len -= chunk_len;
+    }
+    return ResultOk;
+}
+
 #if UAVCAN_TOSTRING
 std::string BitStream::toString() const
 {
@@ -84,7 +163,15 @@ std::string BitStream::toString() const
     for (unsigned offset = 0; true; offset++)
     {
         uint8_t byte = 0;
-        if (1 != buf_.read(offset, &byte, 1U))
+        if (buf_ == UAVCAN_NULLPTR)
+        {
+            if (offset >= span_len_)
+            {
+                break;
+            }
+            byte = span_[offset];
+        }
+        else if (1 != buf_->read(offset, &byte, 1U))
         {
             break;
         }
@@ -38,6 +38,161 @@ bool DeadlineHandler::isRunning() const
 /*
  * MonotonicDeadlineScheduler
  */
+#if UAVCAN_DEADLINE_SCHEDULER_HEAP
+
+DeadlineHandler* DeadlineScheduler::meld(DeadlineHandler* a, DeadlineHandler* b)
+{
+    // Both arguments must be detached heap roots
+    if (a == UAVCAN_NULLPTR)
+    {
+        return b;
+    }
+    if (b == UAVCAN_NULLPTR)
+    {
+        return a;
+    }
+    if (b->getDeadline() < a->getDeadline())
+    {
+        DeadlineHandler* const tmp = a;
+        a = b;
+        b = tmp;
+    }
+    b->heap_prev_ = a;
+    b->setNextListNode(a->heap_child_);
+    if (a->heap_child_ != UAVCAN_NULLPTR)
+    {
+        a->heap_child_->heap_prev_ = b;
+    }
+    a->heap_child_ = b;
+    return a;
+}
+
+DeadlineHandler* DeadlineScheduler::mergePairs(DeadlineHandler* first)
+{
+    /*
+     * Two-pass pairing: the siblings are melded pairwise left to right, then the pairs are melded into
+     * one heap right to left. The intermediate pairs are stacked using the list node links.
+     */
+    DeadlineHandler* pairs = UAVCAN_NULLPTR;
+    while (first != UAVCAN_NULLPTR)
+    {
+        DeadlineHandler* const a = first;
+        DeadlineHandler* const b = a->getNextListNode();
+        first = (b == UAVCAN_NULLPTR) ? UAVCAN_NULLPTR : b->getNextListNode();
+
+        a->heap_prev_ = UAVCAN_NULLPTR;
+        a->setNextListNode(UAVCAN_NULLPTR);
+        if (b != UAVCAN_NULLPTR)
+        {
+            b->heap_prev_ = UAVCAN_NULLPTR;
+            b->setNextListNode(UAVCAN_NULLPTR);
+        }
+
+        DeadlineHandler* const pair = meld(a, b);
+        pair->setNextListNode(pairs);
+        pairs = pair;
+    }
+
+    DeadlineHandler* result = UAVCAN_NULLPTR;
+    while (pairs != UAVCAN_NULLPTR)
+    {
+        DeadlineHandler* const pair = pairs;
+        pairs = pair->getNextListNode();
+        pair->setNextListNode(UAVCAN_NULLPTR);
+        result = meld(result, pair);
+    }
+    return result;
+}
+
+void DeadlineScheduler::add(DeadlineHandler* mdh)
+{
+    UAVCAN_ASSERT(mdh);
+    remove(mdh);
+    UAVCAN_ASSERT(mdh->heap_child_ == UAVCAN_NULLPTR);
+    mdh->setNextListNode(UAVCAN_NULLPTR);
+    heap_root_ = meld(heap_root_, mdh);
+    num_handlers_++;
+}
+
+void DeadlineScheduler::remove(DeadlineHandler* mdh)
+{
+    UAVCAN_ASSERT(mdh);
+    if (!doesExist(mdh))
+    {
+        return;
+    }
+
+    DeadlineHandler* const children = mdh->heap_child_;
+    mdh->heap_child_ = UAVCAN_NULLPTR;
+
+    if (mdh == heap_root_)
+    {
+        heap_root_ = mergePairs(children);
+    }
+    else
+    {
+        DeadlineHandler* const prev = mdh->heap_prev_;
+        DeadlineHandler* const next = mdh->getNextListNode();
+        if (prev->heap_child_ == mdh)
+        {
+            prev->heap_child_ = next;
+        }
+        else
+        {
+            prev->setNextListNode(next);
+        }
+        if (next != UAVCAN_NULLPTR)
+        {
+            next->heap_prev_ = prev;
+        }
+        heap_root_ = meld(heap_root_, mergePairs(children));
+    }
+
+    mdh->heap_prev_ = UAVCAN_NULLPTR;
+    mdh->setNextListNode(UAVCAN_NULLPTR);
+    UAVCAN_ASSERT(num_handlers_ > 0);
+    num_handlers_--;
+}
+
+bool DeadlineScheduler::doesExist(const DeadlineHandler* mdh) const
+{
+    UAVCAN_ASSERT(mdh);
+    return (mdh == heap_root_) || (mdh->heap_prev_ != UAVCAN_NULLPTR);
+}
+
+MonotonicTime DeadlineScheduler::pollAndGetMonotonicTime(ISystemClock& sysclock)
+{
+    while (true)
+    {
+        DeadlineHandler* const mdh = heap_root_;
+        if (!mdh)
+        {
+            return sysclock.getMonotonic();
+        }
+
+        const MonotonicTime ts = sysclock.getMonotonic();
+        if (ts < mdh->getDeadline())
+        {
+            return ts;
+        }
+
+        remove(mdh);
+        mdh->handleDeadline(ts);   // This handler can be re-registered immediately
+    }
+    UAVCAN_ASSERT(0);
+    return MonotonicTime();
+}
+
+MonotonicTime DeadlineScheduler::getEarliestDeadline() const
+{
+    if (heap_root_)
+    {
+        return heap_root_->getDeadline();
+    }
+    return MonotonicTime::getMax();
+}
+
+#else
 struct MonotonicDeadlineHandlerInsertionComparator
 {
     const MonotonicTime ts;
@@ -124,6 +279,8 @@ MonotonicTime DeadlineScheduler::getEarliestDeadline() const
     return MonotonicTime::getMax();
 }
 
+#endif
+
 /*
  * Scheduler
  */
@@ -178,7 +335,8 @@ int Scheduler::spin(MonotonicTime deadline)
 
         const MonotonicTime ts = deadline_scheduler_.pollAndGetMonotonicTime(getSystemClock());
         pollCleanup(ts, unsigned(retval));
-        if (ts >= deadline)
+        const bool woken_up = dispatcher_.getCanIOManager().yieldWakeup();
+        if ((ts >= deadline) || woken_up)
         {
             break;
         }
@@ -205,60 +363,7 @@ int Scheduler::spinOnce()
 
     const MonotonicTime ts = deadline_scheduler_.pollAndGetMonotonicTime(getSystemClock());
     pollCleanup(ts, unsigned(retval));
-
-    return retval;
-}
-
-int Scheduler::spin(RxFrame &frame, MonotonicTime deadline)
-{
-    if (inside_spin_)  // Preventing recursive calls
-    {
-        UAVCAN_ASSERT(0);
-        return -ErrRecursiveCall;
-    }
-    InsideSpinSetter iss(*this);
-    UAVCAN_ASSERT(inside_spin_);
-
-    //std::cerr<<"scheduler::spinframe:1"<<std::endl;
-    int retval = 0;
-    while (true)
-    {
-        const MonotonicTime dl = computeDispatcherSpinDeadline(deadline);
-        retval = dispatcher_.spin(frame, dl);
-        if (retval < 0)
-        {
-            break;
-        }
-
-        const MonotonicTime ts = deadline_scheduler_.pollAndGetMonotonicTime(getSystemClock());
-        pollCleanup(ts, unsigned(retval));
-        if (ts >= deadline)
-        {
-            break;
-        }
-    }
-
-    return retval;
-}
-
-int Scheduler::spinOnce(RxFrame& frame)
-{
-    if (inside_spin_)  // Preventing recursive calls
-    {
-        UAVCAN_ASSERT(0);
-        return -ErrRecursiveCall;
-    }
-    InsideSpinSetter iss(*this);
-    UAVCAN_ASSERT(inside_spin_);
-
-    const int retval = dispatcher_.spinOnce(frame);
-    if (retval < 0)
-    {
-        return retval;
-    }
-
-    const MonotonicTime ts = deadline_scheduler_.pollAndGetMonotonicTime(getSystemClock());
-    pollCleanup(ts, unsigned(retval));
+    (void)dispatcher_.getCanIOManager().yieldWakeup();      // The call returns anyway
 
     return retval;
 }
@@ -14,6 +14,119 @@ const unsigned CanAcceptanceFilterConfigurator::DefaultFilterServiceMask;
 const unsigned CanAcceptanceFilterConfigurator::DefaultAnonMsgMask;
 const unsigned CanAcceptanceFilterConfigurator::DefaultAnonMsgID;
 
+namespace
+{
+/**
+ * Exact search for the partition of filter configurations into a limited number of groups, such that the total
+ * accepted volume of the merged groups is minimal. The partial cost never decreases as configurations are added,
+ * so it is used as the lower bound to prune the search.
+ */
+class FilterPartitionSearch
+{
+    enum { StepBudget = 1000000 };
+
+    const CanFilterConfig* const configs_;
+    const unsigned num_configs_;
+    const unsigned max_groups_;
+
+    CanFilterConfig groups_[MaxCanAcceptanceFilters];
+    unsigned num_groups_;
+    uint64_t cost_;
+    unsigned steps_;
+
+    CanFilterConfig best_groups_[MaxCanAcceptanceFilters];
+    unsigned best_num_groups_;
+    uint64_t best_cost_;
+
+    static CanFilterConfig merge(const CanFilterConfig& a, const CanFilterConfig& b)
+    {
+        CanFilterConfig out;
+        out.mask = a.mask & b.mask & ~(a.id ^ b.id);
+        out.id = a.id & out.mask;
+        return out;
+    }
+
+    void search(unsigned index)
+    {
+        if (steps_ >= StepBudget)
+        {
+            return;
+        }
+        steps_++;
+
+        if (index >= num_configs_)
+        {
+            if (cost_ < best_cost_)
+            {
+                best_cost_ = cost_;
+                best_num_groups_ = num_groups_;
+                (void)copy(groups_, groups_ + num_groups_, best_groups_);
+            }
+            return;
+        }
+
+        const CanFilterConfig& cfg = configs_[index];
+
+        // Opening a new group first, since it never increases the volume of the existing ones
+        if (num_groups_ < max_groups_)
+        {
+            const uint32_t volume = CanAcceptanceFilterConfigurator::getAcceptedVolume(cfg);
+            if ((cost_ + volume) < best_cost_)
+            {
+                groups_[num_groups_++] = cfg;
+                cost_ += volume;
+                search(index + 1U);
+                cost_ -= volume;
+                num_groups_--;
+            }
+        }
+
+        for (unsigned i = 0; i < num_groups_; i++)
+        {
+            const CanFilterConfig saved = groups_[i];
+            const uint32_t saved_volume = CanAcceptanceFilterConfigurator::getAcceptedVolume(saved);
+            groups_[i] = merge(saved, cfg);
+            const uint64_t cost = cost_ - saved_volume + CanAcceptanceFilterConfigurator::getAcceptedVolume(groups_[i]);
+            if (cost < best_cost_)
+            {
+                const uint64_t prev_cost = cost_;
+                cost_ = cost;
+                search(index + 1U);
+                cost_ = prev_cost;
+            }
+            groups_[i] = saved;
+        }
+    }
+
+public:
+    FilterPartitionSearch(const CanFilterConfig* configs, unsigned num_configs, unsigned max_groups,
+                          uint64_t upper_bound)
+        : configs_(configs)
+        , num_configs_(num_configs)
+        , max_groups_(min(max_groups, unsigned(MaxCanAcceptanceFilters)))
+        , num_groups_(0)
+        , cost_(0)
+        , steps_(0)
+        , best_num_groups_(0)
+        , best_cost_(upper_bound)
+    { }
+
+    /**
+     * Returns true if a partition cheaper than the upper bound was found.
+     */
+    bool run()
+    {
+        search(0);
+        UAVCAN_TRACE("CanAcceptanceFilter", "Partition search: %u steps, cost %llu", steps_,
+                     static_cast<unsigned long long>(best_cost_));
+        return best_num_groups_ > 0;
+    }
+
+    unsigned getNumGroups() const { return best_num_groups_; }
+    const CanFilterConfig& getGroup(unsigned index) const { return best_groups_[index]; }
+};
+}
+
 int16_t CanAcceptanceFilterConfigurator::loadInputConfiguration(AnonymousMessages load_mode)
 {
     multiset_configs_.clear();
@@ -69,6 +182,12 @@ int16_t CanAcceptanceFilterConfigurator::mergeConfigurations()
     }
     UAVCAN_ASSERT(multiset_configs_.getSize() != 0);
 
+    return (merge_algorithm_ == MergeByVolume) ? mergeConfigurationsByVolume(acceptance_filters_number)
+                                               : mergeConfigurationsByRank(acceptance_filters_number);
+}
+
+int16_t CanAcceptanceFilterConfigurator::mergeConfigurationsByRank(uint16_t acceptance_filters_number)
+{
     while (acceptance_filters_number < multiset_configs_.getSize())
     {
         uint16_t i_rank = 0, j_rank = 0;
@@ -102,6 +221,95 @@ int16_t CanAcceptanceFilterConfigurator::mergeConfigurations()
     return 0;
 }
 
+void CanAcceptanceFilterConfigurator::mergePairByVolume()
+{
+    const uint16_t size = static_cast<uint16_t>(multiset_configs_.getSize());
+    UAVCAN_ASSERT(size >= 2);
+
+    uint16_t i_best = 0;
+    uint16_t j_best = 1;
+    int64_t best_increase = 0x7FFFFFFFFFFFFFFFLL;
+
+    for (uint16_t i_ind = 0; i_ind < size - 1; i_ind++)
+    {
+        const CanFilterConfig& a = *multiset_configs_.getByIndex(i_ind);
+        for (uint16_t j_ind = static_cast<uint16_t>(i_ind + 1); j_ind < size; j_ind++)
+        {
+            const CanFilterConfig& b = *multiset_configs_.getByIndex(j_ind);
+            // Negative if the configurations overlap, e.g. for the listeners of the same data type
+            const int64_t increase = int64_t(getAcceptedVolume(mergeFilters(a, b))) -
+                                     int64_t(getAcceptedVolume(a)) - int64_t(getAcceptedVolume(b));
+            if (increase < best_increase)
+            {
+                best_increase = increase;
+                i_best = i_ind;
+                j_best = j_ind;
+            }
+        }
+    }
+
+    *multiset_configs_.getByIndex(j_best) = mergeFilters(*multiset_configs_.getByIndex(i_best),
+                                                         *multiset_configs_.getByIndex(j_best));
+    multiset_configs_.removeFirst(*multiset_configs_.getByIndex(i_best));
+}
+
+int16_t CanAcceptanceFilterConfigurator::mergeConfigurationsByVolume(uint16_t acceptance_filters_number)
+{
+    const unsigned exact_limit = max(unsigned(acceptance_filters_number),
+                                     unsigned(UAVCAN_CAN_ACCEPTANCE_FILTER_EXACT_MERGE_LIMIT));
+    while (multiset_configs_.getSize() > exact_limit)
+    {
+        mergePairByVolume();
+    }
+
+    if (multiset_configs_.getSize() <= acceptance_filters_number)
+    {
+        return 0;
+    }
+
+#if UAVCAN_CAN_ACCEPTANCE_FILTER_EXACT_MERGE_LIMIT > 0
+    /*
+     * The greedy result gives the initial upper bound for the exact search
+     */
+    CanFilterConfig configs[UAVCAN_CAN_ACCEPTANCE_FILTER_EXACT_MERGE_LIMIT];
+    const unsigned num_configs = static_cast<unsigned>(multiset_configs_.getSize());
+    UAVCAN_ASSERT(num_configs <= UAVCAN_CAN_ACCEPTANCE_FILTER_EXACT_MERGE_LIMIT);
+    for (unsigned i = 0; i < num_configs; i++)
+    {
+        configs[i] = *multiset_configs_.getByIndex(i);
+    }
+#endif
+
+    while (multiset_configs_.getSize() > acceptance_filters_number)
+    {
+        mergePairByVolume();
+    }
+
+#if UAVCAN_CAN_ACCEPTANCE_FILTER_EXACT_MERGE_LIMIT > 0
+    uint64_t greedy_cost = 0;
+    for (unsigned i = 0; i < multiset_configs_.getSize(); i++)
+    {
+        greedy_cost += getAcceptedVolume(*multiset_configs_.getByIndex(i));
+    }
+
+    FilterPartitionSearch search(configs, num_configs, acceptance_filters_number, greedy_cost);
+    if (search.run())
+    {
+        multiset_configs_.clear();
+        for (unsigned i = 0; i < search.getNumGroups(); i++)
+        {
+            if (multiset_configs_.emplace(search.getGroup(i)) == UAVCAN_NULLPTR)
+            {
+                return -ErrMemory;
+            }
+        }
+    }
+#endif
+
+    UAVCAN_ASSERT(acceptance_filters_number >= multiset_configs_.getSize());
+    return 0;
+}
+
 int CanAcceptanceFilterConfigurator::applyConfiguration(void)
 {
     CanFilterConfig filter_conf_array[MaxCanAcceptanceFilters];
@@ -166,8 +374,10 @@ int CanAcceptanceFilterConfigurator::applyConfiguration(void)
     return 0;
 }
 
-int CanAcceptanceFilterConfigurator::computeConfiguration(AnonymousMessages mode)
+int CanAcceptanceFilterConfigurator::computeConfiguration(AnonymousMessages mode, MergeAlgorithm algorithm)
 {
+    merge_algorithm_ = algorithm;
+
     if (getNumFilters() == 0)
     {
         UAVCAN_TRACE("CanAcceptanceFilter", "No HW filters available");
@@ -234,7 +444,7 @@ int CanAcceptanceFilterConfigurator::addFilterConfig(const CanFilterConfig& conf
     return 0;
 }
 
-CanFilterConfig CanAcceptanceFilterConfigurator::mergeFilters(CanFilterConfig& a_, CanFilterConfig& b_)
+CanFilterConfig CanAcceptanceFilterConfigurator::mergeFilters(const CanFilterConfig& a_, const CanFilterConfig& b_)
 {
     CanFilterConfig temp_arr;
     temp_arr.mask = a_.mask & b_.mask & ~(a_.id ^ b_.id);
@@ -253,4 +463,89 @@ uint8_t CanAcceptanceFilterConfigurator::countBits(uint32_t n_)
 
     return c_;
 }
+
+#if !UAVCAN_TINY
+/*
+ * CanAcceptanceFilterAutoConfigurator
+ */
+void CanAcceptanceFilterAutoConfigurator::handleTimerEvent(const TimerEvent&)
+{
+    (void)reconfigure();
+}
+
+void CanAcceptanceFilterAutoConfigurator::handleTransferListenerRegistryChange(TransferType transfer_type)
+{
+    if (transfer_type == TransferTypeServiceResponse)
+    {
+        return;
+    }
+    if (node_.getNodeID() != configured_node_id_)
+    {
+        // Service requests to the new node ID would be dropped by the filters until they are reconfigured
+        TimerBase::stop();
+        (void)reconfigure();
+    }
+    else
+    {
+        startOneShotWithDelay(debounce_delay_);     // Restarts the timer if it is already running
+    }
+}
+
+int CanAcceptanceFilterAutoConfigurator::start()
+{
+    node_.getDispatcher().installTransferListenerRegistryObserver(this);
+    return reconfigure();
+}
+
+void CanAcceptanceFilterAutoConfigurator::stop()
+{
+    if (isStarted())
+    {
+        node_.getDispatcher().removeTransferListenerRegistryObserver();
+    }
+    TimerBase::stop();
+}
+
+int CanAcceptanceFilterAutoConfigurator::reconfigure()
+{
+    CanAcceptanceFilterConfigurator cfger(node_, filters_number_);
+
+    configured_node_id_ = node_.getNodeID();
+    last_result_ = cfger.computeConfiguration(anon_mode_, CanAcceptanceFilterConfigurator::MergeByVolume);
+    if (last_result_ < 0)
+    {
+        UAVCAN_TRACE("CanAcceptanceFilterAutoConfigurator", "Failed to compute configuration: %d", last_result_);
+        return last_result_;
+    }
+
+    const Multiset<CanFilterConfig>& configs = cfger.getConfiguration();
+    bool changed = configs.getSize() != num_applied_configs_;
+    for (uint16_t i = 0; (i < num_applied_configs_) && !changed; i++)
+    {
+        const CanFilterConfig& cfg = *configs.getByIndex(i);
+        changed = (cfg.id != applied_configs_[i].id) || (cfg.mask != applied_configs_[i].mask);
+    }
+    if (!changed)
+    {
+        return last_result_;
+    }
+
+    last_result_ = cfger.applyConfiguration();
+    if (last_result_ < 0)
+    {
+        UAVCAN_TRACE("CanAcceptanceFilterAutoConfigurator", "Failed to apply configuration: %d", last_result_);
+        num_applied_configs_ = 0;       // Unknown state, will be reapplied next time
+        return last_result_;
+    }
+
+    num_applied_configs_ = static_cast<uint16_t>(min(configs.getSize(), unsigned(MaxCanAcceptanceFilters)));
+    for (uint16_t i = 0; i < num_applied_configs_; i++)
+    {
+        applied_configs_[i] = *configs.getByIndex(i);
+    }
+    num_reconfigurations_++;
+    return last_result_;
+}
+#endif
+
 }
@@ -47,143 +47,475 @@ void CanTxQueueEntry::destroy(CanTxQueueEntry*& obj, IPoolAllocator &allocator)
 }
 
 /*
- * CanTxQueue
+ * CanTxQueueStats
  */
-CanTxQueue::~CanTxQueue() {
-    // Remove all nodes & node contents of the tree without performing re-balancing steps
-    postOrderTraverseEntryCleanup(root_);
-    // Step 2: AvlTree destructor is called to remove all the Node* (automatically after)
+#if UAVCAN_TX_QUEUE_STATS
+const uint32_t CanTxQueueStats::FirstLatencyBinUSec;
+
+uint8_t CanTxQueueStats::getPriorityLevel(const CanFrame& frame)
+{
+    if (frame.isExtended())
+    {
+        return uint8_t((frame.id & CanFrame::MaskExtID) >> 24);
+    }
+    return uint8_t((frame.id & CanFrame::MaskStdID) >> 6);
 }
 
-void CanTxQueue::postOrderTraverseEntryCleanup(Node* n) {
-    if (n == UAVCAN_NULLPTR) {
-        return;
+uint8_t CanTxQueueStats::getLatencyBin(uint32_t latency_usec)
+{
+    uint8_t bin = 0;
+    uint32_t bound = FirstLatencyBinUSec;
+    while ((bin < (NumLatencyBins - 1)) && (latency_usec >= bound))
+    {
+        bin++;
+        bound <<= 2;
     }
+    return bin;
+}
+#endif
+
+/*
+ * CanTxQueue
+ */
+const uint32_t CanTxQueue::MaxFrameLifetimeUSec;
 
-    postOrderTraverseEntryCleanup(n->left);
-    postOrderTraverseEntryCleanup(n->right);
-    CanTxQueueEntry::destroy(n->data, allocator_);
+namespace
+{
+/// Wrap-around aware comparison of insertion sequence numbers
+inline bool seqBefore(uint32_t a, uint32_t b)
+{
+    return int32_t(a - b) < 0;
 }
 
-bool CanTxQueue::contains(const CanFrame& frame) const {
-    Node* n = root_;
+class CanFrameArraySequence : public ICanFrameSequence
+{
+    const CanFrame* const frames_;
+    const unsigned num_frames_;
 
-    while (n != UAVCAN_NULLPTR) {
-        if (frame.priorityHigherThan(n->data->frame)) {
-            n = n->right;
-            continue;
-        }
+public:
+    CanFrameArraySequence(const CanFrame* frames, unsigned num_frames)
+        : frames_(frames)
+        , num_frames_(num_frames)
+    { }
 
-        if (frame.priorityLowerThan(n->data->frame)) {
-            n = n->left;
-            continue;
-        }
+    virtual unsigned getNumFrames() const { return num_frames_; }
 
-        return linkedListContains(n, frame);
+    virtual bool getFrame(unsigned index, CanFrame& out_frame) const
+    {
+        if (index >= num_frames_)
+        {
+            return false;
+        }
+        out_frame = frames_[index];
+        return true;
     }
-    return false;
+};
 }
 
-bool CanTxQueue::linkedListContains(Node* head, const CanFrame& frame) const {
-    Node* next = head;
-    while(next != UAVCAN_NULLPTR) {
-        if (next->data->frame == frame) {
+struct CanTxQueue::PriorityIndex
+{
+    static CanTxQueueEntry*& left(CanTxQueueEntry* e)  { return e->prio_left_; }
+    static CanTxQueueEntry*& right(CanTxQueueEntry* e) { return e->prio_right_; }
+    static int8_t& height(CanTxQueueEntry* e)          { return e->prio_height_; }
+
+    static bool before(const CanTxQueueEntry* a, const CanTxQueueEntry* b)
+    {
+        if (a->frame.priorityHigherThan(b->frame))
+        {
             return true;
         }
+        if (b->frame.priorityHigherThan(a->frame))
+        {
+            return false;
+        }
+        return seqBefore(a->seq_, b->seq_);
+    }
+};
+
+struct CanTxQueue::DeadlineIndex
+{
+    static CanTxQueueEntry*& left(CanTxQueueEntry* e)  { return e->deadline_left_; }
+    static CanTxQueueEntry*& right(CanTxQueueEntry* e) { return e->deadline_right_; }
+    static int8_t& height(CanTxQueueEntry* e)          { return e->deadline_height_; }
 
-        next = head->equal_keys;
+    static bool before(const CanTxQueueEntry* a, const CanTxQueueEntry* b)
+    {
+        if (a->deadline != b->deadline)
+        {
+            return a->deadline < b->deadline;
+        }
+        return seqBefore(a->seq_, b->seq_);
     }
-    return false;
-}
+};
 
-void CanTxQueue::safeIncrementRejectedFrames() {
-    if (rejected_frames_cnt_ < NumericTraits<uint32_t>::max()) {
-        rejected_frames_cnt_++;
+/**
+ * AVL tree operations over the links selected by the index. Keys are unique, since the insertion sequence number
+ * is the last component of every key, so an entry can always be found by its own key.
+ * The first entry (the leftmost one) is the next to transmit, or the next to expire.
+ */
+template <typename Index>
+struct CanTxQueue::Tree
+{
+    static int heightOf(CanTxQueueEntry* e)
+    {
+        return (e == UAVCAN_NULLPTR) ? 0 : Index::height(e);
     }
-}
 
-void CanTxQueue::push(const CanFrame &frame, MonotonicTime tx_deadline, CanIOFlags flags) {
-    const MonotonicTime timestamp = sysclock_.getMonotonic();
+    static void updateHeight(CanTxQueueEntry* e)
+    {
+        Index::height(e) = int8_t(1 + max(heightOf(Index::left(e)), heightOf(Index::right(e))));
+    }
 
-    if (timestamp >= tx_deadline) {
-        UAVCAN_TRACE("CanTxQueue", "Push rejected: already expired");
-        safeIncrementRejectedFrames();
-        return;
+    static CanTxQueueEntry* rotateRight(CanTxQueueEntry* e)
+    {
+        CanTxQueueEntry* const x = Index::left(e);
+        Index::left(e) = Index::right(x);
+        Index::right(x) = e;
+        updateHeight(e);
+        updateHeight(x);
+        return x;
     }
 
-    void* praw = allocator_.allocate(sizeof(CanTxQueueEntry));
-    if (praw == UAVCAN_NULLPTR) {
-        UAVCAN_TRACE("CanTxQueue", "Push rejected: OOM (CanTxQueueEntry)");
-        safeIncrementRejectedFrames();
-        return;
+    static CanTxQueueEntry* rotateLeft(CanTxQueueEntry* e)
+    {
+        CanTxQueueEntry* const x = Index::right(e);
+        Index::right(e) = Index::left(x);
+        Index::left(x) = e;
+        updateHeight(e);
+        updateHeight(x);
+        return x;
+    }
+
+    static CanTxQueueEntry* rebalance(CanTxQueueEntry* e)
+    {
+        updateHeight(e);
+        const int balance = heightOf(Index::left(e)) - heightOf(Index::right(e));
+        if (balance > 1)
+        {
+            if (heightOf(Index::left(Index::left(e))) < heightOf(Index::right(Index::left(e))))
+            {
+                Index::left(e) = rotateLeft(Index::left(e));
+            }
+            return rotateRight(e);
+        }
+        if (balance < -1)
+        {
+            if (heightOf(Index::right(Index::right(e))) < heightOf(Index::left(Index::right(e))))
+            {
+                Index::right(e) = rotateRight(Index::right(e));
+            }
+            return rotateLeft(e);
+        }
+        return e;
+    }
+
+    static CanTxQueueEntry* insert(CanTxQueueEntry* root, CanTxQueueEntry* e)
+    {
+        if (root == UAVCAN_NULLPTR)
+        {
+            Index::left(e) = UAVCAN_NULLPTR;
+            Index::right(e) = UAVCAN_NULLPTR;
+            Index::height(e) = 1;
+            return e;
+        }
+        if (Index::before(e, root))
+        {
+            Index::left(root) = insert(Index::left(root), e);
+        }
+        else
+        {
+            Index::right(root) = insert(Index::right(root), e);
+        }
+        return rebalance(root);
     }
 
-    CanTxQueueEntry* entry = new(praw) CanTxQueueEntry(frame, tx_deadline, flags);
-    UAVCAN_ASSERT(entry);
-    bool result = AvlTree::insert(entry);
+    static CanTxQueueEntry* removeFirst(CanTxQueueEntry* root, CanTxQueueEntry*& out_first)
+    {
+        if (Index::left(root) == UAVCAN_NULLPTR)
+        {
+            out_first = root;
+            return Index::right(root);
+        }
+        Index::left(root) = removeFirst(Index::left(root), out_first);
+        return rebalance(root);
+    }
 
-    if (!result) {
-        /* AVL Tree could not allocate a new node */
-        UAVCAN_TRACE("CanTxQueue", "Push rejected: OOM (AvlTree::Node)");
-        safeIncrementRejectedFrames();
-        CanTxQueueEntry::destroy(entry, allocator_);
+    static CanTxQueueEntry* remove(CanTxQueueEntry* root, CanTxQueueEntry* e)
+    {
+        if (root == UAVCAN_NULLPTR)
+        {
+            UAVCAN_ASSERT(0);           // Not in the tree
+            return UAVCAN_NULLPTR;
+        }
+        if (root == e)
+        {
+            if (Index::left(e) == UAVCAN_NULLPTR)
+            {
+                return Index::right(e);
+            }
+            if (Index::right(e) == UAVCAN_NULLPTR)
+            {
+                return Index::left(e);
+            }
+            CanTxQueueEntry* successor = UAVCAN_NULLPTR;
+            CanTxQueueEntry* const right = removeFirst(Index::right(e), successor);
+            Index::left(successor) = Index::left(e);
+            Index::right(successor) = right;
+            return rebalance(successor);
+        }
+        if (Index::before(e, root))
+        {
+            Index::left(root) = remove(Index::left(root), e);
+        }
+        else
+        {
+            Index::right(root) = remove(Index::right(root), e);
+        }
+        return rebalance(root);
     }
-}
 
-void CanTxQueue::remove(CanTxQueueEntry* entry) {
-    if (entry == UAVCAN_NULLPTR) {
-        return;
+    static CanTxQueueEntry* first(CanTxQueueEntry* root)
+    {
+        if (root != UAVCAN_NULLPTR)
+        {
+            while (Index::left(root) != UAVCAN_NULLPTR)
+            {
+                root = Index::left(root);
+            }
+        }
+        return root;
     }
+};
 
-    // Make the AvlTree remove the specific entry deleting it's Node *
-    this->AvlTree::removeEntry(entry);
-    // Then let the entry destroy it's own contents
-    CanTxQueueEntry::destroy(entry, allocator_);
+CanTxQueue::~CanTxQueue()
+{
+    destroyRecursively(prio_root_, allocator_);
 }
 
-CanTxQueueEntry* CanTxQueue::peek() {
-    Node* maxNode = searchForNonExpiredMax(root_);
+void CanTxQueue::destroyRecursively(CanTxQueueEntry* entry, IPoolAllocator& allocator)
+{
+    if (entry != UAVCAN_NULLPTR)
+    {
+        destroyRecursively(entry->prio_left_, allocator);
+        destroyRecursively(entry->prio_right_, allocator);
+        CanTxQueueEntry::destroy(entry, allocator);
+    }
+}
 
-    if (maxNode == UAVCAN_NULLPTR) {
-        return UAVCAN_NULLPTR;
+bool CanTxQueue::containsRecursively(const CanTxQueueEntry* entry, const CanFrame& frame)
+{
+    if (entry == UAVCAN_NULLPTR)
+    {
+        return false;
     }
+    if (frame.priorityHigherThan(entry->frame))
+    {
+        return containsRecursively(entry->prio_left_, frame);
+    }
+    if (frame.priorityLowerThan(entry->frame))
+    {
+        return containsRecursively(entry->prio_right_, frame);
+    }
+    // Frames of equal priority may be found on both sides
+    return (entry->frame == frame) ||
+           containsRecursively(entry->prio_left_, frame) ||
+           containsRecursively(entry->prio_right_, frame);
+}
 
-    return maxNode->data;
+bool CanTxQueue::contains(const CanFrame& frame) const
+{
+    return containsRecursively(prio_root_, frame);
 }
 
-bool CanTxQueue::topPriorityHigherOrEqual(const CanFrame& rhs_frame) {
-    CanTxQueueEntry* peek_entry = peek();
-    if (peek_entry == UAVCAN_NULLPTR) {
-        return false;
+uint32_t CanTxQueue::makeSeq(MonotonicTime timestamp, unsigned num_frames)
+{
+    const uint32_t now = uint32_t(timestamp.toUSec());
+    const uint32_t first = (isEmpty() || seqBefore(last_seq_, now)) ? now : (last_seq_ + 1U);
+    last_seq_ = first + num_frames - 1U;
+    return first;
+}
+
+void CanTxQueue::registerRejectedFrames(const ICanFrameSequence& frames)
+{
+    const unsigned num_frames = frames.getNumFrames();
+    const uint32_t max_cnt = NumericTraits<uint32_t>::max();
+    rejected_frames_cnt_ = (max_cnt - rejected_frames_cnt_ < num_frames) ? max_cnt
+                                                                         : (rejected_frames_cnt_ + num_frames);
+#if UAVCAN_TX_QUEUE_STATS
+    for (unsigned i = 0; i < num_frames; i++)
+    {
+        CanFrame frame;
+        if (frames.getFrame(i, frame))
+        {
+            stats_.levels[CanTxQueueStats::getPriorityLevel(frame)].num_rejected++;
+        }
     }
-    return !rhs_frame.priorityHigherThan(peek_entry->frame);
+#endif
+}
+
+void CanTxQueue::push(const CanFrame& frame, MonotonicTime tx_deadline, CanIOFlags flags)
+{
+    push(&frame, 1, tx_deadline, flags);
+}
+
+void CanTxQueue::push(const CanFrame* frames, unsigned num_frames, MonotonicTime tx_deadline, CanIOFlags flags)
+{
+    UAVCAN_ASSERT((frames != UAVCAN_NULLPTR) || (num_frames == 0));
+    (void)push(CanFrameArraySequence(frames, num_frames), tx_deadline, flags);
 }
 
-uavcan::AvlTree<uavcan::CanTxQueueEntry>::Node* CanTxQueue::searchForNonExpiredMax(Node* n) {
-    if (n == UAVCAN_NULLPTR) {
-        return UAVCAN_NULLPTR;
+bool CanTxQueue::push(const ICanFrameSequence& frames, MonotonicTime tx_deadline, CanIOFlags flags)
+{
+    const unsigned num_frames = frames.getNumFrames();
+    if (num_frames == 0)
+    {
+        return true;
     }
 
     const MonotonicTime timestamp = sysclock_.getMonotonic();
+    if (timestamp >= tx_deadline)
+    {
+        UAVCAN_TRACE("CanTxQueue", "Push rejected: already expired");
+        registerRejectedFrames(frames);
+        return false;
+    }
+    tx_deadline = min(tx_deadline, timestamp + MonotonicDuration::fromUSec(MaxFrameLifetimeUSec));
+
+    // Expired entries must go before new timestamps are issued, see MaxFrameLifetimeUSec
+    removeExpired(timestamp);
 
-    while(n->data->isExpired(timestamp)) {
-        remove(n->data);
-        return searchForNonExpiredMax(root_);
+    /*
+     * All entries are constructed before any of them is linked, so that OOM leaves the queue unchanged.
+     * Meanwhile, the constructed entries are chained through the left link of the priority index; linking resets it.
+     */
+    const uint32_t prev_last_seq = last_seq_;
+    const uint32_t first_seq = makeSeq(timestamp, num_frames);
+    CanTxQueueEntry* pending = UAVCAN_NULLPTR;
+    bool success = true;
+
+    for (unsigned i = 0; i < num_frames; i++)
+    {
+        void* const praw = allocator_.allocate(sizeof(CanTxQueueEntry));
+        if (praw == UAVCAN_NULLPTR)
+        {
+            UAVCAN_TRACE("CanTxQueue", "Push rejected: OOM, %u of %u frames", i, num_frames);
+            success = false;
+            break;
+        }
+
+        CanFrame frame;
+        if (!frames.getFrame(i, frame))
+        {
+            UAVCAN_ASSERT(0);
+            allocator_.deallocate(praw);
+            success = false;
+            break;
+        }
+
+        CanTxQueueEntry* const entry = new (praw) CanTxQueueEntry(frame, tx_deadline, flags, first_seq + i);
+        entry->prio_left_ = pending;
+        pending = entry;
     }
 
-    while(n->right != UAVCAN_NULLPTR && n->right->data->isExpired(timestamp)) {
-        CanTxQueueEntry* expiredEntry = n->data;
-        n->right = this->AvlTree::removeNode(n, n->data);
-        CanTxQueueEntry::destroy(expiredEntry, allocator_);
+    if (!success)
+    {
+        while (pending != UAVCAN_NULLPTR)
+        {
+            CanTxQueueEntry* entry = pending;
+            pending = pending->prio_left_;
+            CanTxQueueEntry::destroy(entry, allocator_);
+        }
+        last_seq_ = prev_last_seq;
+        registerRejectedFrames(frames);
+        return false;
     }
 
-    Node* r = searchForNonExpiredMax(n->right);
+    // The order of linking doesn't matter, since the entries of equal priority are ordered by sequence number
+    while (pending != UAVCAN_NULLPTR)
+    {
+        CanTxQueueEntry* const entry = pending;
+        pending = pending->prio_left_;
+
+        prio_root_ = Tree<PriorityIndex>::insert(prio_root_, entry);
+        deadline_root_ = Tree<DeadlineIndex>::insert(deadline_root_, entry);
+        size_++;
 
-    if (r != UAVCAN_NULLPTR) {
-        return r;
+#if UAVCAN_TX_QUEUE_STATS
+        CanTxQueueStats::PriorityLevel& level = stats_.levels[CanTxQueueStats::getPriorityLevel(entry->frame)];
+        level.depth++;
+        level.peak_depth = max(level.peak_depth, level.depth);
+#endif
     }
+    return true;
+}
 
-    return n;
+void CanTxQueue::unlink(CanTxQueueEntry* entry)
+{
+    UAVCAN_ASSERT(size_ > 0);
+    prio_root_ = Tree<PriorityIndex>::remove(prio_root_, entry);
+    deadline_root_ = Tree<DeadlineIndex>::remove(deadline_root_, entry);
+    size_--;
+    CanTxQueueEntry::destroy(entry, allocator_);
+}
+
+void CanTxQueue::remove(CanTxQueueEntry* entry)
+{
+    if (entry == UAVCAN_NULLPTR)
+    {
+        return;
+    }
+
+#if UAVCAN_TX_QUEUE_STATS
+    const uint32_t now = uint32_t(sysclock_.getMonotonic().toUSec());
+    const uint32_t latency = seqBefore(entry->seq_, now) ? (now - entry->seq_) : 0U;
+
+    CanTxQueueStats::PriorityLevel& level = stats_.levels[CanTxQueueStats::getPriorityLevel(entry->frame)];
+    UAVCAN_ASSERT(level.depth > 0);
+    level.depth--;
+    level.num_transmitted++;
+    level.max_latency_usec = max(level.max_latency_usec, latency);
+    level.latency_histogram[CanTxQueueStats::getLatencyBin(latency)]++;
+#endif
+
+    unlink(entry);
+}
+
+void CanTxQueue::removeExpired(MonotonicTime timestamp)
+{
+    while (true)
+    {
+        CanTxQueueEntry* const entry = Tree<DeadlineIndex>::first(deadline_root_);
+        if ((entry == UAVCAN_NULLPTR) || !entry->isExpired(timestamp))
+        {
+            break;
+        }
+        UAVCAN_TRACE("CanTxQueue", "Expired: %s", entry->toString().c_str());
+
+#if UAVCAN_TX_QUEUE_STATS
+        CanTxQueueStats::PriorityLevel& level = stats_.levels[CanTxQueueStats::getPriorityLevel(entry->frame)];
+        UAVCAN_ASSERT(level.depth > 0);
+        level.depth--;
+        level.num_expired++;
+#endif
+
+        unlink(entry);
+    }
+}
+
+CanTxQueueEntry* CanTxQueue::peek()
+{
+    removeExpired(sysclock_.getMonotonic());
+    return Tree<PriorityIndex>::first(prio_root_);
+}
+
+bool CanTxQueue::topPriorityHigherOrEqual(const CanFrame& rhs_frame)
+{
+    CanTxQueueEntry* peek_entry = peek();
+    if (peek_entry == UAVCAN_NULLPTR)
+    {
+        return false;
+    }
+    return !rhs_frame.priorityHigherThan(peek_entry->frame);
 }
 
 /*
@@ -241,12 +573,16 @@ int CanIOManager::callSelect(CanSelectMasks &inout_masks, const CanFrame *(&pend
 
     inout_masks.read &= in_masks.read;  // Driver is not required to clean the masks
     inout_masks.write &= in_masks.write;
+    if (inout_masks.wakeup)
+    {
+        wakeup_pending_ = true;         // Kept until yielded, so a wakeup that happens during send() is not lost
+    }
     return res;
 }
 
 CanIOManager::CanIOManager(ICanDriver& driver, IPoolAllocator& allocator, ISystemClock& sysclock,
                            std::size_t mem_blocks_per_iface)
-        : driver_(driver), sysclock_(sysclock), num_ifaces_(driver.getNumIfaces()) 
+        : driver_(driver), sysclock_(sysclock), num_ifaces_(driver.getNumIfaces()), wakeup_pending_(false)
 {
     if (num_ifaces_ < 1 || num_ifaces_ > MaxCanIfaces) 
     {
@@ -280,6 +616,23 @@ uint8_t CanIOManager::makePendingTxMask() const
     return write_mask;
 }
 
+unsigned CanIOManager::getTxQueueDepth(uint8_t iface_index) const
+{
+    if (iface_index >= num_ifaces_)
+    {
+        UAVCAN_ASSERT(0);
+        return 0;
+    }
+    return tx_queues_[iface_index]->getSize();
+}
+
+#if UAVCAN_TX_QUEUE_STATS
+const CanTxQueueStats* CanIOManager::getTxQueueStats(uint8_t iface_index) const
+{
+    return (iface_index < num_ifaces_) ? &tx_queues_[iface_index]->getStats() : UAVCAN_NULLPTR;
+}
+#endif
+
 CanIfacePerfCounters CanIOManager::getIfacePerfCounters(uint8_t iface_index) const 
 {
     ICanIface *const iface = driver_.getIface(iface_index);
@@ -298,15 +651,29 @@ CanIfacePerfCounters CanIOManager::getIfacePerfCounters(uint8_t iface_index) con
 int CanIOManager::send(const CanFrame &frame, MonotonicTime tx_deadline, MonotonicTime blocking_deadline,
                        uint8_t iface_mask, CanIOFlags flags) 
 {
+    return sendBatch(&frame, 1, tx_deadline, blocking_deadline, iface_mask, flags);
+}
+
+int CanIOManager::sendBatch(const CanFrame* frames, unsigned num_frames, MonotonicTime tx_deadline,
+                            MonotonicTime blocking_deadline, uint8_t iface_mask, CanIOFlags flags)
+{
+    UAVCAN_ASSERT((frames != UAVCAN_NULLPTR) || (num_frames == 0));
+
     const uint8_t num_ifaces = getNumIfaces();
     const uint8_t all_ifaces_mask = uint8_t((1U << num_ifaces) - 1);
     iface_mask &= all_ifaces_mask;
 
+    if (num_frames == 0)
+    {
+        iface_mask = 0;
+    }
+
     if (blocking_deadline > tx_deadline) 
     {
         blocking_deadline = tx_deadline;
     }
 
+    unsigned next_frame[MaxCanIfaces] = {};     // Index of the next frame of the batch, per iface
     int retval = 0;
 
     while (true)        // Somebody please refactor this.
@@ -331,6 +698,7 @@ int CanIOManager::send(const CanFrame &frame, MonotonicTime tx_deadline, Monoton
 
                 if (iface_mask & (1 << i))      // I hate myself so much right now.
                 {
+                    const CanFrame& frame = frames[next_frame[i]];
                     bool has_priority = false;
 
                     // This may seem duplicate of topPriorityHigherOrEqual but we want to avoid traversing the queue again
@@ -356,6 +724,7 @@ int CanIOManager::send(const CanFrame &frame, MonotonicTime tx_deadline, Monoton
         }
 
         // Transmission
+        uint8_t progress_mask = 0;      // Ifaces that have accepted a frame
         for (uint8_t i = 0; i < num_ifaces; i++) 
         {
             if (masks.write & (1 << i)) 
@@ -363,6 +732,7 @@ int CanIOManager::send(const CanFrame &frame, MonotonicTime tx_deadline, Monoton
                 int res = 0;
                 if (iface_mask & (1 << i)) 
                 {
+                    const CanFrame& frame = frames[next_frame[i]];
                     if (tx_queues_[i]->topPriorityHigherOrEqual(frame)) 
                     {
                         res = sendFromTxQueue(
@@ -373,7 +743,10 @@ int CanIOManager::send(const CanFrame &frame, MonotonicTime tx_deadline, Monoton
                         res = sendToIface(i, frame, tx_deadline, flags);
                         if (res > 0) 
                         {
-                            iface_mask &= uint8_t(~(1 << i));     // Mark transmitted
+                            if (++next_frame[i] >= num_frames)
+                            {
+                                iface_mask &= uint8_t(~(1 << i));     // Mark transmitted
+                            }
                         }
                     }
                 } 
@@ -383,12 +756,15 @@ int CanIOManager::send(const CanFrame &frame, MonotonicTime tx_deadline, Monoton
                 }
                 if (res > 0) 
                 {
+                    progress_mask = uint8_t(progress_mask | (1 << i));
                     retval++;
                 }
             }
         }
 
-        // Timeout. Enqueue the frame if wasn't transmitted and leave.
+        // Timeout. Enqueue the frames that weren't transmitted and leave.
+        // An iface that still has frames of the batch to send and has just accepted a frame is polled again even
+        // past the deadline, since that doesn't block.
         const bool timed_out = sysclock_.getMonotonic() >= blocking_deadline;
         if (masks.write == 0 || timed_out) 
         {
@@ -397,11 +773,15 @@ int CanIOManager::send(const CanFrame &frame, MonotonicTime tx_deadline, Monoton
                 UAVCAN_TRACE("CanIOManager", "Send: Premature timeout in select(), will try again");
                 continue;
             }
+            if ((progress_mask & iface_mask) != 0)
+            {
+                continue;
+            }
             for (uint8_t i = 0; i < num_ifaces; i++) 
             {
                 if (iface_mask & (1 << i)) 
                 {
-                    tx_queues_[i]->push(frame, tx_deadline, flags);
+                    tx_queues_[i]->push(frames + next_frame[i], num_frames - next_frame[i], tx_deadline, flags);
                 }
             }
             break;
@@ -410,11 +790,40 @@ int CanIOManager::send(const CanFrame &frame, MonotonicTime tx_deadline, Monoton
     return retval;
 }
 
-int CanIOManager::receive(CanRxFrame &out_frame, MonotonicTime blocking_deadline, CanIOFlags &out_flags) 
+int CanIOManager::enqueue(const ICanFrameSequence& frames, MonotonicTime tx_deadline, uint8_t iface_mask,
+                          CanIOFlags flags)
 {
+    int num_accepted = 0;
+    for (uint8_t i = 0; i < getNumIfaces(); i++)
+    {
+        if ((iface_mask & (1 << i)) && tx_queues_[i]->push(frames, tx_deadline, flags))
+        {
+            num_accepted++;
+        }
+    }
+    return num_accepted;
+}
+
+int CanIOManager::receive(CanRxFrame& out_frame, MonotonicTime blocking_deadline, CanIOFlags& out_flags)
+{
+    return receiveBatch(&out_frame, &out_flags, 1, blocking_deadline);
+}
+
+int CanIOManager::receiveBatch(CanRxFrame* out_frames, CanIOFlags* out_flags, unsigned max_frames,
+                               MonotonicTime blocking_deadline)
+{
+    UAVCAN_ASSERT((out_frames != UAVCAN_NULLPTR) && (out_flags != UAVCAN_NULLPTR) && (max_frames > 0));
+    max_frames = min(max_frames, CanRxBatchSize);
+
     const uint8_t num_ifaces = getNumIfaces();
+    CanRxBatchItem items[CanRxBatchSize];
+
+    if (wakeup_pending_)
+    {
+        blocking_deadline = MonotonicTime();    // Not yielded yet, e.g. it arrived during send() - poll only
+    }
 
-    while (true) 
+    while (true)
     {
         CanSelectMasks masks;
         masks.write = makePendingTxMask();
@@ -428,54 +837,91 @@ int CanIOManager::receive(CanRxFrame &out_frame, MonotonicTime blocking_deadline
             }
 
             const int select_res = callSelect(masks, pending_tx, blocking_deadline);
-            if (select_res < 0) 
+            if (select_res < 0)
             {
                 return -ErrDriver;
             }
         }
 
         // Write - if buffers are not empty, one frame will be sent for each iface per one receive() call
-        for (uint8_t i = 0; i < num_ifaces; i++) 
+        for (uint8_t i = 0; i < num_ifaces; i++)
         {
-            if (masks.write & (1 << i)) 
+            if (masks.write & (1 << i))
             {
-                (void) sendFromTxQueue(
-                        i);  // It may fail, we don't care. Requested operation was receive, not send.
+                (void)sendFromTxQueue(i);   // It may fail, we don't care. Requested operation was receive, not send.
             }
         }
 
-        // Read
-        for (uint8_t i = 0; i < num_ifaces; i++) 
+        // Read - every ready iface gets an equal share of the output array
+        unsigned num_ready = 0;
+        for (uint8_t i = 0; i < num_ifaces; i++)
         {
-            if (masks.read & (1 << i)) 
+            if (masks.read & (1 << i))
+            {
+                num_ready++;
+            }
+        }
+
+        if (num_ready > 0)
+        {
+            const unsigned quota = max(1U, max_frames / num_ready);
+            unsigned num_received = 0;
+
+            for (uint8_t i = 0; (i < num_ifaces) && (num_received < max_frames); i++)
             {
-                ICanIface *const iface = driver_.getIface(i);
-                //std::cerr<<"canio::receive:1:"<<std::endl;
-                if (iface == UAVCAN_NULLPTR) 
+                if ((masks.read & (1 << i)) == 0)
+                {
+                    continue;
+                }
+
+                ICanIface* const iface = driver_.getIface(i);
+                if (iface == UAVCAN_NULLPTR)
                 {
                     UAVCAN_ASSERT(0);   // Nonexistent interface
                     continue;
                 }
 
-                const int res = iface->receive(out_frame, out_frame.ts_mono, out_frame.ts_utc, out_flags);
-                //std::cerr<<"canio::receive:2:"<<res<<std::endl;
-                if (res == 0) 
+                const int res = iface->receiveBatch(items, uint16_t(min(quota, max_frames - num_received)));
+                if (res < 0)
+                {
+                    return (num_received > 0) ? int(num_received) : -ErrDriver;
+                }
+                if (res == 0)
                 {
                     UAVCAN_ASSERT(0);   // select() reported that iface has pending RX frames, but receive() returned none
                     continue;
                 }
-                out_frame.iface_index = i;
 
-                if ((res > 0) && !(out_flags & CanIOFlagLoopback)) 
+                for (int k = 0; k < res; k++)
                 {
-                    counters_[i].frames_rx += 1;
+                    CanRxFrame& frame = out_frames[num_received];
+                    static_cast<CanFrame&>(frame) = items[k].frame;
+                    frame.ts_mono = items[k].ts_monotonic;
+                    frame.ts_utc = items[k].ts_utc;
+                    frame.iface_index = i;
+                    out_flags[num_received] = items[k].flags;
+
+                    if (!(items[k].flags & CanIOFlagLoopback))
+                    {
+                        counters_[i].frames_rx += 1;
+                    }
+                    num_received++;
                 }
-                return (res < 0) ? -ErrDriver : res;
             }
+
+            if (num_received > 0)
+            {
+                return int(num_received);
+            }
+        }
+
+        if (wakeup_pending_)
+        {
+            break;
         }
 
         // Timeout checked in the last order - this way we can operate with expired deadline:
-        if (sysclock_.getMonotonic() >= blocking_deadline) 
+        if (sysclock_.getMonotonic() >= blocking_deadline)
         {
             break;
         }
@@ -135,4 +135,125 @@ const uint32_t TransferCRC32::Table[256] = {
 	0xB40BBE37L, 0xC30C8EA1L, 0x5A05DF1BL,
 	0x2D02EF8DL };
 
+#if UAVCAN_CRC_SLICE_BY_8
+/*
+ * Slice-by-8 tables.
+ * Table K of each set gives the contribution of a byte that is followed by K more bytes in the 8-byte block.
+ * All three CRC functions are linear, so the contributions of individual bytes can be XORed together.
+ */
+namespace
+{
+
+struct SliceBy8Tables
+{
+    uint16_t crc16[8][256];
+    uint32_t crc32[8][256];
+    uint32_t crc32_state[3][256];   ///< Contribution of the initial state bytes 0..2; byte 3 is shifted out
+    uint64_t crc48[8][256];
+
+    /// Same as TransferCRC32::add(uint8_t)
+    uint32_t stepCrc32(uint32_t crc, uint8_t byte) const
+    {
+        return uint32_t((crc << 8) ^ crc32[0][((crc >> 8) ^ byte) & 0xFFU]);
+    }
+
+    SliceBy8Tables()
+    {
+        for (unsigned i = 0; i < 256; i++)
+        {
+            uint16_t c16 = uint16_t(i << 8);
+            uint32_t c32 = i;                   // TransferCRC32::Table is the reflected CRC-32 table
+            uint64_t c48 = i;
+            for (unsigned bit = 0; bit < 8; bit++)
+            {
+                c16 = uint16_t((c16 & 0x8000U) ? ((c16 << 1) ^ 0x1021U) : (c16 << 1));
+                c32 = (c32 & 1U) ? ((c32 >> 1) ^ 0xEDB88320U) : (c32 >> 1);
+                c48 = (c48 & 1U) ? ((c48 >> 1) ^ 0xeadb71093528ULL) : (c48 >> 1);
+            }
+            crc16[0][i] = c16;
+            crc32[0][i] = c32;
+            crc48[0][i] = c48;
+        }
+
+        for (unsigned k = 1; k < 8; k++)
+        {
+            for (unsigned i = 0; i < 256; i++)
+            {
+                const uint16_t prev16 = crc16[k - 1][i];
+                crc16[k][i] = uint16_t((prev16 << 8) ^ crc16[0][prev16 >> 8]);
+                crc32[k][i] = stepCrc32(crc32[k - 1][i], 0);
+                const uint64_t prev48 = crc48[k - 1][i];
+                crc48[k][i] = (prev48 >> 8) ^ crc48[0][prev48 & 0xFFU];
+            }
+        }
+
+        for (unsigned j = 0; j < 3; j++)
+        {
+            for (unsigned i = 0; i < 256; i++)
+            {
+                uint32_t c32 = uint32_t(i << (8 * j));
+                for (unsigned k = 0; k < 8; k++)
+                {
+                    c32 = stepCrc32(c32, 0);
+                }
+                crc32_state[j][i] = c32;
+            }
+        }
+    }
+};
+
+/**
+ * Computed on first use, which also makes it safe to compute CRC during static initialization.
+ */
+const SliceBy8Tables& getSliceBy8Tables()
+{
+    static const SliceBy8Tables tables;
+    return tables;
+}
+
+}
+
+uint16_t TransferCRC::addSliceBy8(uint16_t crc, const uint8_t* bytes, unsigned len)
+{
+    UAVCAN_ASSERT((len % 8) == 0);
+    const uint16_t (&t)[8][256] = getSliceBy8Tables().crc16;
+    for (; len > 0; len -= 8, bytes += 8)
+    {
+        crc = uint16_t(t[7][bytes[0] ^ (crc >> 8)] ^ t[6][bytes[1] ^ (crc & 0xFFU)] ^
+                       t[5][bytes[2]] ^ t[4][bytes[3]] ^ t[3][bytes[4]] ^ t[2][bytes[5]] ^
+                       t[1][bytes[6]] ^ t[0][bytes[7]]);
+    }
+    return crc;
+}
+
+uint32_t TransferCRC32::addSliceBy8(uint32_t crc, const uint8_t* bytes, unsigned len)
+{
+    UAVCAN_ASSERT((len % 8) == 0);
+    const SliceBy8Tables& tables = getSliceBy8Tables();
+    const uint32_t (&t)[8][256] = tables.crc32;
+    const uint32_t (&s)[3][256] = tables.crc32_state;
+    for (; len > 0; len -= 8, bytes += 8)
+    {
+        crc = s[0][crc & 0xFFU] ^ s[1][(crc >> 8) & 0xFFU] ^ s[2][(crc >> 16) & 0xFFU] ^
+              t[7][bytes[0]] ^ t[6][bytes[1]] ^ t[5][bytes[2]] ^ t[4][bytes[3]] ^
+              t[3][bytes[4]] ^ t[2][bytes[5]] ^ t[1][bytes[6]] ^ t[0][bytes[7]];
+    }
+    return crc;
+}
+
+uint64_t TransferCRC48::addSliceBy8(uint64_t crc, const uint8_t* bytes, unsigned len)
+{
+    UAVCAN_ASSERT((len % 8) == 0);
+    const uint64_t (&t)[8][256] = getSliceBy8Tables().crc48;
+    for (; len > 0; len -= 8, bytes += 8)
+    {
+        crc = t[7][bytes[0] ^ (crc & 0xFFU)] ^ t[6][bytes[1] ^ ((crc >> 8) & 0xFFU)] ^
+              t[5][bytes[2] ^ ((crc >> 16) & 0xFFU)] ^ t[4][bytes[3] ^ ((crc >> 24) & 0xFFU)] ^
+              t[3][bytes[4] ^ ((crc >> 32) & 0xFFU)] ^ t[2][bytes[5] ^ ((crc >> 40) & 0xFFU)] ^
+              t[1][bytes[6]] ^ t[0][bytes[7]];
+    }
+    return crc;
+}
+#endif
+
 }
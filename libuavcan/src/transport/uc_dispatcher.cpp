@@ -5,7 +5,6 @@
 #include <uavcan/transport/dispatcher.hpp>
 #include <uavcan/debug.hpp>
 #include <cassert>
-#include <iostream>
 
 namespace uavcan
 {
@@ -73,42 +72,102 @@ void LoopbackFrameListenerRegistry::invokeListeners(RxFrame& frame)
 /*
  * Dispatcher::ListenerRegister
  */
-bool Dispatcher::ListenerRegistry::add(TransferListener* listener, Mode mode)
+#if UAVCAN_DISPATCHER_LISTENER_INDEX_SIZE > 0
+void Dispatcher::ListenerRegistry::rebuildIndex()
+{
+    index_len_ = 0;
+    index_overflow_ = false;
+
+    TransferListener* p = list_.get();
+    while (p)
+    {
+        const uint16_t dtid = p->getDataTypeDescriptor().getID().get();
+        if ((index_len_ == 0) || (index_[index_len_ - 1].data_type_id != dtid))
+        {
+            if (index_len_ >= UAVCAN_DISPATCHER_LISTENER_INDEX_SIZE)
+            {
+                UAVCAN_TRACE("Dispatcher", "Listener index overflow, falling back to linear search");
+                index_overflow_ = true;
+                return;
+            }
+            index_[index_len_].first = p;
+            index_[index_len_].data_type_id = dtid;
+            index_len_++;
+        }
+        p = p->getNextListNode();
+    }
+}
+#endif
+
+TransferListener* Dispatcher::ListenerRegistry::findFirst(DataTypeID dtid) const
 {
-    if (mode == UniqueListener)
+#if UAVCAN_DISPATCHER_LISTENER_INDEX_SIZE > 0
+    if (!index_overflow_)
     {
-        TransferListener* p = list_.get();
-        while (p)
+        unsigned lo = 0;
+        unsigned hi = index_len_;
+        while (lo < hi)
         {
-            if (p->getDataTypeDescriptor().getID() == listener->getDataTypeDescriptor().getID())
+            const unsigned mid = (lo + hi) / 2U;
+            const uint16_t mid_dtid = index_[mid].data_type_id;
+            if (mid_dtid == dtid.get())
+            {
+                return index_[mid].first;
+            }
+            if (mid_dtid > dtid.get())  // Descending order
+            {
+                lo = mid + 1U;
+            }
+            else
             {
-                return false;
+                hi = mid;
             }
-            p = p->getNextListNode();
         }
+        return UAVCAN_NULLPTR;
+    }
+#endif
+    TransferListener* p = list_.get();
+    while (p)
+    {
+        const DataTypeID p_dtid = p->getDataTypeDescriptor().getID();
+        if (p_dtid == dtid)
+        {
+            return p;
+        }
+        if (p_dtid < dtid)      // Listeners are ordered by data type id!
+        {
+            break;
+        }
+        p = p->getNextListNode();
+    }
+    return UAVCAN_NULLPTR;
+}
+
+bool Dispatcher::ListenerRegistry::add(TransferListener* listener, Mode mode)
+{
+    if ((mode == UniqueListener) && (findFirst(listener->getDataTypeDescriptor().getID()) != UAVCAN_NULLPTR))
+    {
+        return false;
     }
-    // Objective is to arrange entries by Data Type ID in ascending order from root.
+    // Objective is to arrange entries by Data Type ID in descending order from root.
     list_.insertBefore(listener, DataTypeIDInsertionComparator(listener->getDataTypeDescriptor().getID()));
+#if UAVCAN_DISPATCHER_LISTENER_INDEX_SIZE > 0
+    rebuildIndex();
+#endif
     return true;
 }
 
 void Dispatcher::ListenerRegistry::remove(TransferListener* listener)
 {
     list_.remove(listener);
+#if UAVCAN_DISPATCHER_LISTENER_INDEX_SIZE > 0
+    rebuildIndex();
+#endif
 }
 
 bool Dispatcher::ListenerRegistry::exists(DataTypeID dtid) const
 {
-    TransferListener* p = list_.get();
-    while (p)
-    {
-        if (p->getDataTypeDescriptor().getID() == dtid)
-        {
-            return true;
-        }
-        p = p->getNextListNode();
-    }
-    return false;
+    return findFirst(dtid) != UAVCAN_NULLPTR;
 }
 
 void Dispatcher::ListenerRegistry::cleanup(MonotonicTime ts)
@@ -124,63 +183,52 @@ void Dispatcher::ListenerRegistry::cleanup(MonotonicTime ts)
 
 void Dispatcher::ListenerRegistry::handleFrame(const RxFrame& frame)
 {
-    TransferListener* p = list_.get();
-    while (p)
+    const DataTypeID dtid = frame.getDataTypeID();
+    TransferListener* p = findFirst(dtid);
+    while ((p != UAVCAN_NULLPTR) && (p->getDataTypeDescriptor().getID() == dtid))
     {
         TransferListener* const next = p->getNextListNode();
-        if (p->getDataTypeDescriptor().getID() == frame.getDataTypeID())
-        {
-            //std::cerr<<"data is is same:"<<std::endl;
-            p->handleFrame(frame); // p may be modified
-        }
-        else if (p->getDataTypeDescriptor().getID() < frame.getDataTypeID())  // Listeners are ordered by data type id!
-        {
-            std::cerr<<"data id is little:"<<std::endl;
-            break;
-        }
-        else
-        {
-            std::cerr<<"data id is big:"<<std::endl;
-            ;  // Nothing to do with this one
-        }
+        p->handleFrame(frame); // p may be modified
         p = next;
     }
 }
 
 /*
- * Dispatcher
+ * Dispatcher::RxPrefilter
  */
-void Dispatcher::handleFrame(const CanRxFrame& can_frame)
+#if UAVCAN_DISPATCHER_RX_PREFILTER_BITS > 0
+void Dispatcher::RxPrefilter::rebuild(uint32_t* bitmap, unsigned bitmap_size,
+                                      const LinkedListRoot<TransferListener>& list)
 {
-    RxFrame frame;
-    if (!frame.parse(can_frame))
-    {
-        // This is not counted as a transport error
-        UAVCAN_TRACE("Dispatcher", "Invalid CAN frame received: %s", can_frame.toString().c_str());
-        return;
-    }
+    fill_n(bitmap, bitmap_size, uint32_t(0));
+    const unsigned mask = bitmap_size * 32U - 1U;
 
-    if ((frame.getDstNodeID() != NodeID::Broadcast) &&
-        (frame.getDstNodeID() != getNodeID()))
+    const TransferListener* p = list.get();
+    while (p)
     {
-        return;
+        const unsigned bit = p->getDataTypeDescriptor().getID().get() & mask;
+        bitmap[bit >> 5] |= uint32_t(1UL << (bit & 31U));
+        p = p->getNextListNode();
     }
+}
 
-    switch (frame.getTransferType())
+void Dispatcher::RxPrefilter::rebuild(TransferType transfer_type, const LinkedListRoot<TransferListener>& list)
+{
+    switch (transfer_type)
     {
     case TransferTypeMessageBroadcast:
     {
-        lmsg_.handleFrame(frame);
+        rebuild(messages_, MessageBitmapSize, list);
         break;
     }
     case TransferTypeServiceRequest:
     {
-        lsrv_req_.handleFrame(frame);
+        rebuild(requests_, ServiceBitmapSize, list);
         break;
     }
     case TransferTypeServiceResponse:
     {
-        lsrv_resp_.handleFrame(frame);
+        rebuild(responses_, ServiceBitmapSize, list);
         break;
     }
     default:
@@ -191,8 +239,49 @@ void Dispatcher::handleFrame(const CanRxFrame& can_frame)
     }
 }
 
-void Dispatcher::handleFrame(RxFrame& frame, const CanRxFrame& can_frame)
+bool Dispatcher::RxPrefilter::accept(uint32_t can_id, NodeID self_node_id) const
 {
+    if (((can_id & CanFrame::FlagEFF) == 0) || ((can_id & (CanFrame::FlagRTR | CanFrame::FlagERR)) != 0))
+    {
+        return true;
+    }
+
+    // The CAN ID layout is the same as in Frame::parse()
+    if ((can_id & (1UL << 7)) != 0)
+    {
+        const unsigned dst_node_id = (can_id >> 8) & 0x7FU;
+        if (dst_node_id != self_node_id.get())
+        {
+            return false;
+        }
+        const unsigned dtid = (can_id >> 16) & 0xFFU;
+        return test(((can_id & (1UL << 15)) != 0) ? requests_ : responses_, dtid);
+    }
+    else
+    {
+        unsigned dtid = (can_id >> 8) & 0xFFFFU;
+        if ((can_id & 0x7FU) == 0)
+        {
+            dtid &= 3U;                 // Anonymous frame, removing the discriminator
+        }
+        return test(messages_, dtid & (unsigned(UAVCAN_DISPATCHER_RX_PREFILTER_BITS) - 1U));
+    }
+}
+#endif
+
+/*
+ * Dispatcher
+ */
+void Dispatcher::handleFrame(const CanRxFrame& can_frame)
+{
+#if UAVCAN_DISPATCHER_RX_PREFILTER_BITS > 0
+    if (!rx_prefilter_.accept(can_frame.id, getNodeID()))
+    {
+        return;
+    }
+#endif
+
+    RxFrame frame;
     if (!frame.parse(can_frame))
     {
         // This is not counted as a transport error
@@ -200,13 +289,12 @@ void Dispatcher::handleFrame(RxFrame& frame, const CanRxFrame& can_frame)
         return;
     }
 
-    //std::cerr<<"handle frame 1:"<<std::endl;
-    if(frame.getDstNodeID() != getNodeID())
+    if ((frame.getDstNodeID() != NodeID::Broadcast) &&
+        (frame.getDstNodeID() != getNodeID()))
     {
         return;
     }
 
-    //std::cerr<<"handle frame 2:"<<std::endl;
     switch (frame.getTransferType())
     {
     case TransferTypeMessageBroadcast:
@@ -237,11 +325,11 @@ void Dispatcher::handleLoopbackFrame(const CanRxFrame&)
 {
 }
 
-void Dispatcher::handleLoopbackFrame(RxFrame& frame, const CanRxFrame&)
+void Dispatcher::notifyRxFrameListener(const CanRxFrame&, CanIOFlags)
 {
 }
 
-void Dispatcher::notifyRxFrameListener(const CanRxFrame&, CanIOFlags)
+void Dispatcher::notifyListenerRegistryObserver(TransferType)
 {
 }
 #else
@@ -258,18 +346,6 @@ void Dispatcher::handleLoopbackFrame(const CanRxFrame& can_frame)
     loopback_listeners_.invokeListeners(frame);
 }
 
-void Dispatcher::handleLoopbackFrame(RxFrame& frame, const CanRxFrame& can_frame)
-{
-    if (!frame.parse(can_frame))
-    {
-        UAVCAN_TRACE("Dispatcher", "Invalid loopback CAN frame: %s", can_frame.toString().c_str());
-        UAVCAN_ASSERT(0);  // No way!
-        return;
-    }
-    UAVCAN_ASSERT(frame.getSrcNodeID() == getNodeID());
-    loopback_listeners_.invokeListeners(frame);
-}
-
 void Dispatcher::notifyRxFrameListener(const CanRxFrame& can_frame, CanIOFlags flags)
 {
     if (rx_listener_ != UAVCAN_NULLPTR)
@@ -277,103 +353,50 @@ void Dispatcher::notifyRxFrameListener(const CanRxFrame& can_frame, CanIOFlags f
         rx_listener_->handleRxFrame(can_frame, flags);
     }
 }
-#endif
 
-int Dispatcher::spin(RxFrame& frame, MonotonicTime deadline)
+void Dispatcher::notifyListenerRegistryObserver(TransferType transfer_type)
 {
-    int num_frames_processed = 0;
-    do
+    if (listener_registry_observer_ != UAVCAN_NULLPTR)
     {
-        CanIOFlags flags = 0;
-        CanRxFrame can_frame;
-        const int res = canio_.receive(can_frame, deadline, flags);
-        
-        if (res < 0)
-        {
-            return res;
-        }
-        if (res > 0)
-        {
-            //std::cerr<<"disatcher::spin:"<<res<<std::endl;
-            if (flags & CanIOFlagLoopback)
-            {
-                handleLoopbackFrame(frame, can_frame);
-            }
-            else
-            {
-                num_frames_processed++;
-                handleFrame(frame, can_frame);
-            }
-            notifyRxFrameListener(can_frame, flags);
-        }
+        listener_registry_observer_->handleTransferListenerRegistryChange(transfer_type);
     }
-    while (sysclock_.getMonotonic() < deadline);
-
-    return num_frames_processed;
 }
+#endif
 
-int Dispatcher::spinOnce(RxFrame& frame)
+int Dispatcher::handleBatch(const CanRxFrame* can_frames, const CanIOFlags* flags, int num_frames)
 {
     int num_frames_processed = 0;
-
-    while (true)
+    for (int i = 0; i < num_frames; i++)
     {
-        CanIOFlags flags = 0;
-        CanRxFrame can_frame;
-        const int res = canio_.receive(can_frame, MonotonicTime(), flags);
-        if (res < 0)
+        if (flags[i] & CanIOFlagLoopback)
         {
-            return res;
-        }
-        else if (res > 0)
-        {
-            if (flags & CanIOFlagLoopback)
-            {
-                handleLoopbackFrame(frame, can_frame);
-            }
-            else
-            {
-                num_frames_processed++;
-                handleFrame(frame, can_frame);
-            }
-            notifyRxFrameListener(can_frame, flags);
+            handleLoopbackFrame(can_frames[i]);
         }
         else
         {
-            break;      // No frames left
+            num_frames_processed++;
+            handleFrame(can_frames[i]);
         }
+        notifyRxFrameListener(can_frames[i], flags[i]);
     }
-
     return num_frames_processed;
 }
 
 int Dispatcher::spin(MonotonicTime deadline)
 {
     int num_frames_processed = 0;
+    CanRxFrame can_frames[CanRxBatchSize];
+    CanIOFlags flags[CanRxBatchSize];
     do
     {
-        CanIOFlags flags = 0;
-        CanRxFrame frame;
-        const int res = canio_.receive(frame, deadline, flags);
+        const int res = canio_.receiveBatch(can_frames, flags, CanRxBatchSize, deadline);
         if (res < 0)
         {
             return res;
         }
-        if (res > 0)
-        {
-            if (flags & CanIOFlagLoopback)
-            {
-                handleLoopbackFrame(frame);
-            }
-            else
-            {
-                num_frames_processed++;
-                handleFrame(frame);
-            }
-            notifyRxFrameListener(frame, flags);
-        }
+        num_frames_processed += handleBatch(can_frames, flags, res);
     }
-    while (sysclock_.getMonotonic() < deadline);
+    while ((sysclock_.getMonotonic() < deadline) && !canio_.isWakeupPending());
 
     return num_frames_processed;
 }
@@ -381,28 +404,18 @@ int Dispatcher::spin(MonotonicTime deadline)
 int Dispatcher::spinOnce()
 {
     int num_frames_processed = 0;
-
+    CanRxFrame can_frames[CanRxBatchSize];
+    CanIOFlags flags[CanRxBatchSize];
     while (true)
     {
-        CanIOFlags flags = 0;
-        CanRxFrame frame;
-        const int res = canio_.receive(frame, MonotonicTime(), flags);
+        const int res = canio_.receiveBatch(can_frames, flags, CanRxBatchSize, MonotonicTime());
         if (res < 0)
         {
             return res;
         }
         else if (res > 0)
         {
-            if (flags & CanIOFlagLoopback)
-            {
-                handleLoopbackFrame(frame);
-            }
-            else
-            {
-                num_frames_processed++;
-                handleFrame(frame);
-            }
-            notifyRxFrameListener(frame, flags);
+            num_frames_processed += handleBatch(can_frames, flags, res);
         }
         else
         {
@@ -413,23 +426,38 @@ int Dispatcher::spinOnce()
     return num_frames_processed;
 }
 
-int Dispatcher::send(const Frame& frame, MonotonicTime tx_deadline, MonotonicTime blocking_deadline,
-                    CanIOFlags flags, uint8_t iface_mask)
+bool Dispatcher::isSentByThisNode(const CanFrame& can_frame) const
+{
+    // The source node ID occupies the lowest bits of the CAN ID, see Frame::makeCanIdTemplate()
+    const uint32_t src_node_id = can_frame.id & NodeID::AbsMax;
+    return src_node_id == (uint32_t(getNodeID().get()) & NodeID::AbsMax);
+}
+
+int Dispatcher::sendBatch(const CanFrame* frames, unsigned num_frames, MonotonicTime tx_deadline,
+                          MonotonicTime blocking_deadline, CanIOFlags flags, uint8_t iface_mask)
 {
-    if (frame.getSrcNodeID() != getNodeID())
+    for (unsigned i = 0; i < num_frames; i++)
     {
-        UAVCAN_ASSERT(0);
-        return -ErrLogic;
+        if (!isSentByThisNode(frames[i]))
+        {
+            UAVCAN_ASSERT(0);
+            return -ErrLogic;
+        }
     }
+    return canio_.sendBatch(frames, num_frames, tx_deadline, blocking_deadline, iface_mask, flags);
+}
 
-    CanFrame can_frame;
-    if (!frame.compile(can_frame))
+int Dispatcher::enqueue(const ICanFrameSequence& frames, MonotonicTime tx_deadline, CanIOFlags flags,
+                        uint8_t iface_mask)
+{
+    // All frames of a sequence belong to the same transfer, so checking the first one is enough
+    CanFrame first_frame;
+    if ((frames.getNumFrames() > 0) && (!frames.getFrame(0, first_frame) || !isSentByThisNode(first_frame)))
     {
-        UAVCAN_TRACE("Dispatcher", "Unable to send: frame is malformed: %s", frame.toString().c_str());
         UAVCAN_ASSERT(0);
         return -ErrLogic;
     }
-    return canio_.send(can_frame, tx_deadline, blocking_deadline, iface_mask, flags);
+    return canio_.enqueue(frames, tx_deadline, iface_mask, flags);
 }
 
 void Dispatcher::cleanup(MonotonicTime ts)
@@ -447,7 +475,15 @@ bool Dispatcher::registerMessageListener(TransferListener* listener)
         UAVCAN_ASSERT(0);
         return false;
     }
-    return lmsg_.add(listener, ListenerRegistry::ManyListeners);       // Multiple subscribers are OK
+    if (!lmsg_.add(listener, ListenerRegistry::ManyListeners))       // Multiple subscribers are OK
+    {
+        return false;
+    }
+#if UAVCAN_DISPATCHER_RX_PREFILTER_BITS > 0
+    rx_prefilter_.rebuild(TransferTypeMessageBroadcast, lmsg_.getList());
+#endif
+    notifyListenerRegistryObserver(TransferTypeMessageBroadcast);
+    return true;
 }
 
 bool Dispatcher::registerServiceRequestListener(TransferListener* listener)
@@ -457,7 +493,15 @@ bool Dispatcher::registerServiceRequestListener(TransferListener* listener)
         UAVCAN_ASSERT(0);
         return false;
     }
-    return lsrv_req_.add(listener, ListenerRegistry::UniqueListener);  // Only one server per data type
+    if (!lsrv_req_.add(listener, ListenerRegistry::UniqueListener))  // Only one server per data type
+    {
+        return false;
+    }
+#if UAVCAN_DISPATCHER_RX_PREFILTER_BITS > 0
+    rx_prefilter_.rebuild(TransferTypeServiceRequest, lsrv_req_.getList());
+#endif
+    notifyListenerRegistryObserver(TransferTypeServiceRequest);
+    return true;
 }
 
 bool Dispatcher::registerServiceResponseListener(TransferListener* listener)
@@ -467,22 +511,42 @@ bool Dispatcher::registerServiceResponseListener(TransferListener* listener)
         UAVCAN_ASSERT(0);
         return false;
     }
-    return lsrv_resp_.add(listener, ListenerRegistry::ManyListeners);  // Multiple callers may call same srv
+    if (!lsrv_resp_.add(listener, ListenerRegistry::ManyListeners))  // Multiple callers may call same srv
+    {
+        return false;
+    }
+#if UAVCAN_DISPATCHER_RX_PREFILTER_BITS > 0
+    rx_prefilter_.rebuild(TransferTypeServiceResponse, lsrv_resp_.getList());
+#endif
+    notifyListenerRegistryObserver(TransferTypeServiceResponse);
+    return true;
 }
 
 void Dispatcher::unregisterMessageListener(TransferListener* listener)
 {
     lmsg_.remove(listener);
+#if UAVCAN_DISPATCHER_RX_PREFILTER_BITS > 0
+    rx_prefilter_.rebuild(TransferTypeMessageBroadcast, lmsg_.getList());
+#endif
+    notifyListenerRegistryObserver(TransferTypeMessageBroadcast);
 }
 
 void Dispatcher::unregisterServiceRequestListener(TransferListener* listener)
 {
     lsrv_req_.remove(listener);
+#if UAVCAN_DISPATCHER_RX_PREFILTER_BITS > 0
+    rx_prefilter_.rebuild(TransferTypeServiceRequest, lsrv_req_.getList());
+#endif
+    notifyListenerRegistryObserver(TransferTypeServiceRequest);
 }
 
 void Dispatcher::unregisterServiceResponseListener(TransferListener* listener)
 {
     lsrv_resp_.remove(listener);
+#if UAVCAN_DISPATCHER_RX_PREFILTER_BITS > 0
+    rx_prefilter_.rebuild(TransferTypeServiceResponse, lsrv_resp_.getList());
+#endif
+    notifyListenerRegistryObserver(TransferTypeServiceResponse);
 }
 
 bool Dispatcher::hasSubscriber(DataTypeID dtid) const
@@ -506,6 +570,8 @@ bool Dispatcher::setNodeID(NodeID nid)
     {
         self_node_id_ = nid;
         self_node_id_is_set_ = true;
+        // Service requests are accepted by the destination node ID, so the observer has to know about the change
+        notifyListenerRegistryObserver(TransferTypeServiceRequest);
         return true;
     }
     return false;
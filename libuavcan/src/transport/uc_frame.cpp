@@ -18,7 +18,7 @@ uint8_t Frame::setPayload(const uint8_t* data, unsigned len)
     const uint8_t maxlen = getPayloadCapacity();
     len = min(unsigned(maxlen), len);
     (void)copy(data, data + len, payload_);
-    payload_len_ = uint_fast8_t(len);
+    payload_len_ = static_cast<uint8_t>(len);
     return static_cast<uint8_t>(len);
 }
 
@@ -63,14 +63,15 @@ bool Frame::parse(const CanFrame& can_frame)
     if (service_not_message)
     {
         const bool request_not_response = bitunpack<15, 1>(id) != 0U;
-        transfer_type_ = request_not_response ? TransferTypeServiceRequest : TransferTypeServiceResponse;
+        transfer_type_ = static_cast<uint8_t>(request_not_response ? TransferTypeServiceRequest :
+                                                                     TransferTypeServiceResponse);
 
         dst_node_id_ = static_cast<uint8_t>(bitunpack<8, 7>(id));
         data_type_id_ = static_cast<uint16_t>(bitunpack<16, 8>(id));
     }
     else
     {
-        transfer_type_ = TransferTypeMessageBroadcast;
+        transfer_type_ = static_cast<uint8_t>(TransferTypeMessageBroadcast);
         dst_node_id_ = NodeID::Broadcast;
 
         data_type_id_ = static_cast<uint16_t>(bitunpack<8, 16>(id));
@@ -109,36 +110,67 @@ inline static uint32_t bitpack(uint32_t field)
     return uint32_t((field & ((1UL << WIDTH) - 1)) << OFFSET);
 }
 
-bool Frame::compile(CanFrame& out_can_frame) const
+uint32_t Frame::makeCanIdTemplate() const
 {
-    if (!isValid())
+    if (!isHeaderValid())
     {
-        UAVCAN_ASSERT(0);        // This is an application error, so we need to maximize it.
-        return false;
+        return 0;
     }
 
-    /*
-     * CAN ID field
-     */
-    out_can_frame.id = CanFrame::FlagEFF |
+    uint32_t id = CanFrame::FlagEFF |
         bitpack<0, 7>(src_node_id_.get()) |
         bitpack<24, 5>(transfer_priority_.get());
 
     if (transfer_type_ == TransferTypeMessageBroadcast)
     {
-        out_can_frame.id |=
+        id |=
             bitpack<7, 1>(0U) |
             bitpack<8, 16>(data_type_id_.get());
     }
     else
     {
         const bool request_not_response = transfer_type_ == TransferTypeServiceRequest;
-        out_can_frame.id |=
+        id |=
             bitpack<7, 1>(1U) |
             bitpack<8, 7>(dst_node_id_.get()) |
             bitpack<15, 1>(request_not_response ? 1U : 0U) |
             bitpack<16, 8>(data_type_id_.get());
     }
+    return id;
+}
+
+bool Frame::compile(CanFrame& out_can_frame) const
+{
+    const uint32_t can_id_template = makeCanIdTemplate();
+    if (can_id_template == 0)
+    {
+        UAVCAN_ASSERT(0);        // This is an application error, so we need to maximize it.
+        return false;
+    }
+    return compile(out_can_frame, can_id_template);
+}
+
+bool Frame::compile(CanFrame& out_can_frame, uint32_t can_id_template) const
+{
+    if ((start_of_transfer_ && toggle_) ||
+        (payload_len_ > getPayloadCapacity()) ||
+        (src_node_id_.isBroadcast() && !(start_of_transfer_ && end_of_transfer_)))
+    {
+        UAVCAN_ASSERT(0);
+        return false;
+    }
+#if UAVCAN_CAN_FD
+    if (!CanFrame::isValidDataLen(uint8_t(payload_len_ + 1U)))     // The tail byte can't be followed by padding
+    {
+        UAVCAN_ASSERT(0);
+        return false;
+    }
+#endif
+
+    /*
+     * CAN ID field
+     */
+    out_can_frame.id = can_id_template;
 
     /*
      * Payload
@@ -178,17 +210,8 @@ bool Frame::compile(CanFrame& out_can_frame) const
     return true;
 }
 
-bool Frame::isValid() const
+bool Frame::isHeaderValid() const
 {
-    /*
-     * Toggle
-     */
-    if (start_of_transfer_ && toggle_)
-    {
-        UAVCAN_TRACE("Frame", "Validness check failed at line %d", __LINE__);
-        return false;
-    }
-
     /*
      * Node ID
      */
@@ -219,36 +242,61 @@ bool Frame::isValid() const
         return false;
     }
 
-    // Anonymous transfers
-    if (src_node_id_.isBroadcast() &&
-        (!start_of_transfer_ || !end_of_transfer_ || (transfer_type_ != TransferTypeMessageBroadcast)))
+    // Anonymous transfers can only be message broadcasts
+    if (src_node_id_.isBroadcast() && (transfer_type_ != TransferTypeMessageBroadcast))
     {
         UAVCAN_TRACE("Frame", "Validness check failed at line %d", __LINE__);
         return false;
     }
 
     /*
-     * Payload
+     * Data type ID
      */
-    if (payload_len_ > getPayloadCapacity())
+    if (!data_type_id_.isValidForDataTypeKind(getDataTypeKindForTransferType(getTransferType())))
     {
         UAVCAN_TRACE("Frame", "Validness check failed at line %d", __LINE__);
         return false;
     }
 
     /*
-     * Data type ID
+     * Priority
      */
-    if (!data_type_id_.isValidForDataTypeKind(getDataTypeKindForTransferType(transfer_type_)))
+    if (!transfer_priority_.isValid())
     {
         UAVCAN_TRACE("Frame", "Validness check failed at line %d", __LINE__);
         return false;
     }
 
+    return true;
+}
+
+bool Frame::isValid() const
+{
     /*
-     * Priority
+     * Toggle
      */
-    if (!transfer_priority_.isValid())
+    if (start_of_transfer_ && toggle_)
+    {
+        UAVCAN_TRACE("Frame", "Validness check failed at line %d", __LINE__);
+        return false;
+    }
+
+    if (!isHeaderValid())
+    {
+        return false;
+    }
+
+    // Anonymous transfers are always single-frame
+    if (src_node_id_.isBroadcast() && (!start_of_transfer_ || !end_of_transfer_))
+    {
+        UAVCAN_TRACE("Frame", "Validness check failed at line %d", __LINE__);
+        return false;
+    }
+
+    /*
+     * Payload
+     */
+    if (payload_len_ > getPayloadCapacity())
     {
         UAVCAN_TRACE("Frame", "Validness check failed at line %d", __LINE__);
         return false;
@@ -303,10 +351,14 @@ std::string Frame::toString() const
  */
 bool RxFrame::parse(const CanRxFrame& can_frame)
 {
-    if (!Frame::parse(can_frame))
-    {
-        return false;
-    }
+    // Received frames are copied around by value, they must stay within a cache line (two in CAN FD mode)
+    StaticAssert<(sizeof(RxFrame) <= (CanFrame::MaxDataLen + 32U))>::check();
+
+    return Frame::parse(can_frame) && setRxInfo(can_frame);
+}
+
+bool RxFrame::setRxInfo(const CanRxFrame& can_frame)
+{
     if (can_frame.ts_mono.isZero())  // Monotonic timestamps are mandatory.
     {
         UAVCAN_ASSERT(0);                   // If it is not set, it's a driver failure.
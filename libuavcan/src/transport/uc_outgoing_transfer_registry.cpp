@@ -24,32 +24,115 @@ std::string OutgoingTransferRegistryKey::toString() const
  */
 const MonotonicDuration OutgoingTransferRegistry::MinEntryLifetime = MonotonicDuration::fromMSec(2000);
 
+void OutgoingTransferRegistry::removeAt(unsigned index)
+{
+    UAVCAN_ASSERT(num_entries_ > 0);
+    num_entries_--;
+
+    // Backward shift: moving the following entries of the probe sequence into the gap, unless they are at home
+    unsigned gap = index;
+    unsigned next = index;
+    for (;;)
+    {
+        slots_[gap].deadline = MonotonicTime();
+        for (;;)
+        {
+            next = (next + 1U) & unsigned(SlotIndexMask);
+            if (slots_[next].deadline.isZero())
+            {
+                return;
+            }
+            const unsigned home = getHomeIndex(slots_[next].key);
+            // The entry stays if its home lies cyclically within (gap, next]
+            const bool stays = (gap <= next) ? ((gap < home) && (home <= next)) : ((gap < home) || (home <= next));
+            if (!stays)
+            {
+                break;
+            }
+        }
+        slots_[gap] = slots_[next];
+        gap = next;
+    }
+}
+
 TransferID* OutgoingTransferRegistry::accessOrCreate(const OutgoingTransferRegistryKey& key,
                                                      MonotonicTime new_deadline)
 {
     UAVCAN_ASSERT(!new_deadline.isZero());
-    Value* p = map_.access(key);
-    if (p == UAVCAN_NULLPTR)
+    const uint32_t packed_key = packKey(key);
+
+    unsigned index = getHomeIndex(packed_key);
+    while (!slots_[index].deadline.isZero() && (slots_[index].key != packed_key))
+    {
+        index = (index + 1U) & unsigned(SlotIndexMask);
+    }
+
+    Slot& slot = slots_[index];
+    if (slot.deadline.isZero())
     {
-        p = map_.insert(key, Value());
-        if (p == UAVCAN_NULLPTR)
+        if (num_entries_ >= unsigned(Capacity))
         {
             return UAVCAN_NULLPTR;
         }
+        num_entries_++;
+        slot.key = packed_key;
+        slot.tid = TransferID();
         UAVCAN_TRACE("OutgoingTransferRegistry", "Created %s", key.toString().c_str());
     }
-    p->deadline = new_deadline;
-    return &p->tid;
+
+    slot.deadline = new_deadline;
+    if (earliest_deadline_.isZero() || (new_deadline < earliest_deadline_))
+    {
+        earliest_deadline_ = new_deadline;
+    }
+    return &slot.tid;
 }
 
 bool OutgoingTransferRegistry::exists(DataTypeID dtid, TransferType tt) const
 {
-    return UAVCAN_NULLPTR != map_.find(ExistenceCheckingPredicate(dtid, tt));
+    const uint32_t prefix = (uint32_t(dtid.get()) << 16) | (uint32_t(tt) << 8);
+    for (unsigned i = 0; i < unsigned(NumSlots); i++)
+    {
+        if (!slots_[i].deadline.isZero() && ((slots_[i].key & 0xFFFFFF00U) == prefix))
+        {
+            return true;
+        }
+    }
+    return false;
 }
 
 void OutgoingTransferRegistry::cleanup(MonotonicTime ts)
 {
-    map_.removeAllWhere(DeadlineExpiredPredicate(ts));
+    if ((num_entries_ == 0) || (ts < earliest_deadline_))
+    {
+        return;
+    }
+
+    MonotonicTime earliest;
+    unsigned i = 0;
+    while (i < unsigned(NumSlots))
+    {
+        const Slot& slot = slots_[i];
+        if (slot.deadline.isZero())
+        {
+            i++;
+        }
+        else if (slot.deadline <= ts)
+        {
+            UAVCAN_TRACE("OutgoingTransferRegistry", "Expired key=0x%08x tid=%i",
+                         unsigned(slot.key), int(slot.tid.get()));
+            removeAt(i);        // The slot may be refilled by the following entry, so it has to be checked again
+        }
+        else
+        {
+            if (earliest.isZero() || (slot.deadline < earliest))
+            {
+                earliest = slot.deadline;
+            }
+            i++;
+        }
+    }
+    earliest_deadline_ = earliest;
 }
 
 }
@@ -62,6 +62,59 @@ void StaticTransferBufferImpl::reset()
 #endif
 }
 
+/*
+ * TransferBufferArena
+ */
+TransferBufferArena::~TransferBufferArena()
+{
+    UAVCAN_ASSERT(used_slots_mask_ == 0);
+#if UAVCAN_TRANSFER_BUFFER_ARENA_SLOTS > 0
+    std::free(memory_);
+#endif
+}
+
+uint8_t* TransferBufferArena::allocateSlot()
+{
+#if UAVCAN_TRANSFER_BUFFER_ARENA_SLOTS > 0
+    if ((memory_ == UAVCAN_NULLPTR) && (slot_size_ > 0))
+    {
+        memory_ = static_cast<uint8_t*>(std::malloc(std::size_t(slot_size_) * unsigned(NumSlots)));
+        if (memory_ == UAVCAN_NULLPTR)
+        {
+            return UAVCAN_NULLPTR;
+        }
+    }
+    for (unsigned i = 0; i < unsigned(NumSlots); i++)
+    {
+        if ((used_slots_mask_ & (uint32_t(1) << i)) == 0)
+        {
+            used_slots_mask_ |= uint32_t(1) << i;
+            return memory_ + i * slot_size_;
+        }
+    }
+#endif
+    return UAVCAN_NULLPTR;
+}
+
+void TransferBufferArena::deallocateSlot(uint8_t* slot)
+{
+    UAVCAN_ASSERT((slot >= memory_) && (slot < (memory_ + unsigned(NumSlots) * slot_size_)));
+    UAVCAN_ASSERT(((slot - memory_) % slot_size_) == 0);
+    const unsigned index = unsigned(slot - memory_) / slot_size_;
+    UAVCAN_ASSERT(used_slots_mask_ & (uint32_t(1) << index));
+    used_slots_mask_ &= ~(uint32_t(1) << index);
+}
+
+unsigned TransferBufferArena::getNumUsedSlots() const
+{
+    unsigned num = 0;
+    for (uint32_t mask = used_slots_mask_; mask != 0; mask &= mask - 1U)
+    {
+        num++;
+    }
+    return num;
+}
+
 /*
  * TransferBufferManagerKey
  */
@@ -130,14 +183,15 @@ void TransferBufferManagerEntry::Block::write(const uint8_t*& inptr, unsigned ta
  * DynamicTransferBuffer
  */
 TransferBufferManagerEntry* TransferBufferManagerEntry::instantiate(IPoolAllocator& allocator,
-                                                                                  uint16_t max_size)
+                                                                                  uint16_t max_size,
+                                                                                  TransferBufferArena* arena)
 {
     void* const praw = allocator.allocate(sizeof(TransferBufferManagerEntry));
     if (praw == UAVCAN_NULLPTR)
     {
         return UAVCAN_NULLPTR;
     }
-    return new (praw) TransferBufferManagerEntry(allocator, max_size);
+    return new (praw) TransferBufferManagerEntry(allocator, max_size, arena);
 }
 
 void TransferBufferManagerEntry::destroy(TransferBufferManagerEntry*& obj, IPoolAllocator& allocator)
@@ -168,6 +222,12 @@ int TransferBufferManagerEntry::read(unsigned offset, uint8_t* data, unsigned le
     }
     UAVCAN_ASSERT((offset + len) <= max_write_pos_);
 
+    if (arena_slot_ != UAVCAN_NULLPTR)
+    {
+        (void)copy(arena_slot_ + offset, arena_slot_ + offset + len, data);
+        return int(len);
+    }
+
     // This shall be optimized.
     unsigned total_offset = 0;
     unsigned left_to_read = len;
@@ -220,6 +280,18 @@ int TransferBufferManagerEntry::write(unsigned offset, const uint8_t* data, unsi
     }
     UAVCAN_ASSERT((offset + len) <= max_size_);
 
+    // The arena slot is taken only if nothing has been written into the blocks yet
+    if ((arena_slot_ == UAVCAN_NULLPTR) && (arena_ != UAVCAN_NULLPTR) && (blocks_.get() == UAVCAN_NULLPTR))
+    {
+        arena_slot_ = arena_->allocateSlot();
+    }
+    if (arena_slot_ != UAVCAN_NULLPTR)
+    {
+        (void)copy(data, data + len, arena_slot_ + offset);
+        max_write_pos_ = max(uint16_t(offset + len), uint16_t(max_write_pos_));
+        return int(len);
+    }
+
     unsigned total_offset = 0;
     unsigned left_to_write = len;
     const uint8_t* inptr = data;
@@ -277,6 +349,11 @@ void TransferBufferManagerEntry::reset(const TransferBufferManagerKey& key)
 {
     key_ = key;
     max_write_pos_ = 0;
+    if (arena_slot_ != UAVCAN_NULLPTR)
+    {
+        arena_->deallocateSlot(arena_slot_);
+        arena_slot_ = UAVCAN_NULLPTR;
+    }
     Block* p = blocks_.get();
     while (p)
     {
@@ -336,7 +413,7 @@ ITransferBuffer* TransferBufferManager::create(const TransferBufferManagerKey& k
     }
     remove(key);
 
-    TransferBufferManagerEntry* tbme = TransferBufferManagerEntry::instantiate(allocator_, max_buf_size_);
+    TransferBufferManagerEntry* tbme = TransferBufferManagerEntry::instantiate(allocator_, max_buf_size_, arena_);
     if (tbme == UAVCAN_NULLPTR)
     {
         return UAVCAN_NULLPTR;     // Epic fail.
@@ -354,6 +431,17 @@ ITransferBuffer* TransferBufferManager::create(const TransferBufferManagerKey& k
     return tbme;
 }
 
+const uint8_t* TransferBufferManager::accessContiguous(const TransferBufferManagerKey& key, unsigned& out_len)
+{
+    const TransferBufferManagerEntry* const tbme = findFirst(key);
+    if ((tbme == UAVCAN_NULLPTR) || (tbme->getContiguousData() == UAVCAN_NULLPTR))
+    {
+        return UAVCAN_NULLPTR;
+    }
+    out_len = tbme->getMaxWritePos();
+    return tbme->getContiguousData();
+}
+
 void TransferBufferManager::remove(const TransferBufferManagerKey& key)
 {
     UAVCAN_ASSERT(!key.isEmpty());
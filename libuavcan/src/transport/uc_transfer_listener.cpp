@@ -19,6 +19,33 @@ int IncomingTransfer::write(unsigned, const uint8_t*, unsigned)
     return -ErrLogic;
 }
 
+const uint8_t* IncomingTransfer::getPayloadView(unsigned& out_len, uint8_t* storage, unsigned storage_size) const
+{
+    const uint8_t* const payload = getContiguousPayload(out_len);
+    if ((payload != UAVCAN_NULLPTR) || (storage == UAVCAN_NULLPTR))
+    {
+        return payload;
+    }
+
+    const int res = read(0, storage, storage_size);
+    if (res < 0)
+    {
+        UAVCAN_TRACE("IncomingTransfer", "Flattening failed: read failure %i", res);
+        return UAVCAN_NULLPTR;
+    }
+    uint8_t next_byte = 0;
+    if ((static_cast<unsigned>(res) == storage_size) && (read(storage_size, &next_byte, 1) != 0))
+    {
+        UAVCAN_TRACE("IncomingTransfer", "Flattening failed: storage is too small (%u bytes)", storage_size);
+        return UAVCAN_NULLPTR;
+    }
+
+    flat_payload_ = storage;
+    flat_payload_len_ = static_cast<uint16_t>(res);
+    out_len = flat_payload_len_;
+    return flat_payload_;
+}
+
 /*
  * SingleFrameIncomingTransfer
  */
@@ -80,6 +107,17 @@ int MultiFrameIncomingTransfer::read(unsigned offset, uint8_t* data, unsigned le
     return tbb->read(offset, data, len);
 }
 
+const uint8_t* MultiFrameIncomingTransfer::getContiguousPayload(unsigned& out_len) const
+{
+    // Buffers stored in the arena don't need to be flattened
+    const uint8_t* const flat_payload = IncomingTransfer::getContiguousPayload(out_len);
+    if (flat_payload != UAVCAN_NULLPTR)
+    {
+        return flat_payload;
+    }
+    return const_cast<TransferBufferAccessor&>(buf_acc_).accessContiguous(out_len);
+}
+
 /*
  * TransferListener::TimedOutReceiverPredicate
  */
@@ -90,9 +128,8 @@ bool TransferListener::TimedOutReceiverPredicate::operator()(const TransferBuffe
     {
         UAVCAN_TRACE("TransferListener", "Timed out receiver: %s", key.toString().c_str());
         /*
-         * TransferReceivers do not own their buffers - this helps the Map<> container to copy them
-         * around quickly and safely (using default assignment operator). Downside is that we need to
-         * destroy the buffers manually.
+         * TransferReceivers do not own their buffers - this keeps the receiver table entries within one
+         * pool block. Downside is that we need to destroy the buffers manually.
          * Maybe it is not good that the predicate has side effects, but I ran out of better ideas.
          */
         parent_bufmgr_.remove(key);
@@ -104,35 +141,6 @@ bool TransferListener::TimedOutReceiverPredicate::operator()(const TransferBuffe
 /*
  * TransferListener
  */
-bool TransferListener::checkPayloadCrc(const uint64_t compare_with, const ITransferBuffer& tbb) const
-{
-    TransferCRC crc = crc_base_;
-    unsigned offset = 0;
-    while (true)
-    {
-        uint8_t buf[16];
-        const int res = tbb.read(offset, buf, sizeof(buf));
-        if (res < 0)
-        {
-            UAVCAN_TRACE("TransferListener", "Failed to check CRC: Buffer read failure %i", res);
-            return false;
-        }
-        if (res == 0)
-        {
-            break;
-        }
-        offset += unsigned(res);
-        crc.add(buf, unsigned(res));
-    }
-    if (crc.get() != compare_with)
-    {
-        UAVCAN_TRACE("TransferListener", "CRC mismatch, expected=0x%04x, got=0x%04x",
-                     int(compare_with), int(crc.get()));
-        return false;
-    }
-    return true;
-}
-
 bool TransferListener::checkPayloadCrc32(const uint64_t compare_with, const ITransferBuffer& tbb) const
 {
     TransferCRC32 crc = crc_base32_;
@@ -191,58 +199,18 @@ bool TransferListener::checkPayloadCrc48(const uint64_t compare_with, const ITra
     return true;
 }
 
-void TransferListener::handleReception(TransferReceiver& receiver, const RxFrame& frame,
-                                           TransferBufferAccessor& tba)
+void TransferListener::handleCompleteTransfer(TransferReceiver& receiver, const RxFrame& frame,
+                                              TransferBufferAccessor& tba)
 {
-    //std::cerr<<"listener::handleReception in:"<<std::endl;
-    switch (receiver.addFrame(frame, tba))
-    {
-    case TransferReceiver::ResultNotComplete:
-    {
-        perf_.addErrors(receiver.yieldErrorCount());
-        //std::cerr<<"listener::handleReception 1: not complete"<<std::endl;
-        break;
-    }
-    case TransferReceiver::ResultSingleFrame:
-    {
-        //std::cerr<<"listener::handleReception 2:"<<std::endl;
-        perf_.addRxTransfer();
-        SingleFrameIncomingTransfer it(frame);
-        handleIncomingTransfer(it);
-        break;
-    }
-    case TransferReceiver::ResultComplete:
-    {
-        perf_.addRxTransfer();
-        const ITransferBuffer* tbb = tba.access();
-        if (tbb == UAVCAN_NULLPTR)
-        {
-            UAVCAN_TRACE("TransferListener", "Buffer access failure, last frame: %s", frame.toString().c_str());
-            break;
-        }
-
-        if(frame.getFrameType() == 0)
-        {
-            if (!checkPayloadCrc(receiver.getLastTransferCrc(), *tbb))
-            {
-                UAVCAN_TRACE("TransferListener", "CRC error, last frame: %s", frame.toString().c_str());
-                break;
-            }
-        }
-        //std::cerr<<"listener::handleReception 3:"<<std::endl;
-
-        MultiFrameIncomingTransfer it(receiver.getLastTransferTimestampMonotonic(),
-                                      receiver.getLastTransferTimestampUtc(), frame, tba);
-        handleIncomingTransfer(it);
-        it.release();
-        break;
-    }
-    default:
+    if (tba.access() == UAVCAN_NULLPTR)
     {
-        UAVCAN_ASSERT(0);
-        break;
-    }
+        UAVCAN_TRACE("TransferListener", "Buffer access failure, last frame: %s", frame.toString().c_str());
+        return;
     }
+    MultiFrameIncomingTransfer it(receiver.getLastTransferTimestampMonotonic(),
+                                  receiver.getLastTransferTimestampUtc(), frame, tba);
+    handleIncomingTransfer(it);
+    it.release();
 }
 
 void TransferListener::handleAnonymousTransferReception(const RxFrame& frame)
@@ -257,7 +225,7 @@ void TransferListener::handleAnonymousTransferReception(const RxFrame& frame)
 
 TransferListener::~TransferListener()
 {
-    // Map must be cleared before bufmgr is destroyed
+    // Receivers must be removed before bufmgr is destroyed
     receivers_.clear();
 }
 
@@ -267,38 +235,32 @@ void TransferListener::cleanup(MonotonicTime ts)
     UAVCAN_ASSERT(receivers_.isEmpty() ? bufmgr_.isEmpty() : 1);
 }
 
-void TransferListener::handleFrame(const RxFrame& frame)
+TransferReceiver* TransferListener::accessReceiver(const TransferBufferManagerKey& key, const RxFrame& frame)
 {
-    if (frame.getSrcNodeID().isUnicast())       // Normal transfer
+    TransferReceiver* recv = receivers_.access(key);
+    if (recv == UAVCAN_NULLPTR)
     {
-        const TransferBufferManagerKey key(frame.getSrcNodeID(), frame.getTransferType());
-        //std::cerr<<"listener::handleFrame:unicast:"<<std::endl;
+        if (!frame.isStartOfTransfer())
+        {
+            return UAVCAN_NULLPTR;
+        }
 
-        TransferReceiver* recv = receivers_.access(key);
+        recv = receivers_.insert(key);
         if (recv == UAVCAN_NULLPTR)
         {
-            if (!frame.isStartOfTransfer())
-            {
-                return;
-            }
-
-            TransferReceiver new_recv;
-            recv = receivers_.insert(key, new_recv);
-            if (recv == UAVCAN_NULLPTR)
-            {
-                UAVCAN_TRACE("TransferListener", "Receiver registration failed; frame %s", frame.toString().c_str());
-                return;
-            }
+            UAVCAN_TRACE("TransferListener", "Receiver registration failed; frame %s", frame.toString().c_str());
         }
-        TransferBufferAccessor tba(bufmgr_, key);
-        handleReception(*recv, frame, tba);
     }
-    else if (frame.getSrcNodeID().isBroadcast() &&
-             frame.isStartOfTransfer() &&
-             frame.isEndOfTransfer() &&
-             frame.getDstNodeID().isBroadcast())        // Anonymous transfer
+    return recv;
+}
+
+void TransferListener::handleNonUnicastFrame(const RxFrame& frame)
+{
+    if (frame.getSrcNodeID().isBroadcast() &&
+        frame.isStartOfTransfer() &&
+        frame.isEndOfTransfer() &&
+        frame.getDstNodeID().isBroadcast())        // Anonymous transfer
     {
-        //std::cerr<<"listener::handleFrame:broadcast:"<<std::endl;
         handleAnonymousTransferReception(frame);
     }
     else
@@ -307,6 +269,18 @@ void TransferListener::handleFrame(const RxFrame& frame)
     }
 }
 
+void TransferListener::handleFrame(const RxFrame& frame)
+{
+    if (StandardFrameFormat::matches(frame))
+    {
+        handleFrame<StandardFrameFormat>(frame);
+    }
+    else
+    {
+        handleFrame<RawFrameFormat>(frame);
+    }
+}
+
 /*
  * TransferListenerWithFilter
  */
@@ -55,21 +55,17 @@ void TransferReceiver::prepareForNextTransfer()
     buffer_write_pos_ = 0;
 }
 
-bool TransferReceiver::validate(const RxFrame& frame) const
+bool TransferReceiver::validate(const RxFrame& frame, unsigned transfer_crc_len) const
 {
     if (iface_index_ != frame.getIfaceIndex())
     {
         return false;
     }
-
-    if(frame.getFrameType() == 0)
+    if (frame.isStartOfTransfer() && !frame.isEndOfTransfer() && (frame.getPayloadLen() < transfer_crc_len))
     {
-        if (frame.isStartOfTransfer() && !frame.isEndOfTransfer() && (frame.getPayloadLen() < TransferCRC::NumBytes))
-        {
-            UAVCAN_TRACE("TransferReceiver", "CRC expected, %s", frame.toString().c_str());
-            registerError();
-            return false;
-        }
+        UAVCAN_TRACE("TransferReceiver", "CRC expected, %s", frame.toString().c_str());
+        registerError();
+        return false;
     }
     if (frame.isStartOfTransfer() && frame.getToggle())
     {
@@ -98,82 +94,65 @@ bool TransferReceiver::validate(const RxFrame& frame) const
     return true;
 }
 
-bool TransferReceiver::writePayload(const RxFrame& frame, ITransferBuffer& buf)
+bool TransferReceiver::acceptFrame(const RxFrame& frame, TransferBufferAccessor& tba, unsigned transfer_crc_len)
 {
-    const uint8_t* const payload = frame.getPayloadPtr();
-    const unsigned payload_len = frame.getPayloadLen();
-
-#if 0
-    fprintf(stderr, "TransferReceiver:payload_len:%d\n", payload_len);
-    for(int i=0; i<payload_len; i++)
+    if ((frame.getMonotonicTimestamp().isZero()) ||
+        (frame.getMonotonicTimestamp() < prev_transfer_ts_) ||
+        (frame.getMonotonicTimestamp() < this_transfer_ts_))
     {
-        fprintf(stderr, "TransferReceiver:payload[%d]:%x\n", i, payload[i]);
+        UAVCAN_TRACE("TransferReceiver", "Invalid frame, %s", frame.toString().c_str());
+        return false;
     }
-#endif
 
-    if(frame.getFrameType() == 0)
+    const bool not_initialized = !isInitialized();
+    const bool tid_timed_out = isTimedOut(frame.getMonotonicTimestamp());
+    const bool same_iface = frame.getIfaceIndex() == iface_index_;
+    const bool first_frame = frame.isStartOfTransfer();
+    const bool non_wrapped_tid = tid_.computeForwardDistance(frame.getTransferID()) < TransferID::Half;
+    const bool not_previous_tid = frame.getTransferID().computeForwardDistance(tid_) > 1;
+    const bool iface_switch_allowed = (frame.getMonotonicTimestamp() - this_transfer_ts_) > getIfaceSwitchDelay();
+
+    // FSM, the hard way
+    const bool need_restart =
+        (not_initialized) ||
+        (tid_timed_out) ||
+        (same_iface && first_frame && not_previous_tid) ||
+        (iface_switch_allowed && first_frame && non_wrapped_tid);
+
+    if (need_restart)
     {
-        if (frame.isStartOfTransfer())     // First frame contains CRC, we need to extract it now
+        if (!not_initialized && (tid_ != frame.getTransferID()))
         {
-            if (frame.getPayloadLen() < TransferCRC::NumBytes)
-            {
-                return false;    // Must have been validated earlier though. I think I'm paranoid.
-            }
-            this_transfer_crc_ = static_cast<uint16_t>(payload[0] & 0xFF);
-            this_transfer_crc_ |= static_cast<uint16_t>(static_cast<uint16_t>(payload[1] & 0xFF) << 8);  // Little endian.
-
-            const unsigned effective_payload_len = payload_len - TransferCRC::NumBytes;
-            const int res = buf.write(buffer_write_pos_, payload + TransferCRC::NumBytes, effective_payload_len);
-            const bool success = res == static_cast<int>(effective_payload_len);
-            if (success)
-            {
-                buffer_write_pos_ = static_cast<uint16_t>(buffer_write_pos_ + effective_payload_len);
-            }
-            return success;
+            registerError();
         }
-        else
+        UAVCAN_TRACE("TransferReceiver", "Restart [ni=%d, isa=%d, tt=%d, si=%d, ff=%d, nwtid=%d, nptid=%d, tid=%d], %s",
+                     int(not_initialized), int(iface_switch_allowed), int(tid_timed_out), int(same_iface),
+                     int(first_frame), int(non_wrapped_tid), int(not_previous_tid), int(tid_.get()),
+                     frame.toString().c_str());
+        tba.remove();
+        iface_index_ = frame.getIfaceIndex() & IfaceIndexMask;
+        tid_ = frame.getTransferID();
+        next_toggle_ = false;
+        buffer_write_pos_ = 0;
+        this_transfer_crc_ = 0;
+        if (!first_frame)
         {
-            const int res = buf.write(buffer_write_pos_, payload, payload_len);
-            const bool success = res == static_cast<int>(payload_len);
-            if (success)
-            {
-                buffer_write_pos_ = static_cast<uint16_t>(buffer_write_pos_ + payload_len);
-            }
-            return success;
+            tid_.increment();
+            return false;
         }
     }
-    else
+
+    if (!validate(frame, transfer_crc_len))
     {
-        const int res = buf.write(buffer_write_pos_, payload, payload_len);
-        const bool success = res == static_cast<int>(payload_len);
-        if (success)
-        {
-            buffer_write_pos_ = static_cast<uint16_t>(buffer_write_pos_ + payload_len);
-        }
-        //fprintf(stderr, "TransferReceiver:write_pos:%d, payload_len:%d, res:%d\n", buffer_write_pos_, payload_len, res);
-        return success;
+        UAVCAN_TRACE("TransferReceiver", "Invalid frame2, %s", frame.toString().c_str());
+        return false;
     }
+    return true;
 }
 
-TransferReceiver::ResultCode TransferReceiver::receive(const RxFrame& frame, TransferBufferAccessor& tba)
+ITransferBuffer* TransferReceiver::accessBuffer(const RxFrame& frame, TransferBufferAccessor& tba)
 {
-    // Transfer timestamps are derived from the first frame
-    if (frame.isStartOfTransfer())
-    {
-        this_transfer_ts_ = frame.getMonotonicTimestamp();
-        first_frame_ts_   = frame.getUtcTimestamp();
-    }
-
-    if (frame.isStartOfTransfer() && frame.isEndOfTransfer())
-    {
-        tba.remove();
-        updateTransferTimings();
-        prepareForNextTransfer();
-        this_transfer_crc_ = 0;         // SFT has no CRC
-        return ResultSingleFrame;
-    }
-
-    // Payload write
+    (void)frame;
     ITransferBuffer* buf = tba.access();
     if (buf == UAVCAN_NULLPTR)
     {
@@ -184,96 +163,176 @@ TransferReceiver::ResultCode TransferReceiver::receive(const RxFrame& frame, Tra
         UAVCAN_TRACE("TransferReceiver", "Failed to access the buffer, %s", frame.toString().c_str());
         prepareForNextTransfer();
         registerError();
-        return ResultNotComplete;
     }
-    if (!writePayload(frame, *buf))
+    return buf;
+}
+
+bool TransferReceiver::isTimedOut(MonotonicTime current_ts) const
+{
+    return (current_ts - this_transfer_ts_) > getTidTimeout();
+}
+
+TransferReceiver::ResultCode TransferReceiver::addFrame(const RxFrame& frame, TransferBufferAccessor& tba,
+                                                       const TransferCRC& crc_base)
+{
+    if (StandardFrameFormat::matches(frame))
     {
-        UAVCAN_TRACE("TransferReceiver", "Payload write failed, %s", frame.toString().c_str());
-        tba.remove();
-        prepareForNextTransfer();
-        registerError();
-        return ResultNotComplete;
+        return addFrame<StandardFrameFormat>(frame, tba, crc_base);
     }
-    next_toggle_ = !next_toggle_;
+    return addFrame<RawFrameFormat>(frame, tba, crc_base);
+}
+
+uint8_t TransferReceiver::yieldErrorCount()
+{
+    const uint8_t ret = error_cnt_;
+    error_cnt_ = 0;
+    return ret;
+}
 
-    if (frame.isEndOfTransfer())
+/*
+ * TransferReceiverTable
+ */
+TransferReceiverTable::Entry* TransferReceiverTable::Entry::instantiate(IPoolAllocator& allocator,
+                                                                        const TransferBufferManagerKey& key)
+{
+    void* const praw = allocator.allocate(sizeof(Entry));
+    if (praw == UAVCAN_NULLPTR)
     {
-        updateTransferTimings();
-        prepareForNextTransfer();
-        return ResultComplete;
+        return UAVCAN_NULLPTR;
     }
-    return ResultNotComplete;
+    return new (praw) Entry(key);
 }
 
-bool TransferReceiver::isTimedOut(MonotonicTime current_ts) const
+void TransferReceiverTable::Entry::destroy(Entry*& obj, IPoolAllocator& allocator)
 {
-    return (current_ts - this_transfer_ts_) > getTidTimeout();
+    if (obj != UAVCAN_NULLPTR)
+    {
+        obj->~Entry();
+        allocator.deallocate(obj);
+        obj = UAVCAN_NULLPTR;
+    }
 }
 
-TransferReceiver::ResultCode TransferReceiver::addFrame(const RxFrame& frame, TransferBufferAccessor& tba)
+bool TransferReceiverTable::Page::isEmpty() const
 {
-    if(frame.getFrameType() == 0)
+    for (unsigned i = 0; i < unsigned(NumSlots); i++)
     {
-        if ((frame.getMonotonicTimestamp().isZero()) ||
-            (frame.getMonotonicTimestamp() < prev_transfer_ts_) ||
-            (frame.getMonotonicTimestamp() < this_transfer_ts_))
+        if (slots[i] != UAVCAN_NULLPTR)
         {
-            UAVCAN_TRACE("TransferReceiver", "Invalid frame, %s", frame.toString().c_str());
-            return ResultNotComplete;
+            return false;
         }
+    }
+    return true;
+}
 
-        const bool not_initialized = !isInitialized();
-        const bool tid_timed_out = isTimedOut(frame.getMonotonicTimestamp());
-        const bool same_iface = frame.getIfaceIndex() == iface_index_;
-        const bool first_frame = frame.isStartOfTransfer();
-        const bool non_wrapped_tid = tid_.computeForwardDistance(frame.getTransferID()) < TransferID::Half;
-        const bool not_previous_tid = frame.getTransferID().computeForwardDistance(tid_) > 1;
-        const bool iface_switch_allowed = (frame.getMonotonicTimestamp() - this_transfer_ts_) > getIfaceSwitchDelay();
-
-        // FSM, the hard way
-        const bool need_restart =
-            (not_initialized) ||
-            (tid_timed_out) ||
-            (same_iface && first_frame && not_previous_tid) ||
-            (iface_switch_allowed && first_frame && non_wrapped_tid);
-
-        if (need_restart)
+void TransferReceiverTable::releaseEmptyPages()
+{
+    for (unsigned i = 0; i < unsigned(NumPages); i++)
+    {
+        if ((pages_[i] != UAVCAN_NULLPTR) && pages_[i]->isEmpty())
         {
-            if (!not_initialized && (tid_ != frame.getTransferID()))
-            {
-                registerError();
-            }
-            UAVCAN_TRACE("TransferReceiver", "Restart [ni=%d, isa=%d, tt=%d, si=%d, ff=%d, nwtid=%d, nptid=%d, tid=%d], %s",
-                         int(not_initialized), int(iface_switch_allowed), int(tid_timed_out), int(same_iface),
-                         int(first_frame), int(non_wrapped_tid), int(not_previous_tid), int(tid_.get()),
-                         frame.toString().c_str());
-            tba.remove();
-            iface_index_ = frame.getIfaceIndex() & IfaceIndexMask;
-            tid_ = frame.getTransferID();
-            next_toggle_ = false;
-            buffer_write_pos_ = 0;
-            this_transfer_crc_ = 0;
-            if (!first_frame)
-            {
-                tid_.increment();
-                return ResultNotComplete;
-            }
+            pages_[i]->~Page();
+            allocator_.deallocate(pages_[i]);
+            pages_[i] = UAVCAN_NULLPTR;
         }
+    }
+}
 
-        if (!validate(frame))
+TransferReceiver* TransferReceiverTable::access(const TransferBufferManagerKey& key)
+{
+    UAVCAN_ASSERT(!key.isEmpty());
+    Entry** const slot = accessSlot(key);
+    if (slot == UAVCAN_NULLPTR)
+    {
+        return UAVCAN_NULLPTR;
+    }
+    for (Entry* entry = *slot; entry != UAVCAN_NULLPTR; entry = entry->next)
+    {
+        if (entry->key == key)
         {
-            UAVCAN_TRACE("TransferReceiver", "Invalid frame2, %s", frame.toString().c_str());
-            return ResultNotComplete;
+            return &entry->receiver;
         }
     }
-    return receive(frame, tba);
+    return UAVCAN_NULLPTR;
 }
 
-uint8_t TransferReceiver::yieldErrorCount()
+TransferReceiver* TransferReceiverTable::insert(const TransferBufferManagerKey& key)
 {
-    const uint8_t ret = error_cnt_;
-    error_cnt_ = 0;
-    return ret;
+    TransferReceiver* const existing = access(key);
+    if (existing != UAVCAN_NULLPTR)
+    {
+        return existing;
+    }
+
+    const unsigned page_index = getSlotIndex(key) / unsigned(Page::NumSlots);
+    if (pages_[page_index] == UAVCAN_NULLPTR)
+    {
+        void* const praw = allocator_.allocate(sizeof(Page));
+        if (praw == UAVCAN_NULLPTR)
+        {
+            return UAVCAN_NULLPTR;
+        }
+        pages_[page_index] = new (praw) Page();
+    }
+
+    Entry* const entry = Entry::instantiate(allocator_, key);
+    if (entry == UAVCAN_NULLPTR)
+    {
+        releaseEmptyPages();
+        return UAVCAN_NULLPTR;
+    }
+
+    Entry** const slot = accessSlot(key);
+    UAVCAN_ASSERT(slot != UAVCAN_NULLPTR);
+    entry->next = *slot;
+    *slot = entry;
+    return &entry->receiver;
+}
+
+namespace
+{
+struct YesPredicate
+{
+    bool operator()(const TransferBufferManagerKey&, const TransferReceiver&) const { return true; }
+};
+}
+
+void TransferReceiverTable::clear()
+{
+    removeAllWhere(YesPredicate());
+    UAVCAN_ASSERT(isEmpty());
+}
+
+bool TransferReceiverTable::isEmpty() const
+{
+    for (unsigned i = 0; i < unsigned(NumPages); i++)
+    {
+        if (pages_[i] != UAVCAN_NULLPTR)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+unsigned TransferReceiverTable::getSize() const
+{
+    unsigned num = 0;
+    for (unsigned p = 0; p < unsigned(NumPages); p++)
+    {
+        if (pages_[p] == UAVCAN_NULLPTR)
+        {
+            continue;
+        }
+        for (unsigned s = 0; s < unsigned(Page::NumSlots); s++)
+        {
+            for (const Entry* entry = pages_[p]->slots[s]; entry != UAVCAN_NULLPTR; entry = entry->next)
+            {
+                num++;
+            }
+        }
+    }
+    return num;
 }
 
 }
@@ -9,15 +9,201 @@
 
 namespace uavcan
 {
+namespace
+{
+
+uint16_t computeTransferCrc(TransferCRC crc, const uint8_t* payload, unsigned payload_len)
+{
+    crc.add(payload, payload_len);
+    return crc.get();
+}
+
+/**
+ * Whether the payload fits into one frame.
+ * In CAN FD mode, the frame must also have a valid length, because the tail byte can't be followed by padding.
+ */
+bool isSingleFrameTransfer(const Frame& frame, unsigned payload_len)
+{
+#if UAVCAN_CAN_FD
+    return (payload_len <= frame.getPayloadCapacity()) && CanFrame::isValidDataLen(uint8_t(payload_len + 1U));
+#else
+    return payload_len <= frame.getPayloadCapacity();
+#endif
+}
+
+/**
+ * Produces the frames of a multi-frame transfer by index, reusing the same Frame object for all of them.
+ * The transfer CRC, if the frame format needs it, is computed once at construction; the CAN ID is taken from
+ * the template, so that only the tail byte and the payload are produced per frame.
+ *
+ * The frames carry consecutive chunks of the stream that consists of the transfer CRC followed by the payload.
+ * In CAN FD mode, all frames are full except the last few ones: the rest of the stream is cut into the longest
+ * chunks that make frames of valid CAN FD length, so that no padding is needed.
+ */
+class MultiFrameSequence : public ICanFrameSequence
+{
+    Frame& frame_;
+    const uint8_t* const payload_;
+    const unsigned payload_len_;
+    const uint16_t crc_;
+    const unsigned crc_len_;
+    const unsigned stream_len_;
+    const unsigned capacity_;
+    const TransferID base_tid_;
+    const bool tid_auto_inc_;
+    const uint32_t can_id_template_;
+    unsigned num_full_frames_;
+    unsigned num_frames_;
+
+#if UAVCAN_CAN_FD
+    /**
+     * Length of the next chunk of the stream when the given number of bytes is left to send. The first frame
+     * can't carry the whole stream, otherwise the transfer would look like a single frame one.
+     */
+    unsigned getChunkLen(unsigned remaining, bool first) const
+    {
+        unsigned len = min(first ? (remaining - 1U) : remaining, capacity_);
+        while (!CanFrame::isValidDataLen(uint8_t(len + 1U)))
+        {
+            len--;
+        }
+        return len;
+    }
+#endif
+
+    void locateChunk(unsigned index, unsigned& out_offset, unsigned& out_len) const
+    {
+        if (index < num_full_frames_)
+        {
+            out_offset = index * capacity_;
+            out_len = capacity_;
+            return;
+        }
+#if UAVCAN_CAN_FD
+        out_offset = num_full_frames_ * capacity_;
+        for (unsigned i = num_full_frames_;; i++)
+        {
+            out_len = getChunkLen(stream_len_ - out_offset, i == 0);
+            if (i == index)
+            {
+                break;
+            }
+            out_offset += out_len;
+        }
+#else
+        out_offset = index * capacity_;
+        out_len = stream_len_ - out_offset;
+#endif
+    }
+
+public:
+    MultiFrameSequence(Frame& frame, const uint8_t* payload, unsigned payload_len, TransferCRC crc,
+                       unsigned crc_len, TransferID tid, uint32_t can_id_template)
+        : frame_(frame)
+        , payload_(payload)
+        , payload_len_(payload_len)
+        , crc_((crc_len > 0) ? computeTransferCrc(crc, payload, payload_len) : 0U)
+        , crc_len_(crc_len)
+        , stream_len_(crc_len_ + payload_len)
+        , capacity_(frame.getPayloadCapacity())
+        , base_tid_(frame.isTransferIdAutoInc() ? frame.getBaseAutoTransferID() : tid)
+        , tid_auto_inc_(frame.isTransferIdAutoInc())
+        , can_id_template_(can_id_template)
+        , num_full_frames_(0)
+        , num_frames_(0)
+    {
+        UAVCAN_ASSERT((crc_len_ == 0) || (crc_len_ == TransferCRC::NumBytes));
+#if UAVCAN_CAN_FD
+        UAVCAN_ASSERT(stream_len_ > 1U);
+        num_full_frames_ = (stream_len_ > capacity_) ? (stream_len_ / capacity_) : 0U;
+        num_frames_ = num_full_frames_;
+        for (unsigned offset = num_full_frames_ * capacity_; offset < stream_len_; num_frames_++)
+        {
+            offset += getChunkLen(stream_len_ - offset, num_frames_ == 0);
+        }
+#else
+        UAVCAN_ASSERT(stream_len_ > capacity_);
+        num_full_frames_ = stream_len_ / capacity_;
+        num_frames_ = (stream_len_ + capacity_ - 1U) / capacity_;
+#endif
+    }
+
+    virtual unsigned getNumFrames() const { return num_frames_; }
+
+    virtual bool getFrame(unsigned index, CanFrame& out_frame) const
+    {
+        if (index >= num_frames_)
+        {
+            return false;
+        }
+
+        frame_.setStartOfTransfer(index == 0);
+        frame_.setEndOfTransfer(index == (num_frames_ - 1U));
+        if (frame_.getToggle() != ((index & 1U) != 0))
+        {
+            frame_.flipToggle();
+        }
+        frame_.setTransferID(tid_auto_inc_ ? TransferID(uint8_t((base_tid_.get() + index) & TransferID::Max))
+                                           : base_tid_);
+
+        unsigned offset = 0;
+        unsigned len = 0;
+        locateChunk(index, offset, len);
+
+        if ((index == 0) && (crc_len_ > 0))
+        {
+            uint8_t buf[Frame::PayloadCapacity];
+            buf[0] = uint8_t(crc_ & 0xFFU);       // Transfer CRC, little endian
+            buf[1] = uint8_t((crc_ >> 8) & 0xFF);
+            (void)copy(payload_, payload_ + len - crc_len_, buf + crc_len_);
+            if (frame_.setPayload(buf, len) != len)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            if (frame_.setPayload(payload_ + offset - crc_len_, len) != len)
+            {
+                return false;
+            }
+        }
+
+        if (!frame_.compile(out_frame, can_id_template_))
+        {
+            UAVCAN_TRACE("TransferSender", "Frame is malformed: %s", frame_.toString().c_str());
+            return false;
+        }
+        return true;
+    }
+};
+}
 
 void TransferSender::registerError() const
 {
     dispatcher_.getTransferPerfCounter().addError();
 }
 
+uint32_t TransferSender::getCanIdTemplate(const Frame& frame) const
+{
+    // The data type ID is not a part of the key, since it can't be changed once initialized
+    const uint32_t key = (uint32_t(frame.getPriority().get()) << 16) |
+                         (uint32_t(frame.getTransferType()) << 14) |
+                         (uint32_t(frame.getDstNodeID().get()) << 7) |
+                         uint32_t(frame.getSrcNodeID().get());
+
+    if ((can_id_template_ == 0) || (key != can_id_template_key_))
+    {
+        can_id_template_ = frame.makeCanIdTemplate();
+        can_id_template_key_ = key;
+    }
+    return can_id_template_;
+}
+
 void TransferSender::init(const DataTypeDescriptor& dtid)
 {
     UAVCAN_ASSERT(!isInitialized());
+    can_id_template_ = 0;
 
     data_type_id_ = dtid.getID();
     crc_base_     = dtid.getSignature().toTransferCRC();
@@ -25,9 +211,10 @@ void TransferSender::init(const DataTypeDescriptor& dtid)
     crc_base48_     = dtid.getSignature().toTransferCRC48();
 }
 
-int TransferSender::send(Frame &frame, const uint8_t* payload, unsigned payload_len, MonotonicTime tx_deadline,
-                         MonotonicTime blocking_deadline, TransferType transfer_type, NodeID dst_node_id,
-                         TransferID tid) const
+int TransferSender::sendTransfer(Frame& frame, const uint8_t* payload, unsigned payload_len,
+                                 MonotonicTime tx_deadline, MonotonicTime blocking_deadline,
+                                 TransferType transfer_type, NodeID dst_node_id, TransferID tid,
+                                 unsigned transfer_crc_len) const
 {
     frame.setTransferType(transfer_type);
     frame.setDataTypeID(data_type_id_);
@@ -47,19 +234,28 @@ int TransferSender::send(Frame &frame, const uint8_t* payload, unsigned payload_
     {
         const bool allow = allow_anonymous_transfers_ &&
                            (transfer_type == TransferTypeMessageBroadcast) &&
-                           (int(payload_len) <= frame.getPayloadCapacity());
+                           isSingleFrameTransfer(frame, payload_len);
         if (!allow)
         {
             return -ErrPassiveMode;
         }
     }
 
+    const uint32_t can_id_template = getCanIdTemplate(frame);
+    if (can_id_template == 0)
+    {
+        UAVCAN_TRACE("TransferSender", "Unable to send: frame is malformed: %s", frame.toString().c_str());
+        UAVCAN_ASSERT(0);
+        registerError();
+        return -ErrLogic;
+    }
+
     dispatcher_.getTransferPerfCounter().addTxTransfer();
 
     /*
      * Sending frames
      */
-    if (frame.getPayloadCapacity() >= payload_len)           // Single Frame Transfer
+    if (isSingleFrameTransfer(frame, payload_len))         // Single Frame Transfer
     {
         const int res = frame.setPayload(payload, payload_len);
         if (res != int(payload_len))
@@ -75,106 +271,76 @@ int TransferSender::send(Frame &frame, const uint8_t* payload, unsigned payload_
 
         const CanIOFlags flags = frame.getSrcNodeID().isUnicast() ? flags_ : (flags_ | CanIOFlagAbortOnError);
 
-        return dispatcher_.send(frame, tx_deadline, blocking_deadline, flags, iface_mask_);
+        CanFrame can_frame;
+        if (!frame.compile(can_frame, can_id_template))
+        {
+            UAVCAN_TRACE("TransferSender", "Unable to send: frame is malformed: %s", frame.toString().c_str());
+            registerError();
+            return -ErrLogic;
+        }
+        return dispatcher_.sendBatch(&can_frame, 1, tx_deadline, blocking_deadline, flags, iface_mask_);
     }
     else                                                   // Multi Frame Transfer
     {
         UAVCAN_ASSERT(!dispatcher_.isPassiveMode());
         UAVCAN_ASSERT(frame.getSrcNodeID().isUnicast());
 
-        int offset = 0;
-
-        if(frame.getFrameType() == 0)
-        {
-            TransferCRC crc = crc_base_;
-            crc.add(payload, payload_len);
-
-            static const int BUFLEN = sizeof(static_cast<CanFrame*>(0)->data);
-            uint8_t buf[BUFLEN];
-
-            buf[0] = uint8_t(crc.get() & 0xFFU);       // Transfer CRC, little endian
-            buf[1] = uint8_t((crc.get() >> 8) & 0xFF);
-            (void)copy(payload, payload + BUFLEN - 2, buf + 2);
+        const MultiFrameSequence frames(frame, payload, payload_len, crc_base_, transfer_crc_len, tid,
+                                        can_id_template);
+        const unsigned num_frames = frames.getNumFrames();
 
-            const int write_res = frame.setPayload(buf, BUFLEN);
-            if (write_res < 2)
-            {
-                UAVCAN_TRACE("TransferSender", "Frame payload write failure, %i", write_res);
-                registerError();
-                return write_res;
-            }
-            offset = write_res - 2;
-            UAVCAN_ASSERT(int(payload_len) > offset);
-        }
-        else
+        if (pipelined_)
         {
-            const int write_res = frame.setPayload(payload + offset, payload_len - unsigned(offset));
-            if (write_res < 0)
+            const int enqueue_res = dispatcher_.enqueue(frames, tx_deadline, flags_, iface_mask_);
+            if (enqueue_res <= 0)
             {
-                UAVCAN_TRACE("TransferSender", "Frame payload write failure, %i", write_res);
+                UAVCAN_TRACE("TransferSender", "Unable to enqueue %u frames, %i", num_frames, enqueue_res);
                 registerError();
-                return write_res;
+                return (enqueue_res < 0) ? enqueue_res : -ErrMemory;
             }
-            offset += write_res;
+            return int(num_frames);
         }
 
-        int num_sent = 0;
-
-
-        TransferID transfer_id = tid;
-        if(frame.isTransferIdAutoInc())
-        {
-            transfer_id = frame.getBaseAutoTransferID();
-        }
+        /*
+         * The frames are compiled into a batch, which is handed over to the CAN IO layer at once, so that the
+         * frames that can't be transmitted right away are enqueued together.
+         */
+        CanFrame batch[CanTxBatchSize];
+        unsigned batch_len = 0;
 
-        while (true)
+        for (unsigned i = 0; i < num_frames; i++)
         {
-            frame.setTransferID(transfer_id);
-            const int send_res = dispatcher_.send(frame, tx_deadline, blocking_deadline, flags_, iface_mask_);
-            if (send_res < 0)
+            if (!frames.getFrame(i, batch[batch_len]))
             {
+                UAVCAN_TRACE("TransferSender", "Unable to send: frame is malformed: %s", frame.toString().c_str());
+                UAVCAN_ASSERT(0);
                 registerError();
-                return send_res;
+                return -ErrLogic;
             }
+            batch_len++;
 
-            num_sent++;
-            if (frame.isEndOfTransfer())
+            if ((batch_len >= CanTxBatchSize) || (i == (num_frames - 1U)))
             {
-                return num_sent;  // Number of frames transmitted
-            }
-
-            if (frame.isTransferIdAutoInc())
-            {
-                transfer_id.increment(); 
-            }
-
-            frame.setStartOfTransfer(false);
-            frame.flipToggle();
-
-            UAVCAN_ASSERT(offset >= 0);
-            const int write_res = frame.setPayload(payload + offset, payload_len - unsigned(offset));
-            if (write_res < 0)
-            {
-                UAVCAN_TRACE("TransferSender", "Frame payload write failure, %i", write_res);
-                registerError();
-                return write_res;
-            }
-
-            offset += write_res;
-            UAVCAN_ASSERT(offset <= int(payload_len));
-            if (offset >= int(payload_len))
-            {
-                frame.setEndOfTransfer(true);
+                const int send_res = dispatcher_.sendBatch(batch, batch_len, tx_deadline, blocking_deadline,
+                                                           flags_, iface_mask_);
+                if (send_res < 0)
+                {
+                    registerError();
+                    return send_res;
+                }
+                batch_len = 0;
             }
         }
+        return int(num_frames);  // Number of frames transmitted
     }
 
     UAVCAN_ASSERT(0);
     return -ErrLogic; // Return path analysis is apparently broken. There should be no warning, this 'return' is unreachable.
 }
 
-int TransferSender::send(Frame &frame, const uint8_t* payload, unsigned payload_len, MonotonicTime tx_deadline,
-                         MonotonicTime blocking_deadline, TransferType transfer_type, NodeID dst_node_id) const
+int TransferSender::sendTransfer(Frame& frame, const uint8_t* payload, unsigned payload_len,
+                                 MonotonicTime tx_deadline, MonotonicTime blocking_deadline,
+                                 TransferType transfer_type, NodeID dst_node_id, unsigned transfer_crc_len) const
 {
     /*
      * TODO: TID is not needed for anonymous transfers, this part of the code can be skipped?
@@ -196,8 +362,8 @@ int TransferSender::send(Frame &frame, const uint8_t* payload, unsigned payload_
     const TransferID this_tid = tid->get();
     tid->increment();
 
-    return send(frame, payload, payload_len, tx_deadline, blocking_deadline, transfer_type,
-                dst_node_id, this_tid);
+    return sendTransfer(frame, payload, payload_len, tx_deadline, blocking_deadline, transfer_type,
+                        dst_node_id, this_tid, transfer_crc_len);
 }
 
 int TransferSender::send(const uint8_t* payload, unsigned payload_len, MonotonicTime tx_deadline,
@@ -206,8 +372,8 @@ int TransferSender::send(const uint8_t* payload, unsigned payload_len, Monotonic
 {
     Frame frame(data_type_id_, transfer_type, dispatcher_.getNodeID(), dst_node_id, tid);
 
-    return send(frame, payload, payload_len, tx_deadline, blocking_deadline, transfer_type,
-                dst_node_id, tid);
+    return send<StandardFrameFormat>(frame, payload, payload_len, tx_deadline, blocking_deadline, transfer_type,
+                                     dst_node_id, tid);
 }
 
 
@@ -236,8 +402,8 @@ int TransferSender::send(const uint8_t* payload, unsigned payload_len, Monotonic
     tid->increment();
 
     Frame frame(data_type_id_, transfer_type, dispatcher_.getNodeID(), dst_node_id, this_tid);
-    return send(frame, payload, payload_len, tx_deadline, blocking_deadline, transfer_type,
-                dst_node_id, this_tid);
+    return send<StandardFrameFormat>(frame, payload, payload_len, tx_deadline, blocking_deadline, transfer_type,
+                                     dst_node_id, this_tid);
 }
 
 }
@@ -1417,3 +1417,100 @@ TEST(Array, CaseConversion)
     str.convertToUpperCaseASCII();
     ASSERT_STREQ("HELLO WORLD!", str.c_str());
 }
+
+
+TEST(Array, ByteArrayBulkCodec)
+{
+    typedef IntegerSpec<3, SignednessUnsigned, CastModeSaturate> Prefix;
+    typedef IntegerSpec<8, SignednessUnsigned, CastModeSaturate> Byte;
+    typedef Array<Byte, ArrayModeDynamic, 100> ByteArray;
+    typedef Array<IntegerSpec<8, SignednessSigned, CastModeTruncate>, ArrayModeStatic, 37> StaticByteArray;
+
+    for (unsigned prefix_bits = 0; prefix_bits < 2; prefix_bits++)      // Byte aligned and not
+    {
+        for (unsigned len = 0; len <= 100; len++)
+        {
+            ByteArray array;
+            for (unsigned i = 0; i < len; i++)
+            {
+                array.push_back(uint8_t(i * 7 + 3));
+            }
+
+            // Reference, element by element
+            uavcan::StaticTransferBuffer<200> ref_buf;
+            {
+                uavcan::BitStream bs(ref_buf);
+                uavcan::ScalarCodec sc(bs);
+                if (prefix_bits > 0)
+                {
+                    ASSERT_EQ(1, Prefix::encode(5, sc, uavcan::TailArrayOptDisabled));
+                }
+                for (unsigned i = 0; i < len; i++)
+                {
+                    ASSERT_EQ(1, Byte::encode(array[i], sc, uavcan::TailArrayOptDisabled));
+                }
+            }
+
+            uavcan::StaticTransferBuffer<200> buf;
+            {
+                uavcan::BitStream bs(buf);
+                uavcan::ScalarCodec sc(bs);
+                if (prefix_bits > 0)
+                {
+                    ASSERT_EQ(1, Prefix::encode(5, sc, uavcan::TailArrayOptDisabled));
+                }
+                ASSERT_EQ(1, ByteArray::encode(array, sc, uavcan::TailArrayOptEnabled));
+            }
+            ASSERT_EQ(ref_buf.getMaxWritePos(), buf.getMaxWritePos());
+            uint8_t ref_bytes[200];
+            uint8_t bytes[200];
+            ASSERT_EQ(int(ref_buf.getMaxWritePos()), ref_buf.read(0, ref_bytes, ref_buf.getMaxWritePos()));
+            ASSERT_EQ(int(buf.getMaxWritePos()), buf.read(0, bytes, buf.getMaxWritePos()));
+            ASSERT_TRUE(std::equal(bytes, bytes + buf.getMaxWritePos(), ref_bytes));
+
+            // Tail array decoding stops at the end of the stream
+            {
+                uavcan::BitStream bs(buf);
+                uavcan::ScalarCodec sc(bs);
+                uint8_t prefix = 0;
+                if (prefix_bits > 0)
+                {
+                    ASSERT_EQ(1, Prefix::decode(prefix, sc, uavcan::TailArrayOptDisabled));
+                    ASSERT_EQ(5, prefix);
+                }
+                ByteArray decoded;
+                ASSERT_EQ(1, ByteArray::decode(decoded, sc, uavcan::TailArrayOptEnabled));
+                ASSERT_TRUE(decoded == array);
+            }
+        }
+
+        // Static arrays are never tail optimized
+        StaticByteArray static_array;
+        for (unsigned i = 0; i < static_array.size(); i++)
+        {
+            static_array[i] = int8_t(100 - int(i) * 5);
+        }
+        uavcan::StaticTransferBuffer<200> buf;
+        {
+            uavcan::BitStream bs(buf);
+            uavcan::ScalarCodec sc(bs);
+            if (prefix_bits > 0)
+            {
+                ASSERT_EQ(1, Prefix::encode(5, sc, uavcan::TailArrayOptDisabled));
+            }
+            ASSERT_EQ(1, StaticByteArray::encode(static_array, sc, uavcan::TailArrayOptEnabled));
+        }
+        {
+            uavcan::BitStream bs(buf);
+            uavcan::ScalarCodec sc(bs);
+            uint8_t prefix = 0;
+            if (prefix_bits > 0)
+            {
+                ASSERT_EQ(1, Prefix::decode(prefix, sc, uavcan::TailArrayOptDisabled));
+            }
+            StaticByteArray decoded;
+            ASSERT_EQ(1, StaticByteArray::decode(decoded, sc, uavcan::TailArrayOptEnabled));
+            ASSERT_TRUE(decoded == static_array);
+        }
+    }
+}
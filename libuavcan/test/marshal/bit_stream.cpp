@@ -192,3 +192,108 @@ TEST(BitStream, BitByBit)
     ASSERT_EQ(0, bs_wr.read(dummy_data_rd, 1));
     ASSERT_EQ(0xFF, dummy_data_rd[0]);
 }
+
+
+TEST(BitStream, BitarrayCopy)
+{
+    uint8_t src[40];
+    for (unsigned i = 0; i < sizeof(src); i++)
+    {
+        src[i] = uint8_t(i * 151U + 77U);
+    }
+
+    for (unsigned src_offset = 0; src_offset < 8; src_offset++)
+    {
+        for (unsigned dst_offset = 0; dst_offset < 8; dst_offset++)
+        {
+            for (unsigned len = 1; len <= ((sizeof(src) - 1) * 8); len++)
+            {
+                uint8_t dst[sizeof(src) + 1];
+                uint8_t ref[sizeof(src) + 1];
+                std::fill(dst, dst + sizeof(dst), uint8_t(0xA5));
+                std::fill(ref, ref + sizeof(ref), uint8_t(0xA5));
+
+                // Reference, bit by bit
+                for (unsigned i = 0; i < len; i++)
+                {
+                    const unsigned s = src_offset + i;
+                    const unsigned d = dst_offset + i;
+                    const bool bit = (src[s / 8] >> (7 - (s % 8))) & 1U;
+                    ref[d / 8] = uint8_t(bit ? (ref[d / 8] | (0x80U >> (d % 8))) : (ref[d / 8] & ~(0x80U >> (d % 8))));
+                }
+
+                uavcan::bitarrayCopy(src, src_offset, len, dst, dst_offset);
+                ASSERT_TRUE(std::equal(dst, dst + sizeof(dst), ref))
+                    << "src_offset " << src_offset << " dst_offset " << dst_offset << " len " << len;
+            }
+        }
+    }
+}
+
+
+TEST(BitStream, SpanMode)
+{
+    static const unsigned BitLens[] = { 3, 8, 13, 16, 1, 7, 32, 5, 24, 64, 2 };
+    static const unsigned NumFields = sizeof(BitLens) / sizeof(BitLens[0]);
+
+    uint8_t data[NumFields][8];
+    for (unsigned i = 0; i < NumFields; i++)
+    {
+        for (unsigned k = 0; k < 8; k++)
+        {
+            data[i][k] = uint8_t(0xA5 ^ (i * 37 + k * 11));
+        }
+    }
+
+    // Reference is produced in the buffer mode
+    uavcan::StaticTransferBuffer<32> buf;
+    {
+        uavcan::BitStream bs(buf);
+        for (unsigned i = 0; i < NumFields; i++)
+        {
+            ASSERT_EQ(1, bs.write(data[i], BitLens[i]));
+        }
+    }
+
+    uint8_t span[32];
+    std::fill(span, span + sizeof(span), uint8_t(0xFF));      // Garbage must not leak into the padding bits
+    {
+        uavcan::BitStream bs(span, sizeof(span));
+        ASSERT_EQ(0, bs.getSpanLen());
+        for (unsigned i = 0; i < NumFields; i++)
+        {
+            ASSERT_EQ(1, bs.write(data[i], BitLens[i]));
+        }
+        ASSERT_EQ(buf.getMaxWritePos(), bs.getSpanLen());
+
+        uavcan::BitStream bs_buf(buf);
+        ASSERT_EQ(bs_buf.toString(), bs.toString());
+    }
+
+    // Reading back from a read-only span
+    {
+        const uint8_t* const const_span = span;
+        uavcan::BitStream bs(const_span, buf.getMaxWritePos());
+        uavcan::BitStream bs_buf(buf);
+        for (unsigned i = 0; i < NumFields; i++)
+        {
+            uint8_t a[8];
+            uint8_t b[8];
+            ASSERT_EQ(1, bs.read(a, BitLens[i]));
+            ASSERT_EQ(1, bs_buf.read(b, BitLens[i]));
+            ASSERT_TRUE(std::equal(a, a + (BitLens[i] + 7) / 8, b));
+        }
+        uint8_t byte = 0;
+        ASSERT_EQ(0, bs.read(&byte, 8));                      // End of span
+        ASSERT_EQ(0, bs.writeBytes(&byte, 1));                // Read-only
+    }
+
+    // Out of span space
+    {
+        uavcan::BitStream bs(span, 2);
+        ASSERT_EQ(1, bs.write(data[0], 13));
+        ASSERT_EQ(0, bs.write(data[1], 4));
+        ASSERT_EQ(1, bs.write(data[1], 3));
+        ASSERT_EQ(2, bs.getSpanLen());
+    }
+}
@@ -90,6 +90,136 @@ TEST(Scheduler, Timers)
     ASSERT_EQ(0, node.spin(durMono(1000)));                                    // Spin some more without timers
 }
 
+TEST(Scheduler, Wakeup)
+{
+    SystemClockDriver clock_driver;
+    CanDriverMock can_driver(2, clock_driver);
+    TestNode node(can_driver, clock_driver, 1);
+
+    /*
+     * The wakeup reported by the driver ends spin() long before the deadline and is consumed by it
+     */
+    uavcan::MonotonicTime start_ts = clock_driver.getMonotonic();
+    can_driver.wakeup = true;
+    ASSERT_EQ(0, node.spin(durMono(1000000)));
+    ASSERT_GT(durMono(100000), clock_driver.getMonotonic() - start_ts);
+    ASSERT_FALSE(can_driver.wakeup);
+    ASSERT_FALSE(node.getDispatcher().getCanIOManager().isWakeupPending());
+
+    /*
+     * Same for the version that decodes the frames into the caller's frame object
+     */
+    uavcan::RxFrame frame;
+    start_ts = clock_driver.getMonotonic();
+    can_driver.wakeup = true;
+    ASSERT_EQ(0, node.spin(frame, durMono(1000000)));
+    ASSERT_GT(durMono(100000), clock_driver.getMonotonic() - start_ts);
+    ASSERT_FALSE(can_driver.wakeup);
+    ASSERT_FALSE(node.getDispatcher().getCanIOManager().isWakeupPending());
+
+    /*
+     * spinOnce() returns anyway, the wakeup must not leak into the next spin()
+     */
+    can_driver.wakeup = true;
+    ASSERT_EQ(0, node.spinOnce());
+    ASSERT_FALSE(node.getDispatcher().getCanIOManager().isWakeupPending());
+
+    /*
+     * Without the wakeup the deadline is honored
+     */
+    start_ts = clock_driver.getMonotonic();
+    ASSERT_EQ(0, node.spin(durMono(10000)));
+    ASSERT_LE(durMono(10000), clock_driver.getMonotonic() - start_ts);
+}
+
+struct DeadlineLogger : public uavcan::DeadlineHandler
+{
+    std::vector<uavcan::MonotonicTime>& log;
+
+    DeadlineLogger(uavcan::Scheduler& scheduler, std::vector<uavcan::MonotonicTime>& arg_log)
+        : uavcan::DeadlineHandler(scheduler)
+        , log(arg_log)
+    { }
+
+    virtual void handleDeadline(uavcan::MonotonicTime) { log.push_back(getDeadline()); }
+};
+
+TEST(Scheduler, DeadlineOrdering)
+{
+    SystemClockMock clock_mock(100);
+    CanDriverMock can_driver(2, clock_mock);
+    TestNode node(can_driver, clock_mock, 1);
+    uavcan::DeadlineScheduler& ds = node.getScheduler().getDeadlineScheduler();
+
+    enum { NumHandlers = 200 };
+    std::vector<uavcan::MonotonicTime> log;
+    std::vector<DeadlineLogger*> handlers;
+    for (unsigned i = 0; i < NumHandlers; i++)
+    {
+        handlers.push_back(new DeadlineLogger(node.getScheduler(), log));
+    }
+
+    /*
+     * Shuffled deadlines, some of them are equal; every third handler is stopped, some are restarted
+     */
+    for (unsigned i = 0; i < NumHandlers; i++)
+    {
+        handlers[i]->startWithDeadline(tsMono(1000 + ((i * 37U) % 150U) * 10U));
+    }
+    ASSERT_EQ(NumHandlers, ds.getNumHandlers());
+
+    unsigned num_running = NumHandlers;
+    for (unsigned i = 0; i < NumHandlers; i += 3)
+    {
+        handlers[i]->stop();
+        handlers[i]->stop();                        // Repeated stop has no effect
+        ASSERT_FALSE(handlers[i]->isRunning());
+        num_running--;
+    }
+    for (unsigned i = 1; i < NumHandlers; i += 10)
+    {
+        num_running += handlers[i]->isRunning() ? 0 : 1;
+        handlers[i]->startWithDeadline(tsMono(1005 + i * 10U));
+    }
+    ASSERT_EQ(num_running, ds.getNumHandlers());
+
+    uavcan::MonotonicTime earliest = uavcan::MonotonicTime::getMax();
+    for (unsigned i = 0; i < NumHandlers; i++)
+    {
+        if (handlers[i]->isRunning())
+        {
+            earliest = std::min(earliest, handlers[i]->getDeadline());
+        }
+    }
+    ASSERT_EQ(earliest, ds.getEarliestDeadline());
+
+    /*
+     * Partial poll fires only the expired handlers, in order
+     */
+    clock_mock.monotonic = 1500;
+    ASSERT_EQ(tsMono(1500), ds.pollAndGetMonotonicTime(clock_mock));
+    ASSERT_FALSE(log.empty());
+    ASSERT_LT(tsMono(1500), ds.getEarliestDeadline());
+    const unsigned num_fired = unsigned(log.size());
+    ASSERT_EQ(num_running - num_fired, ds.getNumHandlers());
+
+    clock_mock.monotonic = 100000;
+    ds.pollAndGetMonotonicTime(clock_mock);
+    ASSERT_EQ(0, ds.getNumHandlers());
+    ASSERT_EQ(uavcan::MonotonicTime::getMax(), ds.getEarliestDeadline());
+    ASSERT_EQ(num_running, log.size());
+    for (unsigned i = 1; i < log.size(); i++)
+    {
+        ASSERT_LE(log[i - 1], log[i]);
+    }
+
+    for (unsigned i = 0; i < NumHandlers; i++)
+    {
+        ASSERT_FALSE(handlers[i]->isRunning());
+        delete handlers[i];
+    }
+}
+
 #if UAVCAN_CPP_VERSION >= UAVCAN_CPP11
 
 TEST(Scheduler, TimerCpp11)
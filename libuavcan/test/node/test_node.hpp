@@ -37,6 +37,15 @@ struct TestNode : public uavcan::INode
         setNodeID(self_node_id);
     }
 
+    /**
+     * The node stays in passive mode until the node ID is assigned.
+     */
+    TestNode(uavcan::ICanDriver& can_driver, uavcan::ISystemClock& clock_driver) :
+        pool(1024),
+        scheduler(can_driver, pool, clock_driver),
+        internal_failure_count(0)
+    { }
+
     virtual void registerInternalFailure(const char* msg)
     {
         std::cout << "TestNode internal failure: " << msg << std::endl;
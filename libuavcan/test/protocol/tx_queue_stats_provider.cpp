@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2014 Pavel Kirienko <pavel.kirienko@gmail.com>
+ *
+ * Tests of the TX queue statistics service.
+ */
+
+#include <gtest/gtest.h>
+#include <uavcan/protocol/tx_queue_stats_provider.hpp>
+#include <root_ns_a/TxQueueStats.hpp>
+#include "helpers.hpp"
+
+
+TEST(TxQueueStatsProvider, Basic)
+{
+    InterlinkedTestNodesWithSysClock nodes;
+
+    uavcan::TxQueueStatsProvider<root_ns_a::TxQueueStats> tqsp(nodes.a);
+
+    uavcan::GlobalDataTypeRegistry::instance().reset();
+    uavcan::DefaultDataTypeRegistrator<root_ns_a::TxQueueStats> _reg1;
+
+    ASSERT_LE(0, tqsp.start());
+
+    ServiceClientWithCollector<root_ns_a::TxQueueStats> tqsp_cln(nodes.b);
+
+    /*
+     * Existing interface - all levels are reported; the bus is never busy here, so the queue is empty
+     */
+    root_ns_a::TxQueueStats::Request request;
+    request.iface_index = 0;
+    ASSERT_LE(0, tqsp_cln.call(1, request));
+    ASSERT_LE(0, nodes.spinBoth(uavcan::MonotonicDuration::fromMSec(10)));
+
+    ASSERT_TRUE(tqsp_cln.collector.result.get());
+    ASSERT_TRUE(tqsp_cln.collector.result->isSuccessful());
+    const root_ns_a::TxQueueStats::Response& resp = tqsp_cln.collector.result->getResponse();
+    ASSERT_EQ(uavcan::CanTxQueueStats::NumPriorityLevels, resp.depth.size());
+    ASSERT_EQ(uavcan::CanTxQueueStats::NumPriorityLevels, resp.num_expired.size());
+    ASSERT_EQ(uavcan::CanTxQueueStats::NumPriorityLevels * uavcan::CanTxQueueStats::NumLatencyBins,
+              resp.latency_histogram.size());
+    for (unsigned i = 0; i < resp.depth.size(); i++)
+    {
+        EXPECT_EQ(0, resp.depth[i]);
+        EXPECT_EQ(0, resp.num_rejected[i]);
+    }
+
+    /*
+     * Nonexistent interface
+     */
+    request.iface_index = 7;
+    ASSERT_LE(0, tqsp_cln.call(1, request));
+    ASSERT_LE(0, nodes.spinBoth(uavcan::MonotonicDuration::fromMSec(10)));
+
+    ASSERT_TRUE(tqsp_cln.collector.result.get());
+    ASSERT_TRUE(tqsp_cln.collector.result->isSuccessful());
+    EXPECT_TRUE(tqsp_cln.collector.result->getResponse().depth.empty());
+    EXPECT_TRUE(tqsp_cln.collector.result->getResponse().latency_histogram.empty());
+}
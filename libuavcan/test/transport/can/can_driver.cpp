@@ -78,6 +78,39 @@ TEST(CanFrame, Arbitration)
     ASSERT_TRUE(b.priorityHigherThan(a));
 }
 
+TEST(CanFrame, DataLength)
+{
+    using uavcan::CanFrame;
+
+    for (uint8_t len = 0; len <= 8; len++)
+    {
+        EXPECT_EQ(len, CanFrame::dataLenToDlc(len));
+        EXPECT_EQ(len, CanFrame::dlcToDataLen(len));
+        EXPECT_TRUE(CanFrame::isValidDataLen(len));
+    }
+
+    static const uint8_t FdLengths[] = { 12, 16, 20, 24, 32, 48, 64 };
+    for (uint8_t dlc = 9; dlc <= 15; dlc++)
+    {
+        const uint8_t len = FdLengths[dlc - 9];
+        EXPECT_EQ(len, CanFrame::dlcToDataLen(dlc));
+        EXPECT_EQ(dlc, CanFrame::dataLenToDlc(len));
+        EXPECT_TRUE(CanFrame::isValidDataLen(len));
+    }
+
+    // Rounded up
+    EXPECT_EQ(9,  CanFrame::dataLenToDlc(9));
+    EXPECT_EQ(12, CanFrame::dataLenToDlc(21));
+    EXPECT_EQ(13, CanFrame::dataLenToDlc(25));
+    EXPECT_EQ(15, CanFrame::dataLenToDlc(49));
+    EXPECT_FALSE(CanFrame::isValidDataLen(9));
+    EXPECT_FALSE(CanFrame::isValidDataLen(33));
+    EXPECT_FALSE(CanFrame::isValidDataLen(63));
+    EXPECT_FALSE(CanFrame::isValidDataLen(65));
+
+    EXPECT_FALSE(makeCanFrame(0, "12345678", EXT).isCanFd());
+}
+
 TEST(CanFrame, ToString)
 {
     uavcan::CanFrame frame = makeCanFrame(123, "\x01\x02\x03\x04" "1234", EXT);
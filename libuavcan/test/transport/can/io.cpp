@@ -112,6 +112,125 @@ TEST(CanIOManager, Reception)
     EXPECT_EQ(0, iomgr.getIfacePerfCounters(1).frames_tx);
 }
 
+TEST(CanIOManager, Wakeup)
+{
+    uavcan::PoolAllocator<sizeof(uavcan::CanTxQueueEntry) * 4, sizeof(uavcan::CanTxQueueEntry)> pool;
+
+    SystemClockMock clockmock;
+    CanDriverMock driver(2, clockmock);
+
+    uavcan::CanIOManager iomgr(driver, pool, clockmock);
+
+    uavcan::CanRxFrame frame;
+    uavcan::CanIOFlags flags = uavcan::CanIOFlags();
+
+    /*
+     * Wakeup ends the blocking call before the deadline and stays pending until yielded
+     */
+    EXPECT_FALSE(iomgr.isWakeupPending());
+    driver.wakeup = true;
+    EXPECT_EQ(0, iomgr.receive(frame, tsMono(1000000), flags));
+    EXPECT_GT(1000000, clockmock.monotonic);
+    EXPECT_TRUE(iomgr.isWakeupPending());
+
+    EXPECT_EQ(0, iomgr.receive(frame, tsMono(1000000), flags));     // Still pending - returns immediately
+    EXPECT_GT(1000000, clockmock.monotonic);
+
+    EXPECT_TRUE(iomgr.yieldWakeup());
+    EXPECT_FALSE(iomgr.yieldWakeup());
+    EXPECT_FALSE(iomgr.isWakeupPending());
+
+    /*
+     * Pending frames are still delivered
+     */
+    const uavcan::CanFrame rx_frame = makeCanFrame(1, "a0", EXT);
+    driver.ifaces.at(1).pushRx(rx_frame);
+    driver.wakeup = true;
+    EXPECT_EQ(1, iomgr.receive(frame, tsMono(1000000), flags));
+    EXPECT_TRUE(rxFrameEquals(frame, rx_frame, clockmock.monotonic, 1));
+    EXPECT_TRUE(iomgr.yieldWakeup());
+
+    /*
+     * Without the wakeup it blocks until the deadline as usual
+     */
+    EXPECT_EQ(0, iomgr.receive(frame, tsMono(1000000), flags));
+    EXPECT_EQ(1000000, clockmock.monotonic);
+    EXPECT_FALSE(iomgr.isWakeupPending());
+}
+
+TEST(CanIOManager, BatchReception)
+{
+    // Memory
+    uavcan::PoolAllocator<sizeof(uavcan::CanTxQueueEntry) * 4, sizeof(uavcan::CanTxQueueEntry)> pool;
+
+    // Platform interface
+    SystemClockMock clockmock;
+    CanDriverMock driver(2, clockmock);
+
+    // IO Manager
+    uavcan::CanIOManager iomgr(driver, pool, clockmock);
+
+    static const unsigned BatchSize = 4;
+    if (uavcan::CanRxBatchSize < BatchSize)
+    {
+        std::cout << "Skipping: CanRxBatchSize is too small" << std::endl;
+        return;
+    }
+
+    uavcan::CanRxFrame frames[BatchSize];
+    uavcan::CanIOFlags flags[BatchSize] = {};
+
+    /*
+     * Empty, will time out
+     */
+    EXPECT_EQ(0, iomgr.receiveBatch(frames, flags, BatchSize, tsMono(100)));
+    EXPECT_EQ(100, clockmock.monotonic);
+
+    /*
+     * The first iface is busier than the second one, but both must be served within one call
+     */
+    const uavcan::CanFrame a[6] = {
+        makeCanFrame(1, "a0", EXT), makeCanFrame(2, "a1", EXT), makeCanFrame(3, "a2", EXT),
+        makeCanFrame(4, "a3", EXT), makeCanFrame(5, "a4", EXT), makeCanFrame(6, "a5", EXT)
+    };
+    const uavcan::CanFrame b[2] = { makeCanFrame(7, "b0", STD), makeCanFrame(8, "b1", STD) };
+
+    for (unsigned i = 0; i < 6; i++)
+    {
+        driver.ifaces.at(0).pushRx(a[i]);
+    }
+    driver.ifaces.at(1).pushRx(b[0]);
+    driver.ifaces.at(1).pushRx(b[1]);
+
+    ASSERT_EQ(4, iomgr.receiveBatch(frames, flags, BatchSize, uavcan::MonotonicTime()));
+    EXPECT_TRUE(rxFrameEquals(frames[0], a[0], 100, 0));
+    EXPECT_TRUE(rxFrameEquals(frames[1], a[1], 100, 0));
+    EXPECT_TRUE(rxFrameEquals(frames[2], b[0], 100, 1));
+    EXPECT_TRUE(rxFrameEquals(frames[3], b[1], 100, 1));
+
+    ASSERT_EQ(4, iomgr.receiveBatch(frames, flags, BatchSize, uavcan::MonotonicTime()));
+    for (unsigned i = 0; i < 4; i++)
+    {
+        EXPECT_TRUE(rxFrameEquals(frames[i], a[i + 2], 100, 0));
+        EXPECT_EQ(0, flags[i]);
+    }
+
+    EXPECT_EQ(0, iomgr.receiveBatch(frames, flags, BatchSize, uavcan::MonotonicTime()));
+
+    /*
+     * Frames received before a driver error are not lost
+     */
+    driver.ifaces.at(0).pushRx(a[0]);
+    driver.ifaces.at(1).pushRx(b[0]);
+    driver.ifaces.at(1).rx_failure = true;
+    ASSERT_EQ(1, iomgr.receiveBatch(frames, flags, BatchSize, uavcan::MonotonicTime()));
+    EXPECT_TRUE(rxFrameEquals(frames[0], a[0], 100, 0));
+    EXPECT_EQ(-uavcan::ErrDriver, iomgr.receiveBatch(frames, flags, BatchSize, uavcan::MonotonicTime()));
+
+    EXPECT_EQ(7, iomgr.getIfacePerfCounters(0).frames_rx);
+    EXPECT_EQ(2, iomgr.getIfacePerfCounters(1).frames_rx);
+}
+
 TEST(CanIOManager, Transmission)
 {
     using uavcan::CanIOManager;
@@ -119,7 +238,7 @@ TEST(CanIOManager, Transmission)
     using uavcan::CanTxQueueEntry;
 
     // Memory
-    uavcan::PoolAllocator<40 * 64, 64> pool;
+    uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 40, uavcan::MemPoolBlockSize> pool;
 
     // Platform interface
     SystemClockMock clockmock;
@@ -171,14 +290,14 @@ TEST(CanIOManager, Transmission)
     EXPECT_EQ(200, clockmock.utc);
     EXPECT_TRUE(driver.ifaces.at(0).tx.empty());
     EXPECT_TRUE(driver.ifaces.at(1).tx.empty());
-    EXPECT_EQ(2, pool.getNumUsedBlocks());          // One frame went into TX queue, and will expire soon
+    EXPECT_EQ(1, pool.getNumUsedBlocks());          // One frame went into TX queue, and will expire soon
     EXPECT_TRUE(driver.ifaces.at(0).matchPendingTx(frames[0]));          // This one will persist
     EXPECT_TRUE(driver.ifaces.at(1).matchPendingTx(uavcan::CanFrame())); // This will drop off on the second select()
 
     // Sending to both, both blocked
     driver.ifaces.at(1).writeable = false;
     EXPECT_EQ(0, iomgr.send(frames[1], tsMono(777), tsMono(300), ALL_IFACES_MASK, flags));
-    EXPECT_EQ(6, pool.getNumUsedBlocks());          // Total 3 frames in TX queue now
+    EXPECT_EQ(2, pool.getNumUsedBlocks());          // frames[1] on both; frames[0] on #0 expired and was dropped
     EXPECT_TRUE(driver.ifaces.at(0).matchPendingTx(frames[0])); // Still 0
     EXPECT_TRUE(driver.ifaces.at(1).matchPendingTx(frames[1])); // 1!!
 
@@ -188,7 +307,7 @@ TEST(CanIOManager, Transmission)
     EXPECT_EQ(400, clockmock.utc);
     EXPECT_TRUE(driver.ifaces.at(0).tx.empty());
     EXPECT_TRUE(driver.ifaces.at(1).tx.empty());
-    EXPECT_EQ(6, pool.getNumUsedBlocks());
+    EXPECT_EQ(3, pool.getNumUsedBlocks());
     //EXPECT_TRUE(driver.ifaces.at(0).matchPendingTx(frames[0]));
     EXPECT_TRUE(driver.ifaces.at(1).matchPendingTx(frames[1]));
 
@@ -240,7 +359,7 @@ TEST(CanIOManager, Transmission)
     EXPECT_TRUE(driver.ifaces.at(1).matchPendingTx(frames[0]));
 
     // State checks
-    EXPECT_EQ(10, pool.getNumUsedBlocks());          // TX queue is full
+    EXPECT_EQ(5, pool.getNumUsedBlocks());          // TX queue is full
     EXPECT_EQ(1200, clockmock.monotonic);
     EXPECT_EQ(1200, clockmock.utc);
     EXPECT_TRUE(driver.ifaces.at(0).tx.empty());
@@ -272,7 +391,7 @@ TEST(CanIOManager, Transmission)
     EXPECT_TRUE(driver.ifaces.at(1).matchPendingTx(frames[1]));
 
     // State checks
-    EXPECT_EQ(2, pool.getNumUsedBlocks());          // TX queue is not empty now, contains the pending frames[2] because of QoS changes stated above
+    EXPECT_EQ(1, pool.getNumUsedBlocks());          // TX queue is not empty now, contains the pending frames[2] because of QoS changes stated above
     EXPECT_EQ(1200, clockmock.monotonic);
     EXPECT_EQ(1200, clockmock.utc);
     EXPECT_TRUE(driver.ifaces.at(0).tx.empty());
@@ -305,7 +424,7 @@ TEST(CanIOManager, Transmission)
     EXPECT_TRUE(driver.ifaces.at(0).matchPendingTx(frames[0]));
     EXPECT_TRUE(driver.ifaces.at(1).matchPendingTx(frames[0]));
 
-    ASSERT_EQ(6, pool.getNumUsedBlocks());               // Untransmitted frames will be buffered
+    ASSERT_EQ(3, pool.getNumUsedBlocks());               // Untransmitted frames will be buffered
 
     // Failure removed - transmission shall proceed
     driver.ifaces.at(0).tx_failure = false;
@@ -328,6 +447,141 @@ TEST(CanIOManager, Transmission)
     EXPECT_EQ(9, iomgr.getIfacePerfCounters(1).frames_tx);
 }
 
+TEST(CanIOManager, BatchTransmission)
+{
+    using uavcan::CanFrame;
+
+    uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 16, uavcan::MemPoolBlockSize> pool;
+    SystemClockMock clockmock;
+    CanDriverMock driver(2, clockmock);
+    uavcan::CanIOManager iomgr(driver, pool, clockmock, 9999);
+
+    // Frames of one transfer
+    const CanFrame frames[] = {
+        makeCanFrame(1000, "t0", EXT), makeCanFrame(1000, "t1", EXT), makeCanFrame(1000, "t2", EXT),
+        makeCanFrame(1000, "t3", EXT)
+    };
+    const uavcan::CanIOFlags flags = uavcan::CanIOFlags();
+
+    /*
+     * The writeable iface takes the whole batch directly, the other one gets it enqueued
+     */
+    driver.ifaces.at(1).writeable = false;
+    EXPECT_EQ(4, iomgr.sendBatch(frames, 4, tsMono(1000), tsMono(0), 3, flags));
+    EXPECT_EQ(4, pool.getNumUsedBlocks());
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_TRUE(driver.ifaces.at(0).matchAndPopTx(frames[i], 1000));
+    }
+    EXPECT_TRUE(driver.ifaces.at(0).tx.empty());
+    EXPECT_TRUE(driver.ifaces.at(1).tx.empty());
+
+    /*
+     * Enqueued frames are transmitted in order, ahead of the next batch of equal priority
+     */
+    driver.ifaces.at(1).writeable = true;
+    EXPECT_EQ(6, iomgr.sendBatch(frames, 2, tsMono(2000), tsMono(0), 2, flags));
+    EXPECT_EQ(0, pool.getNumUsedBlocks());
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_TRUE(driver.ifaces.at(1).matchAndPopTx(frames[i], 1000));
+    }
+    EXPECT_TRUE(driver.ifaces.at(1).matchAndPopTx(frames[0], 2000));
+    EXPECT_TRUE(driver.ifaces.at(1).matchAndPopTx(frames[1], 2000));
+    EXPECT_TRUE(driver.ifaces.at(1).tx.empty());
+
+    /*
+     * Not enough memory for the whole batch - nothing is enqueued
+     */
+    uavcan::CanIOManager small_iomgr(driver, pool, clockmock, 3);
+    driver.ifaces.at(0).writeable = false;
+    EXPECT_EQ(0, small_iomgr.sendBatch(frames, 4, tsMono(3000), tsMono(0), 1, flags));
+    EXPECT_EQ(0, pool.getNumUsedBlocks());
+    EXPECT_EQ(4, small_iomgr.getIfacePerfCounters(0).errors);
+}
+
+namespace
+{
+
+class CountingFrameSequence : public uavcan::ICanFrameSequence
+{
+    const unsigned num_frames_;
+
+public:
+    mutable unsigned num_calls;
+    unsigned failing_index;
+
+    explicit CountingFrameSequence(unsigned num_frames)
+        : num_frames_(num_frames)
+        , num_calls(0)
+        , failing_index(num_frames)
+    { }
+
+    virtual unsigned getNumFrames() const { return num_frames_; }
+
+    virtual bool getFrame(unsigned index, uavcan::CanFrame& out_frame) const
+    {
+        num_calls++;
+        if (index == failing_index)
+        {
+            return false;
+        }
+        out_frame = makeCanFrame(1000, std::string("t") + char('0' + index), EXT);
+        return true;
+    }
+};
+
+}
+
+TEST(CanIOManager, Enqueue)
+{
+    uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 16, uavcan::MemPoolBlockSize> pool;
+    SystemClockMock clockmock;
+    CanDriverMock driver(2, clockmock);
+    uavcan::CanIOManager iomgr(driver, pool, clockmock, 9999);
+    uavcan::CanRxFrame rx_frame;
+    uavcan::CanIOFlags flags = uavcan::CanIOFlags();
+
+    /*
+     * Nothing is transmitted until the queue is drained
+     */
+    CountingFrameSequence seq(5);
+    EXPECT_EQ(2, iomgr.enqueue(seq, tsMono(1000), 3, flags));
+    EXPECT_EQ(10, seq.num_calls);
+    EXPECT_EQ(10, pool.getNumUsedBlocks());
+    EXPECT_EQ(5, iomgr.getTxQueueDepth(0));
+    EXPECT_TRUE(driver.ifaces.at(0).tx.empty());
+    EXPECT_TRUE(driver.ifaces.at(1).tx.empty());
+
+    // A higher priority frame goes first
+    const uavcan::CanFrame urgent = makeCanFrame(10, "urgent", EXT);
+    driver.ifaces.at(1).writeable = false;
+    EXPECT_EQ(1, iomgr.send(urgent, tsMono(1000), tsMono(0), 1, flags));
+    EXPECT_TRUE(driver.ifaces.at(0).matchAndPopTx(urgent, 1000));
+    driver.ifaces.at(1).writeable = true;
+
+    // One frame per iface per receive() call, in order
+    for (unsigned i = 0; i < 5; i++)
+    {
+        EXPECT_EQ(0, iomgr.receive(rx_frame, tsMono(0), flags));
+        const uavcan::CanFrame expected = makeCanFrame(1000, std::string("t") + char('0' + i), EXT);
+        EXPECT_TRUE(driver.ifaces.at(0).matchAndPopTx(expected, 1000));
+        EXPECT_TRUE(driver.ifaces.at(1).matchAndPopTx(expected, 1000));
+    }
+    EXPECT_EQ(0, pool.getNumUsedBlocks());
+
+    /*
+     * All or nothing
+     */
+    CountingFrameSequence long_seq(17);
+    EXPECT_EQ(0, iomgr.enqueue(long_seq, tsMono(1000), 1, flags));
+    EXPECT_EQ(0, pool.getNumUsedBlocks());
+    EXPECT_EQ(17, iomgr.getIfacePerfCounters(0).errors);
+
+    EXPECT_EQ(0, iomgr.enqueue(seq, tsMono(0), 1, flags));      // Expired
+    EXPECT_EQ(22, iomgr.getIfacePerfCounters(0).errors);
+}
+
 TEST(CanIOManager, Loopback)
 {
     using uavcan::CanIOManager;
@@ -13,10 +13,10 @@ TEST(CanTxQueue, TxQueue)
     using uavcan::CanTxQueueEntry;
     using uavcan::CanFrame;
 
-    ASSERT_GE(40, sizeof(CanTxQueueEntry)); // should be true for any platforms, though not required
+    ASSERT_GE(uavcan::MemPoolBlockSize, sizeof(CanTxQueueEntry));
 
-    // 2 blocks per entry now, due to AvlTree
-    uavcan::PoolAllocator<64 * 8, 64> pool;
+    // One block per entry
+    uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 4, uavcan::MemPoolBlockSize> pool;
 
     SystemClockMock clockmock;
 
@@ -41,7 +41,7 @@ TEST(CanTxQueue, TxQueue)
     EXPECT_FALSE(queue.isEmpty());
     EXPECT_TRUE(queue.contains(f4));
     EXPECT_EQ(1, queue.getSize());
-    EXPECT_EQ(2, pool.getNumUsedBlocks());
+    EXPECT_EQ(1, pool.getNumUsedBlocks());
 
     EXPECT_EQ(f4, queue.peek()->frame);
     EXPECT_TRUE(queue.topPriorityHigherOrEqual(f5));
@@ -116,18 +116,16 @@ TEST(CanTxQueue, TxQueue)
 
     clockmock.monotonic = 102; // make f4 expire
     EXPECT_TRUE(queue.contains(f0));
-    EXPECT_TRUE(queue.contains(f4)); // f0 is higher priority, so will get traversed first -- f4 not yet removed
+    EXPECT_TRUE(queue.contains(f4)); // Not removed until the next peek
 
     CanTxQueueEntry* peek = queue.peek();
     EXPECT_EQ(f0, peek->frame);
-
-    queue.remove(peek);
-
+    EXPECT_FALSE(queue.contains(f4)); // Removed via the deadline index, even though f0 has higher priority
     EXPECT_EQ(1, queue.getSize());
-    EXPECT_EQ(2, pool.getNumUsedBlocks());
+    EXPECT_EQ(1, pool.getNumUsedBlocks());
 
-    EXPECT_FALSE(queue.peek()); // f4 will be removed now that queue only contains f4
-    EXPECT_FALSE(queue.contains(f4));
+    queue.remove(peek);
+    EXPECT_FALSE(queue.peek());
 
     EXPECT_EQ(0, queue.getSize());
     EXPECT_EQ(0, pool.getNumUsedBlocks());
@@ -144,24 +142,24 @@ TEST(CanTxQueue, TxQueue)
      */
 
     queue.push(f0, tsMono(900), flags);
-    EXPECT_EQ(2, pool.getNumUsedBlocks());
+    EXPECT_EQ(1, pool.getNumUsedBlocks());
 
     queue.push(f1, tsMono(1000), flags);
-    EXPECT_EQ(4, pool.getNumUsedBlocks());
+    EXPECT_EQ(2, pool.getNumUsedBlocks());
 
     queue.push(f2, tsMono(1100), flags);
-    EXPECT_EQ(6, pool.getNumUsedBlocks());
+    EXPECT_EQ(3, pool.getNumUsedBlocks());
 
     queue.push(f3, tsMono(1200), flags);
-    EXPECT_EQ(8, pool.getNumUsedBlocks());
+    EXPECT_EQ(4, pool.getNumUsedBlocks());
     EXPECT_TRUE(queue.contains(f3));
 
     queue.push(f4, tsMono(1300), flags);
-    EXPECT_EQ(8, pool.getNumUsedBlocks());
+    EXPECT_EQ(4, pool.getNumUsedBlocks());
     EXPECT_FALSE(queue.contains(f4));
 
     EXPECT_EQ(4, queue.getSize());
-    EXPECT_EQ(8, pool.getNumUsedBlocks());
+    EXPECT_EQ(4, pool.getNumUsedBlocks());
     EXPECT_FALSE(queue.contains(f4)); // OOM happened on insertion
     EXPECT_EQ(2, queue.getRejectedFrameCount());
 
@@ -176,3 +174,162 @@ TEST(CanTxQueue, TxQueue)
     EXPECT_EQ(0, queue.getSize());
     EXPECT_EQ(0, pool.getNumUsedBlocks());
 }
+
+TEST(CanTxQueue, Batch)
+{
+    using uavcan::CanTxQueue;
+    using uavcan::CanFrame;
+
+    uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 8, uavcan::MemPoolBlockSize> pool;
+    SystemClockMock clockmock;
+    CanTxQueue queue(pool, clockmock, 99999);
+
+    // Frames of one transfer share the CAN ID
+    const CanFrame transfer[] = {
+        makeCanFrame(1000, "t0", EXT), makeCanFrame(1000, "t1", EXT), makeCanFrame(1000, "t2", EXT),
+        makeCanFrame(1000, "t3", EXT), makeCanFrame(1000, "t4", EXT)
+    };
+    const CanFrame high = makeCanFrame(10, "high", EXT);
+    const CanFrame low = makeCanFrame(99999, "low", EXT);
+
+    queue.push(low, tsMono(500), 0);
+    queue.push(transfer, 5, tsMono(200), 0);
+    queue.push(high, tsMono(300), 0);
+    EXPECT_EQ(7, queue.getSize());
+    EXPECT_EQ(7, pool.getNumUsedBlocks());
+
+    /*
+     * All or nothing
+     */
+    queue.push(transfer, 2, tsMono(200), 0);
+    EXPECT_EQ(7, queue.getSize());
+    EXPECT_EQ(7, pool.getNumUsedBlocks());
+    EXPECT_EQ(2, queue.getRejectedFrameCount());
+
+    queue.push(transfer, 3, tsMono(0), 0);     // Already expired
+    EXPECT_EQ(5, queue.getRejectedFrameCount());
+
+    /*
+     * Priority first, then the order of insertion
+     */
+    EXPECT_EQ(high, queue.peek()->frame);
+    queue.remove(queue.peek());
+    for (int i = 0; i < 3; i++)
+    {
+        EXPECT_EQ(transfer[i], queue.peek()->frame);
+        queue.remove(queue.peek());
+    }
+
+    /*
+     * The rest of the transfer expires, the low priority frame stays
+     */
+    clockmock.monotonic = 201;
+    EXPECT_EQ(low, queue.peek()->frame);
+    EXPECT_EQ(1, queue.getSize());
+    EXPECT_EQ(1, pool.getNumUsedBlocks());
+
+    clockmock.monotonic = 501;
+    EXPECT_FALSE(queue.peek());
+    EXPECT_TRUE(queue.isEmpty());
+    EXPECT_EQ(0, pool.getNumUsedBlocks());
+
+    /*
+     * Many entries with random deadlines; the queue must stay consistent while expiring
+     */
+    uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 128, uavcan::MemPoolBlockSize> big_pool;
+    CanTxQueue big_queue(big_pool, clockmock, 99999);
+    for (unsigned i = 0; i < 100; i++)
+    {
+        big_queue.push(makeCanFrame((i * 7919U) % 1000U, "x", EXT), tsMono(1000 + (i * 104729U) % 1000U), 0);
+    }
+    EXPECT_EQ(100, big_queue.getSize());
+
+    clockmock.monotonic = 1500;
+    CanFrame prev;
+    unsigned num_transmitted = 0;
+    while (uavcan::CanTxQueueEntry* entry = big_queue.peek())
+    {
+        EXPECT_FALSE(entry->isExpired(clockmock.getMonotonic()));
+        if (num_transmitted > 0)
+        {
+            EXPECT_FALSE(entry->frame.priorityHigherThan(prev));
+        }
+        prev = entry->frame;
+        big_queue.remove(entry);
+        num_transmitted++;
+    }
+    EXPECT_GT(100, num_transmitted);
+    EXPECT_LT(0, num_transmitted);
+    EXPECT_EQ(0, big_pool.getNumUsedBlocks());
+}
+
+#if UAVCAN_TX_QUEUE_STATS
+
+TEST(CanTxQueue, Stats)
+{
+    using uavcan::CanTxQueue;
+    using uavcan::CanTxQueueStats;
+    using uavcan::CanFrame;
+
+    EXPECT_EQ(0, CanTxQueueStats::getLatencyBin(0));
+    EXPECT_EQ(0, CanTxQueueStats::getLatencyBin(249));
+    EXPECT_EQ(1, CanTxQueueStats::getLatencyBin(250));
+    EXPECT_EQ(2, CanTxQueueStats::getLatencyBin(1000));
+    EXPECT_EQ(6, CanTxQueueStats::getLatencyBin(1023999));
+    EXPECT_EQ(7, CanTxQueueStats::getLatencyBin(1024000));
+    EXPECT_EQ(7, CanTxQueueStats::getLatencyBin(0xFFFFFFFFU));
+
+    uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 4, uavcan::MemPoolBlockSize> pool;
+    SystemClockMock clockmock(1000);
+    CanTxQueue queue(pool, clockmock, 99999);
+
+    // Priority 0 and 16, extended; the STD frame has the same level as the EXT frame with the same top bits
+    const CanFrame high = makeCanFrame(0x00000001, "high", EXT);
+    const CanFrame normal = makeCanFrame(0x10000001, "normal", EXT);
+    const CanFrame normal_std = makeCanFrame(0x401, "std", STD);
+    EXPECT_EQ(0, CanTxQueueStats::getPriorityLevel(high));
+    EXPECT_EQ(16, CanTxQueueStats::getPriorityLevel(normal));
+    EXPECT_EQ(16, CanTxQueueStats::getPriorityLevel(normal_std));
+
+    const CanFrame batch[] = { normal, normal, normal };
+    queue.push(high, uavcan::MonotonicTime::fromUSec(100000), 0);
+    queue.push(batch, 3, uavcan::MonotonicTime::fromUSec(1500), 0);     // Timestamps 1001, 1002, 1003
+
+    const CanTxQueueStats& stats = queue.getStats();
+    EXPECT_EQ(1, stats.levels[0].depth);
+    EXPECT_EQ(3, stats.levels[16].depth);
+    EXPECT_EQ(3, stats.levels[16].peak_depth);
+
+    // OOM
+    queue.push(normal_std, uavcan::MonotonicTime::fromUSec(100000), 0);
+    EXPECT_EQ(1, stats.levels[16].num_rejected);
+
+    // Transmitting
+    clockmock.monotonic = 1300;
+    queue.remove(queue.peek());
+    EXPECT_EQ(0, stats.levels[0].depth);
+    EXPECT_EQ(1, stats.levels[0].num_transmitted);
+    EXPECT_EQ(300, stats.levels[0].max_latency_usec);
+    EXPECT_EQ(1, stats.levels[0].latency_histogram[1]);
+
+    clockmock.monotonic = 1400;
+    queue.remove(queue.peek());
+    EXPECT_EQ(1, stats.levels[16].num_transmitted);
+    EXPECT_EQ(399, stats.levels[16].max_latency_usec);
+    EXPECT_EQ(1, stats.levels[16].latency_histogram[1]);
+
+    // The rest of the batch expires
+    clockmock.monotonic = 1501;
+    EXPECT_FALSE(queue.peek());
+    EXPECT_EQ(0, stats.levels[16].depth);
+    EXPECT_EQ(3, stats.levels[16].peak_depth);
+    EXPECT_EQ(2, stats.levels[16].num_expired);
+    EXPECT_EQ(0, stats.levels[0].num_expired);
+    EXPECT_EQ(0, pool.getNumUsedBlocks());
+
+    // Far deadlines are limited
+    queue.push(normal, uavcan::MonotonicTime::fromUSec(1501 + CanTxQueue::MaxFrameLifetimeUSec * 2ULL), 0);
+    EXPECT_EQ(1501 + CanTxQueue::MaxFrameLifetimeUSec, queue.peek()->deadline.toUSec());
+}
+
+#endif
@@ -8,6 +8,7 @@
 
 #include <uavcan/transport/can_acceptance_filter_configurator.hpp>
 #include "../node/test_node.hpp"
+#include "transfer_test_helpers.hpp"
 #include "uavcan/node/subscriber.hpp"
 #include <uavcan/equipment/camera_gimbal/AngularCommand.hpp>
 #include <uavcan/equipment/air_data/Sideslip.hpp>
@@ -216,4 +217,192 @@ TEST(CanAcceptanceFilter, Basic_test)
     ASSERT_EQ(configure_array_2.getByIndex(3)->id, 2147745792);
     ASSERT_EQ(configure_array_2.getByIndex(3)->mask, 3774868352);
 }
+
+static bool isAcceptedByAny(const uavcan::Multiset<uavcan::CanFilterConfig>& configs, uint32_t can_id)
+{
+    for (unsigned i = 0; i < configs.getSize(); i++)
+    {
+        const uavcan::CanFilterConfig& cfg = *configs.getByIndex(i);
+        if (((can_id ^ cfg.id) & cfg.mask) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t getTotalVolume(const uavcan::Multiset<uavcan::CanFilterConfig>& configs)
+{
+    uint64_t volume = 0;
+    for (unsigned i = 0; i < configs.getSize(); i++)
+    {
+        volume += uavcan::CanAcceptanceFilterConfigurator::getAcceptedVolume(*configs.getByIndex(i));
+    }
+    return volume;
+}
+
+TEST(CanAcceptanceFilter, MergeByVolume)
+{
+    SystemClockDriver clock_driver;
+    CanDriverMock can_driver(1, clock_driver);
+    TestNode node(can_driver, clock_driver, 24);
+
+    static const uint16_t DataTypeIDs[] = { 3, 5, 6, 7, 260, 261, 1000, 1001, 1002, 20000, 20001 };
+    static const unsigned NumTypes = sizeof(DataTypeIDs) / sizeof(DataTypeIDs[0]);
+
+    std::vector<uavcan::DataTypeDescriptor> types;
+    for (unsigned i = 0; i < NumTypes; i++)
+    {
+        types.push_back(makeDataType(uavcan::DataTypeKindMessage, DataTypeIDs[i]));
+    }
+
+    typedef std::unique_ptr<TestListener> TestListenerPtr;
+    std::vector<TestListenerPtr> listeners;
+    for (unsigned i = 0; i < NumTypes; i++)
+    {
+        listeners.push_back(TestListenerPtr(new TestListener(node.getDispatcher().getTransferPerfCounter(),
+                                                             types[i], 7, node.getAllocator())));
+        ASSERT_TRUE(node.getDispatcher().registerMessageListener(listeners.back().get()));
+    }
+
+    for (uint16_t num_filters = 1; num_filters <= NumTypes + 2; num_filters++)
+    {
+        uavcan::CanAcceptanceFilterConfigurator by_rank(node, num_filters);
+        ASSERT_EQ(0, by_rank.computeConfiguration(uavcan::CanAcceptanceFilterConfigurator::IgnoreAnonymousMessages));
+
+        uavcan::CanAcceptanceFilterConfigurator by_volume(node, num_filters);
+        ASSERT_EQ(0, by_volume.computeConfiguration(uavcan::CanAcceptanceFilterConfigurator::IgnoreAnonymousMessages,
+                                                    uavcan::CanAcceptanceFilterConfigurator::MergeByVolume));
+
+        const auto& configs = by_volume.getConfiguration();
+        ASSERT_GE(num_filters, configs.getSize());
+        ASSERT_LE(getTotalVolume(configs), getTotalVolume(by_rank.getConfiguration()));
+
+        // Nothing we listen to may be rejected
+        for (unsigned i = 0; i < NumTypes; i++)
+        {
+            ASSERT_TRUE(isAcceptedByAny(configs, (uint32_t(DataTypeIDs[i]) << 8) | 42U | uavcan::CanFrame::FlagEFF));
+        }
+        ASSERT_TRUE(isAcceptedByAny(configs, (24U << 8) | (1U << 7) | 42U | uavcan::CanFrame::FlagEFF));
+    }
+
+    /*
+     * Two filters for messages, one for services: the distant data type IDs must get a filter of their own
+     */
+    uavcan::CanAcceptanceFilterConfigurator three_filters(node, 3);
+    ASSERT_EQ(0, three_filters.computeConfiguration(uavcan::CanAcceptanceFilterConfigurator::IgnoreAnonymousMessages,
+                                                    uavcan::CanAcceptanceFilterConfigurator::MergeByVolume));
+    ASSERT_FALSE(isAcceptedByAny(three_filters.getConfiguration(), (40000U << 8) | uavcan::CanFrame::FlagEFF));
+    ASSERT_FALSE(isAcceptedByAny(three_filters.getConfiguration(), (2000U << 8) | uavcan::CanFrame::FlagEFF));
+
+    for (auto& l : listeners)
+    {
+        node.getDispatcher().unregisterMessageListener(l.get());
+    }
+}
+
+TEST(CanAcceptanceFilter, AutoConfigurator)
+{
+    SystemClockDriver clock_driver;
+    CanDriverMock can_driver(1, clock_driver);
+    TestNode node(can_driver, clock_driver, 24);
+
+    const uavcan::DataTypeDescriptor msg_1_type = makeDataType(uavcan::DataTypeKindMessage, 100);
+    const uavcan::DataTypeDescriptor msg_2_type = makeDataType(uavcan::DataTypeKindMessage, 200);
+    const uavcan::DataTypeDescriptor srv_type = makeDataType(uavcan::DataTypeKindService, 10);
+
+    TestListener msg_1(node.getDispatcher().getTransferPerfCounter(), msg_1_type, 7, node.getAllocator());
+    TestListener msg_2(node.getDispatcher().getTransferPerfCounter(), msg_2_type, 7, node.getAllocator());
+    TestListener srv_resp(node.getDispatcher().getTransferPerfCounter(), srv_type, 7, node.getAllocator());
+
+    ASSERT_TRUE(node.getDispatcher().registerMessageListener(&msg_1));
+
+    uavcan::CanAcceptanceFilterAutoConfigurator auto_cfg(node, uavcan::MonotonicDuration::fromMSec(50));
+    ASSERT_FALSE(auto_cfg.isStarted());
+    ASSERT_EQ(0, auto_cfg.start());
+    ASSERT_TRUE(auto_cfg.isStarted());
+    ASSERT_EQ(1, auto_cfg.getNumReconfigurations());
+
+    /*
+     * Registrations are debounced
+     */
+    ASSERT_TRUE(node.getDispatcher().registerMessageListener(&msg_2));
+    ASSERT_EQ(1, auto_cfg.getNumReconfigurations());
+    ASSERT_LE(0, node.spin(uavcan::MonotonicDuration::fromMSec(100)));
+    ASSERT_EQ(2, auto_cfg.getNumReconfigurations());
+    ASSERT_EQ(0, auto_cfg.getLastResult());
+
+    /*
+     * Service response listeners are ignored; unchanged configuration is not reapplied
+     */
+    ASSERT_TRUE(node.getDispatcher().registerServiceResponseListener(&srv_resp));
+    node.getDispatcher().unregisterServiceResponseListener(&srv_resp);
+    node.getDispatcher().unregisterMessageListener(&msg_2);
+    ASSERT_TRUE(node.getDispatcher().registerMessageListener(&msg_2));
+    ASSERT_LE(0, node.spin(uavcan::MonotonicDuration::fromMSec(100)));
+    ASSERT_EQ(2, auto_cfg.getNumReconfigurations());
+
+    node.getDispatcher().unregisterMessageListener(&msg_2);
+    ASSERT_LE(0, node.spin(uavcan::MonotonicDuration::fromMSec(100)));
+    ASSERT_EQ(3, auto_cfg.getNumReconfigurations());
+
+    /*
+     * Stopped
+     */
+    auto_cfg.stop();
+    ASSERT_FALSE(auto_cfg.isStarted());
+    ASSERT_FALSE(node.getDispatcher().getTransferListenerRegistryObserver());
+    ASSERT_TRUE(node.getDispatcher().registerMessageListener(&msg_2));
+    ASSERT_LE(0, node.spin(uavcan::MonotonicDuration::fromMSec(100)));
+    ASSERT_EQ(3, auto_cfg.getNumReconfigurations());
+
+    node.getDispatcher().unregisterMessageListener(&msg_1);
+    node.getDispatcher().unregisterMessageListener(&msg_2);
+}
+
+static bool isAcceptedByAny(const std::vector<uavcan::CanFilterConfig>& configs, uint32_t can_id)
+{
+    for (const uavcan::CanFilterConfig& cfg : configs)
+    {
+        if (((can_id ^ cfg.id) & cfg.mask) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+TEST(CanAcceptanceFilter, AutoConfiguratorNodeIDAssignment)
+{
+    SystemClockDriver clock_driver;
+    CanDriverMock can_driver(1, clock_driver);
+    TestNode node(can_driver, clock_driver);        // Passive mode, like a node that uses dynamic node ID allocation
+    ASSERT_TRUE(node.isPassiveMode());
+
+    const uavcan::DataTypeDescriptor msg_type = makeDataType(uavcan::DataTypeKindMessage, 100);
+    TestListener msg(node.getDispatcher().getTransferPerfCounter(), msg_type, 7, node.getAllocator());
+    ASSERT_TRUE(node.getDispatcher().registerMessageListener(&msg));
+
+    uavcan::CanAcceptanceFilterAutoConfigurator auto_cfg(node, uavcan::MonotonicDuration::fromMSec(50));
+    ASSERT_EQ(0, auto_cfg.start());
+    ASSERT_EQ(1, auto_cfg.getNumReconfigurations());
+
+    // Service request 10 from node 42 to node 24
+    const uint32_t request_can_id = (10U << 16) | (1U << 15) | (24U << 8) | (1U << 7) | 42U | uavcan::CanFrame::FlagEFF;
+    ASSERT_FALSE(isAcceptedByAny(can_driver.ifaces.at(0).filters, request_can_id));
+
+    /*
+     * The filters are reconfigured as soon as the node ID is assigned, without waiting for the debounce delay
+     */
+    ASSERT_TRUE(node.setNodeID(24));
+    ASSERT_EQ(2, auto_cfg.getNumReconfigurations());
+    ASSERT_EQ(0, auto_cfg.getLastResult());
+    ASSERT_TRUE(isAcceptedByAny(can_driver.ifaces.at(0).filters, request_can_id));
+    ASSERT_TRUE(isAcceptedByAny(can_driver.ifaces.at(0).filters, (100U << 8) | 42U | uavcan::CanFrame::FlagEFF));
+
+    ASSERT_LE(0, node.spin(uavcan::MonotonicDuration::fromMSec(100)));
+    ASSERT_EQ(2, auto_cfg.getNumReconfigurations());
+
+    node.getDispatcher().unregisterMessageListener(&msg);
+}
 #endif
@@ -30,3 +30,40 @@ TEST(TransferCRC, Correctness)
     crc.add(reinterpret_cast<const uint8_t*>("456789"), 6);
     ASSERT_EQ(0x29B1, crc.get());
 }
+
+/*
+ * Block updates must give the same result as byte-by-byte updates, whichever implementation is enabled.
+ */
+TEST(TransferCRC, BlockMatchesBytewise)
+{
+    uint8_t data[100];
+    for (unsigned i = 0; i < sizeof(data); i++)
+    {
+        data[i] = uint8_t(i * 37U + 11U);
+    }
+
+    for (unsigned offset = 0; offset < 8; offset++)
+    {
+        for (unsigned len = 0; len <= (sizeof(data) - offset); len++)
+        {
+            uavcan::TransferCRC crc16, ref16;
+            uavcan::TransferCRC32 crc32, ref32;
+            uavcan::TransferCRC48 crc48, ref48;
+
+            crc16.add(data + offset, len);
+            crc32.add(data + offset, len);
+            crc48.add(data + offset, len);
+
+            for (unsigned i = 0; i < len; i++)
+            {
+                ref16.add(data[offset + i]);
+                ref32.add(data[offset + i]);
+                ref48.add(data[offset + i]);
+            }
+
+            ASSERT_EQ(ref16.get(), crc16.get()) << "len " << len;
+            ASSERT_EQ(ref32.get(), crc32.get()) << "len " << len;
+            ASSERT_EQ(ref48.get() ^ 0x130edf575accULL, crc48.get()) << "len " << len;   // Output XOR per call
+        }
+    }
+}
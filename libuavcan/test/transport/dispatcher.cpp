@@ -332,6 +332,212 @@ TEST(Dispatcher, Spin)
 }
 
 
+TEST(Dispatcher, FrameFormat)
+{
+    uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 8, uavcan::MemPoolBlockSize> pool;
+
+    SystemClockMock clockmock(100);
+    CanDriverMock driver(1, clockmock);
+
+    uavcan::Dispatcher dispatcher(driver, pool, clockmock);
+    ASSERT_TRUE(dispatcher.setNodeID(SELF_NODE_ID));
+
+    const uavcan::DataTypeDescriptor srv_type = makeDataType(uavcan::DataTypeKindService, 1);
+    TestListener srv_listener(dispatcher.getTransferPerfCounter(), srv_type, 7, pool);
+    ASSERT_TRUE(dispatcher.registerServiceRequestListener(&srv_listener));
+
+    uavcan::Frame frame(srv_type.getID(), uavcan::TransferTypeServiceRequest, 10, SELF_NODE_ID, 0);
+    frame.setStartOfTransfer(true);
+    frame.setEndOfTransfer(true);
+    frame.setPayload(reinterpret_cast<const uint8_t*>("123"), 3);
+
+    uavcan::CanFrame can_frame;
+    ASSERT_TRUE(ScrambledFrameFormat::compile(frame, can_frame));
+
+    /*
+     * The standard codec decodes a different data type ID, nobody listens to it
+     */
+    uavcan::RxFrame rx_frame;
+    driver.ifaces.at(0).pushRx(can_frame);
+    ASSERT_EQ(1, dispatcher.spinOnce(rx_frame));
+    ASSERT_TRUE(srv_listener.isEmpty());
+
+    /*
+     * The codec of the format is used to decode the frames
+     */
+    driver.ifaces.at(0).pushRx(can_frame);
+    ASSERT_EQ(1, dispatcher.spinOnce<ScrambledFrameFormat>(rx_frame));
+    ASSERT_FALSE(srv_listener.isEmpty());
+    ASSERT_EQ(srv_type.getID(), rx_frame.getDataTypeID());
+    ASSERT_EQ(1, dispatcher.getTransferPerfCounter().getRxTransferCount());
+
+    /*
+     * Transmission
+     */
+    uavcan::Frame tx_frame(srv_type.getID(), uavcan::TransferTypeServiceResponse, SELF_NODE_ID, 10, 0);
+    tx_frame.setStartOfTransfer(true);
+    tx_frame.setEndOfTransfer(true);
+
+    ASSERT_EQ(1, dispatcher.send<ScrambledFrameFormat>(tx_frame, tsMono(1000), tsMono(0), 0, 0xFF));
+
+    uavcan::CanFrame expected_can_frame;
+    ASSERT_TRUE(ScrambledFrameFormat::compile(tx_frame, expected_can_frame));
+    ASSERT_TRUE(driver.ifaces.at(0).matchAndPopTx(expected_can_frame, tsMono(1000)));
+}
+
+
+TEST(Dispatcher, ManyListeners)
+{
+    uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 100, uavcan::MemPoolBlockSize> pool;
+
+    SystemClockMock clockmock(100);
+    CanDriverMock driver(2, clockmock);
+
+    uavcan::Dispatcher dispatcher(driver, pool, clockmock);
+    ASSERT_TRUE(dispatcher.setNodeID(SELF_NODE_ID));
+
+    DispatcherTransferEmulator emulator(driver, SELF_NODE_ID);
+
+    /*
+     * More distinct data type IDs than the listener index can hold, two listeners per data type
+     */
+    typedef std::unique_ptr<TestListener> TestListenerPtr;
+    static const unsigned NumTypes = 100;
+    std::vector<uavcan::DataTypeDescriptor> types;
+    std::vector<TestListenerPtr> listeners;
+    for (unsigned i = 0; i < NumTypes; i++)
+    {
+        types.push_back(makeDataType(uavcan::DataTypeKindMessage, uint16_t(i * 7 + 3)));
+    }
+    for (unsigned i = 0; i < NumTypes * 2; i++)
+    {
+        listeners.push_back(TestListenerPtr(new TestListener(dispatcher.getTransferPerfCounter(),
+                                                             types[i % NumTypes], 7, pool)));
+    }
+
+    // Registering in the reverse order to exercise insertion at the head
+    for (unsigned i = NumTypes * 2; i > 0; i--)
+    {
+        ASSERT_TRUE(dispatcher.registerMessageListener(listeners[i - 1].get()));
+    }
+    ASSERT_EQ(NumTypes * 2, dispatcher.getNumMessageListeners());
+
+    for (unsigned i = 0; i < NumTypes; i++)
+    {
+        ASSERT_TRUE(dispatcher.hasSubscriber(types[i].getID()));
+        ASSERT_FALSE(dispatcher.hasSubscriber(uavcan::DataTypeID(uint16_t(i * 7 + 4))));
+    }
+
+    // Unregistering most of the types so that the rest fits the index
+    for (unsigned i = 0; i < NumTypes * 2; i++)
+    {
+        if ((i % NumTypes) >= 10)
+        {
+            dispatcher.unregisterMessageListener(listeners[i].get());
+        }
+    }
+    ASSERT_EQ(20, dispatcher.getNumMessageListeners());
+
+    for (unsigned i = 0; i < NumTypes; i++)
+    {
+        ASSERT_EQ(i < 10, dispatcher.hasSubscriber(types[i].getID()));
+    }
+
+    /*
+     * Delivery
+     */
+    const Transfer transfers[3] =
+    {
+        emulator.makeTransfer(0, uavcan::TransferTypeMessageBroadcast, 10, "abc", types[0]),
+        emulator.makeTransfer(0, uavcan::TransferTypeMessageBroadcast, 11, "def", types[9]),
+        emulator.makeTransfer(0, uavcan::TransferTypeMessageBroadcast, 12, "ghi", types[50])   // Not listened to
+    };
+    emulator.send(transfers);
+
+    while (dispatcher.spinOnce() > 0)
+    {
+        clockmock.advance(100);
+    }
+
+    ASSERT_TRUE(listeners[0]->matchAndPop(transfers[0]));
+    ASSERT_TRUE(listeners[NumTypes]->matchAndPop(transfers[0]));
+    ASSERT_TRUE(listeners[9]->matchAndPop(transfers[1]));
+    ASSERT_TRUE(listeners[NumTypes + 9]->matchAndPop(transfers[1]));
+
+    for (unsigned i = 0; i < NumTypes * 2; i++)
+    {
+        ASSERT_TRUE(listeners[i]->isEmpty());
+    }
+    EXPECT_EQ(4, dispatcher.getTransferPerfCounter().getRxTransferCount());
+}
+
+
+TEST(Dispatcher, RxPrefilter)
+{
+    uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 100, uavcan::MemPoolBlockSize> pool;
+
+    SystemClockMock clockmock(100);
+    CanDriverMock driver(2, clockmock);
+
+    uavcan::Dispatcher dispatcher(driver, pool, clockmock);
+    ASSERT_TRUE(dispatcher.setNodeID(SELF_NODE_ID));
+
+    DispatcherTransferEmulator emulator(driver, SELF_NODE_ID);
+
+    RxFrameListener rx_listener;
+    dispatcher.installRxFrameListener(&rx_listener);
+
+    const uavcan::DataTypeDescriptor msg_type = makeDataType(uavcan::DataTypeKindMessage, 3);
+    const uavcan::DataTypeDescriptor srv_type = makeDataType(uavcan::DataTypeKindService, 5);
+
+    TestListener msg_listener(dispatcher.getTransferPerfCounter(), msg_type, 7, pool);
+    TestListener srv_listener(dispatcher.getTransferPerfCounter(), srv_type, 7, pool);
+    ASSERT_TRUE(dispatcher.registerMessageListener(&msg_listener));
+    ASSERT_TRUE(dispatcher.registerServiceRequestListener(&srv_listener));
+
+    /*
+     * Only the transfers that have listeners are delivered; the RX frame listener still gets all of them
+     */
+    const Transfer transfers[5] =
+    {
+        emulator.makeTransfer(0, uavcan::TransferTypeMessageBroadcast, 10, "abc", msg_type),
+        emulator.makeTransfer(0, uavcan::TransferTypeMessageBroadcast, 11, "def",
+                              makeDataType(uavcan::DataTypeKindMessage, 4)),               // Not listened to
+        emulator.makeTransfer(0, uavcan::TransferTypeServiceRequest, 12, "ghi", srv_type),
+        emulator.makeTransfer(0, uavcan::TransferTypeServiceRequest, 13, "jkl", srv_type, 100), // Foreign node
+        emulator.makeTransfer(0, uavcan::TransferTypeServiceResponse, 14, "mno", srv_type)      // Not listened to
+    };
+    emulator.send(transfers);
+
+    while (dispatcher.spinOnce() > 0)
+    {
+        clockmock.advance(100);
+    }
+
+    ASSERT_TRUE(msg_listener.matchAndPop(transfers[0]));
+    ASSERT_TRUE(srv_listener.matchAndPop(transfers[2]));
+    ASSERT_TRUE(msg_listener.isEmpty());
+    ASSERT_TRUE(srv_listener.isEmpty());
+    EXPECT_EQ(2, dispatcher.getTransferPerfCounter().getRxTransferCount());
+    EXPECT_EQ(5U, rx_listener.rx_frames.size());
+
+    /*
+     * Unregistered listeners are filtered out as well
+     */
+    dispatcher.unregisterMessageListener(&msg_listener);
+
+    const Transfer transfer = emulator.makeTransfer(0, uavcan::TransferTypeMessageBroadcast, 10, "pqr", msg_type);
+    emulator.send(&transfer, 1);
+    while (dispatcher.spinOnce() > 0)
+    {
+        clockmock.advance(100);
+    }
+    ASSERT_TRUE(msg_listener.isEmpty());
+    EXPECT_EQ(2, dispatcher.getTransferPerfCounter().getRxTransferCount());
+
+    dispatcher.unregisterServiceRequestListener(&srv_listener);
+}
+
 struct DispatcherTestLoopbackFrameListener : public uavcan::LoopbackFrameListenerBase
 {
     uavcan::RxFrame last_frame;
@@ -3,11 +3,17 @@
  */
 
 #include <string>
+#include <iostream>
 #include <gtest/gtest.h>
 #include <uavcan/transport/transfer.hpp>
 #include <uavcan/transport/crc.hpp>
 #include "../clock.hpp"
 #include "can/can.hpp"
+#include "transfer_test_helpers.hpp"
+
+#if UAVCAN_CPP_VERSION >= UAVCAN_CPP11
+# include <type_traits>
+#endif
 
 
 TEST(Frame, MessageParseCompile)
@@ -347,6 +353,113 @@ TEST(Frame, RxFrameParse)
 }
 
 
+TEST(Frame, FormatCodec)
+{
+    using uavcan::Frame;
+    using uavcan::RxFrame;
+    using uavcan::CanFrame;
+    using uavcan::CanRxFrame;
+
+    Frame frame(42, uavcan::TransferTypeServiceRequest, 1, 2, 3);
+    frame.setStartOfTransfer(true);
+    frame.setEndOfTransfer(true);
+    const uint8_t payload[] = { 1, 2, 3 };
+    frame.setPayload(payload, sizeof(payload));
+
+    // The standard policy is the frame codec itself
+    CanFrame expected;
+    ASSERT_TRUE(frame.compile(expected));
+    CanFrame can_frame;
+    ASSERT_TRUE(uavcan::StandardFrameFormat::compile(frame, can_frame));
+    ASSERT_TRUE(expected == can_frame);
+
+    // Proprietary codec
+    CanRxFrame can_rx_frame;
+    ASSERT_TRUE(ScrambledFrameFormat::compile(frame, can_rx_frame));
+    ASSERT_EQ(expected.id ^ ScrambledFrameFormat::ScrambleMask, can_rx_frame.id);
+    can_rx_frame.ts_mono = tsMono(123);
+    can_rx_frame.iface_index = 1;
+
+    RxFrame rx_frame(3);
+    ASSERT_TRUE(rx_frame.parse<ScrambledFrameFormat>(can_rx_frame));
+    ASSERT_TRUE(frame == rx_frame);
+    ASSERT_EQ(3, rx_frame.getFrameType());                          // Not touched by the codec
+    ASSERT_EQ(123, rx_frame.getMonotonicTimestamp().toUSec());
+    ASSERT_EQ(1, rx_frame.getIfaceIndex());
+
+    // The standard codec can't make sense of it
+    ASSERT_TRUE(rx_frame.parse(can_rx_frame));
+    ASSERT_NE(42, rx_frame.getDataTypeID().get());
+}
+
+
+TEST(Frame, CanIdTemplate)
+{
+    using uavcan::Frame;
+    using uavcan::CanFrame;
+
+    const uint8_t payload[] = { 1, 2, 3, 4, 5 };
+
+    /*
+     * Template must not depend on the tail byte or the payload
+     */
+    Frame frame(123, uavcan::TransferTypeServiceRequest, 42, 21, 7);
+    frame.setPriority(uavcan::TransferPriority::MiddleLower);
+    frame.setStartOfTransfer(true);
+    frame.setPayload(payload, sizeof(payload));
+
+    const uint32_t can_id_template = frame.makeCanIdTemplate();
+    ASSERT_NE(0, can_id_template);
+
+    CanFrame reference;
+    CanFrame templated;
+    ASSERT_TRUE(frame.compile(reference));
+    ASSERT_TRUE(frame.compile(templated, can_id_template));
+    ASSERT_EQ(reference, templated);
+
+    frame.setStartOfTransfer(false);
+    frame.setEndOfTransfer(true);
+    frame.flipToggle();
+    frame.setTransferID(8);
+    frame.setPayload(payload, 2);
+    ASSERT_EQ(can_id_template, frame.makeCanIdTemplate());
+
+    ASSERT_TRUE(frame.compile(reference));
+    ASSERT_TRUE(frame.compile(templated, can_id_template));
+    ASSERT_EQ(reference, templated);
+
+    /*
+     * Anonymous frames - the discriminator is added on top of the template
+     */
+    Frame anon(3, uavcan::TransferTypeMessageBroadcast, uavcan::NodeID::Broadcast, uavcan::NodeID::Broadcast, 0);
+    anon.setPayload(payload, sizeof(payload));
+
+    // The template is computed before the end of transfer flag is known, like TransferSender does
+    anon.setStartOfTransfer(true);
+    ASSERT_FALSE(anon.isValid());
+    ASSERT_TRUE(anon.isHeaderValid());
+    const uint32_t anon_can_id_template = anon.makeCanIdTemplate();
+    ASSERT_NE(0, anon_can_id_template);
+
+    anon.setEndOfTransfer(true);
+    ASSERT_EQ(anon_can_id_template, anon.makeCanIdTemplate());
+    ASSERT_TRUE(anon.compile(reference));
+    ASSERT_TRUE(anon.compile(templated, anon_can_id_template));
+    ASSERT_EQ(reference, templated);
+
+    // Anonymous service transfers are invalid regardless of the tail byte
+    Frame anon_service(3, uavcan::TransferTypeServiceRequest, uavcan::NodeID::Broadcast, 42, 0);
+    anon_service.setStartOfTransfer(true);
+    anon_service.setEndOfTransfer(true);
+    ASSERT_EQ(0, anon_service.makeCanIdTemplate());
+
+    /*
+     * Invalid frame
+     */
+    ASSERT_EQ(0, Frame().makeCanIdTemplate());
+}
+
+
 TEST(Frame, FrameToString)
 {
     using uavcan::Frame;
@@ -387,3 +500,39 @@ TEST(Frame, FrameToString)
     EXPECT_EQ("prio=31 dtid=65535 tt=2 snid=127 dnid=0 sot=1 eot=1 togl=1 tid=31 payload=[00 01 02 03 04 05 06]",
               frame.toString());
 }
+
+
+TEST(Frame, Layout)
+{
+    using uavcan::Frame;
+    using uavcan::RxFrame;
+
+#if UAVCAN_CPP_VERSION >= UAVCAN_CPP11
+    static_assert(std::is_trivially_copyable<Frame>::value, "Frame must be trivially copyable");
+    static_assert(std::is_trivially_copyable<RxFrame>::value, "RxFrame must be trivially copyable");
+#endif
+
+    std::cout << "sizeof(Frame): " << sizeof(Frame) << ", sizeof(RxFrame): " << sizeof(RxFrame) << std::endl;
+
+    // No vtable, no padding between the fields; the tail may be padded up to the alignment of the struct
+    ASSERT_GE((Frame::PayloadCapacity + 16U + 7U) / 8U * 8U, sizeof(Frame));
+    ASSERT_GE(sizeof(Frame) + 24U, sizeof(RxFrame));
+
+    // Copies preserve everything, including the bit flags
+    Frame frame(123, uavcan::TransferTypeServiceRequest, 1, 2, 3);
+    frame.setStartOfTransfer(false);
+    frame.setEndOfTransfer(true);
+    frame.flipToggle();
+    const uint8_t payload[] = { 1, 2, 3 };
+    frame.setPayload(payload, sizeof(payload));
+
+    const RxFrame rx_frame(frame, tsMono(10), tsUtc(20), 1);
+    ASSERT_TRUE(frame == rx_frame);
+    ASSERT_FALSE(rx_frame.isStartOfTransfer());
+    ASSERT_TRUE(rx_frame.isEndOfTransfer());
+    ASSERT_TRUE(rx_frame.getToggle());
+    ASSERT_EQ(uavcan::TransferTypeServiceRequest, rx_frame.getTransferType());
+    ASSERT_EQ(tsMono(10), rx_frame.getMonotonicTimestamp());
+    ASSERT_EQ(tsUtc(20), rx_frame.getUtcTimestamp());
+    ASSERT_EQ(1, rx_frame.getIfaceIndex());
+}
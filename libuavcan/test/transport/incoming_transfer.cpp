@@ -108,3 +108,67 @@ TEST(MultiFrameIncomingTransfer, Basic)
     it.release();
     ASSERT_FALSE(bufmgr.access(bufmgr_key));
 }
+
+
+TEST(IncomingTransfer, PayloadView)
+{
+    using uavcan::RxFrame;
+
+    const RxFrame frame = makeFrame();
+    uint8_t storage[32];
+    unsigned len = 0;
+
+    /*
+     * Single frame transfers are viewed in place
+     */
+    uavcan::SingleFrameIncomingTransfer sft(frame);
+    ASSERT_EQ(frame.getPayloadPtr(), sft.getPayloadView(len, storage, sizeof(storage)));
+    ASSERT_EQ(frame.getPayloadLen(), len);
+    ASSERT_EQ(frame.getPayloadPtr(), sft.getPayloadView(len, UAVCAN_NULLPTR, 0));
+
+    /*
+     * Multi frame transfers are flattened into the storage
+     */
+    uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 100, uavcan::MemPoolBlockSize> poolmgr;
+    uavcan::TransferBufferManager bufmgr(256, poolmgr);
+    uavcan::TransferBufferManagerKey bufmgr_key(frame.getSrcNodeID(), frame.getTransferType());
+    uavcan::TransferBufferAccessor tba(bufmgr, bufmgr_key);
+    uavcan::MultiFrameIncomingTransfer mft(frame.getMonotonicTimestamp(), frame.getUtcTimestamp(), frame, tba);
+
+    ASSERT_FALSE(mft.getPayloadView(len, storage, sizeof(storage)));      // No buffer
+
+    const std::string data = "The payload is spread over several memory blocks";
+    const uint8_t* const data_ptr = reinterpret_cast<const uint8_t*>(data.c_str());
+    ASSERT_TRUE(bufmgr.create(bufmgr_key));
+    ASSERT_EQ(data.length(), bufmgr.access(bufmgr_key)->write(0, data_ptr, unsigned(data.length())));
+
+    ASSERT_FALSE(mft.getContiguousPayload(len));
+    ASSERT_FALSE(mft.getPayloadView(len, UAVCAN_NULLPTR, 0));
+    ASSERT_FALSE(mft.getPayloadView(len, storage, sizeof(storage)));      // Too small
+
+    uint8_t large_storage[64];
+    ASSERT_EQ(large_storage, mft.getPayloadView(len, large_storage, sizeof(large_storage)));
+    ASSERT_EQ(data.length(), len);
+    ASSERT_TRUE(std::equal(data_ptr, data_ptr + len, large_storage));
+
+    // Flattened once, subsequent calls return the same view
+    len = 0;
+    ASSERT_EQ(large_storage, mft.getPayloadView(len, storage, sizeof(storage)));
+    ASSERT_EQ(data.length(), len);
+    len = 0;
+    ASSERT_EQ(large_storage, mft.getContiguousPayload(len));
+    ASSERT_EQ(data.length(), len);
+
+    // The view survives the buffer release
+    mft.release();
+    ASSERT_FALSE(bufmgr.access(bufmgr_key));
+    ASSERT_EQ(large_storage, mft.getPayloadView(len, UAVCAN_NULLPTR, 0));
+
+    // Exact fit
+    uavcan::MultiFrameIncomingTransfer mft2(frame.getMonotonicTimestamp(), frame.getUtcTimestamp(), frame, tba);
+    ASSERT_TRUE(bufmgr.create(bufmgr_key));
+    ASSERT_EQ(data.length(), bufmgr.access(bufmgr_key)->write(0, data_ptr, unsigned(data.length())));
+    ASSERT_EQ(large_storage, mft2.getPayloadView(len, large_storage, unsigned(data.length())));
+    ASSERT_EQ(data.length(), len);
+    mft2.release();
+}
@@ -3,6 +3,7 @@
  */
 
 #include <algorithm>
+#include <vector>
 #include <gtest/gtest.h>
 #include <uavcan/transport/outgoing_transfer_registry.hpp>
 #include "../clock.hpp"
@@ -12,8 +13,7 @@
 TEST(OutgoingTransferRegistry, Basic)
 {
     using uavcan::OutgoingTransferRegistryKey;
-    uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 2, uavcan::MemPoolBlockSize> poolmgr;
-    uavcan::OutgoingTransferRegistry otr(poolmgr);
+    uavcan::OutgoingTransferRegistry otr;
 
     otr.cleanup(tsMono(1000));
 
@@ -31,7 +31,7 @@ TEST(OutgoingTransferRegistry, Basic)
     ASSERT_EQ(0, otr.accessOrCreate(keys[1], tsMono(1000000))->get());
     ASSERT_EQ(0, otr.accessOrCreate(keys[2], tsMono(1000000))->get());
     ASSERT_EQ(0, otr.accessOrCreate(keys[3], tsMono(1000000))->get());
-    ASSERT_FALSE(otr.accessOrCreate(keys[4], tsMono(1000000)));        // OOM
+    ASSERT_EQ(4, otr.getSize());
 
     /*
      * Incrementing a little
@@ -50,8 +50,6 @@ TEST(OutgoingTransferRegistry, Basic)
 
     ASSERT_EQ(0, otr.accessOrCreate(keys[1], tsMono(4000000))->get());
 
-    ASSERT_FALSE(otr.accessOrCreate(keys[4], tsMono(1000000)));        // Still OOM
-
     /*
      * Checking existence
      * Exist: 0, 1, 2, 3
@@ -85,6 +83,70 @@ TEST(OutgoingTransferRegistry, Basic)
 
     ASSERT_EQ(2, otr.accessOrCreate(keys[2], tsMono(1000000))->get());
 
-    otr.cleanup(tsMono(5000001));    // Frees some memory for 4
+    otr.cleanup(tsMono(5000001));    // Kills all
+    ASSERT_EQ(0, otr.getSize());
     ASSERT_EQ(0, otr.accessOrCreate(keys[0], tsMono(1000000))->get());
+    ASSERT_EQ(0, otr.accessOrCreate(keys[4], tsMono(1000000))->get());
+}
+
+
+TEST(OutgoingTransferRegistry, Capacity)
+{
+    using uavcan::OutgoingTransferRegistryKey;
+    uavcan::OutgoingTransferRegistry otr;
+
+    const unsigned Capacity = uavcan::OutgoingTransferRegistry::Capacity;
+
+    /*
+     * Filling up; every entry keeps a distinct transfer ID in order to detect mixups when entries are moved around
+     */
+    std::vector<OutgoingTransferRegistryKey> keys;
+    for (unsigned i = 0; keys.size() < Capacity; i++)
+    {
+        keys.push_back(OutgoingTransferRegistryKey(uavcan::DataTypeID(uint16_t(i / 100)),
+                                                   uavcan::TransferTypeServiceRequest,
+                                                   uavcan::NodeID(uint8_t(1 + i % 100))));
+    }
+    for (unsigned i = 0; i < Capacity; i++)
+    {
+        uavcan::TransferID* const tid = otr.accessOrCreate(keys[i], tsMono(1000000 + i));
+        ASSERT_TRUE(tid);
+        ASSERT_EQ(0, tid->get());
+        for (unsigned k = 0; k < (i % 32); k++)
+        {
+            tid->increment();
+        }
+    }
+    ASSERT_EQ(Capacity, otr.getSize());
+
+    const OutgoingTransferRegistryKey extra(1234, uavcan::TransferTypeMessageBroadcast, uavcan::NodeID::Broadcast);
+    ASSERT_FALSE(otr.accessOrCreate(extra, tsMono(2000000)));      // Full
+    ASSERT_FALSE(otr.exists(1234, uavcan::TransferTypeMessageBroadcast));
+
+    /*
+     * Nothing expires before the earliest deadline
+     */
+    otr.cleanup(tsMono(999999));
+    ASSERT_EQ(Capacity, otr.getSize());
+
+    /*
+     * Every other entry expires; the rest must keep their transfer IDs
+     */
+    for (unsigned i = 0; i < Capacity; i += 2)
+    {
+        ASSERT_EQ(i % 32, otr.accessOrCreate(keys[i], tsMono(3000000 + i))->get());
+    }
+    otr.cleanup(tsMono(2500000));
+    ASSERT_EQ((Capacity + 1) / 2, otr.getSize());
+
+    for (unsigned i = 0; i < Capacity; i++)
+    {
+        ASSERT_EQ(((i % 2) == 0) ? (i % 32) : 0, otr.accessOrCreate(keys[i], tsMono(4000000))->get());
+    }
+    ASSERT_EQ(Capacity, otr.getSize());
+
+    otr.cleanup(tsMono(4000000));
+    ASSERT_EQ(0, otr.getSize());
+    ASSERT_EQ(0, otr.accessOrCreate(extra, tsMono(5000000))->get());
+    ASSERT_TRUE(otr.exists(1234, uavcan::TransferTypeMessageBroadcast));
 }
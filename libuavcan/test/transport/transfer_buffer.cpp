@@ -16,7 +16,11 @@ static const std::string TEST_DATA =
     "place, and if he had not had Toulon nor Egypt nor the passage of Mont Blanc to begin his career with, but "
     "instead of all those picturesque and monumental things, there had simply been some ridiculous old hag, a "
     "pawnbroker, who had to be murdered too to get money from her trunk (for his career, you understand). "
-    "Well, would he have brought himself to that if there had been no other means?";
+    "Well, would he have brought himself to that if there had been no other means? Wouldn't he have felt a pang "
+    "at its being so far from monumental and... and sinful, too? Well, I must tell you that I worried myself "
+    "fearfully over that 'question' so that I was awfully ashamed when I guessed at last (all of a sudden, somehow) "
+    "that it would not have given him the least pang, that it would not even have struck him that it was not "
+    "monumental... that he would not have seen that there was anything in it to pause over.";
 
 template <typename T, unsigned Size>
 static bool allEqual(const T (&a)[Size])
@@ -316,3 +320,74 @@ TEST(TransferBufferManager, Basic)
     mgr.reset();
     ASSERT_EQ(0, pool.getNumUsedBlocks());
 }
+
+
+#if UAVCAN_TRANSFER_BUFFER_ARENA_SLOTS > 0
+
+TEST(TransferBufferManager, Arena)
+{
+    using uavcan::TransferBufferManager;
+    using uavcan::TransferBufferManagerKey;
+    using uavcan::ITransferBuffer;
+
+    static const int POOL_BLOCKS = 100;
+    static const unsigned NumSlots = uavcan::TransferBufferArena::NumSlots;
+    uavcan::PoolAllocator<uavcan::MemPoolBlockSize * POOL_BLOCKS, uavcan::MemPoolBlockSize> pool;
+    uavcan::TransferBufferArena arena(MGR_MAX_BUFFER_SIZE);
+
+    std::unique_ptr<TransferBufferManager> mgr(new TransferBufferManager(MGR_MAX_BUFFER_SIZE, pool, &arena));
+
+    ITransferBuffer* tbb = UAVCAN_NULLPTR;
+    unsigned len = 0;
+
+    // All slots are taken by the buffers, only the buffer objects themselves come from the pool
+    for (unsigned i = 0; i < NumSlots; i++)
+    {
+        const TransferBufferManagerKey key(uint8_t(i + 1), uavcan::TransferTypeMessageBroadcast);
+        ASSERT_TRUE((tbb = mgr->create(key)));
+        ASSERT_FALSE(mgr->accessContiguous(key, len));                  // Nothing written yet
+        ASSERT_EQ(MGR_MAX_BUFFER_SIZE, fillTestData(MGR_TEST_DATA[i % 4], tbb));
+        ASSERT_EQ(i + 1, arena.getNumUsedSlots());
+        ASSERT_EQ(i + 1, pool.getNumUsedBlocks());
+
+        const uint8_t* const data = mgr->accessContiguous(key, len);
+        ASSERT_TRUE(data);
+        ASSERT_EQ(MGR_MAX_BUFFER_SIZE, len);
+        ASSERT_TRUE(std::equal(data, data + len, MGR_TEST_DATA[i % 4].begin()));
+    }
+
+    // The arena is exhausted, falling back to the memory pool
+    const TransferBufferManagerKey extra_key(127, uavcan::TransferTypeServiceRequest);
+    ASSERT_TRUE((tbb = mgr->create(extra_key)));
+    ASSERT_EQ(MGR_MAX_BUFFER_SIZE, fillTestData(MGR_TEST_DATA[3], tbb));
+    ASSERT_EQ(NumSlots, arena.getNumUsedSlots());
+    ASSERT_LT(NumSlots + 1, pool.getNumUsedBlocks());
+    ASSERT_FALSE(mgr->accessContiguous(extra_key, len));
+    ASSERT_TRUE(matchAgainst(MGR_TEST_DATA[3], *tbb));
+
+    // Random access within the arena
+    const TransferBufferManagerKey first_key(1, uavcan::TransferTypeMessageBroadcast);
+    ASSERT_TRUE((tbb = mgr->access(first_key)));
+    ASSERT_TRUE(matchAgainst(MGR_TEST_DATA[0], *tbb));
+    uint8_t byte = 0;
+    ASSERT_EQ(1, tbb->read(MGR_MAX_BUFFER_SIZE - 1, &byte, 1));
+    ASSERT_EQ(uint8_t(MGR_TEST_DATA[0][MGR_MAX_BUFFER_SIZE - 1]), byte);
+    ASSERT_EQ(0, tbb->read(MGR_MAX_BUFFER_SIZE, &byte, 1));
+    ASSERT_EQ(0, tbb->write(MGR_MAX_BUFFER_SIZE, &byte, 1));
+
+    // Released slots are reused
+    mgr->remove(first_key);
+    ASSERT_EQ(NumSlots - 1, arena.getNumUsedSlots());
+    ASSERT_TRUE((tbb = mgr->create(first_key)));
+    ASSERT_EQ(10, tbb->write(5, reinterpret_cast<const uint8_t*>(MGR_TEST_DATA[1].c_str()), 10));
+    ASSERT_EQ(NumSlots, arena.getNumUsedSlots());
+    ASSERT_TRUE(mgr->accessContiguous(first_key, len));
+    ASSERT_EQ(15, len);
+
+    // Deleting the object; all memory must be freed
+    mgr.reset();
+    ASSERT_EQ(0, pool.getNumUsedBlocks());
+    ASSERT_EQ(0, arena.getNumUsedSlots());
+}
+
+#endif
@@ -6,6 +6,21 @@
 #include "transfer_test_helpers.hpp"
 #include "../clock.hpp"
 
+/**
+ * The test payloads are repeated this many times, so that the transfers take as many frames in the CAN FD mode
+ * as they do with classic CAN, where a frame carries 7 bytes of a multi-frame transfer.
+ */
+static const unsigned PayloadScale = unsigned(uavcan::Frame::PayloadCapacity) / 7U;
+
+static std::string scalePayload(const std::string& payload)
+{
+    std::string out;
+    for (unsigned i = 0; i < PayloadScale; i++)
+    {
+        out += payload;
+    }
+    return out;
+}
 
 class TransferListenerEmulator : public IncomingTransferEmulatorBase
 {
@@ -38,7 +53,7 @@ TEST(TransferListener, BasicMFT)
     uavcan::PoolAllocator<uavcan::MemPoolBlockSize * NUM_POOL_BLOCKS, uavcan::MemPoolBlockSize> pool;
 
     uavcan::TransferPerfCounter perf;
-    TestListener subscriber(perf, type, 256, pool);
+    TestListener subscriber(perf, type, uint16_t(256 * PayloadScale), pool);
 
     /*
      * Test data
@@ -66,11 +81,11 @@ TEST(TransferListener, BasicMFT)
     TransferListenerEmulator emulator(subscriber, type);
     const Transfer transfers[] =
     {
-        emulator.makeTransfer(16, uavcan::TransferTypeMessageBroadcast, 1, DATA[0]),
-        emulator.makeTransfer(16, uavcan::TransferTypeMessageBroadcast, 2, DATA[1]),   // Same NID
-        emulator.makeTransfer(16, uavcan::TransferTypeMessageBroadcast, 3, DATA[2]),
-        emulator.makeTransfer(16, uavcan::TransferTypeServiceRequest,   4, DATA[3]),
-        emulator.makeTransfer(16, uavcan::TransferTypeServiceResponse,  5, DATA[4]),
+        emulator.makeTransfer(16, uavcan::TransferTypeMessageBroadcast, 1, scalePayload(DATA[0])),
+        emulator.makeTransfer(16, uavcan::TransferTypeMessageBroadcast, 2, scalePayload(DATA[1])),   // Same NID
+        emulator.makeTransfer(16, uavcan::TransferTypeMessageBroadcast, 3, scalePayload(DATA[2])),
+        emulator.makeTransfer(16, uavcan::TransferTypeServiceRequest,   4, scalePayload(DATA[3])),
+        emulator.makeTransfer(16, uavcan::TransferTypeServiceResponse,  5, scalePayload(DATA[4])),
     };
 
     /*
@@ -102,7 +117,8 @@ TEST(TransferListener, CrcFailure)
      * Generating transfers with damaged payload (CRC is not valid)
      */
     TransferListenerEmulator emulator(subscriber, type);
-    const Transfer tr_mft = emulator.makeTransfer(16, uavcan::TransferTypeMessageBroadcast, 42, "123456789abcdefghik");
+    const Transfer tr_mft = emulator.makeTransfer(16, uavcan::TransferTypeMessageBroadcast, 42,
+                                                  scalePayload("123456789abcdefghik"));
     const Transfer tr_sft = emulator.makeTransfer(16, uavcan::TransferTypeMessageBroadcast, 11, "abcd");
 
     std::vector<uavcan::RxFrame> ser_mft = serializeTransfer(tr_mft);
@@ -151,7 +167,8 @@ TEST(TransferListener, BasicSFT)
         emulator.makeTransfer(16, uavcan::TransferTypeServiceRequest,   3, "abc"),
         emulator.makeTransfer(16, uavcan::TransferTypeServiceResponse,  4, ""),
         emulator.makeTransfer(16, uavcan::TransferTypeServiceRequest,   2, "foo"),          // Same as 2, not ignored
-        emulator.makeTransfer(16, uavcan::TransferTypeServiceRequest,   2, "123456789abc"), // Same as 2, not SFT - ignore
+        emulator.makeTransfer(16, uavcan::TransferTypeServiceRequest,   2,
+                              scalePayload("123456789abc")),                                // Same as 2, not SFT - ignore
         emulator.makeTransfer(16, uavcan::TransferTypeServiceRequest,   2, "bar"),          // Same as 2, not ignored
     };
 
@@ -182,7 +199,8 @@ TEST(TransferListener, Cleanup)
      * Generating transfers
      */
     TransferListenerEmulator emulator(subscriber, type);
-    const Transfer tr_mft = emulator.makeTransfer(16, uavcan::TransferTypeMessageBroadcast, 42, "123456789abcdefghik");
+    const Transfer tr_mft = emulator.makeTransfer(16, uavcan::TransferTypeMessageBroadcast, 42,
+                                                  scalePayload("123456789abcdefghik"));
     const Transfer tr_sft = emulator.makeTransfer(16, uavcan::TransferTypeServiceResponse, 11, "abcd");
 
     const std::vector<uavcan::RxFrame> ser_mft = serializeTransfer(tr_mft);
@@ -237,9 +255,9 @@ TEST(TransferListener, AnonymousTransfers)
     TransferListenerEmulator emulator(subscriber, type);
     const Transfer transfers[] =
     {
-        emulator.makeTransfer(16, uavcan::TransferTypeServiceRequest,   0, "1234567"),  // Invalid - not broadcast
-        emulator.makeTransfer(16, uavcan::TransferTypeMessageBroadcast, 0, "1234567"),  // Valid
-        emulator.makeTransfer(16, uavcan::TransferTypeMessageBroadcast, 0, "12345678"), // Invalid - not SFT
+        emulator.makeTransfer(16, uavcan::TransferTypeServiceRequest,   0, scalePayload("1234567")),  // Not broadcast
+        emulator.makeTransfer(16, uavcan::TransferTypeMessageBroadcast, 0, scalePayload("1234567")),  // Valid
+        emulator.makeTransfer(16, uavcan::TransferTypeMessageBroadcast, 0, scalePayload("12345678")), // Not SFT
         emulator.makeTransfer(16, uavcan::TransferTypeMessageBroadcast, 0, "")          // Valid
     };
 
@@ -265,4 +283,5 @@ TEST(TransferListener, Sizes)
     using namespace uavcan;
 
     std::cout << "sizeof(TransferListener): " << sizeof(TransferListener) << std::endl;
+    std::cout << "sizeof(TransferReceiverTable): " << sizeof(TransferReceiverTable) << std::endl;
 }
@@ -148,6 +148,11 @@ TEST(TransferReceiver, Basic)
     CHECK_COMPLETE(    rcv.addFrame(gen(0, "foo",              SET011, 0, 200), bk));
 
     ASSERT_TRUE(matchBufferContent(bufmgr.access(gen.bufmgr_key), "34567foo"));
+    {
+        uavcan::TransferCRC crc;                     // Computed on the fly, rejected frames are not included
+        crc.add(reinterpret_cast<const uint8_t*>("34567foo"), 8);
+        ASSERT_EQ(crc.get(), rcv.getLastTransferComputedCrc());
+    }
     ASSERT_EQ(0x1234, rcv.getLastTransferCrc());
     ASSERT_EQ(TransferReceiver::getDefaultTransferInterval(), rcv.getInterval());           // Not initialized yet
     ASSERT_EQ(100, rcv.getLastTransferTimestampMonotonic().toUSec());
@@ -168,6 +173,11 @@ TEST(TransferReceiver, Basic)
     CHECK_COMPLETE(    rcv.addFrame(gen(0, "",        SET010, 1, 1300), bk));
 
     ASSERT_TRUE(matchBufferContent(bufmgr.access(gen.bufmgr_key), "34567abcdefg"));
+    {
+        uavcan::TransferCRC crc;                     // Computed on the fly, rejected frames are not included
+        crc.add(reinterpret_cast<const uint8_t*>("34567abcdefg"), 12);
+        ASSERT_EQ(crc.get(), rcv.getLastTransferComputedCrc());
+    }
     ASSERT_EQ(0x789A, rcv.getLastTransferCrc());
     ASSERT_GE(TransferReceiver::getDefaultTransferInterval(), rcv.getInterval());
     ASSERT_LE(TransferReceiver::getMinTransferInterval(), rcv.getInterval());
@@ -318,6 +328,36 @@ TEST(TransferReceiver, OutOfOrderFrames)
 }
 
 
+TEST(TransferReceiver, RawFrameFormat)
+{
+    Context<32> context;
+    RxFrameGenerator gen(789);
+    uavcan::TransferReceiver& rcv = context.receiver;
+    uavcan::TransferBufferManager& bufmgr = context.bufmgr;
+    uavcan::TransferBufferAccessor bk(context.bufmgr, RxFrameGenerator::DEFAULT_KEY);
+
+    // No CRC, no sequence validation: the frames are appended as they arrive, whatever their TID and toggle
+    CHECK_NOT_COMPLETE(rcv.addFrame<uavcan::RawFrameFormat>(gen(1, "1234567", SET100, 7, 100000000), bk));
+    CHECK_NOT_COMPLETE(rcv.addFrame<uavcan::RawFrameFormat>(gen(0, "qwertyu", SET000, 8, 100000100), bk));
+    CHECK_COMPLETE(    rcv.addFrame<uavcan::RawFrameFormat>(gen(1, "abcd",    SET010, 9, 100000200), bk));
+
+    ASSERT_TRUE(matchBufferContent(bufmgr.access(gen.bufmgr_key), "1234567qwertyuabcd"));
+    ASSERT_EQ(0, rcv.getLastTransferCrc());
+    ASSERT_EQ(0, rcv.yieldErrorCount());
+
+    // The same frames are rejected in the standard format
+    Context<32> std_context;
+    uavcan::TransferBufferAccessor std_bk(std_context.bufmgr, RxFrameGenerator::DEFAULT_KEY);
+    CHECK_NOT_COMPLETE(std_context.receiver.addFrame<uavcan::StandardFrameFormat>(
+                           gen(1, "1234567", SET100, 7, 100000000), std_bk));
+    CHECK_NOT_COMPLETE(std_context.receiver.addFrame<uavcan::StandardFrameFormat>(
+                           gen(0, "qwertyu", SET000, 8, 100000100), std_bk));
+    CHECK_NOT_COMPLETE(std_context.receiver.addFrame<uavcan::StandardFrameFormat>(
+                           gen(1, "abcd",    SET010, 9, 100000200), std_bk));
+    ASSERT_LT(0, std_context.receiver.yieldErrorCount());
+}
+
+
 TEST(TransferReceiver, IntervalMeasurement)
 {
     Context<32> context;
@@ -559,3 +599,99 @@ TEST(TransferReceiver, HeaderParsing)
 
 
 }
+
+namespace
+{
+
+struct NodeIDPredicate
+{
+    const uavcan::NodeID node_id;
+
+    explicit NodeIDPredicate(uavcan::NodeID arg_node_id) : node_id(arg_node_id) { }
+
+    bool operator()(const uavcan::TransferBufferManagerKey& key, const uavcan::TransferReceiver&) const
+    {
+        return key.getNodeID() == node_id;
+    }
+};
+
+}
+
+TEST(TransferReceiverTable, Basic)
+{
+    using uavcan::TransferBufferManagerKey;
+
+    uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 8, uavcan::MemPoolBlockSize> pool;
+    std::unique_ptr<uavcan::TransferReceiverTable> table(new uavcan::TransferReceiverTable(pool));
+
+    const TransferBufferManagerKey key_1_msg(1, uavcan::TransferTypeMessageBroadcast);
+    const TransferBufferManagerKey key_1_req(1, uavcan::TransferTypeServiceRequest);
+    const TransferBufferManagerKey key_2_msg(2, uavcan::TransferTypeMessageBroadcast);
+    const TransferBufferManagerKey key_120_msg(120, uavcan::TransferTypeMessageBroadcast);
+
+    ASSERT_TRUE(table->isEmpty());
+    ASSERT_FALSE(table->access(key_1_msg));
+    ASSERT_EQ(0, pool.getNumUsedBlocks());
+
+    /*
+     * The first receiver allocates the index page, receivers of the same page take one block each
+     */
+    uavcan::TransferReceiver* const recv_1_msg = table->insert(key_1_msg);
+    ASSERT_TRUE(recv_1_msg);
+    ASSERT_EQ(2, pool.getNumUsedBlocks());
+    ASSERT_EQ(recv_1_msg, table->access(key_1_msg));
+    ASSERT_EQ(recv_1_msg, table->insert(key_1_msg));            // Existing receiver is returned
+    ASSERT_EQ(2, pool.getNumUsedBlocks());
+
+    uavcan::TransferReceiver* const recv_1_req = table->insert(key_1_req);
+    ASSERT_TRUE(recv_1_req);
+    ASSERT_NE(recv_1_msg, recv_1_req);
+    ASSERT_TRUE(table->insert(key_2_msg));
+    ASSERT_EQ(4, pool.getNumUsedBlocks());
+
+    ASSERT_TRUE(table->insert(key_120_msg));
+    ASSERT_EQ(6, pool.getNumUsedBlocks());
+    ASSERT_EQ(4, table->getSize());
+
+    ASSERT_EQ(recv_1_msg, table->access(key_1_msg));
+    ASSERT_EQ(recv_1_req, table->access(key_1_req));
+    ASSERT_FALSE(table->access(TransferBufferManagerKey(1, uavcan::TransferTypeServiceResponse)));
+    ASSERT_FALSE(table->access(TransferBufferManagerKey(3, uavcan::TransferTypeMessageBroadcast)));
+
+    /*
+     * Out of memory
+     */
+    ASSERT_TRUE(table->insert(TransferBufferManagerKey(64, uavcan::TransferTypeMessageBroadcast)));
+    ASSERT_EQ(8, pool.getNumUsedBlocks());
+    ASSERT_FALSE(table->insert(TransferBufferManagerKey(100, uavcan::TransferTypeMessageBroadcast)));
+    ASSERT_FALSE(table->insert(TransferBufferManagerKey(65, uavcan::TransferTypeMessageBroadcast)));
+    ASSERT_EQ(8, pool.getNumUsedBlocks());
+    ASSERT_EQ(5, table->getSize());
+
+    /*
+     * Removal releases the pages that became empty
+     */
+    table->removeAllWhere(NodeIDPredicate(64));
+    ASSERT_EQ(6, pool.getNumUsedBlocks());
+    ASSERT_TRUE(table->insert(TransferBufferManagerKey(100, uavcan::TransferTypeMessageBroadcast)));
+    ASSERT_EQ(8, pool.getNumUsedBlocks());
+
+    table->removeAllWhere(NodeIDPredicate(1));
+    ASSERT_EQ(6, pool.getNumUsedBlocks());
+    ASSERT_FALSE(table->access(key_1_msg));
+    ASSERT_FALSE(table->access(key_1_req));
+    ASSERT_TRUE(table->access(key_2_msg));
+    ASSERT_EQ(3, table->getSize());
+
+    table->clear();
+    ASSERT_TRUE(table->isEmpty());
+    ASSERT_EQ(0, pool.getNumUsedBlocks());
+
+    /*
+     * Destructor removes the remaining receivers
+     */
+    ASSERT_TRUE(table->insert(key_120_msg));
+    ASSERT_EQ(2, pool.getNumUsedBlocks());
+    table.reset();
+    ASSERT_EQ(0, pool.getNumUsedBlocks());
+}
@@ -166,6 +166,79 @@ TEST(TransferSender, Basic)
     EXPECT_EQ(8, dispatcher_rx.getTransferPerfCounter().getRxTransferCount());
 }
 
+#if UAVCAN_CAN_FD
+TEST(TransferSender, CanFd)
+{
+    uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 100, uavcan::MemPoolBlockSize> poolmgr;
+
+    SystemClockMock clockmock(100);
+    CanDriverMock driver(1, clockmock);
+
+    static const uavcan::NodeID TX_NODE_ID(64);
+    static const uavcan::NodeID RX_NODE_ID(65);
+    uavcan::Dispatcher dispatcher_tx(driver, poolmgr, clockmock);
+    uavcan::Dispatcher dispatcher_rx(driver, poolmgr, clockmock);
+    ASSERT_TRUE(dispatcher_tx.setNodeID(TX_NODE_ID));
+    ASSERT_TRUE(dispatcher_rx.setNodeID(RX_NODE_ID));
+
+    const uavcan::DataTypeDescriptor type = makeDataType(uavcan::DataTypeKindMessage, 1);
+    uavcan::TransferSender sender(dispatcher_tx, type);
+
+    /*
+     * Payloads that don't make a frame of valid length are split, so that the tail byte is never followed by
+     * padding; all other frames are full.
+     */
+    static const unsigned PayloadLens[] = { 7, 11, 20, 63, 62, 200 };
+    static const unsigned NumFrames[]   = { 1, 1,  2,  1,  2,  5 };
+    static const unsigned NumTransfers = sizeof(PayloadLens) / sizeof(PayloadLens[0]);
+
+    static const uint64_t TX_DEADLINE = 1000000;
+    std::vector<Transfer> transfers;
+    for (unsigned i = 0; i < NumTransfers; i++)
+    {
+        std::string data;
+        for (unsigned k = 0; k < PayloadLens[i]; k++)
+        {
+            data += char('a' + (k + i) % 26);
+        }
+        ASSERT_EQ(int(NumFrames[i]), sendOne(sender, data, TX_DEADLINE, 0, uavcan::TransferTypeMessageBroadcast, 0));
+        transfers.push_back(Transfer(TX_DEADLINE, 0, uavcan::TransferPriority::Default,
+                                     uavcan::TransferTypeMessageBroadcast, uavcan::TransferID(uint8_t(i)),
+                                     TX_NODE_ID, 0, data, type));
+    }
+
+    CanIfaceMock& iface = driver.ifaces.at(0);
+    ASSERT_EQ(12, iface.tx.size());
+    while (!iface.tx.empty())
+    {
+        CanIfaceMock::FrameWithTime ft = iface.tx.front();
+        iface.tx.pop();
+        ASSERT_TRUE(uavcan::CanFrame::isValidDataLen(ft.frame.dlc));
+        iface.rx.push(ft);
+    }
+
+    TestListener sub_msg(dispatcher_rx.getTransferPerfCounter(), type, 512, poolmgr);
+    dispatcher_rx.registerMessageListener(&sub_msg);
+    while (true)
+    {
+        const int res = dispatcher_rx.spin(tsMono(0));
+        ASSERT_LE(0, res);
+        clockmock.advance(100);
+        if (res == 0)
+        {
+            break;
+        }
+    }
+
+    for (unsigned i = 0; i < NumTransfers; i++)
+    {
+        ASSERT_TRUE(sub_msg.matchAndPop(transfers[i]));
+    }
+    EXPECT_EQ(0, dispatcher_tx.getTransferPerfCounter().getErrorCount());
+    EXPECT_EQ(0, dispatcher_rx.getTransferPerfCounter().getErrorCount());
+    EXPECT_EQ(NumTransfers, dispatcher_rx.getTransferPerfCounter().getRxTransferCount());
+}
+#endif
 
 struct TransferSenderTestLoopbackFrameListener : public uavcan::LoopbackFrameListenerBase
 {
@@ -9,6 +9,7 @@
 #include <vector>
 #include <gtest/gtest.h>
 #include <uavcan/transport/transfer_listener.hpp>
+#include <uavcan/transport/frame_format.hpp>
 
 /**
  * UAVCAN transfer representation used in various tests.
@@ -240,6 +241,32 @@ inline uavcan::DataTypeDescriptor makeDataType(uavcan::DataTypeKind kind, uint16
 
 }
 
+/**
+ * Proprietary frame codec used to test the frame format hooks: same as the standard one, but the data type ID
+ * bits of the CAN ID are inverted on the wire.
+ */
+struct ScrambledFrameFormat : public uavcan::StandardFrameFormat
+{
+    static const uint32_t ScrambleMask = 0xFFUL << 16;
+
+    static bool parse(const uavcan::CanFrame& can_frame, uavcan::Frame& out_frame)
+    {
+        uavcan::CanFrame unscrambled = can_frame;
+        unscrambled.id ^= ScrambleMask;
+        return uavcan::StandardFrameFormat::parse(unscrambled, out_frame);
+    }
+
+    static bool compile(const uavcan::Frame& frame, uavcan::CanFrame& out_can_frame)
+    {
+        if (!uavcan::StandardFrameFormat::compile(frame, out_can_frame))
+        {
+            return false;
+        }
+        out_can_frame.id ^= ScrambleMask;
+        return true;
+    }
+};
+
 
 class IncomingTransferEmulatorBase
 {
@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2014 Pavel Kirienko <pavel.kirienko@gmail.com>
+ *
+ * Reports the false-accept ratio of the hardware acceptance filters computed by CanAcceptanceFilterConfigurator,
+ * i.e. the share of foreign frames that pass the filters, versus the number of available filters.
+ * Both merge algorithms are evaluated on the same traffic.
+ *
+ * Usage:
+ *   bench_acceptance_filters [candump.log [subscribed_dtid ...]]
+ * The log is in the format written by "candump -l", e.g. "(1500000000.000000) can0 1401557F#0102C0".
+ * Without arguments, a synthetic recording of a typical vehicle bus is used.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <uavcan/transport/can_acceptance_filter_configurator.hpp>
+#include <uavcan_linux/clock.hpp>
+#include "debug.hpp"
+
+namespace
+{
+
+const std::uint8_t SelfNodeID = 10;
+
+class NullCanIface : public uavcan::ICanIface
+{
+    std::uint16_t num_filters_ = 0;
+
+public:
+    void setNumFilters(std::uint16_t num_filters) { num_filters_ = num_filters; }
+
+    std::int16_t send(const uavcan::CanFrame&, uavcan::MonotonicTime, uavcan::CanIOFlags) override { return 1; }
+
+    std::int16_t receive(uavcan::CanFrame&, uavcan::MonotonicTime&, uavcan::UtcTime&,
+                         uavcan::CanIOFlags&) override
+    {
+        return 0;
+    }
+
+    std::int16_t configureFilters(const uavcan::CanFilterConfig*, std::uint16_t) override { return 0; }
+    std::uint16_t getNumFilters() const override { return num_filters_; }
+    std::uint64_t getErrorCount() const override { return 0; }
+};
+
+class NullCanDriver : public uavcan::ICanDriver
+{
+public:
+    NullCanIface iface;
+
+    uavcan::ICanIface* getIface(std::uint8_t iface_index) override
+    {
+        return (iface_index == 0) ? &iface : nullptr;
+    }
+
+    std::uint8_t getNumIfaces() const override { return 1; }
+
+    std::int16_t select(uavcan::CanSelectMasks& inout_masks, const uavcan::CanFrame* (&)[uavcan::MaxCanIfaces],
+                        uavcan::MonotonicTime) override
+    {
+        inout_masks.read = 0;
+        inout_masks.write &= 1;
+        return 0;
+    }
+};
+
+class BenchNode : public uavcan::INode
+{
+    uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 8192, uavcan::MemPoolBlockSize> pool_;
+    uavcan::Scheduler scheduler_;
+
+public:
+    BenchNode(uavcan::ICanDriver& driver, uavcan::ISystemClock& clock)
+        : scheduler_(driver, pool_, clock)
+    { }
+
+    uavcan::IPoolAllocator& getAllocator() override { return pool_; }
+    uavcan::Scheduler& getScheduler() override { return scheduler_; }
+    const uavcan::Scheduler& getScheduler() const override { return scheduler_; }
+    void registerInternalFailure(const char* msg) override { std::cerr << "Internal failure: " << msg << std::endl; }
+};
+
+class NullListener : public uavcan::TransferListener
+{
+    void handleIncomingTransfer(uavcan::IncomingTransfer&) override { }
+
+public:
+    NullListener(uavcan::TransferPerfCounter& perf, const uavcan::DataTypeDescriptor& data_type,
+                 uavcan::IPoolAllocator& allocator)
+        : uavcan::TransferListener(perf, data_type, 7, allocator)
+    { }
+};
+
+struct Message
+{
+    std::uint16_t dtid;
+    unsigned rate_hz;
+    std::uint8_t num_publishers;
+};
+
+/**
+ * A few seconds of a vehicle bus: standard message types at typical rates, plus service traffic between other nodes.
+ */
+std::vector<std::uint32_t> makeSyntheticRecording(std::vector<std::uint16_t>& out_subscriptions)
+{
+    static const Message Messages[] =
+    {
+        { 341, 1, 20 },     // NodeStatus
+        { 1000, 100, 1 },   // ahrs.Solution
+        { 1001, 50, 2 },    // ahrs.MagneticFieldStrength
+        { 1002, 50, 1 },    // ahrs.MagneticFieldStrength2
+        { 1010, 100, 1 },   // actuator.ArrayCommand
+        { 1011, 50, 4 },    // actuator.Status
+        { 1020, 10, 1 },    // air_data.TrueAirspeed
+        { 1021, 10, 1 },    // air_data.IndicatedAirspeed
+        { 1028, 20, 1 },    // air_data.StaticPressure
+        { 1029, 20, 1 },    // air_data.StaticTemperature
+        { 1030, 400, 1 },   // esc.RawCommand
+        { 1034, 50, 8 },    // esc.Status
+        { 1060, 5, 1 },     // gnss.Fix
+        { 1061, 1, 1 },     // gnss.Auxiliary
+        { 1063, 10, 1 },    // gnss.Fix2
+        { 1092, 10, 1 },    // power.BatteryInfo
+        { 1100, 1, 2 },     // device.Temperature
+        { 16370, 10, 1 },   // debug.KeyValue
+        { 20000, 5, 3 }     // vendor-specific
+    };
+    static const std::uint16_t Subscriptions[] = { 1000, 1010, 1030, 1060, 1063, 1092 };
+
+    out_subscriptions.assign(std::begin(Subscriptions), std::end(Subscriptions));
+
+    std::vector<std::uint32_t> ids;
+    const unsigned NumSeconds = 10;
+    for (unsigned second = 0; second < NumSeconds; second++)
+    {
+        for (const Message& msg : Messages)
+        {
+            for (unsigned i = 0; i < msg.rate_hz * msg.num_publishers; i++)
+            {
+                const std::uint32_t src = 20U + (i % msg.num_publishers) + msg.dtid % 50U;
+                ids.push_back((std::uint32_t(16) << 24) | (std::uint32_t(msg.dtid) << 8) | src);
+            }
+        }
+        // Parameter and file services between other nodes, and a few requests to us
+        for (unsigned i = 0; i < 200; i++)
+        {
+            const std::uint32_t dst = (i % 10 == 0) ? SelfNodeID : (30U + i % 20U);
+            const std::uint32_t srv_dtid = (i % 2 == 0) ? 11 : 48;
+            ids.push_back((std::uint32_t(24) << 24) | (srv_dtid << 16) | (1U << 15) | (dst << 8) | (1U << 7) | 127U);
+        }
+    }
+    return ids;
+}
+
+std::vector<std::uint32_t> loadCandumpRecording(const std::string& path)
+{
+    std::ifstream file(path);
+    ENFORCE(file.good());
+
+    std::vector<std::uint32_t> ids;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        const auto hash = line.find('#');
+        const auto space = line.rfind(' ', hash);
+        if ((hash == std::string::npos) || (space == std::string::npos) || (hash - space - 1) != 8)
+        {
+            continue;       // Only extended frames are of interest
+        }
+        ids.push_back(std::uint32_t(std::stoul(line.substr(space + 1, 8), nullptr, 16)));
+    }
+    return ids;
+}
+
+bool isWanted(std::uint32_t id, const std::vector<std::uint16_t>& subscriptions)
+{
+    if ((id & (1U << 7)) != 0)
+    {
+        return ((id >> 8) & 0x7FU) == SelfNodeID;
+    }
+    const std::uint16_t dtid = std::uint16_t((id >> 8) & 0xFFFFU);
+    return std::find(subscriptions.begin(), subscriptions.end(), dtid) != subscriptions.end();
+}
+
+bool isAccepted(std::uint32_t id, const uavcan::Multiset<uavcan::CanFilterConfig>& configs)
+{
+    const std::uint32_t can_id = id | uavcan::CanFrame::FlagEFF;
+    for (unsigned i = 0; i < configs.getSize(); i++)
+    {
+        const uavcan::CanFilterConfig& cfg = *configs.getByIndex(i);
+        if (((can_id ^ cfg.id) & cfg.mask) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Returns the share of foreign frames that pass the filters; also checks that no wanted frame is rejected.
+ */
+double measureFalseAcceptRatio(BenchNode& node, std::uint16_t num_filters,
+                               uavcan::CanAcceptanceFilterConfigurator::MergeAlgorithm algorithm,
+                               const std::vector<std::uint32_t>& ids, const std::vector<std::uint16_t>& subscriptions,
+                               double& out_compute_time_ms)
+{
+    uavcan::CanAcceptanceFilterConfigurator cfger(node, num_filters);
+
+    const auto started_at = std::chrono::steady_clock::now();
+    ENFORCE(0 == cfger.computeConfiguration(uavcan::CanAcceptanceFilterConfigurator::IgnoreAnonymousMessages,
+                                            algorithm));
+    const auto elapsed = std::chrono::steady_clock::now() - started_at;
+    out_compute_time_ms = double(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()) * 1e-3;
+
+    unsigned num_foreign = 0;
+    unsigned num_false_accepts = 0;
+    for (std::uint32_t id : ids)
+    {
+        const bool accepted = isAccepted(id, cfger.getConfiguration());
+        if (isWanted(id, subscriptions))
+        {
+            ENFORCE(accepted);
+        }
+        else
+        {
+            num_foreign++;
+            num_false_accepts += accepted ? 1U : 0U;
+        }
+    }
+    return (num_foreign > 0) ? (double(num_false_accepts) / num_foreign) : 0.0;
+}
+
+}
+
+int main(int argc, const char** argv)
+{
+    std::vector<std::uint16_t> subscriptions;
+    std::vector<std::uint32_t> ids;
+    if (argc > 1)
+    {
+        ids = loadCandumpRecording(argv[1]);
+        for (int i = 2; i < argc; i++)
+        {
+            subscriptions.push_back(std::uint16_t(std::stoul(argv[i])));
+        }
+    }
+    else
+    {
+        ids = makeSyntheticRecording(subscriptions);
+    }
+
+    uavcan_linux::SystemClock clock;
+    NullCanDriver driver;
+    BenchNode node(driver, clock);
+    ENFORCE(node.setNodeID(SelfNodeID));
+
+    std::vector<uavcan::DataTypeDescriptor> types;
+    for (std::uint16_t dtid : subscriptions)
+    {
+        types.emplace_back(uavcan::DataTypeKindMessage, dtid, uavcan::DataTypeSignature(dtid), "bench.Type");
+    }
+    std::vector<std::unique_ptr<NullListener>> listeners;
+    for (const auto& type : types)
+    {
+        listeners.emplace_back(new NullListener(node.getDispatcher().getTransferPerfCounter(), type,
+                                                node.getAllocator()));
+        ENFORCE(node.getDispatcher().registerMessageListener(listeners.back().get()));
+    }
+
+    std::cout << "Frames: " << ids.size() << ", subscriptions: " << subscriptions.size()
+              << ", exact merge limit: " << UAVCAN_CAN_ACCEPTANCE_FILTER_EXACT_MERGE_LIMIT << "\n"
+              << std::setw(8) << "filters" << std::setw(16) << "by rank, %" << std::setw(16) << "by volume, %"
+              << std::setw(18) << "by volume, ms" << std::endl;
+
+    for (std::uint16_t num_filters = 1; num_filters <= subscriptions.size() + 1U; num_filters++)
+    {
+        driver.iface.setNumFilters(num_filters);
+        double rank_ms = 0;
+        double volume_ms = 0;
+        const double by_rank = measureFalseAcceptRatio(node, num_filters,
+                                                       uavcan::CanAcceptanceFilterConfigurator::MergeByRank,
+                                                       ids, subscriptions, rank_ms);
+        const double by_volume = measureFalseAcceptRatio(node, num_filters,
+                                                         uavcan::CanAcceptanceFilterConfigurator::MergeByVolume,
+                                                         ids, subscriptions, volume_ms);
+        std::cout << std::setw(8) << num_filters << std::fixed << std::setprecision(2)
+                  << std::setw(16) << by_rank * 100 << std::setw(16) << by_volume * 100
+                  << std::setw(18) << std::setprecision(3) << volume_ms << std::endl;
+    }
+
+    for (auto& l : listeners)
+    {
+        node.getDispatcher().unregisterMessageListener(l.get());
+    }
+    return 0;
+}
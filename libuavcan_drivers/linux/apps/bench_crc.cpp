@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2014 Pavel Kirienko <pavel.kirienko@gmail.com>
+ *
+ * Measures the throughput of the transfer CRC functions, comparing byte-by-byte updates against block updates.
+ * Block updates use the slice-by-8 implementation unless the library is built with -DUAVCAN_CRC_SLICE_BY_8=0.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <uavcan/transport/crc.hpp>
+
+namespace
+{
+
+volatile std::uint64_t sink;
+
+template <typename Crc>
+std::uint64_t addBytewise(const std::uint8_t* data, unsigned len)
+{
+    Crc crc;
+    for (unsigned i = 0; i < len; i++)
+    {
+        crc.add(data[i]);
+    }
+    return crc.get();
+}
+
+template <typename Crc>
+std::uint64_t addBlock(const std::uint8_t* data, unsigned len)
+{
+    Crc crc;
+    crc.add(data, len);
+    return crc.get();
+}
+
+/**
+ * This is how TransferListener validates multi-frame transfers.
+ */
+template <typename Crc>
+std::uint64_t addChunked(const std::uint8_t* data, unsigned len)
+{
+    Crc crc;
+    for (unsigned offset = 0; offset < len; offset += 16)
+    {
+        crc.add(data + offset, std::min(16U, len - offset));
+    }
+    return crc.get();
+}
+
+/**
+ * Returns MB/s.
+ */
+template <typename Function>
+double measure(Function function, const std::vector<std::uint8_t>& data, unsigned len)
+{
+    const unsigned num_iterations = unsigned(std::max<std::size_t>(1, (64U << 20) / len));
+    double best = 0;
+    for (int run = 0; run < 3; run++)
+    {
+        const auto started_at = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < num_iterations; i++)
+        {
+            sink = function(data.data(), len);
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - started_at;
+        const double sec = double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) * 1e-9;
+        best = std::max(best, double(len) * num_iterations / sec / 1e6);
+    }
+    return best;
+}
+
+template <typename Crc>
+void benchmark(const char* name, const std::vector<std::uint8_t>& data)
+{
+    std::cout << name << "\n"
+              << std::setw(8) << "bytes" << std::setw(14) << "bytewise MB/s" << std::setw(14) << "block MB/s"
+              << std::setw(14) << "16B chunks" << std::endl;
+
+    for (unsigned len : { 8U, 16U, 64U, 256U, 1024U, 4096U })
+    {
+        std::cout << std::setw(8) << len << std::fixed << std::setprecision(0)
+                  << std::setw(14) << measure(&addBytewise<Crc>, data, len)
+                  << std::setw(14) << measure(&addBlock<Crc>, data, len)
+                  << std::setw(14) << measure(&addChunked<Crc>, data, len) << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+}
+
+int main()
+{
+    std::vector<std::uint8_t> data(4096);
+    for (std::size_t i = 0; i < data.size(); i++)
+    {
+        data[i] = std::uint8_t(i * 131U + 7U);
+    }
+
+    std::cout << "Slice-by-8: " << UAVCAN_CRC_SLICE_BY_8 << "\n" << std::endl;
+
+    benchmark<uavcan::TransferCRC>("TransferCRC (CRC-16-CCITT)", data);
+    benchmark<uavcan::TransferCRC32>("TransferCRC32", data);
+    benchmark<uavcan::TransferCRC48>("TransferCRC48", data);
+    return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2014 Pavel Kirienko <pavel.kirienko@gmail.com>
+ *
+ * Measures per-frame cost of the dispatcher's listener lookup versus the number of registered listeners.
+ * Frames are fed from memory, so the results do not depend on the kernel or the bus.
+ *
+ * Rebuild with -DUAVCAN_DISPATCHER_LISTENER_INDEX_SIZE=0 to compare against the linear search.
+ * The foreign traffic column feeds frames of data types nobody listens to, which is what a node sees on a shared bus;
+ * rebuild with -DUAVCAN_DISPATCHER_RX_PREFILTER_BITS=0 to compare against parsing every frame.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <uavcan/transport/dispatcher.hpp>
+#include <uavcan_linux/clock.hpp>
+#include "debug.hpp"
+
+namespace
+{
+
+class MemoryCanIface : public uavcan::ICanIface
+{
+    const std::vector<uavcan::CanFrame>& frames_;
+    std::size_t next_ = 0;
+    uavcan::ISystemClock& clock_;
+
+public:
+    MemoryCanIface(const std::vector<uavcan::CanFrame>& frames, uavcan::ISystemClock& clock)
+        : frames_(frames)
+        , clock_(clock)
+    { }
+
+    bool isEmpty() const { return next_ >= frames_.size(); }
+    void rewind() { next_ = 0; }
+
+    std::int16_t send(const uavcan::CanFrame&, uavcan::MonotonicTime, uavcan::CanIOFlags) override { return 1; }
+
+    std::int16_t receive(uavcan::CanFrame& out_frame, uavcan::MonotonicTime& out_ts_monotonic,
+                         uavcan::UtcTime& out_ts_utc, uavcan::CanIOFlags& out_flags) override
+    {
+        if (isEmpty())
+        {
+            return 0;
+        }
+        out_frame = frames_[next_++];
+        out_ts_monotonic = clock_.getMonotonic();
+        out_ts_utc = uavcan::UtcTime();
+        out_flags = 0;
+        return 1;
+    }
+
+    std::int16_t configureFilters(const uavcan::CanFilterConfig*, std::uint16_t) override { return 0; }
+    std::uint16_t getNumFilters() const override { return 0; }
+    std::uint64_t getErrorCount() const override { return 0; }
+};
+
+class MemoryCanDriver : public uavcan::ICanDriver
+{
+    MemoryCanIface iface_;
+
+public:
+    MemoryCanDriver(const std::vector<uavcan::CanFrame>& frames, uavcan::ISystemClock& clock)
+        : iface_(frames, clock)
+    { }
+
+    void rewind() { iface_.rewind(); }
+
+    uavcan::ICanIface* getIface(std::uint8_t iface_index) override
+    {
+        return (iface_index == 0) ? &iface_ : nullptr;
+    }
+
+    std::uint8_t getNumIfaces() const override { return 1; }
+
+    std::int16_t select(uavcan::CanSelectMasks& inout_masks, const uavcan::CanFrame* (&)[uavcan::MaxCanIfaces],
+                        uavcan::MonotonicTime) override
+    {
+        inout_masks.read = iface_.isEmpty() ? 0 : 1;
+        inout_masks.write &= 1;
+        return 1;
+    }
+};
+
+class CountingListener : public uavcan::TransferListener
+{
+    void handleIncomingTransfer(uavcan::IncomingTransfer&) override { num_transfers++; }
+
+public:
+    unsigned num_transfers = 0;
+
+    CountingListener(uavcan::TransferPerfCounter& perf, const uavcan::DataTypeDescriptor& data_type,
+                     uavcan::IPoolAllocator& allocator)
+        : uavcan::TransferListener(perf, data_type, 7, allocator)
+    { }
+};
+
+/**
+ * Single-frame broadcasts spread evenly over the registered data types, with distinct sources and transfer IDs
+ * so that no frame gets rejected as a duplicate. Foreign frames use data type IDs in between the registered ones.
+ */
+std::vector<uavcan::CanFrame> makeFrames(unsigned num_types, unsigned num_frames, bool foreign)
+{
+    std::vector<uavcan::CanFrame> frames;
+    for (unsigned i = 0; i < num_frames; i++)
+    {
+        const uavcan::DataTypeID dtid(std::uint16_t((i % num_types) * 3 + (foreign ? 2 : 1)));
+        const uavcan::NodeID src(std::uint8_t(1 + (i / num_types) % 100));
+        uavcan::Frame frame(dtid, uavcan::TransferTypeMessageBroadcast, src, uavcan::NodeID::Broadcast,
+                            uavcan::TransferID(std::uint8_t((i / num_types / 100) & uavcan::TransferID::Max)));
+        frame.setStartOfTransfer(true);
+        frame.setEndOfTransfer(true);
+        const std::uint8_t payload[] = { 1, 2, 3, 4 };
+        frame.setPayload(payload, sizeof(payload));
+
+        uavcan::CanFrame can_frame;
+        ENFORCE(frame.compile(can_frame));
+        frames.push_back(can_frame);
+    }
+    return frames;
+}
+
+double runOnce(unsigned num_listeners, unsigned num_frames, bool foreign)
+{
+    static uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 32768, uavcan::MemPoolBlockSize> pool;
+    uavcan_linux::SystemClock clock;
+
+    const auto frames = makeFrames(num_listeners, num_frames, foreign);
+    MemoryCanDriver driver(frames, clock);
+    uavcan::Dispatcher dispatcher(driver, pool, clock);
+    ENFORCE(dispatcher.setNodeID(127));
+
+    std::vector<std::unique_ptr<CountingListener>> listeners;
+    for (unsigned i = 0; i < num_listeners; i++)
+    {
+        const uavcan::DataTypeDescriptor type(uavcan::DataTypeKindMessage, std::uint16_t(i * 3 + 1),
+                                              uavcan::DataTypeSignature(0x1234 + i), "bench.Type");
+        listeners.emplace_back(new CountingListener(dispatcher.getTransferPerfCounter(), type, pool));
+        ENFORCE(dispatcher.registerMessageListener(listeners.back().get()));
+    }
+
+    const auto started_at = std::chrono::steady_clock::now();
+    const int res = dispatcher.spinOnce();
+    const auto elapsed = std::chrono::steady_clock::now() - started_at;
+    ENFORCE(res == int(num_frames));
+
+    unsigned num_transfers = 0;
+    for (auto& l : listeners)
+    {
+        num_transfers += l->num_transfers;
+    }
+    ENFORCE(foreign ? (num_transfers == 0) : (num_transfers > 0));
+
+    return double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / num_frames;
+}
+
+}
+
+int main(int argc, const char** argv)
+{
+    const unsigned num_frames = (argc > 1) ? unsigned(std::stoul(argv[1])) : 100000;
+
+    std::cout << "Listener index size: " << UAVCAN_DISPATCHER_LISTENER_INDEX_SIZE << "\n"
+              << "RX prefilter bits:   " << UAVCAN_DISPATCHER_RX_PREFILTER_BITS << "\n"
+              << "Frames per run:      " << num_frames << "\n"
+              << std::setw(10) << "listeners" << std::setw(14) << "ns/frame" << std::setw(14) << "foreign ns/fr"
+              << std::endl;
+
+    for (unsigned num_listeners = 1; num_listeners <= 128; num_listeners *= 2)
+    {
+        std::cout << std::setw(10) << num_listeners;
+        for (bool foreign : { false, true })
+        {
+            double best = 0;
+            for (int i = 0; i < 5; i++)
+            {
+                const double x = runOnce(num_listeners, num_frames, foreign);
+                best = (i == 0 || x < best) ? x : best;
+            }
+            std::cout << std::setw(14) << std::fixed << std::setprecision(1) << best;
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2014 Pavel Kirienko <pavel.kirienko@gmail.com>
+ *
+ * Measures how many frames per second can be compiled, comparing the full CAN ID repacking in Frame::compile()
+ * against the precompiled CAN ID template used by TransferSender.
+ * Frames are produced the way a multi-frame transfer produces them: only the tail byte and the payload change.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <uavcan/transport/frame.hpp>
+#include "debug.hpp"
+
+namespace
+{
+
+volatile std::uint32_t sink;
+
+const std::uint8_t Payload[] = { 1, 2, 3, 4, 5, 6, 7 };
+
+void updateFrame(uavcan::Frame& frame, unsigned index)
+{
+    frame.setStartOfTransfer(index == 0);
+    frame.setEndOfTransfer(false);
+    if (frame.getToggle() != ((index & 1U) != 0))
+    {
+        frame.flipToggle();
+    }
+    frame.setPayload(Payload, sizeof(Payload));
+}
+
+/**
+ * Returns frames per second.
+ */
+template <typename Function>
+double measure(uavcan::Frame& frame, Function function)
+{
+    const unsigned NumFrames = 20000000;
+    double best = 0;
+    for (int run = 0; run < 3; run++)
+    {
+        uavcan::CanFrame can_frame;
+        const auto started_at = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < NumFrames; i++)
+        {
+            updateFrame(frame, i);
+            ENFORCE(function(frame, can_frame));
+            sink = can_frame.id ^ can_frame.data[0];
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - started_at;
+        const double sec = double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) * 1e-9;
+        best = std::max(best, NumFrames / sec);
+    }
+    return best;
+}
+
+void benchmark(const char* name, uavcan::Frame frame)
+{
+    const double full = measure(frame, [](const uavcan::Frame& f, uavcan::CanFrame& out)
+    {
+        return f.compile(out);
+    });
+
+    const std::uint32_t can_id_template = frame.makeCanIdTemplate();
+    ENFORCE(can_id_template != 0);
+    const double templated = measure(frame, [can_id_template](const uavcan::Frame& f, uavcan::CanFrame& out)
+    {
+        return f.compile(out, can_id_template);
+    });
+
+    std::cout << std::setw(20) << name << std::fixed << std::setprecision(1)
+              << std::setw(16) << full / 1e6 << std::setw(16) << templated / 1e6
+              << std::setw(10) << std::setprecision(2) << templated / full << std::endl;
+}
+
+}
+
+int main()
+{
+    std::cout << std::setw(20) << "transfer type" << std::setw(16) << "compile() M/s"
+              << std::setw(16) << "template M/s" << std::setw(10) << "speedup" << std::endl;
+
+    benchmark("message", uavcan::Frame(1234, uavcan::TransferTypeMessageBroadcast, 42,
+                                       uavcan::NodeID::Broadcast, 0));
+    benchmark("service request", uavcan::Frame(123, uavcan::TransferTypeServiceRequest, 42, 24, 0));
+    benchmark("service response", uavcan::Frame(123, uavcan::TransferTypeServiceResponse, 24, 42, 0));
+    return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2014 Pavel Kirienko <pavel.kirienko@gmail.com>
+ *
+ * Measures how many frames per second TransferReceiver can reassemble for each frame format policy, and compares
+ * the specialized entry points against the one that selects the format by Frame::getFrameType().
+ * Frames are multi-frame transfers from one node, as produced by TransferSender.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <uavcan/transport/transfer_receiver.hpp>
+#include "debug.hpp"
+
+namespace
+{
+
+const uavcan::TransferBufferManagerKey Key(42, uavcan::TransferTypeMessageBroadcast);
+
+const unsigned FramesPerTransfer = 6;
+
+std::vector<uavcan::RxFrame> makeFrames(std::uint8_t frame_type)
+{
+    std::vector<uavcan::RxFrame> frames;
+    const unsigned NumTransfers = 1024;
+    for (unsigned t = 0; t < NumTransfers; t++)
+    {
+        for (unsigned i = 0; i < FramesPerTransfer; i++)
+        {
+            uavcan::Frame frame(frame_type);
+            frame.setDataTypeID(1234);
+            frame.setTransferType(uavcan::TransferTypeMessageBroadcast);
+            frame.setSrcNodeID(Key.getNodeID());
+            frame.setDstNodeID(uavcan::NodeID::Broadcast);
+            frame.setTransferID(uavcan::TransferID(std::uint8_t(t & uavcan::TransferID::Max)));
+            frame.setStartOfTransfer(i == 0);
+            frame.setEndOfTransfer(i == (FramesPerTransfer - 1));
+            if ((i & 1U) != 0)
+            {
+                frame.flipToggle();
+            }
+            const std::uint8_t payload[] = { std::uint8_t(t), std::uint8_t(i), 3, 4, 5, 6, 7 };
+            frame.setPayload(payload, sizeof(payload));
+
+            const auto ts = uavcan::MonotonicTime::fromUSec(1000000 + (t * FramesPerTransfer + i) * 10);
+            frames.push_back(uavcan::RxFrame(frame, ts, uavcan::UtcTime(), 0));
+        }
+    }
+    return frames;
+}
+
+/**
+ * Returns frames per second.
+ */
+template <typename Function>
+double measure(const std::vector<uavcan::RxFrame>& frames, Function add_frame)
+{
+    const unsigned NumRounds = 2000;
+    double best = 0;
+    for (int run = 0; run < 3; run++)
+    {
+        uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 64, uavcan::MemPoolBlockSize> pool;
+        uavcan::TransferBufferManager bufmgr(256, pool);
+        uavcan::TransferBufferAccessor tba(bufmgr, Key);
+        uavcan::TransferReceiver receiver;
+        unsigned num_complete = 0;
+
+        const auto started_at = std::chrono::steady_clock::now();
+        for (unsigned round = 0; round < NumRounds; round++)
+        {
+            for (const auto& frame : frames)
+            {
+                // Timestamps must not go backwards
+                const uavcan::RxFrame shifted(frame, frame.getMonotonicTimestamp() +
+                                              uavcan::MonotonicDuration::fromMSec(round * 100), uavcan::UtcTime(), 0);
+                if (add_frame(receiver, shifted, tba) == uavcan::TransferReceiver::ResultComplete)
+                {
+                    num_complete++;
+                }
+            }
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - started_at;
+        ENFORCE(num_complete == NumRounds * frames.size() / FramesPerTransfer);
+        tba.remove();
+
+        const double sec = double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) * 1e-9;
+        best = std::max(best, NumRounds * frames.size() / sec);
+    }
+    return best;
+}
+
+}
+
+int main()
+{
+    const uavcan::TransferCRC crc_base;
+
+    const auto standard_frames = makeFrames(uavcan::Frame::FRAME_TYPE_UAVCAN);
+    const auto raw_frames = makeFrames(1);
+
+    typedef uavcan::TransferReceiver::ResultCode ResultCode;
+    typedef uavcan::TransferBufferAccessor Accessor;
+
+    const double standard_runtime = measure(standard_frames,
+        [&](uavcan::TransferReceiver& r, const uavcan::RxFrame& f, Accessor& tba) -> ResultCode
+        {
+            return r.addFrame(f, tba, crc_base);
+        });
+    const double standard = measure(standard_frames,
+        [&](uavcan::TransferReceiver& r, const uavcan::RxFrame& f, Accessor& tba) -> ResultCode
+        {
+            return r.addFrame<uavcan::StandardFrameFormat>(f, tba, crc_base);
+        });
+    const double raw_runtime = measure(raw_frames,
+        [&](uavcan::TransferReceiver& r, const uavcan::RxFrame& f, Accessor& tba) -> ResultCode
+        {
+            return r.addFrame(f, tba, crc_base);
+        });
+    const double raw = measure(raw_frames,
+        [&](uavcan::TransferReceiver& r, const uavcan::RxFrame& f, Accessor& tba) -> ResultCode
+        {
+            return r.addFrame<uavcan::RawFrameFormat>(f, tba, crc_base);
+        });
+
+    std::cout << std::setw(12) << "format" << std::setw(22) << "getFrameType() M/s"
+              << std::setw(16) << "template M/s" << std::endl;
+    std::cout << std::fixed << std::setprecision(2)
+              << std::setw(12) << "standard" << std::setw(22) << standard_runtime / 1e6
+              << std::setw(16) << standard / 1e6 << std::endl;
+    std::cout << std::setw(12) << "raw" << std::setw(22) << raw_runtime / 1e6
+              << std::setw(16) << raw / 1e6 << std::endl;
+    return 0;
+}
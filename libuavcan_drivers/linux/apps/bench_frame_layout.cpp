@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2014 Pavel Kirienko <pavel.kirienko@gmail.com>
+ *
+ * Reports the size of Frame and RxFrame and measures how fast received frames can be parsed and copied
+ * into a queue, compared against a replica of the former layout (vtable, enum-sized transfer type, unordered fields).
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <type_traits>
+#include <uavcan/transport/frame.hpp>
+#include "debug.hpp"
+
+namespace
+{
+
+volatile std::uint32_t sink;
+
+/**
+ * Mirrors the field order and types of the frame classes before they were made non-virtual.
+ */
+class LegacyFrame
+{
+public:
+    std::uint8_t payload_[uavcan::Frame::PayloadCapacity];
+    uavcan::TransferPriority transfer_priority_;
+    uavcan::TransferType transfer_type_;
+    uavcan::DataTypeID data_type_id_;
+    uint_fast8_t payload_len_;
+    uavcan::NodeID src_node_id_;
+    uavcan::NodeID dst_node_id_;
+    uavcan::TransferID transfer_id_;
+    bool start_of_transfer_;
+    bool end_of_transfer_;
+    bool toggle_;
+    uavcan::TransferID transfer_id_base_;
+    std::uint8_t transfer_id_auto_inc_;
+    std::uint8_t type_;
+    std::uint8_t crc_len_;
+
+    virtual ~LegacyFrame() { }
+
+    virtual bool parse(const uavcan::CanRxFrame& can_frame)
+    {
+        uavcan::RxFrame frame;
+        if (!frame.parse(can_frame))
+        {
+            return false;
+        }
+        std::copy(frame.getPayloadPtr(), frame.getPayloadPtr() + frame.getPayloadLen(), payload_);
+        transfer_priority_ = frame.getPriority();
+        transfer_type_ = frame.getTransferType();
+        data_type_id_ = frame.getDataTypeID();
+        payload_len_ = uint_fast8_t(frame.getPayloadLen());
+        src_node_id_ = frame.getSrcNodeID();
+        dst_node_id_ = frame.getDstNodeID();
+        transfer_id_ = frame.getTransferID();
+        start_of_transfer_ = frame.isStartOfTransfer();
+        end_of_transfer_ = frame.isEndOfTransfer();
+        toggle_ = frame.getToggle();
+        return true;
+    }
+};
+
+class LegacyRxFrame : public LegacyFrame
+{
+public:
+    uavcan::MonotonicTime ts_mono_;
+    uavcan::UtcTime ts_utc_;
+    std::uint8_t iface_index_;
+};
+
+uavcan::CanRxFrame makeCanFrame()
+{
+    uavcan::Frame frame(1234, uavcan::TransferTypeMessageBroadcast, 42, uavcan::NodeID::Broadcast, 0);
+    frame.setStartOfTransfer(true);
+    frame.setEndOfTransfer(true);
+    const std::uint8_t payload[] = { 1, 2, 3, 4, 5, 6, 7 };
+    frame.setPayload(payload, sizeof(payload));
+
+    uavcan::CanRxFrame can_frame;
+    ENFORCE(frame.compile(can_frame));
+    can_frame.ts_mono = uavcan::MonotonicTime::fromUSec(1);
+    return can_frame;
+}
+
+/**
+ * Returns the number of frames per second copied into the queue from a reference frame.
+ */
+template <typename T>
+double measureCopy(const T& reference)
+{
+    const unsigned QueueLen = 64;
+    const unsigned NumFrames = 50000000;
+    std::vector<T> queue(QueueLen, reference);
+    double best = 0;
+    for (int run = 0; run < 3; run++)
+    {
+        const auto started_at = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < NumFrames; i++)
+        {
+            T& slot = queue[i % QueueLen];
+            slot = reference;
+            sink = slot.payload_[i % 7];
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - started_at;
+        const double sec = double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) * 1e-9;
+        best = std::max(best, NumFrames / sec);
+    }
+    return best;
+}
+
+double measureParse(const uavcan::CanRxFrame& can_frame)
+{
+    const unsigned NumFrames = 20000000;
+    double best = 0;
+    for (int run = 0; run < 3; run++)
+    {
+        uavcan::RxFrame frame;
+        const auto started_at = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < NumFrames; i++)
+        {
+            ENFORCE(frame.parse(can_frame));
+            sink = frame.getDataTypeID().get();
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - started_at;
+        const double sec = double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) * 1e-9;
+        best = std::max(best, NumFrames / sec);
+    }
+    return best;
+}
+
+}
+
+int main()
+{
+    static_assert(std::is_trivially_copyable<uavcan::RxFrame>::value, "RxFrame must be trivially copyable");
+
+    const uavcan::CanRxFrame can_frame = makeCanFrame();
+
+    uavcan::RxFrame frame;
+    ENFORCE(frame.parse(can_frame));
+    LegacyRxFrame legacy_frame;
+    ENFORCE(legacy_frame.parse(can_frame));
+
+    const double copy_rate = measureCopy(frame);
+    const double legacy_copy_rate = measureCopy(legacy_frame);
+
+    std::cout << std::setw(12) << "layout" << std::setw(10) << "Frame" << std::setw(10) << "RxFrame"
+              << std::setw(14) << "copy M/s" << std::endl;
+    std::cout << std::fixed << std::setprecision(1)
+              << std::setw(12) << "current" << std::setw(10) << sizeof(uavcan::Frame)
+              << std::setw(10) << sizeof(uavcan::RxFrame) << std::setw(14) << copy_rate / 1e6 << std::endl;
+    std::cout << std::setw(12) << "legacy" << std::setw(10) << sizeof(LegacyFrame)
+              << std::setw(10) << sizeof(LegacyRxFrame) << std::setw(14) << legacy_copy_rate / 1e6 << std::endl;
+    std::cout << "RxFrame::parse(): " << measureParse(can_frame) / 1e6 << " M/s" << std::endl;
+    return 0;
+}
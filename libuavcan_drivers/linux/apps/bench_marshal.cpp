@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2014 Pavel Kirienko <pavel.kirienko@gmail.com>
+ *
+ * Measures the encode/decode throughput of the marshaling layer on structures that are typical for DSDL messages.
+ * The structures are composed by hand from the marshal primitives the same way the generated code does it, so the
+ * benchmark doesn't depend on the DSDL compiler output.
+ * Every structure is processed by the bit stream both through the ITransferBuffer interface and in span mode.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <stdexcept>
+#include <uavcan/marshal/types.hpp>
+#include <uavcan/transport/transfer_buffer.hpp>
+
+namespace
+{
+
+using uavcan::IntegerSpec;
+using uavcan::FloatSpec;
+using uavcan::Array;
+using uavcan::ScalarCodec;
+using uavcan::SignednessSigned;
+using uavcan::SignednessUnsigned;
+using uavcan::CastModeSaturate;
+using uavcan::ArrayModeDynamic;
+using uavcan::ArrayModeStatic;
+using uavcan::TailArrayOptDisabled;
+using uavcan::TailArrayOptEnabled;
+using uavcan::TailArrayOptimizationMode;
+
+typedef IntegerSpec<2, SignednessUnsigned, CastModeSaturate> UInt2;
+typedef IntegerSpec<3, SignednessUnsigned, CastModeSaturate> UInt3;
+typedef IntegerSpec<8, SignednessUnsigned, CastModeSaturate> UInt8;
+typedef IntegerSpec<14, SignednessSigned, CastModeSaturate> Int14;
+typedef IntegerSpec<16, SignednessSigned, CastModeSaturate> Int16;
+typedef IntegerSpec<16, SignednessUnsigned, CastModeSaturate> UInt16;
+typedef IntegerSpec<32, SignednessUnsigned, CastModeSaturate> UInt32;
+typedef FloatSpec<16, CastModeSaturate> Float16;
+typedef FloatSpec<32, CastModeSaturate> Float32;
+
+/**
+ * uavcan.protocol.NodeStatus
+ */
+struct NodeStatus
+{
+    std::uint32_t uptime_sec = 123456;
+    std::uint8_t health = 1;
+    std::uint8_t mode = 2;
+    std::uint8_t sub_mode = 3;
+    std::uint16_t vendor_specific_status_code = 0xBEEF;
+
+    static int codec(NodeStatus& s, ScalarCodec& codec, TailArrayOptimizationMode, bool encode)
+    {
+        int res = 1;
+        res = (res <= 0) ? res : (encode ? UInt32::encode(s.uptime_sec, codec, TailArrayOptDisabled)
+                                         : UInt32::decode(s.uptime_sec, codec, TailArrayOptDisabled));
+        res = (res <= 0) ? res : (encode ? UInt2::encode(s.health, codec, TailArrayOptDisabled)
+                                         : UInt2::decode(s.health, codec, TailArrayOptDisabled));
+        res = (res <= 0) ? res : (encode ? UInt3::encode(s.mode, codec, TailArrayOptDisabled)
+                                         : UInt3::decode(s.mode, codec, TailArrayOptDisabled));
+        res = (res <= 0) ? res : (encode ? UInt3::encode(s.sub_mode, codec, TailArrayOptDisabled)
+                                         : UInt3::decode(s.sub_mode, codec, TailArrayOptDisabled));
+        res = (res <= 0) ? res : (encode ? UInt16::encode(s.vendor_specific_status_code, codec, TailArrayOptDisabled)
+                                         : UInt16::decode(s.vendor_specific_status_code, codec, TailArrayOptDisabled));
+        return res;
+    }
+};
+
+/**
+ * uavcan.equipment.esc.RawCommand, 8 channels
+ */
+struct RawCommand
+{
+    Array<Int14, ArrayModeDynamic, 20> cmd;
+
+    RawCommand()
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            cmd.push_back(std::int16_t(i * 1000 - 4000));
+        }
+    }
+
+    static int codec(RawCommand& s, ScalarCodec& codec, TailArrayOptimizationMode tao_mode, bool encode)
+    {
+        return encode ? s.cmd.encode(s.cmd, codec, tao_mode) : s.cmd.decode(s.cmd, codec, tao_mode);
+    }
+};
+
+/**
+ * uavcan.equipment.ahrs.Solution, without the covariance matrices
+ */
+struct AhrsSolution
+{
+    Array<Float16, ArrayModeStatic, 4> orientation_xyzw;
+    Array<Float16, ArrayModeStatic, 3> angular_velocity;
+    Array<Float16, ArrayModeStatic, 3> linear_acceleration;
+    float timestamp = 12.5F;
+
+    AhrsSolution()
+    {
+        for (unsigned i = 0; i < 4; i++) { orientation_xyzw[i] = 0.5F; }
+        for (unsigned i = 0; i < 3; i++) { angular_velocity[i] = 0.1F * float(i); }
+        for (unsigned i = 0; i < 3; i++) { linear_acceleration[i] = 9.8F; }
+    }
+
+    static int codec(AhrsSolution& s, ScalarCodec& codec, TailArrayOptimizationMode, bool encode)
+    {
+        int res = encode ? Float32::encode(s.timestamp, codec, TailArrayOptDisabled)
+                         : Float32::decode(s.timestamp, codec, TailArrayOptDisabled);
+        res = (res <= 0) ? res : (encode ? s.orientation_xyzw.encode(s.orientation_xyzw, codec, TailArrayOptDisabled)
+                                         : s.orientation_xyzw.decode(s.orientation_xyzw, codec, TailArrayOptDisabled));
+        for (auto* a : { &s.angular_velocity, &s.linear_acceleration })
+        {
+            res = (res <= 0) ? res : (encode ? a->encode(*a, codec, TailArrayOptDisabled)
+                                             : a->decode(*a, codec, TailArrayOptDisabled));
+        }
+        return res;
+    }
+};
+
+/**
+ * uavcan.protocol.file.Read response: byte aligned tail array
+ */
+struct FileReadResponse
+{
+    std::int16_t error = 0;
+    Array<UInt8, ArrayModeDynamic, 256> data;
+
+    FileReadResponse()
+    {
+        for (unsigned i = 0; i < 256; i++)
+        {
+            data.push_back(std::uint8_t(i * 7U));
+        }
+    }
+
+    static int codec(FileReadResponse& s, ScalarCodec& codec, TailArrayOptimizationMode tao_mode, bool encode)
+    {
+        int res = encode ? Int16::encode(s.error, codec, TailArrayOptDisabled)
+                         : Int16::decode(s.error, codec, TailArrayOptDisabled);
+        res = (res <= 0) ? res : (encode ? s.data.encode(s.data, codec, tao_mode)
+                                         : s.data.decode(s.data, codec, tao_mode));
+        return res;
+    }
+};
+
+/**
+ * uavcan.protocol.GetNodeInfo response, without the hardware version: the name length prefix leaves the byte array
+ * unaligned
+ */
+struct GetNodeInfoResponse
+{
+    NodeStatus status;
+    std::uint8_t software_version_major = 1;
+    std::uint8_t software_version_minor = 2;
+    Array<UInt8, ArrayModeDynamic, 80> name;
+
+    GetNodeInfoResponse()
+    {
+        name = "org.uavcan.linux_benchmark_node";
+    }
+
+    static int codec(GetNodeInfoResponse& s, ScalarCodec& codec, TailArrayOptimizationMode tao_mode, bool encode)
+    {
+        int res = NodeStatus::codec(s.status, codec, TailArrayOptDisabled, encode);
+        res = (res <= 0) ? res : (encode ? UInt8::encode(s.software_version_major, codec, TailArrayOptDisabled)
+                                         : UInt8::decode(s.software_version_major, codec, TailArrayOptDisabled));
+        res = (res <= 0) ? res : (encode ? UInt8::encode(s.software_version_minor, codec, TailArrayOptDisabled)
+                                         : UInt8::decode(s.software_version_minor, codec, TailArrayOptDisabled));
+        res = (res <= 0) ? res : (encode ? s.name.encode(s.name, codec, tao_mode)
+                                         : s.name.decode(s.name, codec, tao_mode));
+        return res;
+    }
+};
+
+struct Result
+{
+    double encode_mbps = 0;
+    double decode_mbps = 0;
+    unsigned len = 0;
+};
+
+/**
+ * Span mode encodes into the raw memory of the buffer and decodes from it as from a single-frame payload.
+ */
+template <typename T>
+Result benchmark(TailArrayOptimizationMode tao_mode, bool span_mode)
+{
+    constexpr unsigned NumIterations = 200000;
+    T obj;
+    uavcan::StaticTransferBuffer<512> buf;
+
+    Result result;
+    for (int run = 0; run < 3; run++)
+    {
+        auto started_at = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < NumIterations; i++)
+        {
+            uavcan::BitStream bs = span_mode ? uavcan::BitStream(buf.getRawPtr(), buf.getSize())
+                                             : uavcan::BitStream(buf);
+            ScalarCodec sc(bs);
+            if (T::codec(obj, sc, tao_mode, true) <= 0)
+            {
+                throw std::runtime_error("Encoding failed");
+            }
+            if (span_mode)
+            {
+                buf.setMaxWritePos(std::uint16_t(bs.getSpanLen()));
+            }
+        }
+        auto sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_at).count();
+        result.len = buf.getMaxWritePos();
+        result.encode_mbps = std::max(result.encode_mbps, double(result.len) * NumIterations / sec / 1e6);
+
+        started_at = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < NumIterations; i++)
+        {
+            const std::uint8_t* const payload = buf.getRawPtr();
+            uavcan::BitStream bs = span_mode ? uavcan::BitStream(payload, buf.getMaxWritePos())
+                                             : uavcan::BitStream(buf);
+            ScalarCodec sc(bs);
+            if (T::codec(obj, sc, tao_mode, false) <= 0)
+            {
+                throw std::runtime_error("Decoding failed");
+            }
+        }
+        sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_at).count();
+        result.decode_mbps = std::max(result.decode_mbps, double(result.len) * NumIterations / sec / 1e6);
+    }
+    return result;
+}
+
+template <typename T>
+void run(const char* name, TailArrayOptimizationMode tao_mode = TailArrayOptDisabled)
+{
+    const auto buffer = benchmark<T>(tao_mode, false);
+    const auto span = benchmark<T>(tao_mode, true);
+    std::cout << std::setw(24) << std::left << name << std::right << std::setw(8) << buffer.len
+              << std::fixed << std::setprecision(1)
+              << std::setw(14) << buffer.encode_mbps << std::setw(14) << buffer.decode_mbps
+              << std::setw(14) << span.encode_mbps << std::setw(14) << span.decode_mbps << std::endl;
+}
+
+}
+
+int main()
+{
+    std::cout << std::setw(32) << " " << std::setw(28) << "buffer, MB/s" << std::setw(28) << "span, MB/s" << "\n"
+              << std::setw(24) << std::left << "structure" << std::right << std::setw(8) << "bytes"
+              << std::setw(14) << "encode" << std::setw(14) << "decode"
+              << std::setw(14) << "encode" << std::setw(14) << "decode" << std::endl;
+
+    run<NodeStatus>("NodeStatus");
+    run<RawCommand>("RawCommand", TailArrayOptEnabled);
+    run<AhrsSolution>("AhrsSolution");
+    run<GetNodeInfoResponse>("GetNodeInfo response", TailArrayOptEnabled);
+    run<FileReadResponse>("file.Read response", TailArrayOptEnabled);
+    return 0;
+}
@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2014 Pavel Kirienko <pavel.kirienko@gmail.com>
+ *
+ * Measures the frame throughput between the main node and its sub-nodes running in dedicated threads.
+ * The main thread fans frames out to all sub-nodes and collects the frames they send back, so every frame crosses
+ * the thread boundary twice; no CAN hardware and no actual nodes are involved.
+ *
+ * The lock-free SubNodeHub from uavcan_linux/multithreading.hpp is compared against the mutex and condition
+ * variable based design it replaces.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <uavcan_linux/multithreading.hpp>
+#include "debug.hpp"
+
+namespace
+{
+
+constexpr unsigned RxQueueCapacity = 512;
+constexpr unsigned MaxFramesInFlight = RxQueueCapacity / 2;     ///< Keeps the RX queues from overflowing
+
+/**
+ * Mutex-based virtual driver, the same design as the one that used to live in test_multithreading.cpp.
+ */
+class MutexVirtualCanDriver : public uavcan::ICanDriver,
+                              public uavcan::ICanIface,
+                              uavcan::Noncopyable
+{
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<uavcan_linux::VirtualCanRxItem> rx_queue_;
+    std::deque<uavcan_linux::VirtualCanTxItem> tx_queue_;
+    uavcan_linux::SystemClock clock_;
+
+    std::int16_t send(const uavcan::CanFrame& frame, uavcan::MonotonicTime tx_deadline,
+                      uavcan::CanIOFlags flags) override
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uavcan_linux::VirtualCanTxItem item;
+        item.frame = frame;
+        item.deadline = tx_deadline;
+        item.flags = flags;
+        item.iface_mask = 1;
+        tx_queue_.push_back(item);
+        return 1;
+    }
+
+    std::int16_t receive(uavcan::CanFrame& out_frame, uavcan::MonotonicTime& out_ts_monotonic,
+                         uavcan::UtcTime& out_ts_utc, uavcan::CanIOFlags& out_flags) override
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (rx_queue_.empty())
+        {
+            return 0;
+        }
+        const auto item = rx_queue_.front();
+        rx_queue_.pop_front();
+        out_frame = item.frame;
+        out_ts_monotonic = item.frame.ts_mono;
+        out_ts_utc = item.frame.ts_utc;
+        out_flags = item.flags;
+        return 1;
+    }
+
+    std::int16_t configureFilters(const uavcan::CanFilterConfig*, std::uint16_t) override { return 0; }
+    std::uint16_t getNumFilters() const override { return 0; }
+    std::uint64_t getErrorCount() const override { return 0; }
+
+    uavcan::ICanIface* getIface(std::uint8_t iface_index) override { return (iface_index == 0) ? this : nullptr; }
+    std::uint8_t getNumIfaces() const override { return 1; }
+
+    bool hasDataInRxQueue()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return !rx_queue_.empty();
+    }
+
+    std::int16_t select(uavcan::CanSelectMasks& inout_masks, const uavcan::CanFrame* (&)[uavcan::MaxCanIfaces],
+                        uavcan::MonotonicTime blocking_deadline) override
+    {
+        if ((inout_masks.write == 0) && !hasDataInRxQueue())
+        {
+            std::unique_lock<std::mutex> lk(mutex_);
+            (void)cv_.wait_for(lk, std::chrono::microseconds((blocking_deadline - clock_.getMonotonic()).toUSec()));
+        }
+        inout_masks.write = 1;
+        inout_masks.read = hasDataInRxQueue() ? 1 : 0;
+        return 1;
+    }
+
+public:
+    /**
+     * Overwrites the oldest frame when the queue is full.
+     */
+    void addRxFrame(const uavcan::CanRxFrame& frame, uavcan::CanIOFlags flags)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (rx_queue_.size() >= RxQueueCapacity)
+            {
+                rx_queue_.pop_front();
+            }
+            uavcan_linux::VirtualCanRxItem item;
+            item.frame = frame;
+            item.flags = flags;
+            rx_queue_.push_back(item);
+        }
+        cv_.notify_all();
+    }
+
+    template <typename Handler>
+    unsigned flushTxQueue(Handler handler)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const unsigned num_frames = unsigned(tx_queue_.size());
+        for (auto& x : tx_queue_)
+        {
+            handler(x);
+        }
+        tx_queue_.clear();
+        return num_frames;
+    }
+};
+
+/**
+ * Exposes the same interface as uavcan_linux::SubNodeHub.
+ */
+class MutexHub
+{
+    std::vector<std::shared_ptr<MutexVirtualCanDriver>> drivers_;
+
+public:
+    std::shared_ptr<uavcan::ICanDriver> makeSubNodeDriver(unsigned, std::size_t)
+    {
+        drivers_.emplace_back(new MutexVirtualCanDriver);
+        return drivers_.back();
+    }
+
+    void handleRxFrame(const uavcan::CanRxFrame& frame, uavcan::CanIOFlags flags)
+    {
+        for (auto& d : drivers_)
+        {
+            d->addRxFrame(frame, flags);
+        }
+    }
+
+    template <typename Handler>
+    unsigned drainTxFrames(Handler handler)
+    {
+        unsigned num_frames = 0;
+        for (auto& d : drivers_)
+        {
+            num_frames += d->flushTxQueue(handler);
+        }
+        return num_frames;
+    }
+};
+
+/**
+ * Receives frames and sends every one of them back until stopped.
+ */
+void runSubNode(uavcan::ICanDriver& driver, std::atomic<std::uint64_t>& num_received, const std::atomic<bool>& stop)
+{
+    uavcan_linux::SystemClock clock;
+    uavcan::ICanIface& iface = *driver.getIface(0);
+
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        uavcan::CanSelectMasks masks;
+        masks.read = 1;
+        const uavcan::CanFrame* pending_tx[uavcan::MaxCanIfaces] = { };
+        (void)driver.select(masks, pending_tx, clock.getMonotonic() + uavcan::MonotonicDuration::fromMSec(10));
+
+        uavcan::CanFrame frame;
+        uavcan::MonotonicTime ts_mono;
+        uavcan::UtcTime ts_utc;
+        uavcan::CanIOFlags flags = 0;
+        while (iface.receive(frame, ts_mono, ts_utc, flags) > 0)
+        {
+            while ((iface.send(frame, ts_mono, 0) <= 0) && !stop.load(std::memory_order_relaxed))
+            {
+                std::this_thread::yield();
+            }
+            num_received.fetch_add(1, std::memory_order_release);
+        }
+    }
+}
+
+/**
+ * Returns frames per second that crossed the thread boundary, in either direction.
+ */
+template <typename Hub>
+double runOnce(Hub& hub, unsigned num_sub_nodes, unsigned num_frames)
+{
+    std::vector<std::shared_ptr<uavcan::ICanDriver>> drivers;
+    std::vector<std::unique_ptr<std::atomic<std::uint64_t>>> counters;
+    for (unsigned i = 0; i < num_sub_nodes; i++)
+    {
+        drivers.push_back(hub.makeSubNodeDriver(1, RxQueueCapacity));
+        counters.emplace_back(new std::atomic<std::uint64_t>(0));
+    }
+
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < num_sub_nodes; i++)
+    {
+        threads.emplace_back([&, i]() { runSubNode(*drivers[i], *counters[i], stop); });
+    }
+
+    auto min_received = [&]()
+    {
+        std::uint64_t res = counters[0]->load(std::memory_order_acquire);
+        for (auto& c : counters)
+        {
+            res = std::min<std::uint64_t>(res, c->load(std::memory_order_acquire));
+        }
+        return res;
+    };
+
+    std::uint64_t num_tx_frames = 0;
+    auto drain = [&]()
+    {
+        num_tx_frames += hub.drainTxFrames([](const uavcan_linux::VirtualCanTxItem&) { });
+    };
+
+    uavcan::CanRxFrame frame;
+    frame.id = 123 | uavcan::CanFrame::FlagEFF;
+    frame.dlc = 8;
+
+    const auto started_at = std::chrono::steady_clock::now();
+
+    for (unsigned i = 0; i < num_frames; i++)
+    {
+        while ((i - min_received()) >= MaxFramesInFlight)
+        {
+            drain();
+            std::this_thread::yield();
+        }
+        frame.data[0] = std::uint8_t(i);
+        hub.handleRxFrame(frame, 0);
+        if ((i % 16) == 0)
+        {
+            drain();
+        }
+    }
+
+    const std::uint64_t expected_tx_frames = std::uint64_t(num_frames) * num_sub_nodes;
+    while (num_tx_frames < expected_tx_frames)
+    {
+        drain();
+        std::this_thread::yield();
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - started_at;
+
+    stop = true;
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    ENFORCE(num_tx_frames == expected_tx_frames);
+
+    const double sec = double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) * 1e-9;
+    return double(expected_tx_frames * 2) / sec;
+}
+
+template <typename Hub>
+double runBest(unsigned num_sub_nodes, unsigned num_frames)
+{
+    double best = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        Hub hub;
+        best = std::max(best, runOnce(hub, num_sub_nodes, num_frames));
+    }
+    return best;
+}
+
+}
+
+int main(int argc, const char** argv)
+{
+    const unsigned num_frames = (argc > 1) ? unsigned(std::stoul(argv[1])) : 200000;
+
+    std::cout << "Frames per run: " << num_frames << "\n"
+              << std::setw(10) << "sub-nodes" << std::setw(16) << "mutex, fr/s" << std::setw(16) << "lock-free, fr/s"
+              << std::setw(10) << "ratio" << std::endl;
+
+    for (unsigned num_sub_nodes : { 1U, 4U, 8U })
+    {
+        const double mutex = runBest<MutexHub>(num_sub_nodes, num_frames);
+        const double lock_free = runBest<uavcan_linux::SubNodeHub>(num_sub_nodes, num_frames);
+        std::cout << std::setw(10) << num_sub_nodes
+                  << std::setw(16) << std::fixed << std::setprecision(0) << mutex
+                  << std::setw(16) << lock_free
+                  << std::setw(10) << std::setprecision(2) << (lock_free / mutex) << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2014 Pavel Kirienko <pavel.kirienko@gmail.com>
+ *
+ * Measures the cost of OutgoingTransferRegistry::accessOrCreate(), which is invoked by every transfer sender on every
+ * message publication and service call, depending on the number of remote nodes the local node calls services of.
+ * The previous implementation, a Map<> of the same keys allocated from the memory pool, is included for comparison.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <uavcan/transport/outgoing_transfer_registry.hpp>
+#include <uavcan/util/map.hpp>
+#include "debug.hpp"
+
+namespace
+{
+
+const unsigned NumPublishers = 16;
+const unsigned NumServices = 4;
+
+class MapRegistry
+{
+    struct Value
+    {
+        uavcan::MonotonicTime deadline;
+        uavcan::TransferID tid;
+    };
+
+    uavcan::Map<uavcan::OutgoingTransferRegistryKey, Value> map_;
+
+public:
+    explicit MapRegistry(uavcan::IPoolAllocator& allocator)
+        : map_(allocator)
+    { }
+
+    uavcan::TransferID* accessOrCreate(const uavcan::OutgoingTransferRegistryKey& key,
+                                       uavcan::MonotonicTime new_deadline)
+    {
+        Value* p = map_.access(key);
+        if (p == UAVCAN_NULLPTR)
+        {
+            p = map_.insert(key, Value());
+            if (p == UAVCAN_NULLPTR)
+            {
+                return UAVCAN_NULLPTR;
+            }
+        }
+        p->deadline = new_deadline;
+        return &p->tid;
+    }
+};
+
+/**
+ * Broadcast keys of the local publishers, followed by the service request keys per remote node.
+ */
+std::vector<uavcan::OutgoingTransferRegistryKey> makeKeys(unsigned num_peers)
+{
+    std::vector<uavcan::OutgoingTransferRegistryKey> keys;
+    for (unsigned i = 0; i < NumPublishers; i++)
+    {
+        keys.push_back(uavcan::OutgoingTransferRegistryKey(std::uint16_t(20000 + i),
+                                                           uavcan::TransferTypeMessageBroadcast,
+                                                           uavcan::NodeID::Broadcast));
+    }
+    for (unsigned peer = 0; peer < num_peers; peer++)
+    {
+        for (unsigned i = 0; i < NumServices; i++)
+        {
+            keys.push_back(uavcan::OutgoingTransferRegistryKey(std::uint16_t(200 + i),
+                                                               uavcan::TransferTypeServiceRequest,
+                                                               std::uint8_t(1 + peer)));
+        }
+    }
+    return keys;
+}
+
+/**
+ * Returns nanoseconds per access, where every other access is a publication and the rest are service calls.
+ */
+template <typename Registry>
+double measure(Registry& registry, const std::vector<uavcan::OutgoingTransferRegistryKey>& keys)
+{
+    const unsigned NumAccesses = 4000000;
+    const auto deadline = uavcan::MonotonicTime::fromMSec(1000000);
+    unsigned checksum = 0;
+    double best = 1e9;
+
+    for (int run = 0; run < 3; run++)
+    {
+        unsigned service_index = NumPublishers;
+        const auto started_at = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < NumAccesses; i++)
+        {
+            unsigned index = i % NumPublishers;
+            if ((i & 1U) != 0)
+            {
+                index = service_index;
+                service_index = (service_index + 1 < keys.size()) ? (service_index + 1) : NumPublishers;
+            }
+            uavcan::TransferID* const tid = registry.accessOrCreate(keys[index], deadline);
+            ENFORCE(tid != UAVCAN_NULLPTR);
+            tid->increment();
+            checksum += tid->get();
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - started_at;
+        best = std::min(best, double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) /
+                              NumAccesses);
+    }
+    ENFORCE(checksum > 0);
+    return best;
+}
+
+}
+
+int main()
+{
+    std::cout << std::setw(8) << "peers" << std::setw(8) << "keys"
+              << std::setw(16) << "map ns/access" << std::setw(16) << "hash ns/access" << std::endl;
+
+    const unsigned NumPeers[] = { 1, 8, 32, 100 };
+    for (unsigned num_peers : NumPeers)
+    {
+        const auto keys = makeKeys(num_peers);
+        if (keys.size() > unsigned(uavcan::OutgoingTransferRegistry::Capacity))
+        {
+            std::cout << "Registry capacity " << unsigned(uavcan::OutgoingTransferRegistry::Capacity)
+                      << " is too small for " << keys.size() << " keys" << std::endl;
+            return 1;
+        }
+
+        uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 1024, uavcan::MemPoolBlockSize> pool;
+        MapRegistry map_registry(pool);
+        const double map_ns = measure(map_registry, keys);
+
+        uavcan::OutgoingTransferRegistry hash_registry;
+        const double hash_ns = measure(hash_registry, keys);
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << std::setw(8) << num_peers << std::setw(8) << keys.size()
+                  << std::setw(16) << map_ns << std::setw(16) << hash_ns << std::endl;
+    }
+    return 0;
+}
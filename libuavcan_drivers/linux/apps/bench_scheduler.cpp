@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2014 Pavel Kirienko <pavel.kirienko@gmail.com>
+ *
+ * Measures the cost of starting, stopping and firing deadline handlers versus the number of running handlers.
+ * The clock is driven manually, so the results do not depend on the system timer.
+ *
+ * Rebuild with -DUAVCAN_DEADLINE_SCHEDULER_HEAP=0 to compare against the sorted linked list.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <random>
+#include <uavcan/node/scheduler.hpp>
+#include "debug.hpp"
+
+namespace
+{
+
+class ManualClock : public uavcan::ISystemClock
+{
+public:
+    uavcan::MonotonicTime monotonic = uavcan::MonotonicTime::fromUSec(1000);
+
+    uavcan::MonotonicTime getMonotonic() const override { return monotonic; }
+    uavcan::UtcTime getUtc() const override { return uavcan::UtcTime(); }
+    void adjustUtc(uavcan::UtcDuration) override { }
+};
+
+class NullCanIface : public uavcan::ICanIface
+{
+public:
+    std::int16_t send(const uavcan::CanFrame&, uavcan::MonotonicTime, uavcan::CanIOFlags) override { return 1; }
+
+    std::int16_t receive(uavcan::CanFrame&, uavcan::MonotonicTime&, uavcan::UtcTime&, uavcan::CanIOFlags&) override
+    {
+        return 0;
+    }
+
+    std::int16_t configureFilters(const uavcan::CanFilterConfig*, std::uint16_t) override { return 0; }
+    std::uint16_t getNumFilters() const override { return 0; }
+    std::uint64_t getErrorCount() const override { return 0; }
+};
+
+class NullCanDriver : public uavcan::ICanDriver
+{
+    NullCanIface iface_;
+
+public:
+    uavcan::ICanIface* getIface(std::uint8_t iface_index) override
+    {
+        return (iface_index == 0) ? &iface_ : nullptr;
+    }
+
+    std::uint8_t getNumIfaces() const override { return 1; }
+
+    std::int16_t select(uavcan::CanSelectMasks& inout_masks, const uavcan::CanFrame* (&)[uavcan::MaxCanIfaces],
+                        uavcan::MonotonicTime) override
+    {
+        inout_masks = uavcan::CanSelectMasks();
+        return 0;
+    }
+};
+
+class CountingHandler : public uavcan::DeadlineHandler
+{
+public:
+    unsigned num_deadlines = 0;
+
+    explicit CountingHandler(uavcan::Scheduler& scheduler) : uavcan::DeadlineHandler(scheduler) { }
+
+    void handleDeadline(uavcan::MonotonicTime) override { num_deadlines++; }
+};
+
+struct Result
+{
+    double start_ns = 0;
+    double stop_ns = 0;
+    double fire_ns = 0;
+};
+
+double nsPerOp(std::chrono::steady_clock::duration elapsed, unsigned num_ops)
+{
+    return double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / num_ops;
+}
+
+/**
+ * Each handler gets a random deadline within one second, like service calls issued at random times.
+ * Stopping and firing is done in random order and in deadline order respectively.
+ */
+Result runOnce(unsigned num_handlers, unsigned num_rounds)
+{
+    static uavcan::PoolAllocator<uavcan::MemPoolBlockSize * 64, uavcan::MemPoolBlockSize> pool;
+    ManualClock clock;
+    NullCanDriver driver;
+    uavcan::Scheduler scheduler(driver, pool, clock);
+    uavcan::DeadlineScheduler& ds = scheduler.getDeadlineScheduler();
+
+    std::vector<std::unique_ptr<CountingHandler>> handlers;
+    for (unsigned i = 0; i < num_handlers; i++)
+    {
+        handlers.emplace_back(new CountingHandler(scheduler));
+    }
+
+    std::mt19937 rng(42);
+    std::vector<std::uint64_t> deadlines(num_handlers);
+    std::vector<unsigned> stop_order(num_handlers);
+    for (unsigned i = 0; i < num_handlers; i++)
+    {
+        stop_order[i] = i;
+    }
+
+    std::chrono::steady_clock::duration start_time{};
+    std::chrono::steady_clock::duration stop_time{};
+    std::chrono::steady_clock::duration fire_time{};
+
+    for (unsigned round = 0; round < num_rounds; round++)
+    {
+        const std::uint64_t now = clock.monotonic.toUSec();
+        for (auto& x : deadlines)
+        {
+            x = now + 1 + rng() % 1000000U;
+        }
+        std::shuffle(stop_order.begin(), stop_order.end(), rng);
+
+        auto started_at = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < num_handlers; i++)
+        {
+            handlers[i]->startWithDeadline(uavcan::MonotonicTime::fromUSec(deadlines[i]));
+        }
+        start_time += std::chrono::steady_clock::now() - started_at;
+        ENFORCE(ds.getNumHandlers() == num_handlers);
+
+        started_at = std::chrono::steady_clock::now();
+        for (unsigned i : stop_order)
+        {
+            handlers[i]->stop();
+        }
+        stop_time += std::chrono::steady_clock::now() - started_at;
+        ENFORCE(ds.getNumHandlers() == 0);
+
+        for (unsigned i = 0; i < num_handlers; i++)
+        {
+            handlers[i]->startWithDeadline(uavcan::MonotonicTime::fromUSec(deadlines[i]));
+        }
+        clock.monotonic += uavcan::MonotonicDuration::fromMSec(1001);
+
+        started_at = std::chrono::steady_clock::now();
+        (void)ds.pollAndGetMonotonicTime(clock);
+        fire_time += std::chrono::steady_clock::now() - started_at;
+        ENFORCE(ds.getNumHandlers() == 0);
+    }
+
+    for (auto& h : handlers)
+    {
+        ENFORCE(h->num_deadlines == num_rounds);
+    }
+
+    Result res;
+    res.start_ns = nsPerOp(start_time, num_handlers * num_rounds);
+    res.stop_ns = nsPerOp(stop_time, num_handlers * num_rounds);
+    res.fire_ns = nsPerOp(fire_time, num_handlers * num_rounds);
+    return res;
+}
+
+}
+
+int main()
+{
+    std::cout << "Heap scheduler: " << UAVCAN_DEADLINE_SCHEDULER_HEAP << "\n"
+              << std::setw(10) << "handlers" << std::setw(14) << "start, ns" << std::setw(14) << "stop, ns"
+              << std::setw(14) << "fire, ns" << std::endl;
+
+    for (unsigned num_handlers : { 10U, 100U, 1000U })
+    {
+        const unsigned num_rounds = std::max(1U, 200000U / num_handlers);
+        Result best;
+        for (int i = 0; i < 3; i++)
+        {
+            const Result x = runOnce(num_handlers, num_rounds);
+            best.start_ns = (i == 0) ? x.start_ns : std::min(best.start_ns, x.start_ns);
+            best.stop_ns = (i == 0) ? x.stop_ns : std::min(best.stop_ns, x.stop_ns);
+            best.fire_ns = (i == 0) ? x.fire_ns : std::min(best.fire_ns, x.fire_ns);
+        }
+        std::cout << std::setw(10) << num_handlers << std::fixed << std::setprecision(1)
+                  << std::setw(14) << best.start_ns << std::setw(14) << best.stop_ns
+                  << std::setw(14) << best.fire_ns << std::endl;
+    }
+    return 0;
+}
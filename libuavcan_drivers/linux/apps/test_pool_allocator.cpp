@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2014 Pavel Kirienko <pavel.kirienko@gmail.com>
+ *
+ * Checks the size class selection and the statistics of the size class pool allocator, and that the blocks cached
+ * by the threads are not lost; then hammers it from several threads at once, verifying that no block is ever handed
+ * out twice.
+ */
+
+#include <iostream>
+#include <thread>
+#include <future>
+#include <random>
+#include <cstring>
+#include <uavcan_linux/uavcan_linux.hpp>
+#include "debug.hpp"
+
+namespace
+{
+
+void testSingleThreaded()
+{
+    uavcan_linux::SizeClassPoolAllocator pool({ { 32, 4 }, { uavcan::MemPoolBlockSize, 2 } });
+
+    ENFORCE(pool.getNumSizeClasses() == 2);
+    ENFORCE(pool.getBlockCapacity() == 2);      // Only the class of MemPoolBlockSize
+
+    // Small requests take small blocks first, then overflow into the larger class
+    void* small[7] = {};
+    for (auto& p : small)
+    {
+        p = pool.allocate(20);
+    }
+    ENFORCE(small[5] != nullptr);
+    ENFORCE(small[6] == nullptr);
+    ENFORCE(pool.getSizeClassStats(0).num_used == 4);
+    ENFORCE(pool.getSizeClassStats(1).num_used == 2);
+    ENFORCE(pool.getSizeClassStats(0).num_exhausted == 3);
+    ENFORCE(pool.getSizeClassStats(1).num_exhausted == 1);
+    ENFORCE(pool.allocate(uavcan::MemPoolBlockSize) == nullptr);
+    ENFORCE(pool.allocate(uavcan::MemPoolBlockSize + 1) == nullptr);
+
+    for (auto p : small)
+    {
+        pool.deallocate(p);
+    }
+    ENFORCE(pool.getNumUsedBlocks() == 0);
+    ENFORCE(pool.getSizeClassStats(0).peak_num_used == 4);
+    ENFORCE(pool.getSizeClassStats(1).peak_num_used == 2);
+
+    // Large requests skip the small class
+    void* const large = pool.allocate(uavcan::MemPoolBlockSize);
+    ENFORCE(large != nullptr);
+    ENFORCE(pool.getSizeClassStats(0).num_used == 0);
+    ENFORCE(pool.getSizeClassStats(1).num_used == 1);
+    pool.deallocate(large);
+
+    pool.flushThreadCache();
+    ENFORCE(pool.getNumUsedBlocks() == 0);
+
+    // Invalid configurations
+    bool thrown = false;
+    try
+    {
+        uavcan_linux::SizeClassPoolAllocator invalid({ { 64, 4 }, { 32, 4 } });
+    }
+    catch (const uavcan_linux::Exception&)
+    {
+        thrown = true;
+    }
+    ENFORCE(thrown);
+}
+
+void testThreadCaches()
+{
+    constexpr unsigned NumBlocks = 4;
+    static_assert(NumBlocks <= uavcan_linux::SizeClassPoolAllocator::ThreadCacheSize, "Must fit the cache");
+
+    uavcan_linux::SizeClassPoolAllocator pool({ { uavcan::MemPoolBlockSize, NumBlocks } });
+    const auto get_num_exhausted = [&pool]() { return pool.getSizeClassStats(0).num_exhausted; };
+
+    /*
+     * Threads that exit without flushing their caches still return the cached blocks, and their cache slots
+     * are reused by the next threads
+     */
+    for (unsigned i = 0; i < uavcan_linux::SizeClassPoolAllocator::MaxThreads * 2; i++)
+    {
+        std::thread([&pool]() { pool.deallocate(pool.allocate(1)); }).join();
+    }
+
+    auto num_exhausted = get_num_exhausted();
+    std::vector<void*> blocks;
+    for (unsigned i = 0; i < NumBlocks; i++)
+    {
+        blocks.push_back(pool.allocate(1));
+        ENFORCE(blocks.back() != nullptr);
+    }
+    ENFORCE(get_num_exhausted() == num_exhausted);      // All blocks were in the shared stack
+    ENFORCE(pool.allocate(1) == nullptr);
+    for (auto p : blocks)
+    {
+        pool.deallocate(p);
+    }
+    blocks.clear();
+    pool.flushThreadCache();
+
+    /*
+     * The blocks cached by a live thread are taken from its cache when the rest of the pool is exhausted
+     */
+    std::promise<void> blocks_cached;
+    std::promise<void> done;
+    std::thread holder([&]()
+        {
+            std::vector<void*> held;
+            for (unsigned i = 0; i < NumBlocks; i++)
+            {
+                held.push_back(pool.allocate(1));
+            }
+            for (auto p : held)
+            {
+                pool.deallocate(p);     // This thread has a cache, since the slots of the exited threads are free
+            }
+            blocks_cached.set_value();
+            done.get_future().wait();
+        });
+    blocks_cached.get_future().wait();
+
+    num_exhausted = get_num_exhausted();
+    for (unsigned i = 0; i < NumBlocks; i++)
+    {
+        blocks.push_back(pool.allocate(1));
+        ENFORCE(blocks.back() != nullptr);
+    }
+    ENFORCE(get_num_exhausted() == num_exhausted + NumBlocks);     // Every block was taken from the holder
+    ENFORCE(pool.getNumUsedBlocks() == NumBlocks);
+    for (auto p : blocks)
+    {
+        pool.deallocate(p);
+    }
+    pool.flushThreadCache();
+
+    done.set_value();
+    holder.join();
+    ENFORCE(pool.getNumUsedBlocks() == 0);
+}
+
+void testMultiThreaded()
+{
+    constexpr unsigned NumThreads = 4;
+    constexpr unsigned NumIterations = 1000000;
+    constexpr unsigned MaxHeldBlocks = 64;
+
+    uavcan_linux::SizeClassPoolAllocator pool({ { 32, 256 }, { uavcan::MemPoolBlockSize, 256 } });
+    std::atomic<bool> failed(false);
+
+    auto worker = [&](unsigned thread_index)
+    {
+        std::mt19937 rng(thread_index);
+        std::vector<std::pair<std::uint8_t*, std::size_t>> held;
+        const std::uint8_t pattern = std::uint8_t(thread_index + 1);
+
+        for (unsigned i = 0; (i < NumIterations) && !failed; i++)
+        {
+            if (held.empty() || ((held.size() < MaxHeldBlocks) && (rng() % 2 == 0)))
+            {
+                const std::size_t size = (rng() % 2 == 0) ? 24 : uavcan::MemPoolBlockSize;
+                auto p = static_cast<std::uint8_t*>(pool.allocate(size));
+                if (p != nullptr)
+                {
+                    std::memset(p, pattern, size);
+                    held.emplace_back(p, size);
+                }
+            }
+            else
+            {
+                const std::size_t index = rng() % held.size();
+                const auto item = held[index];
+                for (std::size_t k = 0; k < item.second; k++)
+                {
+                    if (item.first[k] != pattern)
+                    {
+                        failed = true;      // Someone else owns this block
+                    }
+                }
+                pool.deallocate(item.first);
+                held[index] = held.back();
+                held.pop_back();
+            }
+        }
+
+        for (auto& item : held)
+        {
+            pool.deallocate(item.first);
+        }
+        pool.flushThreadCache();
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < NumThreads; i++)
+    {
+        threads.emplace_back(worker, i);
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    ENFORCE(!failed);
+    ENFORCE(pool.getNumUsedBlocks() == 0);
+
+    for (unsigned i = 0; i < pool.getNumSizeClasses(); i++)
+    {
+        const auto stats = pool.getSizeClassStats(i);
+        std::cout << "Size class " << stats.block_size << ": capacity " << stats.capacity
+                  << ", peak used " << stats.peak_num_used << ", exhausted " << stats.num_exhausted << std::endl;
+        ENFORCE(stats.peak_num_used <= stats.capacity);
+    }
+
+    // All blocks must be allocatable again once the caches are flushed
+    std::vector<void*> all;
+    while (void* p = pool.allocate(1))
+    {
+        all.push_back(p);
+    }
+    ENFORCE(all.size() == pool.getSizeClassStats(0).capacity + pool.getSizeClassStats(1).capacity);
+    for (auto p : all)
+    {
+        pool.deallocate(p);
+    }
+}
+
+}
+
+int main()
+{
+    try
+    {
+        testSingleThreaded();
+        testThreadCaches();
+        testMultiThreaded();
+        std::cout << "OK" << std::endl;
+        return 0;
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Exception: " << ex.what() << std::endl;
+        return 1;
+    }
+}
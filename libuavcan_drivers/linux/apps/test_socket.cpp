@@ -4,7 +4,11 @@
 
 #include <iostream>
 #include <vector>
+#include <thread>
+#include <chrono>
 #include <cerrno>
+#include <sys/socket.h>
+#include <linux/can.h>
 #include <uavcan_linux/uavcan_linux.hpp>
 #include "debug.hpp"
 
@@ -130,6 +134,63 @@ static void testSocketRxTx(const std::string& iface_name)
     ENFORCE(!if2.hasReadyRx());
 }
 
+/**
+ * The iface is attached to a datagram socket pair instead of a CAN socket, so that the socket can be made
+ * unwritable on demand. No loopback is ever received, so the socket TX queue limit is never released.
+ */
+static void testSocketTxBatch()
+{
+    int fds[2] = { -1, -1 };
+    ENFORCE(0 == ::socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, fds));
+    const int peer_fd = fds[1];
+
+    const uavcan_linux::SystemClock clock;
+    uavcan_linux::SocketCanIface iface(clock, fds[0]);     // Takes ownership of the descriptor
+
+    // Filling the socket up, so that the frames pile up in the user space TX queue
+    const std::uint8_t junk[16] = {};
+    unsigned num_junk = 0;
+    while (::send(fds[0], junk, sizeof(junk), MSG_DONTWAIT) > 0)
+    {
+        num_junk++;
+    }
+    ENFORCE(errno == EAGAIN);
+
+    const unsigned NumFrames = 8;
+    static_assert(NumFrames > uavcan_linux::SocketCanIface::DefaultMaxFramesInSocketTxQueue, "Test is meaningless");
+    ENFORCE(NumFrames <= num_junk);
+    for (unsigned i = 0; i < NumFrames; i++)
+    {
+        ENFORCE(1 == iface.send(makeFrame(100 + i, "batch"), tsMonoOffsetMs(1000), 0));
+    }
+    ENFORCE(iface.hasReadyTx());
+    ENFORCE(0 == iface.getErrorCount());
+
+    for (unsigned i = 0; i < num_junk; i++)
+    {
+        std::uint8_t buf[16];
+        ENFORCE(::recv(peer_fd, buf, sizeof(buf), MSG_DONTWAIT) == sizeof(buf));
+    }
+
+    /*
+     * The whole backlog goes out with one write poll, although the socket TX queue limit is lower
+     */
+    iface.poll(false, true);
+    ENFORCE(!iface.hasReadyTx());
+    ENFORCE(0 == iface.getErrorCount());
+
+    for (unsigned i = 0; i < NumFrames; i++)
+    {
+        ::can_frame frame = ::can_frame();
+        ENFORCE(::recv(peer_fd, &frame, sizeof(frame), MSG_DONTWAIT) == sizeof(frame));
+        ENFORCE((frame.can_id & CAN_SFF_MASK) == (100 + i));
+    }
+    std::uint8_t buf[16];
+    ENFORCE(::recv(peer_fd, buf, sizeof(buf), MSG_DONTWAIT) < 0);   // Nothing else
+
+    (void)::close(peer_fd);
+}
+
 static void testSocketFilters(const std::string& iface_name)
 {
     using uavcan::CanFrame;
@@ -209,8 +270,113 @@ static void testSocketFilters(const std::string& iface_name)
     ENFORCE(flags == 0);
 
     ENFORCE(!if2.hasReadyRx());
+
+    /*
+     * The filters are applied by the kernel, but the loopback of own frames that they reject must still arrive,
+     * otherwise the TX queue of 2 would stall. A foreign frame that only matches the loopback filter is dropped.
+     */
+    ENFORCE(if2.isKernelFilteringActive());
+    for (int i = 0; i < 5; i++)
+    {
+        ENFORCE(1 == if2.send(makeFrame(0x1000 | 42 | EFF, "8"), tsMonoOffsetMs(100), uavcan::CanIOFlagLoopback));
+    }
+    ENFORCE(1 == if1.send(makeFrame(0x2000 | 42 | EFF, "9"), tsMonoOffsetMs(100), 0));   // Drop
+
+    for (int i = 0; i < 10; i++)
+    {
+        if1.poll(true, true);
+        if2.poll(true, true);
+    }
+    ENFORCE(!if2.hasReadyTx());
+    ENFORCE(0 == if2.getErrorCount());
+
+    for (int i = 0; i < 5; i++)
+    {
+        ENFORCE(1 == if2.receive(frame, ts_mono, ts_utc, flags));
+        ENFORCE(frame == makeFrame(0x1000 | 42 | EFF, "8"));
+        ENFORCE(flags == uavcan::CanIOFlagLoopback);
+    }
+    ENFORCE(!if2.hasReadyRx());
+
+    /*
+     * Too many filters for the kernel - falling back to user space filtering
+     */
+    std::vector<uavcan::CanFilterConfig> many_fcs(uavcan_linux::SocketCanIface::MaxKernelFilters + 1);
+    for (unsigned i = 0; i < many_fcs.size(); i++)
+    {
+        many_fcs[i].id = (1000 + i) | EFF;
+        many_fcs[i].mask = CanFrame::MaskExtID | EFF;
+    }
+    ENFORCE(0 == if2.configureFilters(many_fcs.data(), std::uint16_t(many_fcs.size())));
+    ENFORCE(!if2.isKernelFilteringActive());
+
+    ENFORCE(1 == if1.send(makeFrame(1000 | EFF, "a"), tsMonoOffsetMs(100), 0));         // Accept
+    ENFORCE(1 == if1.send(makeFrame(999 | EFF,  "b"), tsMonoOffsetMs(100), 0));         // Drop
+    for (int i = 0; i < 4; i++)
+    {
+        if1.poll(true, true);
+        if2.poll(true, false);
+    }
+    ENFORCE(1 == if2.receive(frame, ts_mono, ts_utc, flags));
+    ENFORCE(frame == makeFrame(1000 | EFF, "a"));
+    ENFORCE(!if2.hasReadyRx());
 }
 
+#if UAVCAN_CAN_FD
+/**
+ * Requires an iface with the CAN FD MTU, e.g. "ip link set vcan0 mtu 72".
+ */
+static void testSocketCanFd(const std::string& iface_name)
+{
+    const int sock1 = uavcan_linux::SocketCanIface::openSocket(iface_name);
+    const int sock2 = uavcan_linux::SocketCanIface::openSocket(iface_name);
+    ENFORCE(sock1 >= 0 && sock2 >= 0);
+
+    const uavcan_linux::SystemClock clock;
+    uavcan_linux::SocketCanIface if1(clock, sock1);
+    uavcan_linux::SocketCanIface if2(clock, sock2, uavcan_linux::SocketCanIface::DefaultMaxFramesInSocketTxQueue, 1);
+
+    const std::string data64 = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+    const auto EFF = uavcan::CanFrame::FlagEFF;
+
+    // Both batched and plain IO
+    ENFORCE(1 == if1.send(makeFrame(1 | EFF, data64), tsMonoOffsetMs(100), uavcan::CanIOFlagLoopback));
+    ENFORCE(1 == if1.send(makeFrame(2 | EFF, data64.substr(0, 12)), tsMonoOffsetMs(100), 0));
+    ENFORCE(1 == if2.send(makeFrame(3 | EFF, "classic"), tsMonoOffsetMs(100), 0));
+    ENFORCE(1 == if2.send(makeFrame(4 | EFF, data64.substr(0, 48)), tsMonoOffsetMs(100), 0));
+
+    for (int i = 0; i < 10; i++)
+    {
+        if1.poll(true, true);
+        if2.poll(true, true);
+    }
+    ENFORCE(!if1.hasReadyTx());
+    ENFORCE(!if2.hasReadyTx());
+    ENFORCE(0 == if1.getErrorCount());
+    ENFORCE(0 == if2.getErrorCount());
+
+    uavcan::CanFrame frame;
+    uavcan::MonotonicTime ts_mono;
+    uavcan::UtcTime ts_utc;
+    uavcan::CanIOFlags flags = 0;
+
+    ENFORCE(1 == if1.receive(frame, ts_mono, ts_utc, flags));
+    ENFORCE(frame == makeFrame(1 | EFF, data64));
+    ENFORCE(flags == uavcan::CanIOFlagLoopback);
+    ENFORCE(1 == if1.receive(frame, ts_mono, ts_utc, flags));
+    ENFORCE(frame == makeFrame(3 | EFF, "classic"));
+    ENFORCE(1 == if1.receive(frame, ts_mono, ts_utc, flags));
+    ENFORCE(frame == makeFrame(4 | EFF, data64.substr(0, 48)));
+    ENFORCE(!if1.hasReadyRx());
+
+    ENFORCE(1 == if2.receive(frame, ts_mono, ts_utc, flags));
+    ENFORCE(frame == makeFrame(1 | EFF, data64));
+    ENFORCE(1 == if2.receive(frame, ts_mono, ts_utc, flags));
+    ENFORCE(frame == makeFrame(2 | EFF, data64.substr(0, 12)));
+    ENFORCE(!if2.hasReadyRx());
+}
+#endif
+
 static void testDriver(const std::vector<std::string>& iface_names)
 {
     /*
@@ -332,6 +498,56 @@ static void testDriver(const std::vector<std::string>& iface_names)
     }
 }
 
+static void testEpollWakeup(const std::string& iface_name)
+{
+    uavcan_linux::SystemClock clock;
+    uavcan_linux::EpollSocketCanDriver driver(clock);
+    ENFORCE(0 == driver.addIface(iface_name));
+
+    /*
+     * Driver level - the wakeup is reported via the select masks exactly once
+     */
+    const uavcan::CanFrame* pending_tx[uavcan::MaxCanIfaces] = {};
+    uavcan::CanSelectMasks masks;
+    driver.wakeup();
+    masks.read = 1;
+    ENFORCE(0 <= driver.select(masks, pending_tx, tsMonoOffsetMs(1000)));
+    ENFORCE(masks.wakeup);
+
+    masks = uavcan::CanSelectMasks();
+    masks.read = 1;
+    ENFORCE(0 <= driver.select(masks, pending_tx, tsMonoOffsetMs(10)));
+    ENFORCE(!masks.wakeup);
+
+    /*
+     * Node level - a wakeup from another thread makes spin() return well before its deadline
+     */
+    uavcan_linux::Node node(driver, clock);
+
+    const auto started_at = std::chrono::steady_clock::now();
+    std::thread waker([&driver]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            driver.wakeup();
+        });
+    const int res = node.spin(uavcan::MonotonicDuration::fromMSec(5000));
+    const auto elapsed = std::chrono::steady_clock::now() - started_at;
+    waker.join();
+
+    std::cout << "Spin returned after "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms" << std::endl;
+    ENFORCE(res >= 0);
+    ENFORCE(elapsed >= std::chrono::milliseconds(50));
+    ENFORCE(elapsed < std::chrono::milliseconds(1000));
+
+    /*
+     * Without the wakeup the duration is honored
+     */
+    const auto restarted_at = std::chrono::steady_clock::now();
+    ENFORCE(0 <= node.spin(uavcan::MonotonicDuration::fromMSec(100)));
+    ENFORCE((std::chrono::steady_clock::now() - restarted_at) >= std::chrono::milliseconds(100));
+}
+
 int main(int argc, const char** argv)
 {
     try
@@ -349,10 +565,15 @@ int main(int argc, const char** argv)
         }
 
         testNonexistentIface();
+        testSocketTxBatch();
         testSocketRxTx(iface_names[0]);
         testSocketFilters(iface_names[0]);
+#if UAVCAN_CAN_FD
+        testSocketCanFd(iface_names[0]);
+#endif
 
         testDriver(iface_names);
+        testEpollWakeup(iface_names[0]);
 
         return 0;
     }
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2014 Pavel Kirienko <pavel.kirienko@gmail.com>
+ *
+ * Checks that the frames sent by a sub-node reach the bus promptly while the main node blocks in spin() for a long
+ * time. The SubNodeHub wakes up the main node via EpollSocketCanDriver::wakeup(), which makes Node::spin() return,
+ * so that the frames can be injected into the TX queue of the main node.
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+#include <linux/can.h>
+#include <uavcan_linux/uavcan_linux.hpp>
+#include <uavcan_linux/multithreading.hpp>
+#include "debug.hpp"
+
+namespace
+{
+
+const auto MainNodeSpinDuration = uavcan::MonotonicDuration::fromMSec(1000);
+const auto MaxAcceptableLatency = std::chrono::milliseconds(100);
+const unsigned NumFrames = 20;
+
+/**
+ * Blocks until the frame with the specified extended CAN ID is received from the raw socket.
+ */
+bool waitForFrame(int fd, std::uint32_t can_id, int timeout_msec)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_msec);
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+
+        ::pollfd pfd = ::pollfd();
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        if (::poll(&pfd, 1, int(remaining.count()) + 1) <= 0)
+        {
+            continue;
+        }
+
+        ::can_frame frame = ::can_frame();
+        if (::read(fd, &frame, sizeof(frame)) < 0)
+        {
+            return false;
+        }
+        if ((frame.can_id & CAN_EFF_FLAG) && ((frame.can_id & CAN_EFF_MASK) == can_id))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+int main(int argc, const char** argv)
+{
+    try
+    {
+        if (argc < 2)
+        {
+            std::cerr << "Usage:\n\t" << argv[0] << " <can-iface-name>" << std::endl;
+            return 1;
+        }
+        const std::string iface_name = argv[1];
+
+        const int monitor_fd = uavcan_linux::SocketCanIface::openSocket(iface_name);
+        ENFORCE(monitor_fd >= 0);
+
+        uavcan_linux::SystemClock clock;
+        uavcan_linux::EpollSocketCanDriver driver(clock);
+        ENFORCE(0 == driver.addIface(iface_name));
+
+        uavcan_linux::Node main_node(driver, clock);
+        uavcan_linux::SubNodeHub hub(uavcan_linux::SubNodeHub::DefaultTxRingCapacity, [&driver]() { driver.wakeup(); });
+        const auto sub_node_driver = hub.makeSubNodeDriver(1);
+        main_node.getDispatcher().installRxFrameListener(&hub);
+
+        /*
+         * The main node thread blocks for much longer than the acceptable latency
+         */
+        std::atomic<bool> stop(false);
+        std::atomic<int> main_node_error(0);
+        std::thread main_thread([&]()
+            {
+                while (!stop)
+                {
+                    const int res = main_node.spin(MainNodeSpinDuration);
+                    if (res < 0)
+                    {
+                        main_node_error = res;
+                    }
+                    (void)hub.injectTxFramesInto(main_node);
+                }
+            });
+
+        /*
+         * This thread acts as the sub-node
+         */
+        std::vector<std::chrono::steady_clock::duration> latencies;
+        for (unsigned i = 0; i < NumFrames; i++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+            const std::uint32_t can_id = 0x123400U + i;
+            const std::uint8_t data[] = { std::uint8_t(i) };
+            const uavcan::CanFrame frame(can_id | uavcan::CanFrame::FlagEFF, data, sizeof(data));
+
+            const auto started_at = std::chrono::steady_clock::now();
+            ENFORCE(1 == sub_node_driver->getIface(0)->send(frame, clock.getMonotonic() + MainNodeSpinDuration,
+                                                            uavcan::CanIOFlags()));
+            ENFORCE(waitForFrame(monitor_fd, can_id, int(MainNodeSpinDuration.toMSec() * 3)));
+            latencies.push_back(std::chrono::steady_clock::now() - started_at);
+        }
+
+        stop = true;
+        driver.wakeup();
+        main_thread.join();
+        (void)::close(monitor_fd);
+        ENFORCE(main_node_error == 0);
+
+        const auto max_latency = *std::max_element(latencies.begin(), latencies.end());
+        std::cout << "Max sub-node TX latency: "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(max_latency).count() << " usec, "
+                  << "main node spin duration: " << MainNodeSpinDuration.toMSec() << " msec" << std::endl;
+        ENFORCE(max_latency < MaxAcceptableLatency);
+
+        return 0;
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Exception: " << ex.what() << std::endl;
+        return 1;
+    }
+}
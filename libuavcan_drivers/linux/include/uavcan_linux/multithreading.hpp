@@ -0,0 +1,591 @@
+/*
+ * Copyright (C) 2015 Pavel Kirienko <pavel.kirienko@gmail.com>
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <thread>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+
+#include <uavcan/uavcan.hpp>
+#include <uavcan_linux/clock.hpp>
+#include <uavcan_linux/exception.hpp>
+
+/*
+ * Support for running sub-nodes in dedicated threads.
+ *
+ * The main node owns the real CAN driver. Every sub-node owns a VirtualCanDriver that exchanges frames with the main
+ * node through lock-free bounded rings:
+ *  - RX: the main node thread fans received frames out into per-iface single-producer/single-consumer rings;
+ *  - TX: all sub-node threads push their frames into one multi-producer/single-consumer ring that is drained by
+ *    the main node thread.
+ * Blocked threads are woken up through eventfd; no mutexes are involved.
+ */
+
+namespace uavcan_linux
+{
+namespace impl_
+{
+/**
+ * Rounds the value up to the next power of two.
+ */
+inline std::size_t roundUpToPowerOfTwo(std::size_t x)
+{
+    std::size_t res = 2;
+    while (res < x)
+    {
+        res <<= 1;
+    }
+    return res;
+}
+
+/**
+ * Keeps the index counters of the producer and the consumer in different cache lines.
+ * Padding is used instead of alignas() because over-aligned heap allocation is not available before C++17.
+ */
+static constexpr std::size_t CacheLineSize = 64;
+
+struct PaddedIndex
+{
+    char padding_before[CacheLineSize];
+    std::atomic<std::size_t> value;
+    char padding_after[CacheLineSize - sizeof(std::atomic<std::size_t>)];
+
+    PaddedIndex() : value(0) { }
+};
+}
+
+/**
+ * Lock-free bounded FIFO for exactly one producer thread and exactly one consumer thread.
+ * Capacity is rounded up to a power of two.
+ */
+template <typename T>
+class SpscRing : uavcan::Noncopyable
+{
+    const std::size_t mask_;
+    std::unique_ptr<T[]> items_;
+    impl_::PaddedIndex head_;           ///< Next item to read, advanced by the consumer
+    impl_::PaddedIndex tail_;           ///< Next item to write, advanced by the producer
+
+public:
+    explicit SpscRing(std::size_t capacity)
+        : mask_(impl_::roundUpToPowerOfTwo(capacity) - 1)
+        , items_(new T[mask_ + 1])
+    { }
+
+    /**
+     * Producer only. Returns false if the ring is full.
+     */
+    bool tryPush(const T& item)
+    {
+        const std::size_t tail = tail_.value.load(std::memory_order_relaxed);
+        if ((tail - head_.value.load(std::memory_order_acquire)) > mask_)
+        {
+            return false;
+        }
+        items_[tail & mask_] = item;
+        tail_.value.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Consumer only. Returns false if the ring is empty.
+     */
+    bool tryPop(T& out_item)
+    {
+        const std::size_t head = head_.value.load(std::memory_order_relaxed);
+        if (head == tail_.value.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        out_item = items_[head & mask_];
+        head_.value.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Can be called from either side; the result may be outdated by the time it is returned.
+     */
+    bool isEmpty() const
+    {
+        return head_.value.load(std::memory_order_acquire) == tail_.value.load(std::memory_order_acquire);
+    }
+
+    std::size_t getCapacity() const { return mask_ + 1; }
+};
+
+/**
+ * Lock-free bounded FIFO for any number of producer threads and exactly one consumer thread.
+ * Every slot carries a sequence number that tells whether it is ready to be written or read, so that producers
+ * only contend for the write index (compare-and-swap) and never wait for each other.
+ * Capacity is rounded up to a power of two.
+ */
+template <typename T>
+class MpscRing : uavcan::Noncopyable
+{
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        T item;
+    };
+
+    const std::size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    impl_::PaddedIndex enqueue_pos_;    ///< Shared by producers
+    impl_::PaddedIndex dequeue_pos_;    ///< Owned by the consumer
+
+public:
+    explicit MpscRing(std::size_t capacity)
+        : mask_(impl_::roundUpToPowerOfTwo(capacity) - 1)
+        , cells_(new Cell[mask_ + 1])
+    {
+        for (std::size_t i = 0; i <= mask_; i++)
+        {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Any thread. Returns false if the ring is full.
+     */
+    bool tryPush(const T& item)
+    {
+        std::size_t pos = enqueue_pos_.value.load(std::memory_order_relaxed);
+        Cell* cell = nullptr;
+        while (true)
+        {
+            cell = &cells_[pos & mask_];
+            const std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const std::intptr_t diff = std::intptr_t(seq) - std::intptr_t(pos);
+            if (diff == 0)
+            {
+                if (enqueue_pos_.value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;           // The consumer did not release this cell yet, i.e. the ring is full
+            }
+            else
+            {
+                pos = enqueue_pos_.value.load(std::memory_order_relaxed);
+            }
+        }
+        cell->item = item;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Consumer only. Returns false if the ring is empty or the oldest item is still being written.
+     */
+    bool tryPop(T& out_item)
+    {
+        const std::size_t pos = dequeue_pos_.value.load(std::memory_order_relaxed);
+        Cell& cell = cells_[pos & mask_];
+        const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (std::intptr_t(seq) - std::intptr_t(pos + 1) < 0)
+        {
+            return false;
+        }
+        out_item = cell.item;
+        cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+        dequeue_pos_.value.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::size_t getCapacity() const { return mask_ + 1; }
+};
+
+/**
+ * Lets one thread sleep until another thread signals it, based on eventfd.
+ * Signaling costs no syscall unless the receiving thread is actually blocked (or is about to block).
+ */
+class ThreadWakeup : uavcan::Noncopyable
+{
+    const int fd_;
+    std::atomic<bool> waiting_;
+
+public:
+    /**
+     * Yielding a few times before going to sleep lets the other side produce a batch of work, which is much cheaper
+     * than waking up on every item.
+     */
+    static constexpr unsigned NumYieldsBeforeSleep = 4;
+
+    ThreadWakeup()
+        : fd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+        , waiting_(false)
+    {
+        if (fd_ < 0)
+        {
+            throw Exception("Failed to create eventfd");
+        }
+    }
+
+    ~ThreadWakeup() { (void)::close(fd_); }
+
+    /**
+     * Blocks until @ref signal() is called, or until the timeout expires, unless the predicate is already true.
+     * The predicate is evaluated after the waiting state is published, so a concurrent signal() can't be lost.
+     * May return spuriously.
+     */
+    template <typename Predicate>
+    void waitUnless(Predicate is_ready, uavcan::MonotonicDuration timeout)
+    {
+        for (unsigned i = 0; (i < NumYieldsBeforeSleep) && timeout.isPositive(); i++)
+        {
+            if (is_ready())
+            {
+                return;
+            }
+            std::this_thread::yield();
+        }
+
+        waiting_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (!is_ready() && timeout.isPositive())
+        {
+            const std::int64_t timeout_usec = timeout.toUSec();
+            auto ts = ::timespec();
+            ts.tv_sec = timeout_usec / 1000000LL;
+            ts.tv_nsec = (timeout_usec % 1000000LL) * 1000;
+
+            auto pfd = ::pollfd();
+            pfd.fd = fd_;
+            pfd.events = POLLIN;
+            if (::ppoll(&pfd, 1, &ts, nullptr) > 0)
+            {
+                std::uint64_t counter = 0;
+                (void)::read(fd_, &counter, sizeof(counter));       // Resetting, non-blocking
+            }
+        }
+
+        waiting_.store(false, std::memory_order_relaxed);
+    }
+
+    /**
+     * Thread safe. The caller must publish the new state (e.g. push into a ring) before calling this.
+     * Only the first call after the waiting thread went to sleep costs a syscall.
+     */
+    void signal()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_.load(std::memory_order_relaxed) && waiting_.exchange(false, std::memory_order_relaxed))
+        {
+            const std::uint64_t one = 1;
+            (void)::write(fd_, &one, sizeof(one));
+        }
+    }
+
+    int getFileDescriptor() const { return fd_; }
+};
+
+/**
+ * Frames passed from the main node to the sub-nodes.
+ */
+struct VirtualCanRxItem
+{
+    uavcan::CanRxFrame frame;
+    uavcan::CanIOFlags flags = 0;
+};
+
+/**
+ * Frames passed from the sub-nodes to the main node.
+ */
+struct VirtualCanTxItem
+{
+    uavcan::CanFrame frame;
+    uavcan::MonotonicTime deadline;
+    uavcan::CanIOFlags flags = 0;
+    std::uint8_t iface_mask = 0;
+};
+
+class SubNodeHub;
+
+/**
+ * CAN iface of a sub-node. Its ICanIface methods are invoked by the sub-node thread only.
+ */
+class VirtualCanIface : public uavcan::ICanIface,
+                        uavcan::Noncopyable
+{
+    friend class VirtualCanDriver;
+
+    SubNodeHub& hub_;
+    const std::uint8_t iface_mask_;
+    SpscRing<VirtualCanRxItem> rx_ring_;
+    std::atomic<std::uint64_t> num_dropped_frames_;
+
+    inline std::int16_t send(const uavcan::CanFrame& frame, uavcan::MonotonicTime tx_deadline,
+                             uavcan::CanIOFlags flags) override;
+
+    std::int16_t receive(uavcan::CanFrame& out_frame, uavcan::MonotonicTime& out_ts_monotonic,
+                         uavcan::UtcTime& out_ts_utc, uavcan::CanIOFlags& out_flags) override
+    {
+        VirtualCanRxItem item;
+        if (!rx_ring_.tryPop(item))
+        {
+            return 0;
+        }
+        out_frame = item.frame;
+        out_ts_monotonic = item.frame.ts_mono;
+        out_ts_utc = item.frame.ts_utc;
+        out_flags = item.flags;
+        return 1;
+    }
+
+    std::int16_t configureFilters(const uavcan::CanFilterConfig*, std::uint16_t) override
+    {
+        return -uavcan::ErrDriver;
+    }
+    std::uint16_t getNumFilters() const override { return 0; }
+
+    /**
+     * Number of frames lost because the RX ring or the shared TX ring was full.
+     */
+    std::uint64_t getErrorCount() const override { return num_dropped_frames_.load(std::memory_order_relaxed); }
+
+    /**
+     * Main node thread only. The frame is dropped if the ring is full.
+     */
+    bool addRxFrame(const uavcan::CanRxFrame& frame, uavcan::CanIOFlags flags)
+    {
+        VirtualCanRxItem item;
+        item.frame = frame;
+        item.flags = flags;
+        if (!rx_ring_.tryPush(item))
+        {
+            num_dropped_frames_++;
+            return false;
+        }
+        return true;
+    }
+
+public:
+    VirtualCanIface(SubNodeHub& hub, std::uint8_t iface_index, std::size_t rx_ring_capacity)
+        : hub_(hub)
+        , iface_mask_(std::uint8_t(1U << iface_index))
+        , rx_ring_(rx_ring_capacity)
+        , num_dropped_frames_(0)
+    { }
+
+    bool hasDataInRxQueue() const { return !rx_ring_.isEmpty(); }
+};
+
+/**
+ * CAN driver of a sub-node. Objects of this class are created by @ref SubNodeHub::makeSubNodeDriver().
+ * Its ICanDriver methods are invoked by the sub-node thread only.
+ */
+class VirtualCanDriver : public uavcan::ICanDriver,
+                         uavcan::Noncopyable
+{
+    friend class SubNodeHub;
+
+    std::vector<std::unique_ptr<VirtualCanIface>> ifaces_;
+    ThreadWakeup wakeup_;               ///< Used to unblock the select() call when RX frames arrive
+    SystemClock clock_;
+
+    bool hasDataInAnyRxQueue(std::uint8_t read_mask) const
+    {
+        for (unsigned i = 0; i < ifaces_.size(); i++)
+        {
+            if ((read_mask & (1U << i)) && ifaces_[i]->hasDataInRxQueue())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Main node thread only.
+     */
+    void addRxFrame(const uavcan::CanRxFrame& frame, uavcan::CanIOFlags flags)
+    {
+        if ((frame.iface_index < ifaces_.size()) && ifaces_[frame.iface_index]->addRxFrame(frame, flags))
+        {
+            wakeup_.signal();
+        }
+    }
+
+public:
+    VirtualCanDriver(SubNodeHub& hub, unsigned num_ifaces, std::size_t rx_ring_capacity)
+    {
+        assert(num_ifaces > 0 && num_ifaces <= uavcan::MaxCanIfaces);
+        for (unsigned i = 0; i < num_ifaces; i++)
+        {
+            ifaces_.emplace_back(new VirtualCanIface(hub, std::uint8_t(i), rx_ring_capacity));
+        }
+    }
+
+    uavcan::ICanIface* getIface(std::uint8_t iface_index) override
+    {
+        return (iface_index < ifaces_.size()) ? ifaces_[iface_index].get() : nullptr;
+    }
+
+    std::uint8_t getNumIfaces() const override { return std::uint8_t(ifaces_.size()); }
+
+    /**
+     * The ifaces are always writeable; frames that don't fit the TX ring are rejected by send() and stay in the
+     * sub-node's own TX queue.
+     */
+    std::int16_t select(uavcan::CanSelectMasks& inout_masks,
+                        const uavcan::CanFrame* (&)[uavcan::MaxCanIfaces],
+                        uavcan::MonotonicTime blocking_deadline) override
+    {
+        const std::uint8_t read_mask = inout_masks.read;
+        if (inout_masks.write == 0)    // Write queue is infinite
+        {
+            wakeup_.waitUnless([&]() { return hasDataInAnyRxQueue(read_mask); },
+                               blocking_deadline - clock_.getMonotonic());
+        }
+
+        inout_masks = uavcan::CanSelectMasks();
+        for (unsigned i = 0; i < ifaces_.size(); i++)
+        {
+            const std::uint8_t iface_mask = std::uint8_t(1U << i);
+            inout_masks.write |= iface_mask;           // Always ready to write
+            if (ifaces_[i]->hasDataInRxQueue())
+            {
+                inout_masks.read |= iface_mask;
+            }
+        }
+
+        return std::int16_t(ifaces_.size());       // We're always ready to write, hence > 0.
+    }
+};
+
+/**
+ * Connects the main node with any number of sub-nodes running in their own threads.
+ *
+ * Usage, in the main node thread:
+ *  - create the sub-node drivers with @ref makeSubNodeDriver() before the sub-node threads are started;
+ *  - install the hub as the RX frame listener of the main node's dispatcher;
+ *  - call @ref injectTxFramesInto() after every spin of the main node.
+ *
+ * The frames sent by the sub-nodes reach the bus only when @ref injectTxFramesInto() is called, so their latency
+ * is bounded by the spin duration of the main node. If the main node spins for a long time, pass a wakeup callback
+ * bound to @ref EpollSocketCanDriver::wakeup(): it makes Node::spin() of the main node return, so the frames are
+ * injected right away. A callback that only unblocks a driver which does not report wakeups via
+ * uavcan::CanSelectMasks::wakeup has no effect, because spin() keeps running until its deadline.
+ * The callback is invoked from the sub-node threads, at most once per @ref injectTxFramesInto() call.
+ */
+class SubNodeHub : public uavcan::IRxFrameListener,
+                   uavcan::Noncopyable
+{
+    friend class VirtualCanIface;
+
+    MpscRing<VirtualCanTxItem> tx_ring_;
+    std::vector<std::shared_ptr<VirtualCanDriver>> drivers_;
+    const std::function<void()> main_node_wakeup_;
+    std::atomic<bool> main_node_wakeup_pending_;
+
+    /**
+     * Sub-node threads.
+     */
+    bool addTxFrame(const VirtualCanTxItem& item)
+    {
+        if (!tx_ring_.tryPush(item))
+        {
+            return false;
+        }
+        if (main_node_wakeup_ && !main_node_wakeup_pending_.exchange(true))
+        {
+            main_node_wakeup_();
+        }
+        return true;
+    }
+
+public:
+    static constexpr std::size_t DefaultTxRingCapacity = 1024;
+    static constexpr std::size_t DefaultRxRingCapacity = 512;
+
+    explicit SubNodeHub(std::size_t tx_ring_capacity = DefaultTxRingCapacity,
+                        const std::function<void()>& main_node_wakeup = std::function<void()>())
+        : tx_ring_(tx_ring_capacity)
+        , main_node_wakeup_(main_node_wakeup)
+        , main_node_wakeup_pending_(false)
+    { }
+
+    /**
+     * Creates the driver for a new sub-node. Main node thread only.
+     * @param num_ifaces        Should match the number of ifaces of the main node.
+     * @param rx_ring_capacity  Per iface; received frames are dropped when the ring is full.
+     */
+    std::shared_ptr<VirtualCanDriver> makeSubNodeDriver(unsigned num_ifaces,
+                                                        std::size_t rx_ring_capacity = DefaultRxRingCapacity)
+    {
+        std::shared_ptr<VirtualCanDriver> drv(new VirtualCanDriver(*this, num_ifaces, rx_ring_capacity));
+        drivers_.push_back(drv);
+        return drv;
+    }
+
+    /**
+     * Invoked by the dispatcher of the main node; forwards the frame to all sub-nodes.
+     */
+    void handleRxFrame(const uavcan::CanRxFrame& frame, uavcan::CanIOFlags flags) override
+    {
+        UAVCAN_TRACE("SubNodeHub", "RX [flags=%u]: %s", unsigned(flags), frame.toString().c_str());
+        for (auto& d : drivers_)
+        {
+            d->addRxFrame(frame, flags);
+        }
+    }
+
+    /**
+     * Pops all frames sent by the sub-nodes, passing each of them to the handler:
+     *  void (const VirtualCanTxItem&)
+     * Main node thread only. Returns the number of frames.
+     */
+    template <typename Handler>
+    unsigned drainTxFrames(Handler handler)
+    {
+        main_node_wakeup_pending_.store(false);
+        unsigned num_frames = 0;
+        VirtualCanTxItem item;
+        while (tx_ring_.tryPop(item))
+        {
+            handler(item);
+            num_frames++;
+        }
+        return num_frames;
+    }
+
+    /**
+     * Moves all frames sent by the sub-nodes into the TX queue of the main node. Main node thread only.
+     */
+    unsigned injectTxFramesInto(uavcan::INode& main_node)
+    {
+        return drainTxFrames([&main_node](const VirtualCanTxItem& item)
+            {
+                UAVCAN_TRACE("SubNodeHub", "TX injection [iface=0x%02x]: %s",
+                             unsigned(item.iface_mask), item.frame.toString().c_str());
+                (void)main_node.injectTxFrame(item.frame, item.deadline, item.iface_mask, item.flags);
+            });
+    }
+};
+
+std::int16_t VirtualCanIface::send(const uavcan::CanFrame& frame, uavcan::MonotonicTime tx_deadline,
+                                   uavcan::CanIOFlags flags)
+{
+    VirtualCanTxItem item;
+    item.frame = frame;
+    item.deadline = tx_deadline;
+    item.flags = flags;
+    item.iface_mask = iface_mask_;
+    return hub_.addTxFrame(item) ? 1 : 0;
+}
+
+}
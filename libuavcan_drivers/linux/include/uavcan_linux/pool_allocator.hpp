@@ -0,0 +1,517 @@
+/*
+ * Copyright (C) 2015 Pavel Kirienko <pavel.kirienko@gmail.com>
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <uavcan/dynamic_memory.hpp>
+#include <uavcan_linux/exception.hpp>
+
+namespace uavcan_linux
+{
+/**
+ * Thread-safe pool allocator with several block size classes.
+ *
+ * Every allocation is served by the smallest size class that fits the requested size. If that class is exhausted,
+ * the next larger classes are tried, so that small objects (AVL nodes, TX queue entries) don't take the blocks
+ * of large objects (transfer buffer blocks) unless they have to.
+ *
+ * Each size class keeps its free blocks in a lock-free stack; the stack head is a block index paired with a
+ * modification counter, which is updated with CAS to avoid the ABA problem.
+ * In addition, every thread keeps up to @ref ThreadCacheSize free blocks of each class in its own cache, so the
+ * shared stacks are accessed only when a cache runs empty or full. Up to @ref MaxThreads threads can have a cache
+ * at the same time; the other threads use the shared stacks directly.
+ *
+ * A cache is protected by a spinlock which is normally taken only by its owner, so it is never contended.
+ * If both the cache and the shared stack of a size class are empty, the allocator takes a block from the caches of
+ * the other threads before it gives up, so the cached blocks are not lost for the rest of the process.
+ * When a thread exits, its cached blocks are returned to the shared stacks and its cache is reused by the next
+ * thread; @ref flushThreadCache() does the same for a thread that stays alive.
+ */
+class SizeClassPoolAllocator : public uavcan::IPoolAllocator,
+                               uavcan::Noncopyable
+{
+public:
+    struct SizeClassConfig
+    {
+        std::size_t block_size;
+        unsigned num_blocks;
+    };
+
+    struct SizeClassStats
+    {
+        std::size_t block_size = 0;
+        unsigned capacity = 0;
+        unsigned num_used = 0;              ///< Blocks held by the application
+        unsigned peak_num_used = 0;
+        std::uint64_t num_exhausted = 0;    ///< Allocations that found this class empty
+    };
+
+    static constexpr unsigned MaxSizeClasses = 8;
+    static constexpr unsigned MaxThreads = 32;
+    static constexpr unsigned ThreadCacheSize = 8;
+
+private:
+    static constexpr std::size_t CacheLineSize = 64;
+    static constexpr std::uint32_t EmptyLink = 0;       ///< Links hold block index + 1
+
+    struct SizeClass
+    {
+        std::size_t block_size = 0;
+        unsigned num_blocks = 0;
+        std::unique_ptr<std::max_align_t[]> storage;
+        std::uint8_t* begin = nullptr;
+        std::uint8_t* end = nullptr;
+        std::unique_ptr<std::atomic<std::uint32_t>[]> links;
+
+        char padding_before[CacheLineSize];
+        std::atomic<std::uint64_t> head;                ///< Modification counter << 32 | link of the top block
+        std::atomic<unsigned> num_used;
+        std::atomic<unsigned> peak_num_used;
+        std::atomic<std::uint64_t> num_exhausted;
+        char padding_after[CacheLineSize];
+
+        void* getBlock(std::uint32_t index) const { return begin + index * block_size; }
+
+        bool contains(const void* ptr) const
+        {
+            return (static_cast<const std::uint8_t*>(ptr) >= begin) && (static_cast<const std::uint8_t*>(ptr) < end);
+        }
+
+        std::uint32_t getIndex(const void* ptr) const
+        {
+            return std::uint32_t(std::size_t(static_cast<const std::uint8_t*>(ptr) - begin) / block_size);
+        }
+
+        bool pop(std::uint32_t& out_index)
+        {
+            std::uint64_t old_head = head.load(std::memory_order_acquire);
+            while (true)
+            {
+                const std::uint32_t top = std::uint32_t(old_head);
+                if (top == EmptyLink)
+                {
+                    return false;
+                }
+                // If the top block is taken meanwhile, the link may be stale, but then the CAS fails
+                const std::uint32_t next = links[top - 1].load(std::memory_order_relaxed);
+                const std::uint64_t new_head = (((old_head >> 32) + 1) << 32) | next;
+                if (head.compare_exchange_weak(old_head, new_head,
+                                               std::memory_order_acq_rel, std::memory_order_acquire))
+                {
+                    out_index = top - 1;
+                    return true;
+                }
+            }
+        }
+
+        void push(std::uint32_t index)
+        {
+            std::uint64_t old_head = head.load(std::memory_order_relaxed);
+            std::uint64_t new_head = 0;
+            do
+            {
+                links[index].store(std::uint32_t(old_head), std::memory_order_relaxed);
+                new_head = (((old_head >> 32) + 1) << 32) | (index + 1);
+            }
+            while (!head.compare_exchange_weak(old_head, new_head,
+                                               std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        void registerAllocation()
+        {
+            const unsigned used = num_used.fetch_add(1, std::memory_order_relaxed) + 1;
+            unsigned peak = peak_num_used.load(std::memory_order_relaxed);
+            while ((used > peak) &&
+                   !peak_num_used.compare_exchange_weak(peak, used, std::memory_order_relaxed))
+            { }
+        }
+    };
+
+    /**
+     * Used by one thread, except when the other threads steal blocks from it or when it's flushed on thread exit.
+     * Padded to keep the caches of different threads in different cache lines.
+     */
+    struct ThreadCache
+    {
+        std::atomic<bool> locked;
+        unsigned num_items[MaxSizeClasses];
+        std::uint32_t items[MaxSizeClasses][ThreadCacheSize];
+        char padding[CacheLineSize];
+
+        void lock()
+        {
+            while (locked.exchange(true, std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        void unlock() { locked.store(false, std::memory_order_release); }
+
+        bool take(unsigned class_index, std::uint32_t& out_index)
+        {
+            lock();
+            const bool res = num_items[class_index] > 0;
+            if (res)
+            {
+                out_index = items[class_index][--num_items[class_index]];
+            }
+            unlock();
+            return res;
+        }
+    };
+
+    /**
+     * Process-wide list of the allocator instances and of the cache slots taken by the live threads.
+     * A thread takes a free slot when it uses an allocator for the first time; when it exits, the slot is released
+     * and the blocks cached in it by every instance are returned to the shared stacks.
+     */
+    class ThreadSlotRegistry
+    {
+        std::mutex mutex_;
+        std::vector<SizeClassPoolAllocator*> instances_;
+        std::atomic<bool> slot_taken_[MaxThreads];
+
+        ThreadSlotRegistry()
+        {
+            for (auto& x : slot_taken_)
+            {
+                x.store(false, std::memory_order_relaxed);
+            }
+        }
+
+    public:
+        static ThreadSlotRegistry& getInstance()
+        {
+            static ThreadSlotRegistry registry;
+            return registry;
+        }
+
+        void addAllocator(SizeClassPoolAllocator* allocator)
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            instances_.push_back(allocator);
+        }
+
+        void removeAllocator(SizeClassPoolAllocator* allocator)
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            instances_.erase(std::remove(instances_.begin(), instances_.end(), allocator), instances_.end());
+        }
+
+        /**
+         * Returns MaxThreads if all slots are taken.
+         */
+        unsigned takeSlot()
+        {
+            for (unsigned i = 0; i < MaxThreads; i++)
+            {
+                if (!slot_taken_[i].exchange(true, std::memory_order_acq_rel))
+                {
+                    return i;
+                }
+            }
+            return MaxThreads;
+        }
+
+        void releaseSlot(unsigned index)
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            for (auto a : instances_)
+            {
+                a->flushCache(index);
+            }
+            slot_taken_[index].store(false, std::memory_order_release);
+        }
+    };
+
+    struct ThreadSlot
+    {
+        const unsigned index;
+        ThreadSlot() : index(ThreadSlotRegistry::getInstance().takeSlot()) { }
+        ~ThreadSlot()
+        {
+            if (index < MaxThreads)
+            {
+                ThreadSlotRegistry::getInstance().releaseSlot(index);
+            }
+        }
+    };
+
+    std::unique_ptr<SizeClass[]> classes_;
+    const unsigned num_classes_;
+    std::unique_ptr<ThreadCache[]> thread_caches_;
+
+    /**
+     * Cache slot of the calling thread, common for all allocator instances; MaxThreads if the thread has none.
+     */
+    static unsigned getThreadIndex()
+    {
+        thread_local const ThreadSlot slot;
+        return slot.index;
+    }
+
+    ThreadCache* getThreadCache() const
+    {
+        const unsigned index = getThreadIndex();
+        return (index < MaxThreads) ? &thread_caches_[index] : nullptr;
+    }
+
+    void* allocateFrom(unsigned class_index, ThreadCache* cache)
+    {
+        SizeClass& sc = classes_[class_index];
+        std::uint32_t block_index = 0;
+        if (((cache == nullptr) || !cache->take(class_index, block_index)) && !sc.pop(block_index))
+        {
+            sc.num_exhausted.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        sc.registerAllocation();
+        return sc.getBlock(block_index);
+    }
+
+    /**
+     * Last resort when the size class is exhausted: the block is taken from the cache of another thread.
+     * The shared stack is checked again first, since other threads may have returned some blocks meanwhile.
+     */
+    void* stealFrom(unsigned class_index, const ThreadCache* own_cache)
+    {
+        SizeClass& sc = classes_[class_index];
+        std::uint32_t block_index = 0;
+        bool found = sc.pop(block_index);
+        for (unsigned i = 0; (i < MaxThreads) && !found; i++)
+        {
+            if (&thread_caches_[i] != own_cache)
+            {
+                found = thread_caches_[i].take(class_index, block_index);
+            }
+        }
+        if (!found)
+        {
+            return nullptr;
+        }
+        sc.registerAllocation();
+        return sc.getBlock(block_index);
+    }
+
+    void flushCache(unsigned thread_index)
+    {
+        ThreadCache& cache = thread_caches_[thread_index];
+        cache.lock();
+        for (unsigned i = 0; i < num_classes_; i++)
+        {
+            while (cache.num_items[i] > 0)
+            {
+                classes_[i].push(cache.items[i][--cache.num_items[i]]);
+            }
+        }
+        cache.unlock();
+    }
+
+    static void validateConfig(const std::vector<SizeClassConfig>& config)
+    {
+        if (config.empty() || (config.size() > MaxSizeClasses))
+        {
+            throw Exception("SizeClassPoolAllocator: invalid number of size classes", 0);
+        }
+        for (std::size_t i = 0; i < config.size(); i++)
+        {
+            if ((config[i].block_size == 0) || ((config[i].block_size % alignof(std::max_align_t)) != 0) ||
+                (config[i].num_blocks == 0) || ((i > 0) && (config[i].block_size <= config[i - 1].block_size)))
+            {
+                throw Exception("SizeClassPoolAllocator: invalid size class " + std::to_string(i), 0);
+            }
+        }
+        if (config.back().block_size < uavcan::MemPoolBlockSize)
+        {
+            throw Exception("SizeClassPoolAllocator: the largest size class is less than MemPoolBlockSize", 0);
+        }
+    }
+
+public:
+    /**
+     * Size classes must be listed in ascending order of block size; block sizes must be multiples of the
+     * fundamental alignment. The largest block size must not be less than @ref uavcan::MemPoolBlockSize.
+     * @throws uavcan_linux::Exception.
+     */
+    explicit SizeClassPoolAllocator(const std::vector<SizeClassConfig>& config)
+        : num_classes_((validateConfig(config), unsigned(config.size())))
+    {
+        classes_.reset(new SizeClass[num_classes_]);
+        for (unsigned i = 0; i < num_classes_; i++)
+        {
+            SizeClass& sc = classes_[i];
+            sc.block_size = config[i].block_size;
+            sc.num_blocks = config[i].num_blocks;
+
+            const std::size_t num_bytes = sc.block_size * sc.num_blocks;
+            sc.storage.reset(new std::max_align_t[(num_bytes + sizeof(std::max_align_t) - 1) /
+                                                  sizeof(std::max_align_t)]);
+            sc.begin = reinterpret_cast<std::uint8_t*>(sc.storage.get());
+            sc.end = sc.begin + num_bytes;
+
+            sc.links.reset(new std::atomic<std::uint32_t>[sc.num_blocks]);
+            for (unsigned k = 0; k < sc.num_blocks; k++)
+            {
+                sc.links[k].store(k + 2 <= sc.num_blocks ? k + 2 : EmptyLink, std::memory_order_relaxed);
+            }
+            sc.head.store(1, std::memory_order_relaxed);
+            sc.num_used.store(0, std::memory_order_relaxed);
+            sc.peak_num_used.store(0, std::memory_order_relaxed);
+            sc.num_exhausted.store(0, std::memory_order_relaxed);
+        }
+
+        thread_caches_.reset(new ThreadCache[MaxThreads]);
+        for (unsigned i = 0; i < MaxThreads; i++)
+        {
+            thread_caches_[i].locked.store(false, std::memory_order_relaxed);
+            std::fill(thread_caches_[i].num_items, thread_caches_[i].num_items + MaxSizeClasses, 0U);
+        }
+
+        ThreadSlotRegistry::getInstance().addAllocator(this);
+    }
+
+    ~SizeClassPoolAllocator() override
+    {
+        ThreadSlotRegistry::getInstance().removeAllocator(this);
+    }
+
+    void* allocate(std::size_t size) override
+    {
+        ThreadCache* const cache = getThreadCache();
+        for (unsigned i = 0; i < num_classes_; i++)
+        {
+            if (classes_[i].block_size >= size)
+            {
+                void* const p = allocateFrom(i, cache);
+                if (p != nullptr)
+                {
+                    return p;
+                }
+            }
+        }
+        for (unsigned i = 0; i < num_classes_; i++)
+        {
+            if (classes_[i].block_size >= size)
+            {
+                void* const p = stealFrom(i, cache);
+                if (p != nullptr)
+                {
+                    return p;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    void deallocate(const void* ptr) override
+    {
+        if (ptr == nullptr)
+        {
+            return;
+        }
+        for (unsigned i = 0; i < num_classes_; i++)
+        {
+            SizeClass& sc = classes_[i];
+            if (!sc.contains(ptr))
+            {
+                continue;
+            }
+            const std::uint32_t block_index = sc.getIndex(ptr);
+            UAVCAN_ASSERT(sc.getBlock(block_index) == ptr);
+            sc.num_used.fetch_sub(1, std::memory_order_relaxed);
+
+            ThreadCache* const cache = getThreadCache();
+            if (cache == nullptr)
+            {
+                sc.push(block_index);
+                return;
+            }
+            cache->lock();
+            if (cache->num_items[i] >= ThreadCacheSize)     // Returning half of the cache to the shared stack
+            {
+                while (cache->num_items[i] > ThreadCacheSize / 2)
+                {
+                    sc.push(cache->items[i][--cache->num_items[i]]);
+                }
+            }
+            cache->items[i][cache->num_items[i]++] = block_index;
+            cache->unlock();
+            return;
+        }
+        UAVCAN_ASSERT(0);       // Not our block
+    }
+
+    /**
+     * Number of blocks in the size class that serves the requests of @ref uavcan::MemPoolBlockSize bytes, saturated.
+     * The library sizes its per-interface TX queue quotas from this value, and the TX queue entries come from
+     * that class; the blocks of the smaller classes could never hold them.
+     */
+    std::uint16_t getBlockCapacity() const override
+    {
+        for (unsigned i = 0; i < num_classes_; i++)
+        {
+            if (classes_[i].block_size >= uavcan::MemPoolBlockSize)
+            {
+                return std::uint16_t(std::min(classes_[i].num_blocks, 0xFFFFU));
+            }
+        }
+        UAVCAN_ASSERT(0);       // Ensured by the constructor
+        return 0;
+    }
+
+    /**
+     * Returns the blocks cached by the calling thread to the shared stacks.
+     */
+    void flushThreadCache()
+    {
+        const unsigned index = getThreadIndex();
+        if (index < MaxThreads)
+        {
+            flushCache(index);
+        }
+    }
+
+    unsigned getNumSizeClasses() const { return num_classes_; }
+
+    SizeClassStats getSizeClassStats(unsigned class_index) const
+    {
+        SizeClassStats stats;
+        if (class_index < num_classes_)
+        {
+            const SizeClass& sc = classes_[class_index];
+            stats.block_size = sc.block_size;
+            stats.capacity = sc.num_blocks;
+            stats.num_used = sc.num_used.load(std::memory_order_relaxed);
+            stats.peak_num_used = sc.peak_num_used.load(std::memory_order_relaxed);
+            stats.num_exhausted = sc.num_exhausted.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+    /**
+     * Number of blocks held by the application, in all size classes.
+     */
+    unsigned getNumUsedBlocks() const
+    {
+        unsigned res = 0;
+        for (unsigned i = 0; i < num_classes_; i++)
+        {
+            res += classes_[i].num_used.load(std::memory_order_relaxed);
+        }
+        return res;
+    }
+};
+
+}
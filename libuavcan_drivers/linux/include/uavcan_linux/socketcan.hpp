@@ -22,6 +22,8 @@
 #include <linux/can.h>
 #include <linux/can/raw.h>
 #include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include <uavcan/uavcan.hpp>
 #include <uavcan_linux/clock.hpp>
@@ -55,35 +57,77 @@ enum class SocketCanError
  * Note that if max_frames_in_socket_tx_queue_ is greater than one, frame reordering may occur (depending on the
  * unrderlying logic).
  *
+ * If io_batch_size_ is greater than one, the socket is accessed with recvmmsg()/sendmmsg() using preallocated
+ * message arrays, so that a busy bus costs one syscall per batch rather than per frame. In this mode,
+ * 'max_frames_in_socket_tx_queue_' only decides when the next TX batch can be written: once the socket holds fewer
+ * frames than that, up to io_batch_size_ highest priority frames are written at once. Hence the socket may hold up to
+ * max_frames_in_socket_tx_queue_ + io_batch_size_ - 1 frames; the TX deadlines are checked and a higher priority
+ * frame can overtake the queued ones at the granularity of one batch. Use a smaller batch if this matters more
+ * than the syscall rate.
+ *
+ * If the library is built with UAVCAN_CAN_FD, the socket exchanges struct canfd_frame with the kernel; frames
+ * longer than 8 bytes are sent as CAN FD frames with bit rate switching, shorter ones as classic CAN frames.
+ *
  * This class is too complex and needs to be refactored later. At least, basic socket IO and configuration
  * should be extracted into a different class.
  */
 class SocketCanIface : public uavcan::ICanIface
 {
-    static inline ::can_frame makeSocketCanFrame(const uavcan::CanFrame& uavcan_frame)
+#if UAVCAN_CAN_FD
+    using SocketCanFrame = ::canfd_frame;       ///< Classic CAN frames are exchanged through it as well
+
+    static inline std::uint8_t getDataLen(const SocketCanFrame& sockcan_frame) { return sockcan_frame.len; }
+    static inline void setDataLen(SocketCanFrame& sockcan_frame, std::uint8_t len)
     {
-        ::can_frame sockcan_frame = ::can_frame();
-        sockcan_frame.can_id = uavcan_frame.id & uavcan::CanFrame::MaskExtID;
-        sockcan_frame.can_dlc = uavcan_frame.dlc;
-        (void)std::copy(uavcan_frame.data, uavcan_frame.data + uavcan_frame.dlc, sockcan_frame.data);
+        sockcan_frame.len = len;
+        sockcan_frame.flags = (len > uavcan::CanFrame::MaxClassicDataLen) ? CANFD_BRS : 0;
+    }
+#else
+    using SocketCanFrame = ::can_frame;
+
+    static inline std::uint8_t getDataLen(const SocketCanFrame& sockcan_frame) { return sockcan_frame.can_dlc; }
+    static inline void setDataLen(SocketCanFrame& sockcan_frame, std::uint8_t len) { sockcan_frame.can_dlc = len; }
+#endif
+
+    /**
+     * Number of bytes to write into the socket: CAN FD frames are told apart from classic ones by the size.
+     */
+    static inline std::size_t getMtu(const uavcan::CanFrame& uavcan_frame)
+    {
+        return uavcan_frame.isCanFd() ? CANFD_MTU : CAN_MTU;
+    }
+
+    static inline ::canid_t makeSocketCanId(const uavcan::CanFrame& uavcan_frame)
+    {
+        ::canid_t can_id = uavcan_frame.id & uavcan::CanFrame::MaskExtID;
         if (uavcan_frame.isExtended())
         {
-            sockcan_frame.can_id |= CAN_EFF_FLAG;
+            can_id |= CAN_EFF_FLAG;
         }
         if (uavcan_frame.isErrorFrame())
         {
-            sockcan_frame.can_id |= CAN_ERR_FLAG;
+            can_id |= CAN_ERR_FLAG;
         }
         if (uavcan_frame.isRemoteTransmissionRequest())
         {
-            sockcan_frame.can_id |= CAN_RTR_FLAG;
+            can_id |= CAN_RTR_FLAG;
         }
+        return can_id;
+    }
+
+    static inline SocketCanFrame makeSocketCanFrame(const uavcan::CanFrame& uavcan_frame)
+    {
+        SocketCanFrame sockcan_frame = SocketCanFrame();
+        sockcan_frame.can_id = makeSocketCanId(uavcan_frame);
+        setDataLen(sockcan_frame, uavcan_frame.dlc);
+        (void)std::copy(uavcan_frame.data, uavcan_frame.data + uavcan_frame.dlc, sockcan_frame.data);
         return sockcan_frame;
     }
 
-    static inline uavcan::CanFrame makeUavcanFrame(const ::can_frame& sockcan_frame)
+    static inline uavcan::CanFrame makeUavcanFrame(const SocketCanFrame& sockcan_frame)
     {
-        uavcan::CanFrame uavcan_frame(sockcan_frame.can_id & CAN_EFF_MASK, sockcan_frame.data, sockcan_frame.can_dlc);
+        uavcan::CanFrame uavcan_frame(sockcan_frame.can_id & CAN_EFF_MASK, sockcan_frame.data,
+                                      getDataLen(sockcan_frame));
         if (sockcan_frame.can_id & CAN_EFF_FLAG)
         {
             uavcan_frame.id |= uavcan::CanFrame::FlagEFF;
@@ -99,6 +143,54 @@ class SocketCanIface : public uavcan::ICanIface
         return uavcan_frame;
     }
 
+    /**
+     * Makes a filter that passes the loopback of the given frame through the kernel.
+     * UAVCAN frames carry the source node ID in the lowest 7 bits of the extended CAN ID, so a single filter
+     * covers everything this node sends; standard frames are matched exactly.
+     */
+    static inline ::can_filter makeLoopbackFilter(::canid_t can_id)
+    {
+        auto f = ::can_filter();
+        if (can_id & CAN_EFF_FLAG)
+        {
+            f.can_id   = can_id & (0x7FU | CAN_EFF_FLAG | CAN_RTR_FLAG);
+            f.can_mask = 0x7FU | CAN_EFF_FLAG | CAN_RTR_FLAG;
+        }
+        else
+        {
+            f.can_id   = can_id & (CAN_SFF_MASK | CAN_RTR_FLAG);
+            f.can_mask = CAN_SFF_MASK | CAN_EFF_FLAG | CAN_RTR_FLAG;
+        }
+        return f;
+    }
+
+    static bool isAcceptedBy(const std::vector<::can_filter>& filters, ::canid_t can_id)
+    {
+        for (auto& f : filters)
+        {
+            if (((can_id & f.can_mask) ^ f.can_id) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Returns true if every CAN ID accepted by the filter is also accepted by one of the filters in the list.
+     */
+    static bool isCoveredBy(const std::vector<::can_filter>& filters, const ::can_filter& filter)
+    {
+        for (auto& f : filters)
+        {
+            if (((f.can_mask & ~filter.can_mask) == 0) && (((filter.can_id ^ f.can_id) & f.can_mask) == 0))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
     struct TxItem
     {
         uavcan::CanFrame frame;
@@ -140,12 +232,29 @@ class SocketCanIface : public uavcan::ICanIface
         { }
     };
 
+    static constexpr std::size_t RxControlSize = sizeof(::cmsghdr) + sizeof(::timeval);
+    using RxControlStorage = typename std::aligned_storage<RxControlSize>::type;
+
     const SystemClock& clock_;
     const int fd_;
 
     const unsigned max_frames_in_socket_tx_queue_;
     unsigned frames_in_socket_tx_queue_ = 0;
 
+    /*
+     * Preallocated recvmmsg()/sendmmsg() buffers; empty if batched IO is disabled.
+     * Message headers point into the other arrays, so none of them may be resized after construction.
+     */
+    std::vector<::mmsghdr> rx_msgs_;
+    std::vector<::iovec> rx_iovs_;
+    std::vector<SocketCanFrame> rx_frames_;
+    std::vector<RxControlStorage> rx_controls_;
+
+    std::vector<::mmsghdr> tx_msgs_;
+    std::vector<::iovec> tx_iovs_;
+    std::vector<SocketCanFrame> tx_frames_;
+    std::vector<TxItem> tx_batch_;              ///< Items being sent with the current sendmmsg() call
+
     std::uint64_t tx_frame_counter_ = 0;        ///< Increments with every frame pushed into the TX queue
 
     std::map<SocketCanError, std::uint64_t> errors_;
@@ -156,11 +265,23 @@ class SocketCanIface : public uavcan::ICanIface
 
     std::vector<::can_filter> hw_filters_container_;
 
+    /*
+     * The configured filters are installed into the socket with CAN_RAW_FILTER, so that rejected frames never leave
+     * the kernel. The kernel applies the filters to the loopback of our own frames too, hence every sent frame must
+     * also match one of the loopback filters, otherwise its TX confirmation would be lost and the TX queue would stall.
+     * If the kernel refuses the filters, the socket accepts everything and the filtering is done in user space.
+     */
+    std::vector<::can_filter> loopback_filters_;
+    std::vector<::can_filter> kernel_filters_;          ///< Currently installed; empty if the socket accepts all
+    bool userspace_filtering_ = false;
+
     void registerError(SocketCanError e) { errors_[e]++; }
 
     void incrementNumFramesInSocketTxQueue()
     {
-        assert(frames_in_socket_tx_queue_ < max_frames_in_socket_tx_queue_);
+        // A TX batch may overshoot the limit, see the class comment
+        assert(frames_in_socket_tx_queue_ <
+               (max_frames_in_socket_tx_queue_ + std::max<std::size_t>(tx_msgs_.size(), 1U) - 1U));
         frames_in_socket_tx_queue_++;
     }
 
@@ -190,9 +311,10 @@ class SocketCanIface : public uavcan::ICanIface
     {
         errno = 0;
 
-        const ::can_frame sockcan_frame = makeSocketCanFrame(frame);
+        const SocketCanFrame sockcan_frame = makeSocketCanFrame(frame);
+        const std::size_t mtu = getMtu(frame);
 
-        const int res = ::write(fd_, &sockcan_frame, sizeof(sockcan_frame));
+        const int res = ::write(fd_, &sockcan_frame, mtu);
         //std::cerr<<"can write in:"<<res<<std::endl;
         if (res <= 0)
         {
@@ -202,7 +324,7 @@ class SocketCanIface : public uavcan::ICanIface
             }
             return res;
         }
-        if (res != sizeof(sockcan_frame))
+        if (res != int(mtu))
         {
             return -1;
         }
@@ -219,21 +341,19 @@ class SocketCanIface : public uavcan::ICanIface
     int read(uavcan::CanFrame& frame, uavcan::UtcTime& ts_utc, bool& loopback) const
     {
         auto iov = ::iovec();
-        auto sockcan_frame = ::can_frame();
+        auto sockcan_frame = SocketCanFrame();
         iov.iov_base = &sockcan_frame;
         iov.iov_len  = sizeof(sockcan_frame);
 
-        static constexpr size_t ControlSize = sizeof(cmsghdr) + sizeof(::timeval);
-        using ControlStorage = typename std::aligned_storage<ControlSize>::type;
-        ControlStorage control_storage;
+        RxControlStorage control_storage;
         auto control = reinterpret_cast<std::uint8_t *>(&control_storage);
-        std::fill(control, control + ControlSize, 0x00);
+        std::fill(control, control + RxControlSize, 0x00);
 
         auto msg = ::msghdr();
         msg.msg_iov    = &iov;
         msg.msg_iovlen = 1;
         msg.msg_control = control;
-        msg.msg_controllen = ControlSize;
+        msg.msg_controllen = RxControlSize;
 
         const int res = ::recvmsg(fd_, &msg, MSG_DONTWAIT);
         //std::cerr<<"can read in:"<<res<<std::endl;
@@ -241,6 +361,16 @@ class SocketCanIface : public uavcan::ICanIface
         {
             return (res < 0 && errno == EWOULDBLOCK) ? 0 : res;
         }
+        return decodeMessage(msg, sockcan_frame, frame, ts_utc, loopback);
+    }
+
+    /**
+     * Extracts the frame, the loopback flag and the UTC timestamp from a message received with recvmsg() or
+     * recvmmsg(). Returns 1 if the frame is accepted, 0 if it is rejected by the filters, negative on error.
+     */
+    int decodeMessage(const ::msghdr& msg, const SocketCanFrame& sockcan_frame,
+                      uavcan::CanFrame& frame, uavcan::UtcTime& ts_utc, bool& loopback) const
+    {
         /*
          * Flags
          */
@@ -275,6 +405,11 @@ class SocketCanIface : public uavcan::ICanIface
     void pollWrite()
     {
         //std::cerr<<"can poll write in:"<<std::endl;
+        if (!tx_msgs_.empty())
+        {
+            pollWriteBatched();
+            return;
+        }
         while (hasReadyTx())
         {
             const TxItem tx = tx_queue_.top();
@@ -309,9 +444,95 @@ class SocketCanIface : public uavcan::ICanIface
         }
     }
 
+    /**
+     * Sends as many frames as possible with one sendmmsg() call per batch.
+     */
+    void pollWriteBatched()
+    {
+        while (hasReadyTx())
+        {
+            // Collecting the highest priority frames, the socket TX queue limit is not applied; see the class comment
+            const unsigned capacity = unsigned(tx_msgs_.size());
+            const auto ts_mono = clock_.getMonotonic();
+            tx_batch_.clear();
+            while (!tx_queue_.empty() && (tx_batch_.size() < capacity))
+            {
+                const TxItem tx = tx_queue_.top();
+                tx_queue_.pop();
+                if (tx.deadline >= ts_mono)
+                {
+                    tx_frames_[tx_batch_.size()] = makeSocketCanFrame(tx.frame);
+                    tx_iovs_[tx_batch_.size()].iov_len = getMtu(tx.frame);
+                    tx_batch_.push_back(tx);
+                }
+                else
+                {
+                    registerError(SocketCanError::TxTimeout);
+                }
+            }
+            if (tx_batch_.empty())
+            {
+                break;
+            }
+
+            errno = 0;
+            const int res = ::sendmmsg(fd_, tx_msgs_.data(), tx_batch_.size(), MSG_DONTWAIT);
+            const unsigned num_sent = (res > 0) ? unsigned(res) : 0U;
+
+            for (unsigned i = 0; i < num_sent; i++)
+            {
+                incrementNumFramesInSocketTxQueue();
+                if (tx_batch_[i].flags & uavcan::CanIOFlagLoopback)
+                {
+                    (void)pending_loopback_ids_.insert(tx_batch_[i].frame.id);
+                }
+            }
+
+            // The first unsent frame is dropped on error, the same way as in pollWrite()
+            const bool failed = (res < 0) && (errno != ENOBUFS) && (errno != EAGAIN);
+            if (failed)
+            {
+                registerError(SocketCanError::SocketWriteFailure);
+            }
+            for (unsigned i = num_sent + (failed ? 1U : 0U); i < tx_batch_.size(); i++)
+            {
+                tx_queue_.push(tx_batch_[i]);   // Order numbers are retained, so the queue ordering is preserved
+            }
+            if (!failed && (num_sent < tx_batch_.size()))
+            {
+                break;                          // Socket buffer is full, the rest will be retried later
+            }
+        }
+    }
+
+    /**
+     * Updates the TX bookkeeping for a received frame and puts it into the RX queue if the library needs it.
+     */
+    void handleReceivedFrame(RxItem& rx, bool loopback)
+    {
+        assert(!rx.ts_utc.isZero());
+        bool accept = true;
+        if (loopback)                   // We receive loopback for all CAN frames
+        {
+            confirmSentFrame();
+            rx.flags |= uavcan::CanIOFlagLoopback;
+            accept = wasInPendingLoopbackSet(rx.frame); // Do we need to send this loopback into the lib?
+        }
+        if (accept)
+        {
+            rx.ts_utc += clock_.getPrivateAdjustment();
+            rx_queue_.push(rx);
+        }
+    }
+
     void pollRead()
     {
         //std::cerr<<"can poll read in:"<<std::endl;
+        if (!rx_msgs_.empty())
+        {
+            pollReadBatched();
+            return;
+        }
         while (true)
         {
             RxItem rx;
@@ -320,19 +541,7 @@ class SocketCanIface : public uavcan::ICanIface
             const int res = read(rx.frame, rx.ts_utc, loopback);
             if (res == 1)
             {
-                assert(!rx.ts_utc.isZero());
-                bool accept = true;
-                if (loopback)                   // We receive loopback for all CAN frames
-                {
-                    confirmSentFrame();
-                    rx.flags |= uavcan::CanIOFlagLoopback;
-                    accept = wasInPendingLoopbackSet(rx.frame); // Do we need to send this loopback into the lib?
-                }
-                if (accept)
-                {
-                    rx.ts_utc += clock_.getPrivateAdjustment();
-                    rx_queue_.push(rx);
-                }
+                handleReceivedFrame(rx, loopback);
             }
             else if (res == 0)
             {
@@ -347,39 +556,172 @@ class SocketCanIface : public uavcan::ICanIface
     }
 
     /**
-     * Returns true if a frame accepted by HW filters
+     * Drains the socket with recvmmsg(), one batch per syscall.
      */
-    bool checkHWFilters(const ::can_frame& frame) const
+    void pollReadBatched()
     {
-        if (!hw_filters_container_.empty())
+        while (true)
         {
-            for (auto& f : hw_filters_container_)
+            for (auto& m : rx_msgs_)
+            {
+                m.msg_hdr.msg_controllen = RxControlSize;   // Overwritten by the kernel
+                m.msg_hdr.msg_flags = 0;
+            }
+
+            const int res = ::recvmmsg(fd_, rx_msgs_.data(), rx_msgs_.size(), MSG_DONTWAIT, nullptr);
+            if (res <= 0)
+            {
+                if (res < 0 && errno != EWOULDBLOCK)
+                {
+                    registerError(SocketCanError::SocketReadFailure);
+                }
+                break;
+            }
+
+            const auto ts_mono = clock_.getMonotonic();  // Monotonic timestamp is not required to be precise
+            for (int i = 0; i < res; i++)
             {
-                if (((frame.can_id & f.can_mask) ^ f.can_id) == 0)
+                RxItem rx;
+                rx.ts_mono = ts_mono;
+                bool loopback = false;
+                const int decode_res = decodeMessage(rx_msgs_[i].msg_hdr, rx_frames_[i], rx.frame, rx.ts_utc,
+                                                     loopback);
+                if (decode_res == 1)
                 {
-                    return true;
+                    handleReceivedFrame(rx, loopback);
                 }
+                else if (decode_res < 0)
+                {
+                    registerError(SocketCanError::SocketReadFailure);
+                }
+            }
+
+            if (unsigned(res) < rx_msgs_.size())
+            {
+                break;                          // The socket is empty
             }
-            return false;
         }
-        else
+    }
+
+    /**
+     * Returns true if a frame accepted by HW filters.
+     * Only frames that passed the kernel filters get here, so they need to be checked again only if the kernel
+     * filters are wider than the configured ones.
+     */
+    bool checkHWFilters(const SocketCanFrame& frame) const
+    {
+        return !userspace_filtering_ || isAcceptedBy(hw_filters_container_, frame.can_id);
+    }
+
+    /**
+     * Installs the configured filters and the loopback filters into the socket.
+     * Falls back to user space filtering if there are too many of them or the kernel refuses them.
+     */
+    void applyKernelFilters()
+    {
+        kernel_filters_ = hw_filters_container_;
+        for (auto& f : loopback_filters_)
         {
-            return true;
+            if (!isCoveredBy(hw_filters_container_, f))
+            {
+                kernel_filters_.push_back(f);
+            }
+        }
+
+        if (!hw_filters_container_.empty() && (kernel_filters_.size() <= MaxKernelFilters))
+        {
+            const int res = ::setsockopt(fd_, SOL_CAN_RAW, CAN_RAW_FILTER, kernel_filters_.data(),
+                                         ::socklen_t(kernel_filters_.size() * sizeof(::can_filter)));
+            if (res == 0)
+            {
+                // Foreign frames that match only the loopback filters have to be dropped in user space
+                userspace_filtering_ = kernel_filters_.size() > hw_filters_container_.size();
+                return;
+            }
+            UAVCAN_TRACE("SocketCAN", "CAN_RAW_FILTER failed on fd %d, errno %d", fd_, errno);
+        }
+
+        kernel_filters_.clear();
+        const auto accept_all = ::can_filter();
+        (void)::setsockopt(fd_, SOL_CAN_RAW, CAN_RAW_FILTER, &accept_all, sizeof(accept_all));
+        userspace_filtering_ = !hw_filters_container_.empty();
+    }
+
+    /**
+     * Makes sure that the loopback of the frame will pass the kernel filters.
+     * The loopback filters are kept even while the socket accepts everything, so that the loopback of a frame
+     * that is still in flight passes the filters that may be configured later.
+     */
+    void admitLoopback(const uavcan::CanFrame& frame)
+    {
+        const ::canid_t can_id = makeSocketCanId(frame);
+        if (isAcceptedBy(loopback_filters_, can_id))
+        {
+            return;
+        }
+        loopback_filters_.push_back(makeLoopbackFilter(can_id));
+        if (isKernelFilteringActive() && !isAcceptedBy(kernel_filters_, can_id))
+        {
+            applyKernelFilters();
         }
     }
 
 public:
+    static constexpr unsigned DefaultMaxFramesInSocketTxQueue = 2;
+    static constexpr unsigned DefaultIoBatchSize = 32;
+
+    /**
+     * Max number of CAN_RAW_FILTER entries accepted by the kernel; larger filter sets are checked in user space.
+     */
+#ifdef CAN_RAW_FILTER_MAX
+    static constexpr unsigned MaxKernelFilters = CAN_RAW_FILTER_MAX;
+#else
+    static constexpr unsigned MaxKernelFilters = 512;
+#endif
+
     /**
      * Takes ownership of socket's file descriptor.
      *
      * @ref max_frames_in_socket_tx_queue       See a note in the class comment.
+     * @ref io_batch_size                       Max number of frames per recvmmsg()/sendmmsg() call;
+     *                                          1 selects the plain recvmsg()/write() IO.
      */
-    SocketCanIface(const SystemClock& clock, int socket_fd, int max_frames_in_socket_tx_queue = 2)
+    SocketCanIface(const SystemClock& clock, int socket_fd,
+                   int max_frames_in_socket_tx_queue = DefaultMaxFramesInSocketTxQueue,
+                   unsigned io_batch_size = DefaultIoBatchSize)
         : clock_(clock)
         , fd_(socket_fd)
         , max_frames_in_socket_tx_queue_(max_frames_in_socket_tx_queue)
     {
         assert(fd_ >= 0);
+        if (io_batch_size > 1)
+        {
+            rx_msgs_.resize(io_batch_size, ::mmsghdr());
+            rx_iovs_.resize(io_batch_size, ::iovec());
+            rx_frames_.resize(io_batch_size, SocketCanFrame());
+            rx_controls_.resize(io_batch_size);
+            for (unsigned i = 0; i < io_batch_size; i++)
+            {
+                rx_iovs_[i].iov_base = &rx_frames_[i];
+                rx_iovs_[i].iov_len  = sizeof(SocketCanFrame);
+                rx_msgs_[i].msg_hdr.msg_iov        = &rx_iovs_[i];
+                rx_msgs_[i].msg_hdr.msg_iovlen     = 1;
+                rx_msgs_[i].msg_hdr.msg_control    = &rx_controls_[i];
+                rx_msgs_[i].msg_hdr.msg_controllen = RxControlSize;
+            }
+
+            tx_msgs_.resize(io_batch_size, ::mmsghdr());
+            tx_iovs_.resize(io_batch_size, ::iovec());
+            tx_frames_.resize(io_batch_size, SocketCanFrame());
+            tx_batch_.reserve(io_batch_size);
+            for (unsigned i = 0; i < io_batch_size; i++)
+            {
+                tx_iovs_[i].iov_base = &tx_frames_[i];
+                tx_iovs_[i].iov_len  = CAN_MTU;     // Set per frame
+                tx_msgs_[i].msg_hdr.msg_iov    = &tx_iovs_[i];
+                tx_msgs_[i].msg_hdr.msg_iovlen = 1;
+            }
+        }
     }
 
     /**
@@ -398,6 +740,7 @@ public:
                       const uavcan::CanIOFlags flags) override
     {
         //std::cerr<<"can send in:"<<std::endl;
+        admitLoopback(frame);
         tx_queue_.emplace(frame, tx_deadline, flags, tx_frame_counter_);
         tx_frame_counter_++;
         pollRead();     // Read poll is necessary because it can release the pending TX flag
@@ -432,6 +775,30 @@ public:
         return 1;
     }
 
+    /**
+     * Same as receive(), but hands over up to max_items frames from the RX queue at once.
+     */
+    std::int16_t receiveBatch(uavcan::CanRxBatchItem* out_items, std::uint16_t max_items) override
+    {
+        if (rx_queue_.empty())
+        {
+            pollRead();
+        }
+        std::int16_t num_received = 0;
+        while ((std::uint16_t(num_received) < max_items) && !rx_queue_.empty())
+        {
+            const RxItem& rx = rx_queue_.front();
+            uavcan::CanRxBatchItem& item = out_items[num_received];
+            item.frame        = rx.frame;
+            item.ts_monotonic = rx.ts_mono;
+            item.ts_utc       = rx.ts_utc;
+            item.flags        = rx.flags;
+            rx_queue_.pop();
+            num_received++;
+        }
+        return num_received;
+    }
+
     /**
      * Performs socket read/write.
      * @param read  Socket is readable
@@ -489,12 +856,18 @@ public:
             }
         }
 
+        applyKernelFilters();
         return 0;
     }
 
     /**
-     * SocketCAN emulates the CAN filters in software, so the number of filters is virtually unlimited.
-     * This method returns a constant value.
+     * Whether the configured filters are applied by the kernel rather than in user space.
+     */
+    bool isKernelFilteringActive() const { return !kernel_filters_.empty(); }
+
+    /**
+     * SocketCAN emulates the CAN filters in software in the kernel, so the number of filters is virtually
+     * unlimited (up to @ref MaxKernelFilters). This method returns a constant value.
      */
     static constexpr unsigned NumFilters = 8;
     std::uint16_t getNumFilters() const override { return NumFilters; }
@@ -588,6 +961,18 @@ public:
             {
                 return -1;
             }
+#if UAVCAN_CAN_FD
+            // CAN FD frames; the library produces them, so the iface must be able to send them
+            if (::setsockopt(s, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &on, sizeof(on)) < 0)
+            {
+                return -1;
+            }
+            if ((::ioctl(s, SIOCGIFMTU, &ifr) < 0) || (ifr.ifr_mtu != CANFD_MTU))
+            {
+                errno = EPROTONOSUPPORT;
+                return -1;
+            }
+#endif
             // Non-blocking
             if (::fcntl(s, F_SETFL, O_NONBLOCK) < 0)
             {
@@ -614,7 +999,7 @@ public:
 
 /**
  * Multiplexing container for multiple SocketCAN sockets.
- * Uses ppoll() for multiplexing.
+ * Uses ppoll() for multiplexing; see @ref EpollSocketCanDriver for the epoll() based alternative.
  *
  * When an interface becomes down/disconnected while the node is running,
  * the driver will silently exclude it from the IO loop and continue to run on the remaining interfaces.
@@ -624,12 +1009,15 @@ public:
  */
 class SocketCanDriver : public uavcan::ICanDriver
 {
+protected:
     class IfaceWrapper : public SocketCanIface
     {
         bool down_ = false;
 
     public:
-        IfaceWrapper(const SystemClock& clock, int fd) : SocketCanIface(clock, fd) { }
+        IfaceWrapper(const SystemClock& clock, int fd, unsigned io_batch_size)
+            : SocketCanIface(clock, fd, DefaultMaxFramesInSocketTxQueue, io_batch_size)
+        { }
 
         void updateDownStatusFromPollResult(const ::pollfd& pfd)
         {
@@ -650,14 +1038,95 @@ class SocketCanDriver : public uavcan::ICanDriver
     };
 
     const SystemClock& clock_;
+    const unsigned io_batch_size_;
     std::vector<std::unique_ptr<IfaceWrapper>> ifaces_;
 
+    /**
+     * Whether the iface should be polled for writability.
+     */
+    bool needToPollWrite(unsigned iface_index, const uavcan::CanSelectMasks& masks) const
+    {
+        return ifaces_[iface_index]->hasReadyTx() || (masks.write & (1U << iface_index));
+    }
+
+    /**
+     * Blocks until the deadline or until any of the ifaces becomes available for IO, then performs the IO.
+     * Returns negative on error.
+     */
+    virtual int waitAndPoll(const uavcan::CanSelectMasks& masks, uavcan::MonotonicTime blocking_deadline)
+    {
+        // Poll FD set setup
+        ::pollfd pollfds[uavcan::MaxCanIfaces] = {};
+        unsigned num_pollfds = 0;
+        IfaceWrapper* pollfd_index_to_iface[uavcan::MaxCanIfaces] = { };
+
+        for (unsigned i = 0; i < ifaces_.size(); i++)
+        {
+            if (!ifaces_[i]->isDown())
+            {
+                pollfds[num_pollfds].fd = ifaces_[i]->getFileDescriptor();
+                pollfds[num_pollfds].events = POLLIN;
+                if (needToPollWrite(i, masks))
+                {
+                    pollfds[num_pollfds].events |= POLLOUT;
+                }
+                pollfd_index_to_iface[num_pollfds] = ifaces_[i].get();
+                num_pollfds++;
+            }
+        }
+
+        // This is where we abort when the last iface goes down
+        if (num_pollfds == 0)
+        {
+            throw AllIfacesDownException();
+        }
+
+        // Timeout conversion
+        const std::int64_t timeout_usec = (blocking_deadline - clock_.getMonotonic()).toUSec();
+        auto ts = ::timespec();
+        if (timeout_usec > 0)
+        {
+            ts.tv_sec = timeout_usec / 1000000LL;
+            ts.tv_nsec = (timeout_usec % 1000000LL) * 1000;
+        }
+
+        // Blocking here
+        const int res = ::ppoll(pollfds, num_pollfds, &ts, nullptr);
+        if (res < 0)
+        {
+            return res;
+        }
+
+        // Handling poll output
+        for (unsigned i = 0; i < num_pollfds; i++)
+        {
+            pollfd_index_to_iface[i]->updateDownStatusFromPollResult(pollfds[i]);
+
+            const bool poll_read  = pollfds[i].revents & POLLIN;
+            const bool poll_write = pollfds[i].revents & POLLOUT;
+            pollfd_index_to_iface[i]->poll(poll_read, poll_write);
+        }
+        return res;
+    }
+
+    /**
+     * Invoked by @ref addIface() once the new iface is constructed. Returns negative on error.
+     */
+    virtual int registerIface(unsigned iface_index)
+    {
+        (void)iface_index;
+        return 0;
+    }
+
 public:
     /**
      * Reference to the clock object shall remain valid.
+     * @ref io_batch_size   See @ref SocketCanIface.
      */
-    explicit SocketCanDriver(const SystemClock& clock)
+    explicit SocketCanDriver(const SystemClock& clock,
+                             unsigned io_batch_size = SocketCanIface::DefaultIoBatchSize)
         : clock_(clock)
+        , io_batch_size_(io_batch_size)
     {
         ifaces_.reserve(uavcan::MaxCanIfaces);
     }
@@ -685,57 +1154,11 @@ public:
 
         if (need_block)
         {
-            // Poll FD set setup
-            ::pollfd pollfds[uavcan::MaxCanIfaces] = {};
-            unsigned num_pollfds = 0;
-            IfaceWrapper* pollfd_index_to_iface[uavcan::MaxCanIfaces] = { };
-
-            for (unsigned i = 0; i < ifaces_.size(); i++)
-            {
-                if (!ifaces_[i]->isDown())
-                {
-                    pollfds[num_pollfds].fd = ifaces_[i]->getFileDescriptor();
-                    pollfds[num_pollfds].events = POLLIN;
-                    if (ifaces_[i]->hasReadyTx() || (inout_masks.write & (1U << i)))
-                    {
-                        pollfds[num_pollfds].events |= POLLOUT;
-                    }
-                    pollfd_index_to_iface[num_pollfds] = ifaces_[i].get();
-                    num_pollfds++;
-                }
-            }
-
-            // This is where we abort when the last iface goes down
-            if (num_pollfds == 0)
-            {
-                throw AllIfacesDownException();
-            }
-
-            // Timeout conversion
-            const std::int64_t timeout_usec = (blocking_deadline - clock_.getMonotonic()).toUSec();
-            auto ts = ::timespec();
-            if (timeout_usec > 0)
-            {
-                ts.tv_sec = timeout_usec / 1000000LL;
-                ts.tv_nsec = (timeout_usec % 1000000LL) * 1000;
-            }
-
-            // Blocking here
-            const int res = ::ppoll(pollfds, num_pollfds, &ts, nullptr);
+            const int res = waitAndPoll(inout_masks, blocking_deadline);
             if (res < 0)
             {
                 return res;
             }
-
-            // Handling poll output
-            for (unsigned i = 0; i < num_pollfds; i++)
-            {
-                pollfd_index_to_iface[i]->updateDownStatusFromPollResult(pollfds[i]);
-
-                const bool poll_read  = pollfds[i].revents & POLLIN;
-                const bool poll_write = pollfds[i].revents & POLLOUT;
-                pollfd_index_to_iface[i]->poll(poll_read, poll_write);
-            }
         }
 
         // Writing the output masks
@@ -786,7 +1209,7 @@ public:
         // Construct the iface - upon successful construction the iface will take ownership of the fd.
         try
         {
-            ifaces_.emplace_back(new IfaceWrapper(clock_, fd));
+            ifaces_.emplace_back(new IfaceWrapper(clock_, fd, io_batch_size_));
         }
         catch (...)
         {
@@ -794,6 +1217,13 @@ public:
             throw;
         }
 
+        const int reg_res = registerIface(ifaces_.size() - 1);
+        if (reg_res < 0)
+        {
+            ifaces_.pop_back();         // Closes the fd
+            return reg_res;
+        }
+
         UAVCAN_TRACE("SocketCAN", "New iface '%s' fd %d", iface_name.c_str(), fd);
 
         return ifaces_.size() - 1;
@@ -808,4 +1238,181 @@ public:
     }
 };
 
+/**
+ * SocketCAN driver that uses epoll() for multiplexing.
+ *
+ * Unlike @ref SocketCanDriver, the sockets stay registered with the epoll instance for the whole lifetime of the
+ * driver, so that select() only has to update the write interest when it changes.
+ *
+ * The driver also owns an eventfd which is monitored together with the sockets. Any thread can call
+ * @ref wakeup() to make a blocking select() return immediately and report the wakeup to the library, so that
+ * Node::spin() returns too, e.g. after putting new frames into a queue that is drained by the thread that spins
+ * the node. Note that the rest of the driver is not thread safe.
+ *
+ * Timeouts are rounded up to whole milliseconds, as required by epoll_wait().
+ */
+class EpollSocketCanDriver : public SocketCanDriver
+{
+    static constexpr std::uint32_t WakeupEventToken = 0xFFFFFFFFU;
+
+    int epoll_fd_ = -1;
+    int event_fd_ = -1;
+    bool wakeup_received_ = false;
+    std::uint32_t registered_events_[uavcan::MaxCanIfaces] = {};
+
+    int updateRegistration(unsigned iface_index, std::uint32_t events)
+    {
+        if (registered_events_[iface_index] == events)
+        {
+            return 0;
+        }
+        auto ev = ::epoll_event();
+        ev.events = events;
+        ev.data.u32 = iface_index;
+        const int op = (events == 0) ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+        const int res = ::epoll_ctl(epoll_fd_, op, ifaces_[iface_index]->getFileDescriptor(), &ev);
+        if (res >= 0)
+        {
+            registered_events_[iface_index] = events;
+        }
+        return res;
+    }
+
+    int registerIface(unsigned iface_index) override
+    {
+        auto ev = ::epoll_event();
+        ev.events = EPOLLIN;
+        ev.data.u32 = iface_index;
+        const int res = ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, ifaces_[iface_index]->getFileDescriptor(), &ev);
+        registered_events_[iface_index] = (res < 0) ? 0 : ev.events;
+        return res;
+    }
+
+    int waitAndPoll(const uavcan::CanSelectMasks& masks, uavcan::MonotonicTime blocking_deadline) override
+    {
+        // Updating the write interest; the dead ifaces are removed from the set
+        unsigned num_alive = 0;
+        for (unsigned i = 0; i < ifaces_.size(); i++)
+        {
+            std::uint32_t events = 0;
+            if (!ifaces_[i]->isDown())
+            {
+                num_alive++;
+                events = EPOLLIN | (needToPollWrite(i, masks) ? std::uint32_t(EPOLLOUT) : 0U);
+            }
+            if (updateRegistration(i, events) < 0)
+            {
+                return -1;
+            }
+        }
+
+        // This is where we abort when the last iface goes down
+        if (num_alive == 0)
+        {
+            throw AllIfacesDownException();
+        }
+
+        // Timeout conversion
+        const std::int64_t timeout_usec = (blocking_deadline - clock_.getMonotonic()).toUSec();
+        const int timeout_msec = (timeout_usec > 0) ? int((timeout_usec + 999) / 1000) : 0;
+
+        // Blocking here
+        ::epoll_event events[uavcan::MaxCanIfaces + 1];
+        const int res = ::epoll_wait(epoll_fd_, events, uavcan::MaxCanIfaces + 1, timeout_msec);
+        if (res < 0)
+        {
+            return res;
+        }
+
+        // Handling poll output
+        for (int i = 0; i < res; i++)
+        {
+            if (events[i].data.u32 == WakeupEventToken)
+            {
+                std::uint64_t counter = 0;
+                (void)::read(event_fd_, &counter, sizeof(counter));    // Resetting the counter
+                wakeup_received_ = true;
+                continue;
+            }
+
+            IfaceWrapper& iface = *ifaces_.at(events[i].data.u32);
+
+            auto pfd = ::pollfd();
+            pfd.fd = iface.getFileDescriptor();
+            pfd.revents = short(((events[i].events & EPOLLERR) ? POLLERR : 0) |
+                                ((events[i].events & EPOLLIN)  ? POLLIN  : 0) |
+                                ((events[i].events & EPOLLOUT) ? POLLOUT : 0));
+            iface.updateDownStatusFromPollResult(pfd);
+            iface.poll(pfd.revents & POLLIN, pfd.revents & POLLOUT);
+        }
+        return res;
+    }
+
+public:
+    /**
+     * @throws uavcan_linux::Exception if the epoll instance or the eventfd could not be created.
+     */
+    explicit EpollSocketCanDriver(const SystemClock& clock,
+                                  unsigned io_batch_size = SocketCanIface::DefaultIoBatchSize)
+        : SocketCanDriver(clock, io_batch_size)
+    {
+        epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0)
+        {
+            throw Exception("Failed to create epoll instance");
+        }
+
+        event_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (event_fd_ < 0)
+        {
+            const int error = errno;
+            (void)::close(epoll_fd_);
+            throw Exception("Failed to create eventfd", error);
+        }
+
+        auto ev = ::epoll_event();
+        ev.events = EPOLLIN;
+        ev.data.u32 = WakeupEventToken;
+        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &ev) < 0)
+        {
+            const int error = errno;
+            (void)::close(event_fd_);
+            (void)::close(epoll_fd_);
+            throw Exception("Failed to register eventfd", error);
+        }
+    }
+
+    ~EpollSocketCanDriver() override
+    {
+        (void)::close(event_fd_);
+        (void)::close(epoll_fd_);
+    }
+
+    std::int16_t select(uavcan::CanSelectMasks& inout_masks,
+                        const uavcan::CanFrame* (&pending_tx)[uavcan::MaxCanIfaces],
+                        uavcan::MonotonicTime blocking_deadline) override
+    {
+        const std::int16_t res = SocketCanDriver::select(inout_masks, pending_tx, blocking_deadline);
+        inout_masks.wakeup = wakeup_received_;
+        wakeup_received_ = false;
+        return res;
+    }
+
+    /**
+     * Makes the current or the next blocking select() call return immediately, which in turn makes the
+     * current or the next Node::spin() call return.
+     * This method is thread safe and async-signal safe.
+     */
+    void wakeup() const
+    {
+        const std::uint64_t one = 1;
+        (void)::write(event_fd_, &one, sizeof(one));
+    }
+
+    /**
+     * The eventfd used by @ref wakeup(). Writing a non-zero 8-byte counter into it has the same effect.
+     */
+    int getWakeupFileDescriptor() const { return event_fd_; }
+};
+
 }
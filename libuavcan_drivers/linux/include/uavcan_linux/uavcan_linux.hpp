@@ -10,3 +10,4 @@
 #include <uavcan_linux/socketcan.hpp>
 #include <uavcan_linux/helpers.hpp>
 #include <uavcan_linux/system_utils.hpp>
+#include <uavcan_linux/pool_allocator.hpp>